@@ -96,4 +96,9 @@ void allgather(AllgatherOptions& opts) {
   }
 }
 
+std::shared_ptr<Work> iallgather(AllgatherOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](AllgatherOptions& opts) { allgather(opts); });
+}
+
 } // namespace gloo
@@ -10,6 +10,7 @@
 
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -70,4 +71,8 @@ class AllgatherOptions {
 
 void allgather(AllgatherOptions& opts);
 
+// Non-blocking variant of allgather. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> iallgather(AllgatherOptions opts);
+
 } // namespace gloo
@@ -139,4 +139,9 @@ void allgatherv(AllgathervOptions& opts) {
   out->waitRecv(opts.timeout);
 }
 
+std::shared_ptr<Work> iallgatherv(AllgathervOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](AllgathervOptions& opts) { allgatherv(opts); });
+}
+
 } // namespace gloo
@@ -10,6 +10,7 @@
 
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -91,4 +92,8 @@ class AllgathervOptions {
 
 void allgatherv(AllgathervOptions& opts);
 
+// Non-blocking variant of allgatherv. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> iallgatherv(AllgathervOptions opts);
+
 } // namespace gloo
@@ -11,8 +11,12 @@
 #include <algorithm>
 #include <array>
 #include <cstring>
+#include <map>
+#include <mutex>
 
+#include "gloo/allreduce_tuning.h"
 #include "gloo/common/logging.h"
+#include "gloo/config.h"
 #include "gloo/math.h"
 #include "gloo/types.h"
 
@@ -25,28 +29,196 @@ using ReductionFunction = AllreduceOptions::Func;
 using ReduceRangeFunction = std::function<void(size_t, size_t)>;
 using BroadcastRangeFunction = std::function<void(size_t, size_t)>;
 
+// Precomputed schedule of an allreduce algorithm. Everything that only
+// depends on the options (peers, segment offsets, scratch space) is
+// computed when the schedule is created, so that it can be run any
+// number of times (see AllreducePlan).
+//
+// A schedule is a state machine. It can run to completion on the
+// calling thread (see run), or be advanced step by step without
+// blocking on I/O, so that a scheduler can interleave its execution
+// with other operations (see AllreduceOperation).
+//
+class Schedule {
+ public:
+  explicit Schedule(const detail::AllreduceOptionsImpl& opts)
+      : opts_(opts), slot_(Slot::build(kAllreduceSlotPrefix, opts.tag)) {}
+
+  Schedule(const detail::AllreduceOptionsImpl& opts, const Slot& slot)
+      : opts_(opts), slot_(slot) {}
+
+  virtual ~Schedule() {}
+
+  // Prepares the schedule for a new execution.
+  virtual void reset() {
+    deadline_ = std::chrono::steady_clock::now() + opts_.timeout;
+  }
+
+  // Executes as much of the schedule as possible. If blocking is set,
+  // this waits for pending I/O and only returns when the execution has
+  // completed. Otherwise, it returns false when it has to wait.
+  // Returns true if the execution has completed.
+  virtual bool advance(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs,
+      bool blocking) = 0;
+
+  void run(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs) {
+    reset();
+    advance(reduceInputs, broadcastOutputs, true);
+  }
+
+  // Attaches signal to every unbound buffer this schedule waits on, so
+  // that a thread that runs it along with other schedules can sleep
+  // until any of their operations completes (see ConcurrentSchedule
+  // and Scheduler).
+  virtual void setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& /* unused */) {
+    GLOO_ENFORCE(false, "Schedule doesn't support completion signals");
+  }
+
+  // Time at which the schedule has to be advanced even if none of its
+  // operations completed. This is when the current execution times
+  // out (see reset), unless the schedule waits for something else.
+  virtual std::chrono::steady_clock::time_point getDeadline() const {
+    return deadline_;
+  }
+
+ protected:
+  const detail::AllreduceOptionsImpl& opts_;
+  const Slot slot_;
+  std::chrono::steady_clock::time_point deadline_;
+
+  // Returns true if a recv operation on the specified buffer completed.
+  bool waitRecv(transport::UnboundBuffer* buf, bool blocking) {
+    if (blocking) {
+      buf->waitRecv(opts_.timeout);
+      return true;
+    }
+    if (buf->testRecv()) {
+      return true;
+    }
+    // Past the deadline, defer to the blocking wait, so that the
+    // timeout is handled the same way as when executing blocking.
+    if (std::chrono::steady_clock::now() >= deadline_) {
+      buf->waitRecv(std::chrono::milliseconds(1));
+      return true;
+    }
+    return false;
+  }
+
+  // Returns true if a send operation on the specified buffer completed.
+  bool waitSend(transport::UnboundBuffer* buf, bool blocking) {
+    if (blocking) {
+      buf->waitSend(opts_.timeout);
+      return true;
+    }
+    if (buf->testSend()) {
+      return true;
+    }
+    if (std::chrono::steady_clock::now() >= deadline_) {
+      buf->waitSend(std::chrono::milliseconds(1));
+      return true;
+    }
+    return false;
+  }
+};
+
 // Forward declaration of ring algorithm implementation.
-void ring(
+std::unique_ptr<Schedule> createRingSchedule(
     const detail::AllreduceOptionsImpl& opts,
-    ReduceRangeFunction reduceInputs,
-    BroadcastRangeFunction broadcastOutputs);
+    size_t maxSegmentSize);
 
 // Forward declaration of bcube algorithm implementation.
-void bcube(
+std::unique_ptr<Schedule> createBcubeSchedule(
+    const detail::AllreduceOptionsImpl& opts);
+
+// Forward declaration of halving/doubling algorithm implementation.
+std::unique_ptr<Schedule> createHalvingDoublingSchedule(
+    const detail::AllreduceOptionsImpl& opts);
+
+// Forward declaration of hierarchical algorithm implementation.
+std::unique_ptr<Schedule> createHierarchicalSchedule(
+    const detail::AllreduceOptionsImpl& opts);
+
+// Forward declaration of double binary tree algorithm implementation.
+std::unique_ptr<Schedule> createDoubleBinaryTreeSchedule(
     const detail::AllreduceOptionsImpl& opts,
-    ReduceRangeFunction reduceInputs,
-    BroadcastRangeFunction broadcastOutputs);
+    size_t maxSegmentSize);
+
+// Returns true if every host runs the same number of processes.
+bool hasUniformHostLayout(const std::shared_ptr<Context>& context) {
+  std::vector<int> count(context->getNumHosts(), 0);
+  for (int i = 0; i < context->size; i++) {
+    count[context->getHost(i)]++;
+  }
+  return std::all_of(count.begin(), count.end(), [&](int n) {
+    return n == count[0];
+  });
+}
+
+// Returns the base pointers of the specified buffers.
+std::vector<const uint8_t*> getBasePointers(const BufferVector& buffers) {
+  std::vector<const uint8_t*> result(buffers.size());
+  for (size_t i = 0; i < buffers.size(); i++) {
+    result[i] = static_cast<const uint8_t*>(buffers[i]->ptr);
+  }
+  return result;
+}
+
+// Returns the specified base pointers plus a byte offset, for the N-ary
+// reduction kernels. The array is owned by the calling thread and only
+// valid until its next call. It is reused across calls, so that local
+// reductions don't allocate once it has grown to the number of inputs.
+// Local reductions can run on multiple threads at the same time (see
+// setReductionThreads), so the array can't be owned by the function.
+const void* const* offsetPointers(
+    const std::vector<const uint8_t*>& bases,
+    size_t offset) {
+  thread_local std::vector<const void*> ptrs;
+  ptrs.resize(bases.size());
+  for (size_t i = 0; i < bases.size(); i++) {
+    ptrs[i] = bases[i] + offset;
+  }
+  return ptrs.data();
+}
 
 // Returns function that computes local reduction over inputs and
 // stores it in the output for a given range in those buffers.
 // This is done prior to either sending a region to a neighbor, or
 // reducing a region received from a neighbor.
+//
+// If the reduction is a built-in one, all inputs are reduced in a
+// single pass (see getReduceKernels). Otherwise, they are reduced
+// pairwise, with a pass over the output for every input.
+//
+// For an average (see ReduceOp::AVG), the result is multiplied by the
+// specified factor. Every process scales its own contribution before
+// it is sent, so the sum across processes is the average. This is
+// also needed for a single buffer that is both input and output.
 ReduceRangeFunction genLocalReduceFunction(
     const BufferVector& in,
     const BufferVector& out,
     size_t elementSize,
-    ReductionFunction fn) {
-  if (in.size() > 0) {
+    ReductionFunction fn,
+    const ReduceKernels& kernels,
+    double factor) {
+  const auto nary = kernels.nary;
+  const auto scaledNary = kernels.scaledNary;
+  if (scaledNary != nullptr) {
+    const auto bases = getBasePointers(in.size() > 0 ? in : out);
+    return [bases, &out, elementSize, scaledNary, factor](
+               size_t offset, size_t length) {
+      scaledNary(
+          static_cast<uint8_t*>(out[0]->ptr) + offset,
+          offsetPointers(bases, offset),
+          bases.size(),
+          length / elementSize,
+          factor);
+    };
+  } else if (in.size() > 0) {
     if (in.size() == 1) {
       return [&in, &out](size_t offset, size_t length) {
         memcpy(
@@ -54,6 +226,15 @@ ReduceRangeFunction genLocalReduceFunction(
             static_cast<const uint8_t*>(in[0]->ptr) + offset,
             length);
       };
+    } else if (nary != nullptr) {
+      const auto bases = getBasePointers(in);
+      return [bases, &out, elementSize, nary](size_t offset, size_t length) {
+        nary(
+            static_cast<uint8_t*>(out[0]->ptr) + offset,
+            offsetPointers(bases, offset),
+            bases.size(),
+            length / elementSize);
+      };
     } else {
       return [&in, &out, elementSize, fn](size_t offset, size_t length) {
         fn(static_cast<uint8_t*>(out[0]->ptr) + offset,
@@ -68,6 +249,16 @@ ReduceRangeFunction genLocalReduceFunction(
         }
       };
     }
+  } else if (nary != nullptr && out.size() > 2) {
+    // The output is also the first input of the reduction.
+    const auto bases = getBasePointers(out);
+    return [bases, &out, elementSize, nary](size_t offset, size_t length) {
+      nary(
+          static_cast<uint8_t*>(out[0]->ptr) + offset,
+          offsetPointers(bases, offset),
+          bases.size(),
+          length / elementSize);
+    };
   } else {
     return [&out, elementSize, fn](size_t offset, size_t length) {
       for (size_t i = 1; i < out.size(); i++) {
@@ -94,20 +285,53 @@ BroadcastRangeFunction genLocalBroadcastFunction(const BufferVector& out) {
   };
 }
 
-void allreduce(const detail::AllreduceOptionsImpl& opts) {
-  if (opts.elements == 0) {
-    return;
-  }
-
-  const auto& context = opts.context;
-  const std::vector<std::unique_ptr<transport::UnboundBuffer>>& in = opts.in;
-  const std::vector<std::unique_ptr<transport::UnboundBuffer>>& out = opts.out;
-  const auto slot = Slot::build(kAllreduceSlotPrefix, opts.tag);
+void validate(const detail::AllreduceOptionsImpl& opts) {
+  const auto& in = opts.in;
+  const auto& out = opts.out;
 
   // Sanity checks
   GLOO_ENFORCE_GT(out.size(), 0);
   GLOO_ENFORCE(opts.elementSize > 0);
+  GLOO_ENFORCE(
+      opts.reduceOp == ReduceOp::UNSPECIFIED ||
+          opts.dataType != DataType::UNSPECIFIED,
+      "Reduce op requires buffers of a built-in data type");
   GLOO_ENFORCE(opts.reduce != nullptr);
+  GLOO_ENFORCE(
+      opts.rings >= 1 && opts.rings <= 64,
+      "Number of rings must be between 1 and 64");
+  GLOO_ENFORCE(
+      opts.pipelineDepth >= 2 && opts.pipelineDepth <= 16,
+      "Pipeline depth must be between 2 and 16");
+  if (opts.compression != DataType::UNSPECIFIED) {
+    GLOO_ENFORCE(
+        opts.compression == DataType::FLOAT16 ||
+            opts.compression == DataType::BFLOAT16 ||
+            opts.compression == DataType::INT8,
+        "Data is only compressed to float16, bfloat16, or int8");
+    GLOO_ENFORCE(
+        opts.dataType == DataType::FLOAT32,
+        "Compression requires float32 buffers");
+    GLOO_ENFORCE(
+        opts.reduceOp != ReduceOp::UNSPECIFIED,
+        "Compression requires a built-in reduction operation");
+    GLOO_ENFORCE(
+        opts.algorithm == detail::AllreduceOptionsImpl::UNSPECIFIED ||
+            opts.algorithm == detail::AllreduceOptionsImpl::RING,
+        "Compression is only supported by the ring algorithm");
+  }
+  if (opts.residual != nullptr) {
+    GLOO_ENFORCE(
+        opts.compression != DataType::UNSPECIFIED,
+        "Error feedback requires compression");
+    GLOO_ENFORCE(
+        opts.reduceOp == ReduceOp::SUM || opts.reduceOp == ReduceOp::AVG,
+        "Error feedback requires ReduceOp::SUM or ReduceOp::AVG");
+    GLOO_ENFORCE_EQ(
+        opts.residualElements,
+        opts.elements,
+        "Error feedback buffer must have as many elements as the outputs");
+  }
 
   // Assert the size of all inputs and outputs is identical.
   const size_t totalBytes = opts.elements * opts.elementSize;
@@ -117,279 +341,879 @@ void allreduce(const detail::AllreduceOptionsImpl& opts) {
   for (size_t i = 0; i < in.size(); i++) {
     GLOO_ENFORCE_EQ(in[i]->size, totalBytes);
   }
+}
+
+// Returns the kernels of the built-in reduction in the options. If
+// only a reduction function is specified, they are only found if it
+// is one of the built-in reduction functions.
+ReduceKernels getReduceKernels(const detail::AllreduceOptionsImpl& opts) {
+  if (opts.reduceOp != ReduceOp::UNSPECIFIED) {
+    return getReduceKernels(opts.reduceOp, opts.dataType);
+  }
+  return findReduceKernels(opts.reduce);
+}
+
+// Returns the factor that the sum is multiplied with to compute an
+// average: one over the number of buffers across all processes. This
+// assumes that every process reduces the same number of buffers.
+double getAverageFactor(const detail::AllreduceOptionsImpl& opts) {
+  const auto buffers = opts.in.size() > 0 ? opts.in.size() : opts.out.size();
+  return 1.0 / (opts.context->size * buffers);
+}
+
+// Returns schedule for the algorithm specified in the options.
+// If no algorithm is specified, it is selected automatically (see
+// gloo/allreduce_tuning.h). Must not be called for a context of size 1.
+std::unique_ptr<Schedule> createSchedule(
+    const detail::AllreduceOptionsImpl& opts) {
+  auto algorithm = opts.algorithm;
+  auto maxSegmentSize = opts.maxSegmentSize;
+
+  // Only the ring algorithm supports compression.
+  if (algorithm == detail::AllreduceOptionsImpl::UNSPECIFIED &&
+      opts.compression != DataType::UNSPECIFIED) {
+    algorithm = detail::AllreduceOptionsImpl::RING;
+  }
+
+  if (algorithm == detail::AllreduceOptionsImpl::UNSPECIFIED) {
+    const auto& context = opts.context;
+    const auto selection = selectAllreduceAlgorithm(
+        context->size,
+        context->getNumHosts(),
+        opts.elements * opts.elementSize,
+        AllreduceLinkModel::getDefault(),
+        AllreduceTuningTable::getDefault());
+    algorithm = selection.algorithm;
+
+    // The hierarchical algorithm requires the same number of processes
+    // on every host. The selection can't know, because it is given
+    // only the number of hosts.
+    if (algorithm == detail::AllreduceOptionsImpl::HIERARCHICAL &&
+        !hasUniformHostLayout(context)) {
+      algorithm = detail::AllreduceOptionsImpl::RING;
+    }
+
+    // An explicitly specified segment size takes precedence.
+    if (maxSegmentSize == detail::AllreduceOptionsImpl::kMaxSegmentSize) {
+      maxSegmentSize = selection.maxSegmentSize;
+    }
+  }
+
+  switch (algorithm) {
+    case detail::AllreduceOptionsImpl::RING:
+      return createRingSchedule(opts, maxSegmentSize);
+    case detail::AllreduceOptionsImpl::BCUBE:
+      return createBcubeSchedule(opts);
+    case detail::AllreduceOptionsImpl::HALVING_DOUBLING:
+      return createHalvingDoublingSchedule(opts);
+    case detail::AllreduceOptionsImpl::HIERARCHICAL:
+      return createHierarchicalSchedule(opts);
+    case detail::AllreduceOptionsImpl::DOUBLE_BINARY_TREE:
+      return createDoubleBinaryTreeSchedule(opts, maxSegmentSize);
+    default:
+      GLOO_ENFORCE(false, "Algorithm not handled.");
+  }
+  return nullptr;
+}
+
+void allreduce(const detail::AllreduceOptionsImpl& opts) {
+  if (opts.elements == 0) {
+    return;
+  }
+
+  const auto& context = opts.context;
+  const std::vector<std::unique_ptr<transport::UnboundBuffer>>& in = opts.in;
+  const std::vector<std::unique_ptr<transport::UnboundBuffer>>& out = opts.out;
+  validate(opts);
 
   // Initialize local reduction and broadcast functions.
   // Note that these are a no-op if only a single output is specified
   // and is used as both input and output.
-  const auto reduceInputs =
-      genLocalReduceFunction(in, out, opts.elementSize, opts.reduce);
+  const auto reduceInputs = genLocalReduceFunction(
+      in,
+      out,
+      opts.elementSize,
+      opts.reduce,
+      getReduceKernels(opts),
+      getAverageFactor(opts));
   const auto broadcastOutputs = genLocalBroadcastFunction(out);
 
   // Simple circuit if there is only a single process.
   if (context->size == 1) {
+    const size_t totalBytes = opts.elements * opts.elementSize;
     reduceInputs(0, totalBytes);
     broadcastOutputs(0, totalBytes);
     return;
   }
 
-  switch (opts.algorithm) {
-    case detail::AllreduceOptionsImpl::UNSPECIFIED:
-    case detail::AllreduceOptionsImpl::RING:
-      ring(opts, reduceInputs, broadcastOutputs);
-      break;
-    case detail::AllreduceOptionsImpl::BCUBE:
-      bcube(opts, reduceInputs, broadcastOutputs);
-      break;
-    default:
-      GLOO_ENFORCE(false, "Algorithm not handled.");
-  }
+  createSchedule(opts)->run(reduceInputs, broadcastOutputs);
 }
 
-void ring(
-    const detail::AllreduceOptionsImpl& opts,
-    ReduceRangeFunction reduceInputs,
-    BroadcastRangeFunction broadcastOutputs) {
-  const auto& context = opts.context;
-  const std::vector<std::unique_ptr<transport::UnboundBuffer>>& out = opts.out;
-  const auto slot = Slot::build(kAllreduceSlotPrefix, opts.tag);
-  const size_t totalBytes = opts.elements * opts.elementSize;
+// Returns the pool of the specified number of threads that executes
+// local reductions for the ring algorithm (see setReductionThreads).
+// Pools are shared by all operations in the process. They are leaked
+// on purpose, like the default progress engine.
+ProgressEngine& getReductionEngine(size_t threads) {
+  static std::mutex mutex;
+  static std::map<size_t, ProgressEngine*> engines;
+  std::lock_guard<std::mutex> guard(mutex);
+  auto& engine = engines[threads];
+  if (engine == nullptr) {
+    engine = new ProgressEngine(threads);
+  }
+  return *engine;
+}
 
-  // Note: context->size > 1
-  const auto recvRank = (context->size + context->rank + 1) % context->size;
-  const auto sendRank = (context->size + context->rank - 1) % context->size;
-  GLOO_ENFORCE(
-      context->getPair(recvRank),
-      "missing connection between rank " + std::to_string(context->rank) +
-          " (this process) and rank " + std::to_string(recvRank));
-  GLOO_ENFORCE(
-      context->getPair(sendRank),
-      "missing connection between rank " + std::to_string(context->rank) +
-          " (this process) and rank " + std::to_string(sendRank));
+// Returns the order of processes in a ring where every process is
+// followed by the process that is stride ranks away. The stride must be
+// coprime with the number of processes for the ring to include all of
+// them. If reverse is set, the order is reversed.
+std::vector<int> computeRingOrder(int size, int stride, bool reverse) {
+  std::vector<int> order(size);
+  for (int i = 0; i < size; i++) {
+    order[i] = (i * stride) % size;
+  }
+  if (reverse) {
+    std::reverse(order.begin(), order.end());
+  }
+  return order;
+}
 
-  // The ring algorithm works as follows.
-  //
-  // The given input is split into a number of chunks equal to the
-  // number of processes. Once the algorithm has finished, every
-  // process hosts one chunk of reduced output, in sequential order
-  // (rank 0 has chunk 0, rank 1 has chunk 1, etc.). As the input may
-  // not be divisible by the number of processes, the chunk on the
-  // final ranks may have partial output or may be empty.
-  //
-  // As a chunk is passed along the ring and contains the reduction of
-  // successively more ranks, we have to alternate between performing
-  // I/O for that chunk and computing the reduction between the
-  // received chunk and the local chunk. To avoid this alternating
-  // pattern, we split up a chunk into multiple segments (>= 2), and
-  // ensure we have one segment in flight while computing a reduction
-  // on the other. The segment size has an upper bound to minimize
-  // memory usage and avoid poor cache behavior. This means we may
-  // have many segments per chunk when dealing with very large inputs.
-  //
-  // The nomenclature here is reflected in the variable naming below
-  // (one chunk per rank and many segments per chunk).
+class RingSchedule : public Schedule {
+ public:
+  // Runs the ring algorithm on the region of the buffer at the
+  // specified byte offset and length, passing data along the specified
+  // order of processes. Every process sends to the process before it
+  // and receives from the process after it in this order.
   //
+  // All I/O is done through the specified unbound buffer, which must
+  // point to the same memory as out[0]. Concurrent rings must use
+  // different unbound buffers, so that they don't observe completion
+  // of each other's send and recv operations.
+  RingSchedule(
+      const detail::AllreduceOptionsImpl& opts,
+      size_t maxSegmentSize,
+      const Slot& slot,
+      const std::vector<int>& order,
+      transport::UnboundBuffer* buf,
+      size_t offset,
+      size_t totalBytes)
+      : Schedule(opts, slot), buf_(buf) {
+    const auto& context = opts.context;
+
+    // Position of this process in the ring.
+    // Note: context->size > 1
+    const int position =
+        std::find(order.begin(), order.end(), context->rank) - order.begin();
+    GLOO_ENFORCE_LT(position, context->size);
+    recvRank_ = order[(context->size + position + 1) % context->size];
+    sendRank_ = order[(context->size + position - 1) % context->size];
+    GLOO_ENFORCE(
+        context->getPair(recvRank_),
+        "missing connection between rank " + std::to_string(context->rank) +
+            " (this process) and rank " + std::to_string(recvRank_));
+    GLOO_ENFORCE(
+        context->getPair(sendRank_),
+        "missing connection between rank " + std::to_string(context->rank) +
+            " (this process) and rank " + std::to_string(sendRank_));
+
+    // The ring algorithm works as follows.
+    //
+    // The given input is split into a number of chunks equal to the
+    // number of processes. Once the algorithm has finished, every
+    // process hosts one chunk of reduced output, in sequential order
+    // (rank 0 has chunk 0, rank 1 has chunk 1, etc.). As the input may
+    // not be divisible by the number of processes, the chunk on the
+    // final ranks may have partial output or may be empty.
+    //
+    // As a chunk is passed along the ring and contains the reduction of
+    // successively more ranks, we have to alternate between performing
+    // I/O for that chunk and computing the reduction between the
+    // received chunk and the local chunk. To avoid this alternating
+    // pattern, we split up a chunk into multiple segments (>= 2), and
+    // ensure we have one segment in flight while computing a reduction
+    // on the other. The segment size has an upper bound to minimize
+    // memory usage and avoid poor cache behavior. This means we may
+    // have many segments per chunk when dealing with very large inputs.
+    //
+    // The nomenclature here is reflected in the variable naming below
+    // (one chunk per rank and many segments per chunk).
+    //
+
+    // Ensure that maximum segment size is a multiple of the element size.
+    // Otherwise, the segment size can exceed the maximum segment size after
+    // rounding it up to the nearest multiple of the element size.
+    // For example, if maxSegmentSize = 10, and elementSize = 4,
+    // then after rounding up: segmentSize = 12;
+    const size_t maxSegmentBytes = opts.elementSize *
+        std::max((size_t)1, maxSegmentSize / opts.elementSize);
+
+    // Compute how many segments make up the input buffer.
+    //
+    // Round up to the nearest multiple of the context size such that
+    // there is an equal number of segments per process and execution is
+    // symmetric across processes.
+    //
+    // The minimum is the pipeline depth times the context size, because
+    // the algorithm below overlaps sending/receiving segments with
+    // computing the reduction of other segments. A segment that is
+    // received in one iteration is forwarded numSegmentsPerRank
+    // iterations later, which must not be before its reduction was
+    // started (see advance).
+    //
+    const size_t depth = opts.pipelineDepth;
+    const size_t numSegments = roundUp(
+        std::max(
+            (totalBytes + (maxSegmentBytes - 1)) / maxSegmentBytes,
+            (size_t)context->size * depth),
+        (size_t)context->size);
+    GLOO_ENFORCE_EQ(numSegments % context->size, 0);
+    GLOO_ENFORCE_GE(numSegments, context->size * depth);
+    const size_t numSegmentsPerRank = numSegments / context->size;
+
+    // With compression, segments are sent from and received into a
+    // copy of this region in the narrower format, which is kept up to
+    // date by the reductions (see setCompression). Segments must start
+    // at a block boundary of the narrower format.
+    if (opts.compression != DataType::UNSPECIFIED) {
+      compressed_ =
+          getCompressedReduceKernels(opts.reduceOp, opts.compression);
+      offset_ = offset;
+    }
+    const size_t segmentBytes = roundUp(
+        (totalBytes + numSegments - 1) / numSegments,
+        opts.elementSize * compressed_.blockSize);
 
-  // Ensure that maximum segment size is a multiple of the element size.
-  // Otherwise, the segment size can exceed the maximum segment size after
-  // rounding it up to the nearest multiple of the element size.
-  // For example, if maxSegmentSize = 10, and elementSize = 4,
-  // then after rounding up: segmentSize = 12;
-  const size_t maxSegmentBytes = opts.elementSize *
-      std::max((size_t)1, opts.maxSegmentSize / opts.elementSize);
+    numSegments_ = numSegments;
+    numSegmentsPerRank_ = numSegmentsPerRank;
+    depth_ = depth;
+    segmentBytes_ = segmentBytes;
 
-  // Compute how many segments make up the input buffer.
-  //
-  // Round up to the nearest multiple of the context size such that
-  // there is an equal number of segments per process and execution is
-  // symmetric across processes.
-  //
-  // The minimum is twice the context size, because the algorithm
-  // below overlaps sending/receiving a segment with computing the
-  // reduction of the another segment.
-  //
-  const size_t numSegments = roundUp(
-      std::max(
-          (totalBytes + (maxSegmentBytes - 1)) / maxSegmentBytes,
-          (size_t)context->size * 2),
-      (size_t)context->size);
-  GLOO_ENFORCE_EQ(numSegments % context->size, 0);
-  GLOO_ENFORCE_GE(numSegments, context->size * 2);
-  const size_t numSegmentsPerRank = numSegments / context->size;
-  const size_t segmentBytes =
-      roundUp((totalBytes + numSegments - 1) / numSegments, opts.elementSize);
-
-  // Allocate scratch space to hold two chunks
-  std::unique_ptr<uint8_t[]> tmpAllocation(new uint8_t[segmentBytes * 2]);
-  std::unique_ptr<transport::UnboundBuffer> tmpBuffer =
-      context->createUnboundBuffer(tmpAllocation.get(), segmentBytes * 2);
-  transport::UnboundBuffer* tmp = tmpBuffer.get();
-
-  // Use dynamic lookup for chunk offset in the temporary buffer.
-  // With two operations in flight we need two offsets.
-  // They can be indexed using the loop counter.
-  std::array<size_t, 2> segmentOffset;
-  segmentOffset[0] = 0;
-  segmentOffset[1] = segmentBytes;
-
-  // Function computes the offsets and lengths of the segments to be
-  // sent and received for a given iteration during reduce/scatter.
-  auto computeReduceScatterOffsets = [&](size_t i) {
-    struct {
-      size_t sendOffset;
-      size_t recvOffset;
-      ssize_t sendLength;
-      ssize_t recvLength;
-    } result;
-
-    // Compute segment index to send from (to rank - 1) and segment
-    // index to receive into (from rank + 1). Multiply by the number
-    // of bytes in a chunk to get to an offset. The offset is allowed
-    // to be out of range (>= totalBytes) and this is taken into
-    // account when computing the associated length.
-    result.sendOffset =
-        ((((context->rank + 1) * numSegmentsPerRank) + i) * segmentBytes) %
-        (numSegments * segmentBytes);
-    result.recvOffset =
-        ((((context->rank + 2) * numSegmentsPerRank) + i) * segmentBytes) %
-        (numSegments * segmentBytes);
-
-    // If the segment is entirely in range, the following statement is
-    // equal to segmentBytes. If it isn't, it will be less, or even
-    // negative. This is why the ssize_t typecasts are needed.
-    result.sendLength = std::min(
-        (ssize_t)segmentBytes,
-        (ssize_t)totalBytes - (ssize_t)result.sendOffset);
-    result.recvLength = std::min(
-        (ssize_t)segmentBytes,
-        (ssize_t)totalBytes - (ssize_t)result.recvOffset);
-
-    return result;
+    if (compressed_.reduce != nullptr) {
+      copy_ = context->getScratchPool().acquire(getWireBytes(totalBytes));
+    }
+
+    // Borrow scratch space to hold one segment per pipeline stage.
+    scratch_ =
+        context->getScratchPool().acquire(getWireBytes(segmentBytes) * depth);
+
+    // Reductions are executed by a pool of worker threads if configured.
+    if (opts.reductionThreads > 0) {
+      engine_ = &getReductionEngine(opts.reductionThreads);
+    }
+
+    // Compute offsets and lengths of the segments to be sent and
+    // received for every iteration of both phases.
+    auto computeSegment = [&](size_t sendIndex, size_t recvIndex) {
+      Segment result;
+      result.sendOffset =
+          (sendIndex * segmentBytes) % (numSegments * segmentBytes);
+      result.recvOffset =
+          (recvIndex * segmentBytes) % (numSegments * segmentBytes);
+
+      // If the segment is entirely in range, the following statement is
+      // equal to segmentBytes. If it isn't, it will be less, or even
+      // negative. This is why the ssize_t typecasts are needed.
+      result.sendLength = std::min(
+          (ssize_t)segmentBytes,
+          (ssize_t)totalBytes - (ssize_t)result.sendOffset);
+      result.recvLength = std::min(
+          (ssize_t)segmentBytes,
+          (ssize_t)totalBytes - (ssize_t)result.recvOffset);
+
+      // Offsets are relative to the region this ring operates on.
+      result.sendOffset += offset;
+      result.recvOffset += offset;
+      return result;
+    };
+
+    const size_t numIterations = numSegments - numSegmentsPerRank;
+    tasks_.resize(numIterations);
+    reduceScatterSegments_.reserve(numIterations);
+    allgatherSegments_.reserve(numIterations);
+    for (size_t i = 0; i < numIterations; i++) {
+      // During reduce/scatter, send segment to rank - 1 and receive
+      // segment from rank + 1. The offset is allowed to be out of
+      // range (>= totalBytes) and this is taken into account when
+      // computing the associated length.
+      reduceScatterSegments_.push_back(computeSegment(
+          ((position + 1) * numSegmentsPerRank) + i,
+          ((position + 2) * numSegmentsPerRank) + i));
+      allgatherSegments_.push_back(computeSegment(
+          ((position) * numSegmentsPerRank) + i,
+          ((position + 1) * numSegmentsPerRank) + i));
+    }
+  }
+
+  ~RingSchedule() override {
+    drain();
+  }
+
+  void reset() override {
+    Schedule::reset();
+    drain();
+    phase_ = kReduceScatter;
+    iteration_ = 0;
+    step_ = 0;
+  }
+
+  void setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& signal) override {
+    buf_->setCompletionSignal(signal);
+    scratch_.getUnboundBuffer()->setCompletionSignal(signal);
+    if (copy_) {
+      copy_.getUnboundBuffer()->setCompletionSignal(signal);
+    }
+  }
+
+  // Local reductions on the reduction pool don't notify the completion
+  // signal, so the schedule has to be advanced again right away while
+  // any of them is running.
+  std::chrono::steady_clock::time_point getDeadline() const override {
+    for (const auto& task : tasks_) {
+      if (task && !task->test()) {
+        return std::chrono::steady_clock::now();
+      }
+    }
+    return Schedule::getDeadline();
+  }
+
+  bool advance(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs,
+      bool blocking) override {
+    const auto& opts = opts_;
+    const auto& out = opts.out;
+    const auto slot = slot_;
+    const auto recvRank = recvRank_;
+    const auto sendRank = sendRank_;
+    const auto numSegmentsPerRank = numSegmentsPerRank_;
+    const auto numIterations = numSegments_ - numSegmentsPerRank_;
+    const auto depth = depth_;
+    const auto slotBytes = getWireBytes(segmentBytes_);
+    transport::UnboundBuffer* tmp = scratch_.getUnboundBuffer();
+
+    // Buffer that segments are sent from and, in the allgather phase,
+    // received into. This is the compressed copy if there is one.
+    const auto compressed = compressed_;
+    transport::UnboundBuffer* wire =
+        compressed.reduce != nullptr ? copy_.getUnboundBuffer() : buf_;
+    const auto wireOffset = [this](size_t offset) {
+      return compressed_.reduce != nullptr ? getWireBytes(offset - offset_)
+                                           : offset;
+    };
+
+    // Error feedback residual of the local contribution to a segment.
+    const auto residual = [&opts](size_t offset) {
+      return opts.residual != nullptr
+          ? opts.residual + offset / opts.elementSize
+          : nullptr;
+    };
+
+    // Ring reduce/scatter.
+    //
+    // Number of iterations is computed as follows:
+    // - Take `numSegments` for the total number of segments,
+    // - Subtract `numSegmentsPerRank` because the final segments hold
+    //   the partial result and must not be forwarded in this phase.
+    // - Add `depth - 1` because we pipeline send and receive operations
+    //   (the operations issued in iteration i are waited for in
+    //   iteration i + depth - 1).
+    //
+    // Once the segment received in iteration i has arrived, it is
+    // reduced into the output. This happens on the reduction pool if
+    // there is one, while this thread continues with I/O. The
+    // reduction must complete before its scratch space is reused in
+    // iteration i + depth, and before the result is forwarded in
+    // iteration i + numSegmentsPerRank.
+    //
+    // Every iteration is split up in steps, so that execution can
+    // resume where it left off when it had to wait.
+    //
+    for (; phase_ == kReduceScatter; iteration_++, step_ = 0) {
+      const auto i = iteration_;
+      if (i == numIterations + depth - 1) {
+        for (auto& task : tasks_) {
+          if (!waitTask(task, blocking)) {
+            return false;
+          }
+        }
+        phase_ = kAllgather;
+        iteration_ = 0;
+        break;
+      }
+
+      // Issue new send and receive operation in all but the final
+      // iterations. At that point we have already sent all data we
+      // needed to and only have to wait for the final segments to be
+      // reduced into the output.
+      if (step_ == 0) {
+        if (i < numIterations) {
+          if (i >= depth && !waitTask(tasks_[i - depth], blocking)) {
+            return false;
+          }
+          if (i >= numSegmentsPerRank &&
+              !waitTask(tasks_[i - numSegmentsPerRank], blocking)) {
+            return false;
+          }
+
+          // Look up send and receive offsets and lengths for this iteration.
+          const auto& cur = reduceScatterSegments_[i];
+          if (cur.recvLength > 0) {
+            tmp->recv(
+                recvRank,
+                slot,
+                (i % depth) * slotBytes,
+                getWireBytes(cur.recvLength));
+          }
+          if (cur.sendLength > 0) {
+            // Prepare out[0]->ptr to hold the local reduction for this
+            // segment. Forwarded segments are compressed when they are
+            // reduced.
+            if (i < numSegmentsPerRank) {
+              reduceInputs(cur.sendOffset, cur.sendLength);
+              if (compressed.compress != nullptr) {
+                compressed.compress(
+                    static_cast<uint8_t*>(wire->ptr) +
+                        wireOffset(cur.sendOffset),
+                    static_cast<const uint8_t*>(out[0]->ptr) + cur.sendOffset,
+                    residual(cur.sendOffset),
+                    cur.sendLength / opts.elementSize);
+              }
+            }
+            wire->send(
+                sendRank,
+                slot,
+                wireOffset(cur.sendOffset),
+                getWireBytes(cur.sendLength));
+          }
+        }
+        step_ = 1;
+      }
+
+      if (i + 1 >= depth) {
+        // Look up send and receive offsets and lengths of the operations
+        // issued depth - 1 iterations ago. Needed so we know when to
+        // wait for an operation and when to ignore (when the offset was
+        // out of bounds), and know where to reduce the contents of the
+        // temporary buffer.
+        const auto j = i + 1 - depth;
+        const auto& prev = reduceScatterSegments_[j];
+        if (step_ == 1) {
+          if (prev.recvLength > 0) {
+            // Wait for segment from neighbor.
+            if (!waitRecv(tmp, blocking)) {
+              return false;
+            }
+            // Prepare out[0]->ptr to hold the local reduction and reduce
+            // segment from neighbor into it.
+            const size_t offset = prev.recvOffset;
+            const size_t length = prev.recvLength;
+            uint8_t* ptr = static_cast<uint8_t*>(out[0]->ptr) + offset;
+            const uint8_t* tmpPtr = static_cast<const uint8_t*>(tmp->ptr) +
+                (j % depth) * slotBytes;
+            if (compressed.reduce != nullptr) {
+              // Also compresses the result for forwarding.
+              const auto reduce = compressed.reduce;
+              uint8_t* copyPtr =
+                  static_cast<uint8_t*>(wire->ptr) + wireOffset(offset);
+              float* residualPtr = residual(offset);
+              tasks_[j] = dispatch([&opts,
+                                    &reduceInputs,
+                                    reduce,
+                                    offset,
+                                    length,
+                                    ptr,
+                                    copyPtr,
+                                    tmpPtr,
+                                    residualPtr]() {
+                reduceInputs(offset, length);
+                reduce(
+                    ptr,
+                    copyPtr,
+                    tmpPtr,
+                    residualPtr,
+                    length / opts.elementSize);
+              });
+            } else {
+              tasks_[j] = dispatch(
+                  [&opts, &reduceInputs, offset, length, ptr, tmpPtr]() {
+                    reduceInputs(offset, length);
+                    opts.reduce(ptr, ptr, tmpPtr, length / opts.elementSize);
+                  });
+            }
+          }
+          step_ = 2;
+        }
+        if (prev.sendLength > 0 && !waitSend(wire, blocking)) {
+          return false;
+        }
+      }
+    }
+
+    // Ring allgather.
+    //
+    // Beware: totalBytes <= (numSegments * segmentBytes), which is
+    // incompatible with the generic allgather algorithm where the
+    // contribution is identical across processes.
+    //
+    // See comment prior to reduce/scatter loop on how the number of
+    // iterations for this loop is computed. The local broadcast of
+    // received segments to the other outputs is executed on the
+    // reduction pool if there is one. With compression, segments are
+    // forwarded as they were received, and decompressed into the
+    // output along with the broadcast.
+    //
+    for (; phase_ == kAllgather; iteration_++, step_ = 0) {
+      const auto i = iteration_;
+      if (i == numIterations + depth - 1) {
+        for (auto& task : tasks_) {
+          if (!waitTask(task, blocking)) {
+            return false;
+          }
+        }
+        phase_ = kDone;
+        break;
+      }
+
+      if (step_ == 0) {
+        if (i < numIterations) {
+          const auto& cur = allgatherSegments_[i];
+          if (cur.recvLength > 0) {
+            wire->recv(
+                recvRank,
+                slot,
+                wireOffset(cur.recvOffset),
+                getWireBytes(cur.recvLength));
+          }
+          if (cur.sendLength > 0) {
+            wire->send(
+                sendRank,
+                slot,
+                wireOffset(cur.sendOffset),
+                getWireBytes(cur.sendLength));
+          }
+        }
+        step_ = 1;
+      }
+
+      if (i + 1 >= depth) {
+        const auto j = i + 1 - depth;
+        const auto& prev = allgatherSegments_[j];
+        if (step_ == 1) {
+          if (prev.recvLength > 0) {
+            if (!waitRecv(wire, blocking)) {
+              return false;
+            }
+          }
+          // Broadcast received segments to output buffers. The first
+          // segments that were sent are broadcast along with them.
+          const auto decompress = compressed.decompress;
+          if (out.size() > 1 || decompress != nullptr) {
+            const auto recvLength = std::max(prev.recvLength, (ssize_t)0);
+            const auto sendLength = j < numSegmentsPerRank
+                ? std::max(prev.sendLength, (ssize_t)0)
+                : (ssize_t)0;
+            const size_t recvOffset = prev.recvOffset;
+            const size_t sendOffset = prev.sendOffset;
+            uint8_t* ptr = static_cast<uint8_t*>(out[0]->ptr) + recvOffset;
+            const uint8_t* copyPtr =
+                static_cast<const uint8_t*>(wire->ptr) + wireOffset(recvOffset);
+            tasks_[j] = dispatch([&opts,
+                                  &broadcastOutputs,
+                                  decompress,
+                                  ptr,
+                                  copyPtr,
+                                  recvOffset,
+                                  recvLength,
+                                  sendOffset,
+                                  sendLength]() {
+              if (recvLength > 0) {
+                if (decompress != nullptr) {
+                  decompress(ptr, copyPtr, recvLength / opts.elementSize);
+                }
+                broadcastOutputs(recvOffset, recvLength);
+              }
+              if (sendLength > 0) {
+                broadcastOutputs(sendOffset, sendLength);
+              }
+            });
+          }
+          step_ = 2;
+        }
+        if (prev.sendLength > 0 && !waitSend(wire, blocking)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+ protected:
+  // Offsets and lengths of the segments to be sent and received for a
+  // given iteration.
+  struct Segment {
+    size_t sendOffset;
+    size_t recvOffset;
+    ssize_t sendLength;
+    ssize_t recvLength;
   };
 
-  // Ring reduce/scatter.
-  //
-  // Number of iterations is computed as follows:
-  // - Take `numSegments` for the total number of segments,
-  // - Subtract `numSegmentsPerRank` because the final segments hold
-  //   the partial result and must not be forwarded in this phase.
-  // - Add 2 because we pipeline send and receive operations (we issue
-  //   send/recv operations on iterations 0 and 1 and wait for them to
-  //   complete on iterations 2 and 3).
-  //
-  for (auto i = 0; i < (numSegments - numSegmentsPerRank + 2); i++) {
-    if (i >= 2) {
-      // Compute send and receive offsets and lengths two iterations
-      // ago. Needed so we know when to wait for an operation and when
-      // to ignore (when the offset was out of bounds), and know where
-      // to reduce the contents of the temporary buffer.
-      auto prev = computeReduceScatterOffsets(i - 2);
-      if (prev.recvLength > 0) {
-        // Prepare out[0]->ptr to hold the local reduction
-        reduceInputs(prev.recvOffset, prev.recvLength);
-        // Wait for segment from neighbor.
-        tmp->waitRecv(opts.timeout);
-        // Reduce segment from neighbor into out->ptr.
-        opts.reduce(
-            static_cast<uint8_t*>(out[0]->ptr) + prev.recvOffset,
-            static_cast<const uint8_t*>(out[0]->ptr) + prev.recvOffset,
-            static_cast<const uint8_t*>(tmp->ptr) + segmentOffset[i & 0x1],
-            prev.recvLength / opts.elementSize);
-      }
-      if (prev.sendLength > 0) {
-        out[0]->waitSend(opts.timeout);
-      }
-    }
-
-    // Issue new send and receive operation in all but the final two
-    // iterations. At that point we have already sent all data we
-    // needed to and only have to wait for the final segments to be
-    // reduced into the output.
-    if (i < (numSegments - numSegmentsPerRank)) {
-      // Compute send and receive offsets and lengths for this iteration.
-      auto cur = computeReduceScatterOffsets(i);
-      if (cur.recvLength > 0) {
-        tmp->recv(recvRank, slot, segmentOffset[i & 0x1], cur.recvLength);
-      }
-      if (cur.sendLength > 0) {
-        // Prepare out[0]->ptr to hold the local reduction for this segment
-        if (i < numSegmentsPerRank) {
-          reduceInputs(cur.sendOffset, cur.sendLength);
-        }
-        out[0]->send(sendRank, slot, cur.sendOffset, cur.sendLength);
-      }
-    }
-  }
-
-  // Function computes the offsets and lengths of the segments to be
-  // sent and received for a given iteration during allgather.
-  auto computeAllgatherOffsets = [&](size_t i) {
-    struct {
-      size_t sendOffset;
-      size_t recvOffset;
-      ssize_t sendLength;
-      ssize_t recvLength;
-    } result;
-
-    result.sendOffset =
-        ((((context->rank) * numSegmentsPerRank) + i) * segmentBytes) %
-        (numSegments * segmentBytes);
-    result.recvOffset =
-        ((((context->rank + 1) * numSegmentsPerRank) + i) * segmentBytes) %
-        (numSegments * segmentBytes);
-
-    // If the segment is entirely in range, the following statement is
-    // equal to segmentBytes. If it isn't, it will be less, or even
-    // negative. This is why the ssize_t typecasts are needed.
-    result.sendLength = std::min(
-        (ssize_t)segmentBytes,
-        (ssize_t)totalBytes - (ssize_t)result.sendOffset);
-    result.recvLength = std::min(
-        (ssize_t)segmentBytes,
-        (ssize_t)totalBytes - (ssize_t)result.recvOffset);
-
-    return result;
+  enum Phase {
+    kReduceScatter,
+    kAllgather,
+    kDone,
   };
 
-  // Ring allgather.
-  //
-  // Beware: totalBytes <= (numSegments * segmentBytes), which is
-  // incompatible with the generic allgather algorithm where the
-  // contribution is identical across processes.
-  //
-  // See comment prior to reduce/scatter loop on how the number of
-  // iterations for this loop is computed.
-  //
-  for (auto i = 0; i < (numSegments - numSegmentsPerRank + 2); i++) {
-    if (i >= 2) {
-      auto prev = computeAllgatherOffsets(i - 2);
-      if (prev.recvLength > 0) {
-        out[0]->waitRecv(opts.timeout);
-        // Broadcast received segments to output buffers.
-        broadcastOutputs(prev.recvOffset, prev.recvLength);
-      }
-      if (prev.sendLength > 0) {
-        out[0]->waitSend(opts.timeout);
+  transport::UnboundBuffer* buf_;
+  int recvRank_;
+  int sendRank_;
+  size_t numSegments_;
+  size_t numSegmentsPerRank_;
+  size_t depth_;
+  size_t segmentBytes_;
+  std::vector<Segment> reduceScatterSegments_;
+  std::vector<Segment> allgatherSegments_;
+
+  // Scratch space for the segments in flight and the segments being
+  // reduced, one segment per pipeline stage. The segment received in
+  // iteration i is stored at offset (i % depth_) * slot size, where
+  // the slot size is getWireBytes(segmentBytes_).
+  ScratchPool::Scratch scratch_;
+
+  // Kernels and copy of the region in the narrower format, if data is
+  // compressed. Offsets in the copy are relative to the offset of the
+  // region in the output (offset_).
+  CompressedReduceKernels compressed_;
+  size_t offset_ = 0;
+  ScratchPool::Scratch copy_;
+
+  // Returns the number of bytes that the specified number of bytes of
+  // the output take on the wire.
+  size_t getWireBytes(size_t bytes) const {
+    if (compressed_.reduce == nullptr) {
+      return bytes;
+    }
+    return compressed_.getCompressedSize(bytes / opts_.elementSize);
+  }
+
+  // Pool that executes the local reductions, or null if they are
+  // executed by the calling thread.
+  ProgressEngine* engine_ = nullptr;
+
+  // Pending reduction per iteration of the current phase.
+  std::vector<std::shared_ptr<Work>> tasks_;
+
+  // Waits for the tasks of an execution that didn't complete (e.g.
+  // because it timed out), so that they don't outlive the buffers and
+  // functions they refer to. Their result no longer matters.
+  void drain() {
+    for (auto& task : tasks_) {
+      if (task && !task->cancel()) {
+        try {
+          task->wait();
+        } catch (...) {
+        }
       }
+      task.reset();
+    }
+  }
+
+  // Runs the specified function on the reduction pool, or on the
+  // calling thread if there is none.
+  std::shared_ptr<Work> dispatch(std::function<void()> fn) {
+    if (engine_ == nullptr) {
+      fn();
+      return nullptr;
+    }
+    return engine_->enqueue(std::move(fn));
+  }
+
+  // Returns true if the specified task completed. Rethrows the
+  // exception thrown by the task if it failed.
+  bool waitTask(std::shared_ptr<Work>& task, bool blocking) {
+    if (!task) {
+      return true;
+    }
+    if (!blocking && !task->test()) {
+      return false;
+    }
+    task->wait();
+    task.reset();
+    return true;
+  }
+
+  // Execution state.
+  Phase phase_;
+  size_t iteration_;
+  int step_;
+};
+
+// Runs multiple schedules concurrently, each on a part of the buffer.
+// The schedules are advanced in turn without blocking, so that they
+// make progress concurrently on a single thread.
+//
+// Every schedule must use its own slot, so that messages between the
+// same pair of processes can't be mixed up, and its own unbound
+// buffers, so that it doesn't observe completion of another
+// schedule's operations.
+//
+class ConcurrentSchedule : public Schedule {
+ public:
+  explicit ConcurrentSchedule(const detail::AllreduceOptionsImpl& opts)
+      : Schedule(opts),
+        signal_(std::make_shared<transport::CompletionSignal>()) {}
+
+  ~ConcurrentSchedule() override {
+    // Scratch buffers outlive the schedules.
+    for (auto& schedule : schedules_) {
+      schedule->setCompletionSignal(nullptr);
+    }
+  }
+
+  void reset() override {
+    Schedule::reset();
+    for (auto& schedule : schedules_) {
+      schedule->reset();
+      schedule->setCompletionSignal(signal_);
     }
+    done_.assign(schedules_.size(), false);
+  }
+
+  void setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& signal) override {
+    for (auto& schedule : schedules_) {
+      schedule->setCompletionSignal(signal);
+    }
+  }
 
-    // Issue new send and receive operation in all but the final two
-    // iterations. At that point we have already sent all data we
-    // needed to and only have to wait for the final segments to be
-    // sent to the output.
-    if (i < (numSegments - numSegmentsPerRank)) {
-      auto cur = computeAllgatherOffsets(i);
-      if (cur.recvLength > 0) {
-        out[0]->recv(recvRank, slot, cur.recvOffset, cur.recvLength);
+  std::chrono::steady_clock::time_point getDeadline() const override {
+    auto deadline = Schedule::getDeadline();
+    for (size_t i = 0; i < schedules_.size(); i++) {
+      if (!done_[i]) {
+        deadline = std::min(deadline, schedules_[i]->getDeadline());
       }
-      if (cur.sendLength > 0) {
-        out[0]->send(sendRank, slot, cur.sendOffset, cur.sendLength);
-        // Broadcast first segments to outputs buffers.
-        if (i < numSegmentsPerRank) {
-          broadcastOutputs(cur.sendOffset, cur.sendLength);
+    }
+    return deadline;
+  }
+
+  bool advance(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs,
+      bool blocking) override {
+    for (;;) {
+      const auto generation = signal_->generation();
+      bool done = true;
+      for (size_t i = 0; i < schedules_.size(); i++) {
+        if (!done_[i]) {
+          done_[i] =
+              schedules_[i]->advance(reduceInputs, broadcastOutputs, false);
+          done = done && done_[i];
         }
       }
+      if (done) {
+        return true;
+      }
+      if (!blocking) {
+        return false;
+      }
+
+      // None of the schedules can make progress until one of their
+      // operations completes. Past the deadline, the next pass reports
+      // the timeout (see waitRecv and waitSend).
+      signal_->wait(generation, getDeadline());
+    }
+  }
+
+ protected:
+  // Notified when an operation of any of the schedules completes.
+  std::shared_ptr<transport::CompletionSignal> signal_;
+
+  // Unbound buffers used by the schedules.
+  BufferVector buffers_;
+
+  std::vector<std::unique_ptr<Schedule>> schedules_;
+  std::vector<bool> done_;
+
+  // Returns new unbound buffer for the memory of out[0].
+  transport::UnboundBuffer* createOutputBuffer() {
+    buffers_.push_back(opts_.context->createUnboundBuffer(
+        opts_.out[0]->ptr, opts_.elements * opts_.elementSize));
+    return buffers_.back().get();
+  }
+};
+
+// Runs multiple rings concurrently, each on a part of the buffer.
+//
+// A single ring only uses every link between processes in one
+// direction. With two rings that rotate in opposite directions, both
+// directions of every link are used. Additional rings pass data along
+// different permutations of the processes (using strides that are
+// coprime with the number of processes), so that they use different
+// links where possible.
+//
+class MultiRingSchedule : public ConcurrentSchedule {
+ public:
+  MultiRingSchedule(
+      const detail::AllreduceOptionsImpl& opts,
+      size_t maxSegmentSize,
+      size_t numRings)
+      : ConcurrentSchedule(opts) {
+    const auto& context = opts.context;
+
+    // Strides that result in a ring that includes every process. A
+    // stride s and size - s result in the same ring in reverse, which
+    // is covered by the counter-rotating rings.
+    std::vector<int> strides;
+    for (int i = 1; i == 1 || 2 * i < context->size; i++) {
+      if (gcd(i, context->size) == 1) {
+        strides.push_back(i);
+      }
+    }
+
+    const size_t ringElements = (opts.elements + numRings - 1) / numRings;
+    for (size_t i = 0; i < numRings; i++) {
+      const size_t offset = std::min(opts.elements, i * ringElements);
+      const size_t length = std::min(ringElements, opts.elements - offset);
+      if (length == 0) {
+        break;
+      }
+      const auto order = computeRingOrder(
+          context->size, strides[(i / 2) % strides.size()], i % 2 == 1);
+      schedules_.emplace_back(new RingSchedule(
+          opts,
+          maxSegmentSize,
+          slot_ + static_cast<uint8_t>(i),
+          order,
+          createOutputBuffer(),
+          offset * opts.elementSize,
+          length * opts.elementSize));
     }
   }
+
+ protected:
+  static int gcd(int a, int b) {
+    return b == 0 ? a : gcd(b, a % b);
+  }
+};
+
+std::unique_ptr<Schedule> createRingSchedule(
+    const detail::AllreduceOptionsImpl& opts,
+    size_t maxSegmentSize) {
+  if (opts.rings > 1) {
+    return std::unique_ptr<Schedule>(
+        new MultiRingSchedule(opts, maxSegmentSize, opts.rings));
+  }
+  const auto& context = opts.context;
+  return std::unique_ptr<Schedule>(new RingSchedule(
+      opts,
+      maxSegmentSize,
+      Slot::build(kAllreduceSlotPrefix, opts.tag),
+      computeRingOrder(context->size, 1, false),
+      opts.out[0].get(),
+      0,
+      opts.elements * opts.elementSize));
 }
 
 // For a given context size and desired group size, compute the actual group
@@ -426,253 +1250,1480 @@ std::vector<size_t> computeGroupSizePerStep(size_t size, const size_t n) {
 // all processes have 1/8th of the result. Then, the same factorization is
 // followed in reverse to perform an allgather.
 //
-void bcube(
-    const detail::AllreduceOptionsImpl& opts,
-    ReduceRangeFunction reduceInputs,
-    BroadcastRangeFunction broadcastOutputs) {
-  const auto& context = opts.context;
-  const auto slot = Slot::build(kAllreduceSlotPrefix, opts.tag);
-  const auto elementSize = opts.elementSize;
-  auto& out = opts.out[0];
+class BcubeSchedule : public Schedule {
+ public:
+  explicit BcubeSchedule(const detail::AllreduceOptionsImpl& opts)
+      : Schedule(opts) {
+    const auto& context = opts.context;
+    const auto elementSize = opts.elementSize;
+
+    constexpr auto n = 2;
+
+    // Figure out the number of steps in this algorithm.
+    const auto groupSizePerStep = computeGroupSizePerStep(context->size, n);
+
+    // Compute the details of a group at every algorithm step.
+    // We keep this in a vector because we iterate through it in forward
+    // order in the reduce/scatter phase and in backward order in the
+    // allgather phase.
+    {
+      struct group group;
+      group.peerDistance = 1;
+      group.bufferOffset = 0;
+      group.bufferLength = opts.elements;
+      for (const size_t groupSize : groupSizePerStep) {
+        const size_t groupRank =
+            (context->rank / group.peerDistance) % groupSize;
+        const size_t baseRank =
+            context->rank - (groupRank * group.peerDistance);
+        group.ranks.reserve(groupSize);
+        for (size_t i = 0; i < groupSize; i++) {
+          group.ranks.push_back(baseRank + i * group.peerDistance);
+        }
 
-  constexpr auto n = 2;
+        // Compute the length of the chunk we're exchanging at this step.
+        group.chunkLength =
+            ((group.bufferLength + (groupSize - 1)) / groupSize);
+
+        // This process is computing the reduction of the chunk positioned at
+        // <rank>/<size> within the current segment.
+        group.myChunkOffset =
+            group.bufferOffset + (groupRank * group.chunkLength);
+        group.myChunkLength = std::min(
+            size_t(group.chunkLength),
+            size_t(std::max(
+                int64_t(0),
+                int64_t(group.bufferLength) -
+                    int64_t(groupRank * group.chunkLength))));
+
+        // Store a const copy of this group in the vector.
+        groups_.push_back(group);
+
+        // Initialize with updated peer distance and segment offset and
+        // length.
+        struct group nextGroup;
+        nextGroup.peerDistance = group.peerDistance * groupSize;
+        nextGroup.bufferOffset = group.myChunkOffset;
+        nextGroup.bufferLength = group.myChunkLength;
+        std::swap(group, nextGroup);
+      }
+    }
 
-  // Figure out the number of steps in this algorithm.
-  const auto groupSizePerStep = computeGroupSizePerStep(context->size, n);
+    // The chunk length is rounded up, so the maximum scratch space we need
+    // might be larger than the size of the output buffer. Compute the maximum.
+    size_t bufferLength = opts.elements;
+    for (const auto& group : groups_) {
+      bufferLength =
+          std::max(bufferLength, group.ranks.size() * group.chunkLength);
+    }
 
-  struct group {
-    // Distance between peers in this group.
-    size_t peerDistance;
+    // Borrow scratch space to receive data from peers.
+    const size_t bufferSize = bufferLength * elementSize;
+    scratch_ = context->getScratchPool().acquire(bufferSize);
+  }
 
-    // Segment that this group is responsible for reducing.
-    size_t bufferOffset;
-    size_t bufferLength;
+  void reset() override {
+    Schedule::reset();
+    phase_ = kReduceScatter;
+    step_ = 0;
+    issued_ = false;
+    pendingRecvs_ = 0;
+    pendingSends_ = 0;
+  }
 
-    // The process ranks that are a member of this group.
-    std::vector<size_t> ranks;
+  void setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& signal) override {
+    opts_.out[0]->setCompletionSignal(signal);
+    scratch_.getUnboundBuffer()->setCompletionSignal(signal);
+  }
 
-    // Upper bound of the length of the chunk that each process has the
-    // reduced values for by the end of the reduction for this group.
-    size_t chunkLength;
+  bool advance(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs,
+      bool blocking) override {
+    const auto& opts = opts_;
+    const auto& context = opts.context;
+    const auto slot = slot_;
+    const auto elementSize = opts.elementSize;
+    const auto& groups = groups_;
+    auto& out = opts.out[0];
+    transport::UnboundBuffer* tmp = scratch_.getUnboundBuffer();
+
+    // Reduce/scatter.
+    for (; phase_ == kReduceScatter; step_++, issued_ = false) {
+      if (step_ == groups.size()) {
+        // There is one chunk that contains the final result and this
+        // chunk can already be broadcast locally to out[1..N], if
+        // applicable. Doing so means we only have to broadcast locally
+        // to out[1..N] all chunks as we receive them from our peers
+        // during the allgather phase.
+        const auto& group = groups.back();
+        broadcastOutputs(
+            group.myChunkOffset * elementSize,
+            group.myChunkLength * elementSize);
+        phase_ = kAllgather;
+        step_ = 0;
+        break;
+      }
 
-    // Chunk within the segment that this process is responsible for reducing.
-    size_t myChunkOffset;
-    size_t myChunkLength;
-  };
+      const auto step = step_;
+      const auto& group = groups[step];
+
+      if (!issued_) {
+        // Issue receive operations for chunks from peers.
+        for (size_t i = 0; i < group.ranks.size(); i++) {
+          const auto src = group.ranks[i];
+          if (src == context->rank) {
+            continue;
+          }
+          tmp->recv(
+              src,
+              slot,
+              i * group.chunkLength * elementSize,
+              group.myChunkLength * elementSize);
+        }
 
-  // Compute the details of a group at every algorithm step.
-  // We keep this in a vector because we iterate through it in forward order in
-  // the reduce/scatter phase and in backward order in the allgather phase.
-  std::vector<struct group> groups;
-  {
-    struct group group;
-    group.peerDistance = 1;
-    group.bufferOffset = 0;
-    group.bufferLength = opts.elements;
-    for (const size_t groupSize : groupSizePerStep) {
-      const size_t groupRank = (context->rank / group.peerDistance) % groupSize;
-      const size_t baseRank = context->rank - (groupRank * group.peerDistance);
-      group.ranks.reserve(groupSize);
-      for (size_t i = 0; i < groupSize; i++) {
-        group.ranks.push_back(baseRank + i * group.peerDistance);
-      }
-
-      // Compute the length of the chunk we're exchanging at this step.
-      group.chunkLength = ((group.bufferLength + (groupSize - 1)) / groupSize);
-
-      // This process is computing the reduction of the chunk positioned at
-      // <rank>/<size> within the current segment.
-      group.myChunkOffset =
-          group.bufferOffset + (groupRank * group.chunkLength);
-      group.myChunkLength = std::min(
-          size_t(group.chunkLength),
-          size_t(std::max(
-              int64_t(0),
-              int64_t(group.bufferLength) -
-                  int64_t(groupRank * group.chunkLength))));
-
-      // Store a const copy of this group in the vector.
-      groups.push_back(group);
-
-      // Initialize with updated peer distance and segment offset and length.
-      struct group nextGroup;
-      nextGroup.peerDistance = group.peerDistance * groupSize;
-      nextGroup.bufferOffset = group.myChunkOffset;
-      nextGroup.bufferLength = group.myChunkLength;
-      std::swap(group, nextGroup);
-    }
-  }
-
-  // The chunk length is rounded up, so the maximum scratch space we need
-  // might be larger than the size of the output buffer. Compute the maximum
-  size_t bufferLength = opts.elements;
-  for (const auto& group : groups) {
-    bufferLength =
-        std::max(bufferLength, group.ranks.size() * group.chunkLength);
-  }
-
-  // Allocate scratch space to receive data from peers.
-  const size_t bufferSize = bufferLength * elementSize;
-  std::unique_ptr<uint8_t[]> buffer(new uint8_t[bufferSize]);
-  std::unique_ptr<transport::UnboundBuffer> tmp =
-      context->createUnboundBuffer(buffer.get(), bufferSize);
-
-  // Reduce/scatter.
-  for (size_t step = 0; step < groups.size(); step++) {
-    const auto& group = groups[step];
-
-    // Issue receive operations for chunks from peers.
-    for (size_t i = 0; i < group.ranks.size(); i++) {
-      const auto src = group.ranks[i];
-      if (src == context->rank) {
-        continue;
-      }
-      tmp->recv(
-          src,
-          slot,
-          i * group.chunkLength * elementSize,
-          group.myChunkLength * elementSize);
-    }
-
-    // Issue send operations for local chunks to peers.
-    for (size_t i = 0; i < group.ranks.size(); i++) {
-      const auto dst = group.ranks[i];
-      if (dst == context->rank) {
-        continue;
-      }
-      const size_t currentChunkOffset =
-          group.bufferOffset + i * group.chunkLength;
-      const size_t currentChunkLength = std::min(
-          size_t(group.chunkLength),
-          size_t(std::max(
-              int64_t(0),
-              int64_t(group.bufferLength) - int64_t(i * group.chunkLength))));
-      // Compute the local reduction only in the first step of the algorithm.
-      // In subsequent steps, we already have a partially reduced result.
+        // Issue send operations for local chunks to peers.
+        for (size_t i = 0; i < group.ranks.size(); i++) {
+          const auto dst = group.ranks[i];
+          if (dst == context->rank) {
+            continue;
+          }
+          const size_t currentChunkOffset =
+              group.bufferOffset + i * group.chunkLength;
+          const size_t currentChunkLength = std::min(
+              size_t(group.chunkLength),
+              size_t(std::max(
+                  int64_t(0),
+                  int64_t(group.bufferLength) -
+                      int64_t(i * group.chunkLength))));
+          // Compute the local reduction only in the first step of the
+          // algorithm. In subsequent steps, we already have a partially
+          // reduced result.
+          if (step == 0) {
+            reduceInputs(
+                currentChunkOffset * elementSize,
+                currentChunkLength * elementSize);
+          }
+          out->send(
+              dst,
+              slot,
+              currentChunkOffset * elementSize,
+              currentChunkLength * elementSize);
+        }
+
+        pendingRecvs_ = group.ranks.size() - 1;
+        pendingSends_ = group.ranks.size() - 1;
+        issued_ = true;
+      }
+
+      // Wait for send and receive operations to complete.
+      if (!waitAll(tmp, out.get(), blocking)) {
+        return false;
+      }
+
+      // In the first step, prepare the chunk this process is responsible
+      // for with the reduced version of its inputs (if multiple are
+      // specified).
       if (step == 0) {
         reduceInputs(
-            currentChunkOffset * elementSize, currentChunkLength * elementSize);
-      }
-      out->send(
-          dst,
-          slot,
-          currentChunkOffset * elementSize,
-          currentChunkLength * elementSize);
-    }
-
-    // Wait for send and receive operations to complete.
-    for (size_t i = 0; i < group.ranks.size(); i++) {
-      const auto peer = group.ranks[i];
-      if (peer == context->rank) {
-        continue;
-      }
-      tmp->waitRecv();
-      out->waitSend();
-    }
-
-    // In the first step, prepare the chunk this process is responsible for
-    // with the reduced version of its inputs (if multiple are specified).
-    if (step == 0) {
-      reduceInputs(
-          group.myChunkOffset * elementSize, group.myChunkLength * elementSize);
-    }
-
-    // Reduce chunks from peers.
-    for (size_t i = 0; i < group.ranks.size(); i++) {
-      const auto src = group.ranks[i];
-      if (src == context->rank) {
-        continue;
-      }
-      opts.reduce(
-          static_cast<uint8_t*>(out->ptr) + (group.myChunkOffset * elementSize),
-          static_cast<const uint8_t*>(out->ptr) +
-              (group.myChunkOffset * elementSize),
-          static_cast<const uint8_t*>(tmp->ptr) +
-              (i * group.chunkLength * elementSize),
-          group.myChunkLength);
-    }
-  }
-
-  // There is one chunk that contains the final result and this chunk
-  // can already be broadcast locally to out[1..N], if applicable.
-  // Doing so means we only have to broadcast locally to out[1..N] all
-  // chunks as we receive them from our peers during the allgather phase.
-  {
-    const auto& group = groups.back();
-    broadcastOutputs(
-        group.myChunkOffset * elementSize, group.myChunkLength * elementSize);
-  }
-
-  // Allgather.
-  for (auto it = groups.rbegin(); it != groups.rend(); it++) {
-    const auto& group = *it;
-
-    // Issue receive operations for reduced chunks from peers.
-    for (size_t i = 0; i < group.ranks.size(); i++) {
-      const auto src = group.ranks[i];
-      if (src == context->rank) {
-        continue;
-      }
-      const size_t currentChunkOffset =
-          group.bufferOffset + i * group.chunkLength;
-      const size_t currentChunkLength = std::min(
-          size_t(group.chunkLength),
-          size_t(std::max(
-              int64_t(0),
-              int64_t(group.bufferLength) - int64_t(i * group.chunkLength))));
-      out->recv(
-          src,
-          slot,
-          currentChunkOffset * elementSize,
-          currentChunkLength * elementSize);
-    }
-
-    // Issue send operations for reduced chunk to peers.
-    for (size_t i = 0; i < group.ranks.size(); i++) {
-      const auto dst = group.ranks[i];
-      if (dst == context->rank) {
-        continue;
-      }
-      out->send(
-          dst,
-          slot,
-          group.myChunkOffset * elementSize,
-          group.myChunkLength * elementSize);
-    }
-
-    // Wait for operations to complete.
-    for (size_t i = 0; i < group.ranks.size(); i++) {
-      const auto peer = group.ranks[i];
-      if (peer == context->rank) {
-        continue;
-      }
-      out->waitRecv();
-      out->waitSend();
-    }
-
-    // Broadcast result to multiple output buffers, if applicable.
-    for (size_t i = 0; i < group.ranks.size(); i++) {
-      const auto peer = group.ranks[i];
-      if (peer == context->rank) {
-        continue;
-      }
-      const size_t currentChunkOffset =
-          group.bufferOffset + i * group.chunkLength;
-      const size_t currentChunkLength = std::min(
-          size_t(group.chunkLength),
-          size_t(std::max(
-              int64_t(0),
-              int64_t(group.bufferLength) - int64_t(i * group.chunkLength))));
-      broadcastOutputs(
-          currentChunkOffset * elementSize, currentChunkLength * elementSize);
+            group.myChunkOffset * elementSize,
+            group.myChunkLength * elementSize);
+      }
+
+      // Reduce chunks from peers.
+      for (size_t i = 0; i < group.ranks.size(); i++) {
+        const auto src = group.ranks[i];
+        if (src == context->rank) {
+          continue;
+        }
+        opts.reduce(
+            static_cast<uint8_t*>(out->ptr) +
+                (group.myChunkOffset * elementSize),
+            static_cast<const uint8_t*>(out->ptr) +
+                (group.myChunkOffset * elementSize),
+            static_cast<const uint8_t*>(tmp->ptr) +
+                (i * group.chunkLength * elementSize),
+            group.myChunkLength);
+      }
     }
-  }
-}
 
-} // namespace
+    // Allgather. Iterates over the groups in reverse order.
+    for (; phase_ == kAllgather; step_++, issued_ = false) {
+      if (step_ == groups.size()) {
+        phase_ = kDone;
+        break;
+      }
 
-void allreduce(const AllreduceOptions& opts) {
+      const auto& group = groups[groups.size() - 1 - step_];
+
+      if (!issued_) {
+        // Issue receive operations for reduced chunks from peers.
+        for (size_t i = 0; i < group.ranks.size(); i++) {
+          const auto src = group.ranks[i];
+          if (src == context->rank) {
+            continue;
+          }
+          const size_t currentChunkOffset =
+              group.bufferOffset + i * group.chunkLength;
+          const size_t currentChunkLength = std::min(
+              size_t(group.chunkLength),
+              size_t(std::max(
+                  int64_t(0),
+                  int64_t(group.bufferLength) -
+                      int64_t(i * group.chunkLength))));
+          out->recv(
+              src,
+              slot,
+              currentChunkOffset * elementSize,
+              currentChunkLength * elementSize);
+        }
+
+        // Issue send operations for reduced chunk to peers.
+        for (size_t i = 0; i < group.ranks.size(); i++) {
+          const auto dst = group.ranks[i];
+          if (dst == context->rank) {
+            continue;
+          }
+          out->send(
+              dst,
+              slot,
+              group.myChunkOffset * elementSize,
+              group.myChunkLength * elementSize);
+        }
+
+        pendingRecvs_ = group.ranks.size() - 1;
+        pendingSends_ = group.ranks.size() - 1;
+        issued_ = true;
+      }
+
+      // Wait for operations to complete.
+      if (!waitAll(out.get(), out.get(), blocking)) {
+        return false;
+      }
+
+      // Broadcast result to multiple output buffers, if applicable.
+      for (size_t i = 0; i < group.ranks.size(); i++) {
+        const auto peer = group.ranks[i];
+        if (peer == context->rank) {
+          continue;
+        }
+        const size_t currentChunkOffset =
+            group.bufferOffset + i * group.chunkLength;
+        const size_t currentChunkLength = std::min(
+            size_t(group.chunkLength),
+            size_t(std::max(
+                int64_t(0),
+                int64_t(group.bufferLength) -
+                    int64_t(i * group.chunkLength))));
+        broadcastOutputs(
+            currentChunkOffset * elementSize,
+            currentChunkLength * elementSize);
+      }
+    }
+
+    return true;
+  }
+
+ protected:
+  struct group {
+    // Distance between peers in this group.
+    size_t peerDistance;
+
+    // Segment that this group is responsible for reducing.
+    size_t bufferOffset;
+    size_t bufferLength;
+
+    // The process ranks that are a member of this group.
+    std::vector<size_t> ranks;
+
+    // Upper bound of the length of the chunk that each process has the
+    // reduced values for by the end of the reduction for this group.
+    size_t chunkLength;
+
+    // Chunk within the segment that this process is responsible for reducing.
+    size_t myChunkOffset;
+    size_t myChunkLength;
+  };
+
+  enum Phase {
+    kReduceScatter,
+    kAllgather,
+    kDone,
+  };
+
+  // Details of a group at every algorithm step.
+  std::vector<struct group> groups_;
+
+  ScratchPool::Scratch scratch_;
+
+  // Execution state.
+  Phase phase_;
+  size_t step_;
+  bool issued_;
+  size_t pendingRecvs_;
+  size_t pendingSends_;
+
+  // Waits for the pending operations of the current step.
+  bool waitAll(
+      transport::UnboundBuffer* recvBuf,
+      transport::UnboundBuffer* sendBuf,
+      bool blocking) {
+    for (; pendingRecvs_ > 0; pendingRecvs_--) {
+      if (!waitRecv(recvBuf, blocking)) {
+        return false;
+      }
+    }
+    for (; pendingSends_ > 0; pendingSends_--) {
+      if (!waitSend(sendBuf, blocking)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+std::unique_ptr<Schedule> createBcubeSchedule(
+    const detail::AllreduceOptionsImpl& opts) {
+  return std::unique_ptr<Schedule>(new BcubeSchedule(opts));
+}
+
+// Reverses the order of the last n bits of the specified value.
+size_t reverseLastNBits(size_t value, size_t n) {
+  size_t result = 0;
+  for (size_t i = 0; i < n; i++) {
+    result = (result << 1) | ((value >> i) & 1);
+  }
+  return result;
+}
+
+// Returns the base 2 logarithm of the largest power of two <= value.
+size_t log2Floor(size_t value) {
+  size_t result = 0;
+  while (value >>= 1) {
+    result++;
+  }
+  return result;
+}
+
+// The halving/doubling algorithm (also known as Rabenseifner's
+// algorithm) performs a reduce/scatter by recursive vector halving and
+// distance doubling, followed by an allgather by recursive vector
+// doubling and distance halving. It takes 2 * log2(P) steps and every
+// process sends and receives 2 * (P - 1) / P times the buffer.
+//
+// If the number of processes is not a power of two, the processes are
+// split into binary blocks: one block for every bit that is set in the
+// number of processes, with the largest block holding the lowest ranks.
+// For example, 13 processes are split into blocks of 8 (ranks 0-7),
+// 4 (ranks 8-11), and 1 (rank 12). Every block runs the reduce/scatter
+// independently. Then, starting with the smallest block, every block
+// sends its partial result to the next larger block, which reduces it
+// into its own. The largest block ends up with the final result and
+// sends it back down the chain, before every block runs its allgather.
+//
+// This is the same algorithm as AllreduceHalvingDoubling, built on
+// unbound buffers, and with support for multiple inputs and outputs.
+//
+class HalvingDoublingSchedule : public Schedule {
+ public:
+  explicit HalvingDoublingSchedule(const detail::AllreduceOptionsImpl& opts)
+      : Schedule(opts) {
+    const auto& context = opts.context;
+    const size_t rank = context->rank;
+    const size_t size = context->size;
+    const size_t count = opts.elements;
+
+    // The buffer is split into as many chunks as the largest block has
+    // processes. At every step within a block, the part of the buffer
+    // a process is responsible for is halved.
+    const size_t steps = log2Floor(size);
+    const size_t chunkSize = (count + (1 << steps) - 1) >> steps;
+
+    // Find the binary block this process is a member of.
+    {
+      size_t offset = size;
+      size_t blockSize = 1;
+      size_t currentBlockSize = 0;
+      size_t prevBlockSize = 0;
+      myBlockSize_ = 0;
+      nextSmallerBlockSize_ = 0;
+      nextLargerBlockSize_ = 0;
+      do {
+        if (size & blockSize) {
+          prevBlockSize = currentBlockSize;
+          currentBlockSize = blockSize;
+          offset -= blockSize;
+          if (myBlockSize_ != 0) {
+            nextLargerBlockSize_ = currentBlockSize;
+            break;
+          }
+          if (offset <= rank) {
+            offsetToMyBlock_ = offset;
+            myBlockSize_ = currentBlockSize;
+            nextSmallerBlockSize_ = prevBlockSize;
+          }
+        }
+        blockSize <<= 1;
+      } while (offset != 0);
+    }
+    const size_t stepsWithinBlock = log2Floor(myBlockSize_);
+    const size_t rankInBlock = rank % myBlockSize_;
+
+    // Compute the peer, offsets, and lengths (in elements) of every
+    // step within the block. Data received from peers is stored at
+    // consecutive offsets in the scratch buffer.
+    size_t stepChunkSize = chunkSize << (steps - 1);
+    size_t sendOffset = 0;
+    size_t recvOffset = 0;
+    size_t bufferOffset = 0;
+    for (size_t i = 0; i < stepsWithinBlock; i++) {
+      const size_t bitmask = 1 << i;
+      Step step;
+      step.peer = rank ^ bitmask;
+      step.sendOffset = sendOffset + ((step.peer & bitmask) ? stepChunkSize : 0);
+      step.recvOffset = recvOffset + ((rank & bitmask) ? stepChunkSize : 0);
+      step.sendLength = clamp(step.sendOffset, stepChunkSize, count);
+      step.recvLength = clamp(step.recvOffset, stepChunkSize, count);
+      step.bufferOffset = bufferOffset;
+      steps_.push_back(step);
+      bufferOffset += stepChunkSize;
+      if (rank & bitmask) {
+        sendOffset += stepChunkSize;
+        recvOffset += stepChunkSize;
+      }
+      stepChunkSize >>= 1;
+    }
+
+    // Chunk this process is responsible for after the reduce/scatter.
+    if (stepsWithinBlock > 0) {
+      myChunkOffset_ = steps_.back().recvOffset;
+      myChunkLength_ = steps_.back().recvLength;
+    } else {
+      myChunkOffset_ = 0;
+      myChunkLength_ = count;
+    }
+
+    // The remainder of the scratch buffer is used to receive the
+    // partial result from the next smaller block, or the final result
+    // from the next larger block. This never happens concurrently.
+    blockBufferOffset_ = bufferOffset;
+
+    // Every process in the next smaller block sends its partial result
+    // to a process in this block that is responsible for the same
+    // chunk, and receives the final result from it.
+    if (nextSmallerBlockSize_ != 0) {
+      smallerBlockPeer_ = offsetToMyBlock_ + myBlockSize_ +
+          rankInBlock % nextSmallerBlockSize_;
+    }
+
+    // The chunk of a process in this block covers the chunks of
+    // multiple processes in the next larger block. Send every one of
+    // them its piece of the partial result, and receive the final
+    // result for that piece from it.
+    if (nextLargerBlockSize_ != 0 && myChunkLength_ > 0) {
+      const size_t offsetToLargerBlock =
+          offsetToMyBlock_ - nextLargerBlockSize_;
+      const size_t numPeers = nextLargerBlockSize_ / myBlockSize_;
+      const size_t pieceLength = stepChunkSize >> (log2Floor(numPeers) - 1);
+      size_t ordinal =
+          reverseLastNBits(rankInBlock, stepsWithinBlock) * numPeers;
+      for (size_t i = 0; i < numPeers; i++, ordinal++) {
+        if (pieceLength * i >= myChunkLength_) {
+          break;
+        }
+        Piece piece;
+        piece.peer = offsetToLargerBlock +
+            reverseLastNBits(ordinal, log2Floor(nextLargerBlockSize_));
+        piece.offset = myChunkOffset_ + pieceLength * i;
+        piece.length = std::min(pieceLength, myChunkLength_ - pieceLength * i);
+        largerBlockPieces_.push_back(piece);
+      }
+    }
+
+    // Borrow scratch space to receive data from peers.
+    scratch_ =
+        context->getScratchPool().acquire((chunkSize << steps) * opts.elementSize);
+  }
+
+  void reset() override {
+    Schedule::reset();
+    phase_ = kReduceScatter;
+    step_ = 0;
+    issued_ = false;
+    pendingRecvs_ = 0;
+    pendingSends_ = 0;
+  }
+
+  void setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& signal) override {
+    opts_.out[0]->setCompletionSignal(signal);
+    scratch_.getUnboundBuffer()->setCompletionSignal(signal);
+  }
+
+  bool advance(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs,
+      bool blocking) override {
+    const auto& opts = opts_;
+    const auto slot = slot_;
+    const auto elementSize = opts.elementSize;
+    const size_t totalBytes = opts.elements * elementSize;
+    auto& out = opts.out[0];
+    transport::UnboundBuffer* tmp = scratch_.getUnboundBuffer();
+    auto outPtr = [&](size_t offset) {
+      return static_cast<uint8_t*>(out->ptr) + offset * elementSize;
+    };
+    auto tmpPtr = [&](size_t offset) {
+      return static_cast<uint8_t*>(tmp->ptr) + offset * elementSize;
+    };
+
+    // Reduce/scatter within the block.
+    for (; phase_ == kReduceScatter; step_++, issued_ = false) {
+      if (step_ == steps_.size()) {
+        phase_ = kReduceSmallerBlock;
+        break;
+      }
+
+      const auto& step = steps_[step_];
+      if (!issued_) {
+        // Prepare out[0] to hold the local reduction of the inputs.
+        if (step_ == 0) {
+          reduceInputs(0, totalBytes);
+        }
+        if (step.recvLength > 0) {
+          tmp->recv(
+              step.peer,
+              slot,
+              step.bufferOffset * elementSize,
+              step.recvLength * elementSize);
+          pendingRecvs_++;
+        }
+        if (step.sendLength > 0) {
+          out->send(
+              step.peer,
+              slot,
+              step.sendOffset * elementSize,
+              step.sendLength * elementSize);
+          pendingSends_++;
+        }
+        issued_ = true;
+      }
+
+      if (!waitAll(tmp, out.get(), blocking)) {
+        return false;
+      }
+
+      if (step.recvLength > 0) {
+        opts.reduce(
+            outPtr(step.recvOffset),
+            outPtr(step.recvOffset),
+            tmpPtr(step.bufferOffset),
+            step.recvLength);
+      }
+    }
+
+    // Reduce the partial result of the next smaller block.
+    if (phase_ == kReduceSmallerBlock) {
+      if (steps_.empty()) {
+        // A single process block did not execute any steps.
+        reduceInputs(0, totalBytes);
+      }
+      if (nextSmallerBlockSize_ != 0 && myChunkLength_ > 0) {
+        if (!issued_) {
+          tmp->recv(
+              smallerBlockPeer_,
+              slot,
+              blockBufferOffset_ * elementSize,
+              myChunkLength_ * elementSize);
+          pendingRecvs_++;
+          issued_ = true;
+        }
+        if (!waitAll(tmp, out.get(), blocking)) {
+          return false;
+        }
+        opts.reduce(
+            outPtr(myChunkOffset_),
+            outPtr(myChunkOffset_),
+            tmpPtr(blockBufferOffset_),
+            myChunkLength_);
+      }
+      phase_ = kExchangeLargerBlock;
+      issued_ = false;
+    }
+
+    // Send the partial result to the next larger block and receive the
+    // final result from it.
+    if (phase_ == kExchangeLargerBlock) {
+      if (!issued_) {
+        size_t bufferOffset = blockBufferOffset_;
+        for (const auto& piece : largerBlockPieces_) {
+          tmp->recv(
+              piece.peer,
+              slot,
+              bufferOffset * elementSize,
+              piece.length * elementSize);
+          out->send(
+              piece.peer,
+              slot,
+              piece.offset * elementSize,
+              piece.length * elementSize);
+          bufferOffset += piece.length;
+        }
+        pendingRecvs_ += largerBlockPieces_.size();
+        pendingSends_ += largerBlockPieces_.size();
+        issued_ = true;
+      }
+      if (!waitAll(tmp, out.get(), blocking)) {
+        return false;
+      }
+      if (!largerBlockPieces_.empty()) {
+        memcpy(
+            outPtr(myChunkOffset_),
+            tmpPtr(blockBufferOffset_),
+            myChunkLength_ * elementSize);
+      }
+
+      // Send the final result to the next smaller block. Completion of
+      // this send is awaited together with the sends of the allgather.
+      if (nextSmallerBlockSize_ != 0 && myChunkLength_ > 0) {
+        out->send(
+            smallerBlockPeer_,
+            slot,
+            myChunkOffset_ * elementSize,
+            myChunkLength_ * elementSize);
+        pendingSends_++;
+      }
+
+      // The chunk this process is responsible for is final and can
+      // already be broadcast locally to out[1..N], if applicable.
+      broadcastOutputs(myChunkOffset_ * elementSize, myChunkLength_ * elementSize);
+      phase_ = kAllgather;
+      step_ = 0;
+      issued_ = false;
+    }
+
+    // Allgather within the block. Iterates over the steps in reverse.
+    for (; phase_ == kAllgather; step_++, issued_ = false) {
+      if (step_ == steps_.size()) {
+        phase_ = kDone;
+        break;
+      }
+
+      const auto& step = steps_[steps_.size() - 1 - step_];
+      if (!issued_) {
+        if (step.sendLength > 0) {
+          out->recv(
+              step.peer,
+              slot,
+              step.sendOffset * elementSize,
+              step.sendLength * elementSize);
+          pendingRecvs_++;
+        }
+        if (step.recvLength > 0) {
+          out->send(
+              step.peer,
+              slot,
+              step.recvOffset * elementSize,
+              step.recvLength * elementSize);
+          pendingSends_++;
+        }
+        issued_ = true;
+      }
+
+      if (!waitAll(out.get(), out.get(), blocking)) {
+        return false;
+      }
+
+      // Broadcast result to multiple output buffers, if applicable.
+      if (step.sendLength > 0) {
+        broadcastOutputs(
+            step.sendOffset * elementSize, step.sendLength * elementSize);
+      }
+    }
+
+    // Wait for the final send to the next smaller block.
+    if (!waitAll(out.get(), out.get(), blocking)) {
+      return false;
+    }
+
+    return true;
+  }
+
+ protected:
+  // Peer, offsets, and lengths (in elements) of a step within a block.
+  // The same step is used in reverse for the allgather.
+  struct Step {
+    size_t peer;
+    size_t sendOffset;
+    size_t sendLength;
+    size_t recvOffset;
+    size_t recvLength;
+
+    // Offset in the scratch buffer to receive into.
+    size_t bufferOffset;
+  };
+
+  // Part of this process' chunk that is exchanged with a process in
+  // the next larger block.
+  struct Piece {
+    size_t peer;
+    size_t offset;
+    size_t length;
+  };
+
+  enum Phase {
+    kReduceScatter,
+    kReduceSmallerBlock,
+    kExchangeLargerBlock,
+    kAllgather,
+    kDone,
+  };
+
+  // Returns the number of elements of a chunk that are in range.
+  static size_t clamp(size_t offset, size_t length, size_t count) {
+    return offset < count ? std::min(length, count - offset) : 0;
+  }
+
+  size_t offsetToMyBlock_;
+  size_t myBlockSize_;
+  size_t nextSmallerBlockSize_;
+  size_t nextLargerBlockSize_;
+  std::vector<Step> steps_;
+  size_t myChunkOffset_;
+  size_t myChunkLength_;
+  size_t blockBufferOffset_;
+  size_t smallerBlockPeer_;
+  std::vector<Piece> largerBlockPieces_;
+
+  ScratchPool::Scratch scratch_;
+
+  // Execution state.
+  Phase phase_;
+  size_t step_;
+  bool issued_;
+  size_t pendingRecvs_;
+  size_t pendingSends_;
+
+  // Waits for the pending operations of the current phase.
+  bool waitAll(
+      transport::UnboundBuffer* recvBuf,
+      transport::UnboundBuffer* sendBuf,
+      bool blocking) {
+    for (; pendingRecvs_ > 0; pendingRecvs_--) {
+      if (!waitRecv(recvBuf, blocking)) {
+        return false;
+      }
+    }
+    for (; pendingSends_ > 0; pendingSends_--) {
+      if (!waitSend(sendBuf, blocking)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+std::unique_ptr<Schedule> createHalvingDoublingSchedule(
+    const detail::AllreduceOptionsImpl& opts) {
+  return std::unique_ptr<Schedule>(new HalvingDoublingSchedule(opts));
+}
+
+// The hierarchical algorithm takes the host layout into account (see
+// Context::getHost). It runs in three stages:
+//
+//   1. A ring reduce/scatter among the processes on the same host.
+//      Afterwards, every process holds 1/L of the host's partial
+//      result, where L is the number of processes per host.
+//   2. A ring allreduce of that part among the processes with the same
+//      local rank on every host.
+//   3. A ring allgather among the processes on the same host.
+//
+// Only the second stage crosses hosts. Every process sends 1/L of the
+// buffer over the network, instead of all of it, so the network
+// traffic per host is the same as if a single process per host
+// participated. This requires the same number of processes on every
+// host.
+//
+class HierarchicalSchedule : public Schedule {
+ public:
+  explicit HierarchicalSchedule(const detail::AllreduceOptionsImpl& opts)
+      : Schedule(opts) {
+    const auto& context = opts.context;
+    GLOO_ENFORCE(
+        hasUniformHostLayout(context),
+        "Hierarchical allreduce requires the same number of processes ",
+        "on every host");
+
+    // Ranks of the processes on this host, and of the processes with
+    // the same local rank on every host, ordered by host.
+    const int host = context->getHost(context->rank);
+    std::vector<int> localRanks;
+    std::vector<int> crossRanks(context->getNumHosts());
+    std::vector<int> localIndex(context->getNumHosts(), 0);
+    for (int i = 0; i < context->size; i++) {
+      const int h = context->getHost(i);
+      if (h == host) {
+        localRanks.push_back(i);
+      }
+      if (localIndex[h]++ == context->getLocalRank()) {
+        crossRanks[h] = i;
+      }
+    }
+
+    // Region of the buffer that this process reduces across hosts.
+    const size_t localChunk = (opts.elements + localRanks.size() - 1) /
+        localRanks.size();
+    const size_t crossOffset = std::min(
+        opts.elements, context->getLocalRank() * localChunk);
+    const size_t crossLength =
+        std::min(localChunk, opts.elements - crossOffset);
+
+    const size_t localPosition = context->getLocalRank();
+    const size_t crossPosition = host;
+    stages_.push_back(
+        Stage{localRanks, localPosition, 0, opts.elements, true});
+    stages_.push_back(
+        Stage{crossRanks, crossPosition, crossOffset, crossLength, true});
+    stages_.push_back(
+        Stage{crossRanks, crossPosition, crossOffset, crossLength, false});
+    stages_.push_back(
+        Stage{localRanks, localPosition, 0, opts.elements, false});
+
+    // Borrow scratch space to receive a chunk for reduction.
+    scratch_ = context->getScratchPool().acquire(
+        std::max(localChunk, size_t(1)) * opts.elementSize);
+  }
+
+  void reset() override {
+    Schedule::reset();
+    stage_ = 0;
+    step_ = 0;
+    issued_ = false;
+    pendingRecvs_ = 0;
+    pendingSends_ = 0;
+  }
+
+  void setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& signal) override {
+    opts_.out[0]->setCompletionSignal(signal);
+    scratch_.getUnboundBuffer()->setCompletionSignal(signal);
+  }
+
+  bool advance(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs,
+      bool blocking) override {
+    const auto& opts = opts_;
+    const auto slot = slot_;
+    const auto elementSize = opts.elementSize;
+    const size_t totalBytes = opts.elements * elementSize;
+    auto& out = opts.out[0];
+    transport::UnboundBuffer* tmp = scratch_.getUnboundBuffer();
+
+    // Prepare out[0] to hold the local reduction of the inputs.
+    if (stage_ == 0 && step_ == 0 && !issued_) {
+      reduceInputs(0, totalBytes);
+    }
+
+    for (; stage_ < stages_.size(); stage_++, step_ = 0) {
+      const auto& stage = stages_[stage_];
+      const size_t n = stage.ranks.size();
+      const int sendRank = stage.ranks[(stage.position + 1) % n];
+      const int recvRank = stage.ranks[(stage.position + n - 1) % n];
+
+      // In a reduce/scatter, this process ends up with the chunk at its
+      // own position. In an allgather, it starts with this chunk.
+      for (; step_ + 1 < n; step_++, issued_ = false) {
+        const size_t shift = stage.reduce ? step_ + 1 : step_;
+        const auto send = stage.chunk((stage.position + 2 * n - shift) % n);
+        const auto recv =
+            stage.chunk((stage.position + 2 * n - shift - 1) % n);
+        auto recvBuf = stage.reduce ? tmp : out.get();
+        if (!issued_) {
+          if (recv.second > 0) {
+            recvBuf->recv(
+                recvRank,
+                slot,
+                stage.reduce ? 0 : recv.first * elementSize,
+                recv.second * elementSize);
+            pendingRecvs_++;
+          }
+          if (send.second > 0) {
+            out->send(
+                sendRank,
+                slot,
+                send.first * elementSize,
+                send.second * elementSize);
+            pendingSends_++;
+          }
+          issued_ = true;
+        }
+
+        if (!waitAll(recvBuf, out.get(), blocking)) {
+          return false;
+        }
+
+        if (stage.reduce && recv.second > 0) {
+          opts.reduce(
+              static_cast<uint8_t*>(out->ptr) + recv.first * elementSize,
+              static_cast<const uint8_t*>(out->ptr) + recv.first * elementSize,
+              static_cast<const uint8_t*>(tmp->ptr),
+              recv.second);
+        }
+      }
+    }
+
+    if (stage_ == stages_.size()) {
+      broadcastOutputs(0, totalBytes);
+      stage_++;
+    }
+
+    return true;
+  }
+
+ protected:
+  // Ring reduce/scatter or allgather of a region of the buffer among a
+  // group of processes. The region is split into one chunk per process.
+  struct Stage {
+    std::vector<int> ranks;
+    size_t position;
+
+    // Region of the buffer in elements.
+    size_t offset;
+    size_t length;
+
+    // Reduce/scatter if set, allgather otherwise.
+    bool reduce;
+
+    // Returns offset and length of the specified chunk in elements.
+    std::pair<size_t, size_t> chunk(size_t index) const {
+      const size_t chunkLength = (length + ranks.size() - 1) / ranks.size();
+      const size_t chunkOffset = std::min(length, index * chunkLength);
+      return std::make_pair(
+          offset + chunkOffset, std::min(chunkLength, length - chunkOffset));
+    }
+  };
+
+  std::vector<Stage> stages_;
+
+  ScratchPool::Scratch scratch_;
+
+  // Execution state.
+  size_t stage_;
+  size_t step_;
+  bool issued_;
+  size_t pendingRecvs_;
+  size_t pendingSends_;
+
+  // Waits for the pending operations of the current step.
+  bool waitAll(
+      transport::UnboundBuffer* recvBuf,
+      transport::UnboundBuffer* sendBuf,
+      bool blocking) {
+    for (; pendingRecvs_ > 0; pendingRecvs_--) {
+      if (!waitRecv(recvBuf, blocking)) {
+        return false;
+      }
+    }
+    for (; pendingSends_ > 0; pendingSends_--) {
+      if (!waitSend(sendBuf, blocking)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+std::unique_ptr<Schedule> createHierarchicalSchedule(
+    const detail::AllreduceOptionsImpl& opts) {
+  return std::unique_ptr<Schedule>(new HierarchicalSchedule(opts));
+}
+
+// Parent and children of a process in a binary tree.
+// A rank of -1 means there is no parent (for the root).
+struct TreeNode {
+  int parent;
+  std::vector<int> children;
+};
+
+// Returns the node of the specified rank in a binary tree where the
+// process with the lowest set bit in its rank at position k is at
+// height k. The root is rank 0, with a single child. All odd ranks are
+// leaves, so that half the processes only send and receive once.
+TreeNode computeBinaryTreeNode(int size, int rank) {
+  TreeNode node;
+  int bit = 1;
+  while (bit < size && !(bit & rank)) {
+    bit <<= 1;
+  }
+  if (rank == 0) {
+    node.parent = -1;
+    if (size > 1) {
+      node.children.push_back(bit >> 1);
+    }
+    return node;
+  }
+
+  node.parent = (rank ^ bit) | (bit << 1);
+  if (node.parent >= size) {
+    node.parent = rank ^ bit;
+  }
+
+  int lowbit = bit >> 1;
+  if (lowbit > 0) {
+    node.children.push_back(rank - lowbit);
+    while (lowbit > 0 && rank + lowbit >= size) {
+      lowbit >>= 1;
+    }
+    if (lowbit > 0) {
+      node.children.push_back(rank + lowbit);
+    }
+  }
+  return node;
+}
+
+// Returns the node of the specified rank in the complement of the tree
+// above. It is mirrored (if the number of processes is even) or
+// shifted by one (if it is odd), so that the leaves of one tree are
+// the inner nodes of the other.
+TreeNode computeComplementaryTreeNode(int size, int rank) {
+  const bool mirror = size % 2 == 0;
+  auto map = [&](int r) {
+    if (r < 0) {
+      return r;
+    }
+    return mirror ? size - 1 - r : (r + 1) % size;
+  };
+  auto node = computeBinaryTreeNode(
+      size, mirror ? size - 1 - rank : (rank + size - 1) % size);
+  node.parent = map(node.parent);
+  for (auto& child : node.children) {
+    child = map(child);
+  }
+  return node;
+}
+
+// Allreduce of a region of the buffer along a binary tree. Segments of
+// the region are reduced up the tree and broadcast down the tree as
+// soon as they reach the root, so that all levels of the tree work on
+// different segments at the same time.
+//
+// Every peer is served by its own unbound buffer, so that completions
+// can be attributed to a peer and a segment: operations with the same
+// peer complete in order.
+//
+class TreeSchedule : public Schedule {
+ public:
+  TreeSchedule(
+      const detail::AllreduceOptionsImpl& opts,
+      const Slot& slot,
+      const TreeNode& node,
+      size_t offset,
+      size_t length,
+      size_t segmentBytes)
+      : Schedule(opts, slot),
+        node_(node),
+        offset_(offset),
+        length_(length),
+        segmentBytes_(segmentBytes),
+        numSegments_((length + segmentBytes - 1) / segmentBytes) {
+    const auto& context = opts.context;
+    const auto size = opts.elements * opts.elementSize;
+    if (node_.parent >= 0) {
+      parentBuf_ = context->createUnboundBuffer(opts.out[0]->ptr, size);
+    }
+
+    // Received segments are double buffered per child, so that the
+    // next segment can be received while reducing the current one.
+    if (!node_.children.empty()) {
+      scratch_ = context->getScratchPool().acquire(
+          node_.children.size() * 2 * segmentBytes_);
+    }
+    for (size_t i = 0; i < node_.children.size(); i++) {
+      childRecvBufs_.push_back(
+          context->createUnboundBuffer(scratch_.ptr(), scratch_.size()));
+      childSendBufs_.push_back(
+          context->createUnboundBuffer(opts.out[0]->ptr, size));
+    }
+    setCompletionSignal(std::make_shared<transport::CompletionSignal>());
+  }
+
+  void reset() override {
+    Schedule::reset();
+    upPosted_ = 0;
+    upDone_ = 0;
+    upSent_ = 0;
+    downPosted_ = 0;
+    downDone_ = 0;
+    childRecvs_.assign(node_.children.size(), 0);
+    childSends_.assign(node_.children.size(), 0);
+  }
+
+  void setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& signal) override {
+    signal_ = signal;
+    if (parentBuf_) {
+      parentBuf_->setCompletionSignal(signal);
+    }
+    for (auto& buf : childRecvBufs_) {
+      buf->setCompletionSignal(signal);
+    }
+    for (auto& buf : childSendBufs_) {
+      buf->setCompletionSignal(signal);
+    }
+  }
+
+  bool advance(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs,
+      bool blocking) override {
+    for (;;) {
+      const auto generation = signal_->generation();
+      const bool progress = poll(reduceInputs, broadcastOutputs);
+      if (done()) {
+        return true;
+      }
+      if (!progress) {
+        if (!blocking) {
+          return false;
+        }
+
+        // Sleep until one of the operations completes. Past the
+        // deadline, the next poll reports the timeout.
+        signal_->wait(generation, deadline_);
+      }
+    }
+  }
+
+ protected:
+  const TreeNode node_;
+
+  // Region of the buffer in bytes.
+  const size_t offset_;
+  const size_t length_;
+
+  const size_t segmentBytes_;
+  const size_t numSegments_;
+
+  std::unique_ptr<transport::UnboundBuffer> parentBuf_;
+  BufferVector childRecvBufs_;
+  BufferVector childSendBufs_;
+  ScratchPool::Scratch scratch_;
+  std::shared_ptr<transport::CompletionSignal> signal_;
+
+  // Execution state, in number of segments.
+  size_t upPosted_;
+  size_t upDone_;
+  size_t upSent_;
+  size_t downPosted_;
+  size_t downDone_;
+  std::vector<size_t> childRecvs_;
+  std::vector<size_t> childSends_;
+
+  size_t segmentOffset(size_t segment) const {
+    return offset_ + segment * segmentBytes_;
+  }
+
+  size_t segmentLength(size_t segment) const {
+    return std::min(segmentBytes_, length_ - segment * segmentBytes_);
+  }
+
+  size_t scratchOffset(size_t child, size_t segment) const {
+    return (child * 2 + (segment & 0x1)) * segmentBytes_;
+  }
+
+  bool done() const {
+    if (downDone_ < numSegments_) {
+      return false;
+    }
+    if (node_.parent >= 0 && upSent_ < numSegments_) {
+      return false;
+    }
+    for (const auto sends : childSends_) {
+      if (sends < numSegments_) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Makes as much progress as possible without blocking.
+  // Returns true if any progress was made.
+  bool poll(
+      const ReduceRangeFunction& reduceInputs,
+      const BroadcastRangeFunction& broadcastOutputs) {
+    const auto& opts = opts_;
+    const auto slot = slot_;
+    const auto& children = node_.children;
+    const auto& out = opts.out[0];
+    bool progress = false;
+
+    // Post receive operations for segments from children, at most two
+    // segments ahead of the reduction.
+    for (; upPosted_ < numSegments_ && upPosted_ < upDone_ + 2; upPosted_++) {
+      for (size_t i = 0; i < children.size(); i++) {
+        childRecvBufs_[i]->recv(
+            children[i],
+            slot,
+            scratchOffset(i, upPosted_),
+            segmentLength(upPosted_));
+      }
+      progress = true;
+    }
+
+    // Reduce segments from children and send them to the parent.
+    while (upDone_ < upPosted_) {
+      const auto segment = upDone_;
+      bool ready = true;
+      for (size_t i = 0; i < children.size(); i++) {
+        if (childRecvs_[i] > segment) {
+          continue;
+        }
+        if (!waitRecv(childRecvBufs_[i].get(), false)) {
+          ready = false;
+          continue;
+        }
+        childRecvs_[i]++;
+        progress = true;
+      }
+      if (!ready) {
+        break;
+      }
+      const auto offset = segmentOffset(segment);
+      const auto length = segmentLength(segment);
+      reduceInputs(offset, length);
+      for (size_t i = 0; i < children.size(); i++) {
+        opts.reduce(
+            static_cast<uint8_t*>(out->ptr) + offset,
+            static_cast<const uint8_t*>(out->ptr) + offset,
+            static_cast<const uint8_t*>(scratch_.ptr()) +
+                scratchOffset(i, segment),
+            length / opts.elementSize);
+      }
+      if (node_.parent >= 0) {
+        parentBuf_->send(node_.parent, slot, offset, length);
+      }
+      upDone_++;
+      progress = true;
+    }
+
+    if (node_.parent >= 0) {
+      // A segment can only be received from the parent after it has
+      // been sent to the parent, because it is received in place.
+      for (; upSent_ < upDone_; upSent_++) {
+        if (!waitSend(parentBuf_.get(), false)) {
+          break;
+        }
+        progress = true;
+      }
+      for (; downPosted_ < upSent_; downPosted_++) {
+        parentBuf_->recv(
+            node_.parent,
+            slot,
+            segmentOffset(downPosted_),
+            segmentLength(downPosted_));
+        progress = true;
+      }
+    } else {
+      // The root has the final result as soon as it is reduced.
+      downPosted_ = upDone_;
+    }
+
+    // Broadcast segments to children.
+    for (; downDone_ < downPosted_; downDone_++) {
+      if (node_.parent >= 0 && !waitRecv(parentBuf_.get(), false)) {
+        break;
+      }
+      const auto offset = segmentOffset(downDone_);
+      const auto length = segmentLength(downDone_);
+      broadcastOutputs(offset, length);
+      for (size_t i = 0; i < children.size(); i++) {
+        childSendBufs_[i]->send(children[i], slot, offset, length);
+      }
+      progress = true;
+    }
+
+    for (size_t i = 0; i < children.size(); i++) {
+      for (; childSends_[i] < downDone_; childSends_[i]++) {
+        if (!waitSend(childSendBufs_[i].get(), false)) {
+          break;
+        }
+        progress = true;
+      }
+    }
+
+    return progress;
+  }
+};
+
+// The double binary tree algorithm runs an allreduce along two
+// complementary binary trees concurrently, each on half of the buffer.
+// A binary tree takes 2 * log2(P) steps, but its leaves (half of the
+// processes) send and receive only once, and its inner nodes send
+// every segment twice. In the complementary tree, the leaves of the
+// first tree are inner nodes and vice versa, so that every process
+// sends and receives about as much as in the ring algorithm.
+//
+// Segments are pipelined through the trees. The segment size is chosen
+// such that a tree has at least kMinTreeSegments segments in flight,
+// unless this would make them smaller than kMinTreeSegmentSize.
+//
+class DoubleBinaryTreeSchedule : public ConcurrentSchedule {
+ public:
+  static constexpr size_t kMinTreeSegments = 8;
+  static constexpr size_t kMinTreeSegmentSize = 4096;
+
+  DoubleBinaryTreeSchedule(
+      const detail::AllreduceOptionsImpl& opts,
+      size_t maxSegmentSize)
+      : ConcurrentSchedule(opts) {
+    const auto& context = opts.context;
+    const auto elementSize = opts.elementSize;
+    const size_t halfElements = (opts.elements + 1) / 2;
+
+    size_t segmentBytes = std::min(
+        maxSegmentSize,
+        std::max(
+            kMinTreeSegmentSize,
+            (halfElements * elementSize + kMinTreeSegments - 1) /
+                kMinTreeSegments));
+    segmentBytes = elementSize * std::max((size_t)1, segmentBytes / elementSize);
+
+    const std::array<TreeNode, 2> nodes = {
+        computeBinaryTreeNode(context->size, context->rank),
+        computeComplementaryTreeNode(context->size, context->rank),
+    };
+    for (size_t i = 0; i < nodes.size(); i++) {
+      const size_t offset = std::min(opts.elements, i * halfElements);
+      const size_t length = std::min(halfElements, opts.elements - offset);
+      if (length == 0) {
+        break;
+      }
+      schedules_.emplace_back(new TreeSchedule(
+          opts,
+          slot_ + static_cast<uint8_t>(i),
+          nodes[i],
+          offset * elementSize,
+          length * elementSize,
+          segmentBytes));
+    }
+  }
+};
+
+constexpr size_t DoubleBinaryTreeSchedule::kMinTreeSegments;
+constexpr size_t DoubleBinaryTreeSchedule::kMinTreeSegmentSize;
+
+std::unique_ptr<Schedule> createDoubleBinaryTreeSchedule(
+    const detail::AllreduceOptionsImpl& opts,
+    size_t maxSegmentSize) {
+  return std::unique_ptr<Schedule>(
+      new DoubleBinaryTreeSchedule(opts, maxSegmentSize));
+}
+
+} // namespace
+
+void allreduce(const AllreduceOptions& opts) {
   allreduce(opts.impl_);
 }
 
+struct AllreducePlan::State {
+  ReduceRangeFunction reduceInputs;
+  BroadcastRangeFunction broadcastOutputs;
+
+  // Only set if there is more than a single process.
+  std::unique_ptr<Schedule> schedule;
+};
+
+AllreducePlan::AllreducePlan(AllreduceOptions opts)
+    : opts_(std::move(opts.impl_)), state_(new State) {
+  if (opts_.elements == 0) {
+    return;
+  }
+
+  validate(opts_);
+
+  // The functions capture references to the buffer vectors in opts_.
+  // This is safe because a plan can be neither copied nor moved.
+  state_->reduceInputs = genLocalReduceFunction(
+      opts_.in,
+      opts_.out,
+      opts_.elementSize,
+      opts_.reduce,
+      getReduceKernels(opts_),
+      getAverageFactor(opts_));
+  state_->broadcastOutputs = genLocalBroadcastFunction(opts_.out);
+  if (opts_.context->size > 1) {
+    state_->schedule = createSchedule(opts_);
+  }
+}
+
+AllreducePlan::~AllreducePlan() {}
+
+void AllreducePlan::execute() {
+  if (opts_.elements == 0) {
+    return;
+  }
+
+  // Simple circuit if there is only a single process.
+  if (!state_->schedule) {
+    const size_t totalBytes = opts_.elements * opts_.elementSize;
+    state_->reduceInputs(0, totalBytes);
+    state_->broadcastOutputs(0, totalBytes);
+    return;
+  }
+
+  state_->schedule->run(state_->reduceInputs, state_->broadcastOutputs);
+}
+
+namespace {
+
+// Allreduce that executes as a state machine on a scheduler.
+class AllreduceOperation : public AllreducePlan, public Operation {
+ public:
+  explicit AllreduceOperation(AllreduceOptions opts)
+      : AllreducePlan(std::move(opts)) {
+    // The timeout starts when the operation is submitted.
+    if (state_->schedule) {
+      state_->schedule->reset();
+    }
+  }
+
+  bool poll() override {
+    if (!state_->schedule) {
+      execute();
+      return true;
+    }
+    return state_->schedule->advance(
+        state_->reduceInputs, state_->broadcastOutputs, false);
+  }
+
+  bool setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& signal) override {
+    if (!state_->schedule) {
+      return false;
+    }
+    state_->schedule->setCompletionSignal(signal);
+    return true;
+  }
+
+  std::chrono::steady_clock::time_point getDeadline() const override {
+    if (!state_->schedule) {
+      return std::chrono::steady_clock::time_point::max();
+    }
+    return state_->schedule->getDeadline();
+  }
+};
+
+} // namespace
+
+std::shared_ptr<Work> iallreduce(AllreduceOptions opts) {
+  return iallreduce(std::move(opts), Scheduler::getDefault());
+}
+
+std::shared_ptr<Work> iallreduce(AllreduceOptions opts, Scheduler& scheduler) {
+  return scheduler.submit(std::unique_ptr<Operation>(
+      new AllreduceOperation(std::move(opts))));
+}
+
 } // namespace gloo
@@ -13,7 +13,10 @@
 #include <vector>
 
 #include "gloo/context.h"
+#include "gloo/reduce_op.h"
+#include "gloo/scheduler.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -39,6 +42,9 @@ struct AllreduceOptionsImpl {
     UNSPECIFIED = 0,
     RING = 1,
     BCUBE = 2,
+    HALVING_DOUBLING = 3,
+    HIERARCHICAL = 4,
+    DOUBLE_BINARY_TREE = 5,
   };
 
   explicit AllreduceOptionsImpl(const std::shared_ptr<Context>& context)
@@ -68,12 +74,20 @@ struct AllreduceOptionsImpl {
   // Reduction function.
   Func reduce;
 
+  // Built-in reduction operation, if specified (see setReduceOp).
+  // The reduction function is then set to its kernel for the data type.
+  ReduceOp reduceOp = ReduceOp::UNSPECIFIED;
+
+  // Type of the elements. Unspecified if the buffers were set with a
+  // type that is not supported by the built-in reduction operations.
+  DataType dataType = DataType::UNSPECIFIED;
+
   // Tag for this operation.
   // Must be unique across operations executing in parallel.
   uint32_t tag = 0;
 
   // This is the maximum size of each I/O operation (send/recv) of which
-  // two are in flight at all times. A smaller value leads to more
+  // pipelineDepth are in flight at all times. A smaller value leads to more
   // overhead and a larger value leads to poor cache behavior.
   static constexpr size_t kMaxSegmentSize = 1024 * 1024;
 
@@ -82,6 +96,28 @@ struct AllreduceOptionsImpl {
   // (because they would require millions of elements if the default
   // were not configurable).
   size_t maxSegmentSize = kMaxSegmentSize;
+
+  // Number of rings that the ring algorithm runs concurrently, each on
+  // a part of the buffer (see setRings).
+  size_t rings = 1;
+
+  // Number of segments that the ring algorithm keeps in flight, each
+  // with its own scratch space (see setPipelineDepth).
+  size_t pipelineDepth = 2;
+
+  // Number of worker threads that execute the local reductions of the
+  // ring algorithm. If zero, they are executed by the calling thread
+  // (see setReductionThreads).
+  size_t reductionThreads = 0;
+
+  // Type that float32 data is transferred as by the ring algorithm, or
+  // unspecified to transfer it as is (see setCompression).
+  DataType compression = DataType::UNSPECIFIED;
+
+  // Caller owned error feedback buffer with one element per element of
+  // the outputs, or null (see setErrorFeedback).
+  float* residual = nullptr;
+  size_t residualElements = 0;
 };
 
 } // namespace detail
@@ -110,6 +146,7 @@ class AllreduceOptions {
     impl_.elements = bufs[0]->size / sizeof(T);
     impl_.elementSize = sizeof(T);
     impl_.in = std::move(bufs);
+    setDataType(getDataType<T>());
   }
 
   template <typename T>
@@ -131,6 +168,7 @@ class AllreduceOptions {
       impl_.in.push_back(
           impl_.context->createUnboundBuffer(ptrs[i], elements * sizeof(T)));
     }
+    setDataType(getDataType<T>());
   }
 
   template <typename T>
@@ -145,6 +183,7 @@ class AllreduceOptions {
     impl_.elements = bufs[0]->size / sizeof(T);
     impl_.elementSize = sizeof(T);
     impl_.out = std::move(bufs);
+    setDataType(getDataType<T>());
   }
 
   template <typename T>
@@ -166,10 +205,24 @@ class AllreduceOptions {
       impl_.out.push_back(
           impl_.context->createUnboundBuffer(ptrs[i], elements * sizeof(T)));
     }
+    setDataType(getDataType<T>());
   }
 
+  // Use a custom reduction function. Overrides a built-in reduction
+  // operation that was set before (see setReduceOp).
   void setReduceFunction(Func fn) {
     impl_.reduce = fn;
+    impl_.reduceOp = ReduceOp::UNSPECIFIED;
+  }
+
+  // Use a built-in reduction operation. Its kernels are selected for
+  // the type of the input and output buffers, which must be one of the
+  // types in gloo/reduce_op.h. Unlike with a custom reduction
+  // function, this lets the collective select specialized kernels,
+  // such as a single pass reduction of multiple inputs.
+  void setReduceOp(ReduceOp op) {
+    impl_.reduceOp = op;
+    updateReduceFunction();
   }
 
   void setTag(uint32_t tag) {
@@ -180,6 +233,66 @@ class AllreduceOptions {
     impl_.maxSegmentSize = maxSegmentSize;
   }
 
+  // Run the ring algorithm on the specified number of rings
+  // concurrently, each on a part of the buffer. The first two rings
+  // rotate in opposite directions, so that both directions of every
+  // link between processes are used. Additional rings use different
+  // permutations of the processes.
+  void setRings(size_t rings) {
+    impl_.rings = rings;
+  }
+
+  // Number of segments the ring algorithm keeps in flight (2 to 16).
+  // Every segment needs its own scratch space, and the buffer is split
+  // into at least this many segments per process.
+  void setPipelineDepth(size_t depth) {
+    impl_.pipelineDepth = depth;
+  }
+
+  // Execute the local reductions of the ring algorithm on a pool of
+  // the specified number of threads, so that they overlap with the
+  // network I/O instead of delaying it. This includes the reduction
+  // of multiple inputs and the broadcast to multiple outputs. Pools
+  // are shared by all operations in the process.
+  //
+  // The reduction of a segment overlaps with the I/O of the other
+  // segments in flight, so this is best combined with a pipeline
+  // depth larger than 2 (see setPipelineDepth).
+  void setReductionThreads(size_t threads) {
+    impl_.reductionThreads = threads;
+  }
+
+  // Transfer float32 data as float16 or bfloat16, which halves the
+  // number of bytes on the wire, or as INT8, which quarters it.
+  // Segments are converted as they are sent and received, and reduced
+  // in float32. Requires a built-in reduction operation (see
+  // setReduceOp) and the ring algorithm, which is selected if no
+  // algorithm is specified.
+  //
+  // The partial results are rounded to the narrower type at every step
+  // of the ring, so the error grows with the number of processes. With
+  // float16, results beyond its range (65504) become infinite. With
+  // bfloat16, the range is the same as float32, but the precision is
+  // only 8 bits. With int8, every block of kQuantizationBlockSize
+  // elements is scaled by its largest absolute value, so the error of
+  // an element is up to 1/254 of the largest value in its block. Every
+  // process ends up with the same result.
+  void setCompression(DataType type) {
+    impl_.compression = type;
+  }
+
+  // Compensate for the rounding error of compression over successive
+  // allreduce calls (error feedback). The caller owns the buffer and
+  // passes the same one to every call, initialized to zeros before the
+  // first. It must have as many elements as the outputs. The rounding
+  // error of every value this process compresses is kept in the
+  // buffer, and added to the local input of the next call. Requires
+  // compression and ReduceOp::SUM or ReduceOp::AVG.
+  void setErrorFeedback(float* residual, size_t elements) {
+    impl_.residual = residual;
+    impl_.residualElements = elements;
+  }
+
   void setTimeout(std::chrono::milliseconds timeout) {
     impl_.timeout = timeout;
   }
@@ -187,9 +300,64 @@ class AllreduceOptions {
  protected:
   detail::AllreduceOptionsImpl impl_;
 
+  void setDataType(DataType type) {
+    impl_.dataType = type;
+    updateReduceFunction();
+  }
+
+  // Selects the kernel of the built-in reduction operation, if any.
+  // Buffers and operation can be set in any order.
+  void updateReduceFunction() {
+    if (impl_.reduceOp != ReduceOp::UNSPECIFIED &&
+        impl_.dataType != DataType::UNSPECIFIED) {
+      impl_.reduce = getReduceKernels(impl_.reduceOp, impl_.dataType).binary;
+    }
+  }
+
   friend void allreduce(const AllreduceOptions&);
+  friend class AllreducePlan;
 };
 
 void allreduce(const AllreduceOptions& opts);
 
+// Non-blocking variant of allreduce. Executes as a state machine on
+// the default scheduler (see gloo/scheduler.h), so that operations in
+// flight don't need a thread each.
+std::shared_ptr<Work> iallreduce(AllreduceOptions opts);
+
+// Non-blocking variant of allreduce that executes as a state machine
+// on the specified scheduler; see gloo/scheduler.h.
+std::shared_ptr<Work> iallreduce(AllreduceOptions opts, Scheduler& scheduler);
+
+// Persistent allreduce.
+//
+// Everything that only depends on the options is done once, when the
+// plan is created: validating the buffers, creating the local
+// reduction and broadcast functions, computing the algorithm schedule,
+// and borrowing scratch space. Every call to execute() then runs the
+// collective on the same buffers without further allocations.
+//
+// The plan holds on to its scratch space for as long as it lives.
+// Executions of different plans (or of a plan and a regular call to
+// allreduce) must use different tags if they run concurrently.
+//
+class AllreducePlan {
+ public:
+  explicit AllreducePlan(AllreduceOptions opts);
+
+  ~AllreducePlan();
+
+  AllreducePlan(const AllreducePlan&) = delete;
+
+  AllreducePlan& operator=(const AllreducePlan&) = delete;
+
+  void execute();
+
+ protected:
+  struct State;
+
+  detail::AllreduceOptionsImpl opts_;
+  std::unique_ptr<State> state_;
+};
+
 } // namespace gloo
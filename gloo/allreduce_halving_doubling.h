@@ -78,7 +78,14 @@ class AllreduceHalvingDoubling : public Algorithm {
         chunkSize_((count_ + chunks_ - 1) / chunks_),
         chunkBytes_(chunkSize_ * sizeof(T)),
         fn_(fn),
-        recvBuf_(chunkSize_ << steps_),
+        recvScratch_(
+            count_ == 0 || this->contextSize_ == 1
+                ? ScratchPool::Scratch()
+                : context->getScratchPool().acquire(
+                      (chunkSize_ << steps_) * sizeof(T))),
+        recvBuf_(
+            recvScratch_ ? reinterpret_cast<T*>(recvScratch_.ptr())
+                         : nullptr),
         sendOffsets_(steps_),
         recvOffsets_(steps_),
         sendCounts_(steps_, 0),
@@ -371,7 +378,9 @@ class AllreduceHalvingDoubling : public Algorithm {
   const ReductionFunction<T>* fn_;
 
   // buffer where data is received prior to being reduced
-  std::vector<T> recvBuf_;
+  // (borrowed from the context's scratch pool)
+  ScratchPool::Scratch recvScratch_;
+  T* recvBuf_;
 
   // offsets into the data buffer from which to send during the reduce-scatter
   // these become the offsets at which the process receives during the allgather
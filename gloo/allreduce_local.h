@@ -31,6 +31,9 @@ class AllreduceLocal : public Algorithm {
   const int count_;
   const int bytes_;
   const ReductionFunction<T>* fn_;
+
+  // Same as ptrs_, for the N-ary reduction functions.
+  const std::vector<const T*> inputs_;
 };
 
 } // namespace gloo
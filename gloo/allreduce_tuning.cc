@@ -0,0 +1,353 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/allreduce_tuning.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "gloo/common/logging.h"
+#include "gloo/math.h"
+
+namespace gloo {
+
+namespace {
+
+size_t parseNumber(const std::string& str, const std::string& text) {
+  size_t pos = 0;
+  size_t value = 0;
+  try {
+    value = std::stoull(str, &pos);
+  } catch (const std::exception&) {
+    pos = 0;
+  }
+  GLOO_ENFORCE(
+      pos > 0 && pos == str.size(),
+      "Invalid number '",
+      str,
+      "' in: ",
+      text);
+  return value;
+}
+
+AllreduceTuningTable::Range parseRange(
+    const std::string& str,
+    const std::string& rule) {
+  AllreduceTuningTable::Range range;
+  const auto pos = str.find('-');
+  if (pos == std::string::npos) {
+    range.min = parseNumber(str, rule);
+    range.max = range.min;
+  } else {
+    range.min = parseNumber(str.substr(0, pos), rule);
+    if (pos + 1 < str.size()) {
+      range.max = parseNumber(str.substr(pos + 1), rule);
+    }
+  }
+  GLOO_ENFORCE_LE(range.min, range.max, "Invalid range in rule: ", rule);
+  return range;
+}
+
+AllreduceTuningTable::Rule parseRule(const std::string& line) {
+  AllreduceTuningTable::Rule rule;
+  bool hasAlgorithm = false;
+  std::istringstream iss(line);
+  std::string token;
+  while (iss >> token) {
+    const auto pos = token.find('=');
+    GLOO_ENFORCE(
+        pos != std::string::npos,
+        "Expected key=value in allreduce tuning rule: ",
+        line);
+    const auto key = token.substr(0, pos);
+    const auto value = token.substr(pos + 1);
+    if (key == "size") {
+      rule.size = parseRange(value, line);
+    } else if (key == "hosts") {
+      rule.hosts = parseRange(value, line);
+    } else if (key == "bytes") {
+      rule.bytes = parseRange(value, line);
+    } else if (key == "segment") {
+      rule.maxSegmentSize = parseNumber(value, line);
+      GLOO_ENFORCE_GT(rule.maxSegmentSize, 0, "Invalid segment size: ", line);
+    } else if (key == "algorithm") {
+      if (value == "ring") {
+        rule.algorithm = AllreduceTuningTable::Algorithm::RING;
+      } else if (value == "bcube") {
+        rule.algorithm = AllreduceTuningTable::Algorithm::BCUBE;
+      } else if (value == "halving_doubling") {
+        rule.algorithm = AllreduceTuningTable::Algorithm::HALVING_DOUBLING;
+      } else if (value == "hierarchical") {
+        rule.algorithm = AllreduceTuningTable::Algorithm::HIERARCHICAL;
+      } else if (value == "double_binary_tree") {
+        rule.algorithm = AllreduceTuningTable::Algorithm::DOUBLE_BINARY_TREE;
+      } else {
+        GLOO_ENFORCE(false, "Unknown algorithm '", value, "' in rule: ", line);
+      }
+      hasAlgorithm = true;
+    } else {
+      GLOO_ENFORCE(false, "Unknown key '", key, "' in rule: ", line);
+    }
+  }
+  GLOO_ENFORCE(hasAlgorithm, "Missing algorithm in rule: ", line);
+  return rule;
+}
+
+// Number of processes in a bcube group at every step (with base 2).
+std::vector<size_t> bcubeGroupSizes(size_t size) {
+  std::vector<size_t> result;
+  while (size % 2 == 0) {
+    result.push_back(2);
+    size /= 2;
+  }
+  if (size > 1) {
+    result.push_back(size);
+  }
+  return result;
+}
+
+// Number of sequential messages of the halving/doubling algorithm: the
+// steps within the largest binary block, plus the exchanges along the
+// chain of smaller blocks (see HalvingDoublingSchedule).
+size_t halvingDoublingMessages(size_t size) {
+  size_t blocks = 0;
+  size_t largest = 0;
+  for (size_t bit = 0; (size >> bit) > 0; bit++) {
+    if (size & (size_t(1) << bit)) {
+      blocks++;
+      largest = bit;
+    }
+  }
+  return 2 * (largest + blocks - 1);
+}
+
+// Cost of the ring algorithm in microseconds, with every chunk split
+// into segments of the specified size. Every step sends one segment
+// per process. The transfer and reduction of a segment overlap with
+// those of the next, except for the last segment of every step of the
+// reduce/scatter, so smaller segments shorten the pipeline at the cost
+// of more messages.
+double ringCost(
+    int size,
+    size_t bytes,
+    size_t segmentBytes,
+    double bandwidthMbps,
+    const AllreduceLinkModel& model) {
+  const double p = size;
+  const double n = bytes;
+  const size_t segments = roundUp(
+      std::max((bytes + segmentBytes - 1) / segmentBytes, (size_t)size * 2),
+      (size_t)size);
+  const double byteMicros = 8 / bandwidthMbps + 1 / model.reduceBytesPerMicro;
+  return 2 * (segments - segments / size) * model.latencyMicros +
+      2 * ((p - 1) / p) * n / (bandwidthMbps / 8) +
+      (p - 1) * (n / segments) * byteMicros;
+}
+
+// Returns the segment size that minimizes the estimated cost of the
+// ring algorithm (see ringCost), in the same way getPipelineSegments
+// does for the pipelined tree reduce.
+size_t ringSegmentSize(
+    int size,
+    size_t bytes,
+    double bandwidthMbps,
+    const AllreduceLinkModel& model) {
+  const size_t maxSegmentSize = detail::AllreduceOptionsImpl::kMaxSegmentSize;
+  if (size < 2 || bytes == 0) {
+    return maxSegmentSize;
+  }
+  const double byteMicros = 8 / bandwidthMbps + 1 / model.reduceBytesPerMicro;
+  const double segments = std::max(
+      std::sqrt(size * bytes * byteMicros / (2 * model.latencyMicros)), 1.0);
+  const auto segmentBytes = static_cast<size_t>(std::ceil(bytes / segments));
+  return std::min(std::max(segmentBytes, (size_t)1), maxSegmentSize);
+}
+
+} // namespace
+
+AllreduceTuningTable AllreduceTuningTable::parse(const std::string& text) {
+  AllreduceTuningTable table;
+  std::string normalized(text);
+  std::replace(normalized.begin(), normalized.end(), ';', '\n');
+  std::istringstream iss(normalized);
+  std::string line;
+  while (std::getline(iss, line)) {
+    const auto begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#') {
+      continue;
+    }
+    table.rules.push_back(parseRule(line));
+  }
+  return table;
+}
+
+AllreduceTuningTable AllreduceTuningTable::load(const std::string& path) {
+  std::ifstream ifs(path);
+  GLOO_ENFORCE(ifs, "Unable to read allreduce tuning table: ", path);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return parse(ss.str());
+}
+
+const AllreduceTuningTable& AllreduceTuningTable::getDefault() {
+  static const AllreduceTuningTable table = [] {
+    AllreduceTuningTable result;
+    const char* inlineRules = getenv("GLOO_ALLREDUCE_TUNING");
+    if (inlineRules != nullptr) {
+      result = parse(inlineRules);
+    }
+    const char* path = getenv("GLOO_ALLREDUCE_TUNING_FILE");
+    if (path != nullptr) {
+      const auto file = load(path);
+      result.rules.insert(
+          result.rules.end(), file.rules.begin(), file.rules.end());
+    }
+    return result;
+  }();
+  return table;
+}
+
+const AllreduceTuningTable::Rule* AllreduceTuningTable::lookup(
+    int size,
+    int hosts,
+    size_t bytes) const {
+  for (const auto& rule : rules) {
+    if (rule.size.contains(size) && rule.hosts.contains(hosts) &&
+        rule.bytes.contains(bytes)) {
+      return &rule;
+    }
+  }
+  return nullptr;
+}
+
+AllreduceLinkModel AllreduceLinkModel::parse(const std::string& text) {
+  AllreduceLinkModel model;
+  std::istringstream iss(text);
+  std::string token;
+  while (iss >> token) {
+    const auto pos = token.find('=');
+    GLOO_ENFORCE(
+        pos != std::string::npos, "Expected key=value in link model: ", text);
+    const auto key = token.substr(0, pos);
+    const auto value =
+        static_cast<double>(parseNumber(token.substr(pos + 1), text));
+    GLOO_ENFORCE_GT(value, 0, "Invalid value in link model: ", text);
+    if (key == "bandwidth") {
+      model.bandwidthMbps = value;
+    } else if (key == "local_bandwidth") {
+      model.localBandwidthMbps = value;
+    } else if (key == "latency") {
+      model.latencyMicros = value;
+    } else if (key == "reduce") {
+      model.reduceBytesPerMicro = value;
+    } else {
+      GLOO_ENFORCE(false, "Unknown key '", key, "' in link model: ", text);
+    }
+  }
+  return model;
+}
+
+const AllreduceLinkModel& AllreduceLinkModel::getDefault() {
+  static const AllreduceLinkModel model = [] {
+    const char* text = getenv("GLOO_ALLREDUCE_LINK_MODEL");
+    return text != nullptr ? parse(text) : AllreduceLinkModel();
+  }();
+  return model;
+}
+
+AllreduceSelection selectAllreduceAlgorithm(
+    int size,
+    int hosts,
+    size_t bytes,
+    const AllreduceLinkModel& model,
+    const AllreduceTuningTable& table) {
+  AllreduceSelection selection;
+  const double bandwidth =
+      hosts > 1 ? model.bandwidthMbps : model.localBandwidthMbps;
+  selection.maxSegmentSize = ringSegmentSize(size, bytes, bandwidth, model);
+
+  const auto rule = table.lookup(size, hosts, bytes);
+  if (rule != nullptr) {
+    selection.algorithm = rule->algorithm;
+    if (rule->maxSegmentSize > 0) {
+      selection.maxSegmentSize = rule->maxSegmentSize;
+    }
+    return selection;
+  }
+
+  // All flat algorithms send and receive 2 * (P - 1) / P times the
+  // buffer. The ring algorithm needs 2 * (P - 1) steps (more if the
+  // buffer is split into more segments than 2 * P). Its reductions
+  // mostly overlap with I/O (see ringCost), and if processes are
+  // numbered by host, only one process per host sends over the
+  // network at any time. The bcube
+  // algorithm needs 2 * log2(P) steps when P is a power of two, but its
+  // reductions do not overlap with I/O, and all processes on a host
+  // share its network link.
+  const double p = size;
+  const double n = bytes;
+  const double perHost = (size + hosts - 1) / hosts;
+  const double sharedBandwidth =
+      hosts > 1 ? model.bandwidthMbps / perHost : model.localBandwidthMbps;
+  const double sharedTransferMicros =
+      2 * ((p - 1) / p) * n / (sharedBandwidth / 8);
+  const double reduceMicros = ((p - 1) / p) * n / model.reduceBytesPerMicro;
+
+  const double ringMicros =
+      ringCost(size, bytes, selection.maxSegmentSize, bandwidth, model);
+
+  double bcubeMessages = 0;
+  for (const auto groupSize : bcubeGroupSizes(size)) {
+    bcubeMessages += 2 * (groupSize - 1);
+  }
+  const double bcubeMicros = bcubeMessages * model.latencyMicros +
+      sharedTransferMicros + reduceMicros;
+
+  selection.algorithm = bcubeMicros < ringMicros
+      ? AllreduceOptions::Algorithm::BCUBE
+      : AllreduceOptions::Algorithm::RING;
+  double bestMicros = std::min(bcubeMicros, ringMicros);
+
+  // The halving/doubling algorithm has the same cost structure as the
+  // bcube algorithm, but takes fewer steps if the number of processes
+  // has a large prime factor (e.g. 10 steps instead of 24 steps for 13
+  // processes). If both take the same number of steps
+  // (e.g. for powers of two), they are equivalent.
+  const double halvingDoublingMicros =
+      halvingDoublingMessages(size) * model.latencyMicros +
+      sharedTransferMicros + reduceMicros;
+  if (halvingDoublingMicros < bestMicros) {
+    selection.algorithm = AllreduceOptions::Algorithm::HALVING_DOUBLING;
+    bestMicros = halvingDoublingMicros;
+  }
+
+  // The hierarchical algorithm runs a ring reduce/scatter and allgather
+  // among the L processes on a host, and a ring allreduce of 1/L of the
+  // buffer among the H hosts. It needs 2 * (L - 1) + 2 * (H - 1) steps,
+  // and sends as much over the network per host as the ring algorithm.
+  // It requires the same number of processes on every host.
+  if (hosts > 1 && size % hosts == 0 && size / hosts > 1) {
+    const double l = size / hosts;
+    const double h = hosts;
+    const double hierarchicalMicros =
+        2 * ((l - 1) + (h - 1)) * model.latencyMicros +
+        2 * ((l - 1) / l) * n / (model.localBandwidthMbps / 8) +
+        2 * ((h - 1) / h) * n / (model.bandwidthMbps / 8) +
+        ((l - 1) / l + (h - 1) / h / l) * n / model.reduceBytesPerMicro;
+    if (hierarchicalMicros < bestMicros) {
+      selection.algorithm = AllreduceOptions::Algorithm::HIERARCHICAL;
+    }
+  }
+  return selection;
+}
+
+} // namespace gloo
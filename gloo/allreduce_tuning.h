@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "gloo/allreduce.h"
+
+namespace gloo {
+
+// Table of rules that override the automatic selection of the
+// allreduce algorithm (see selectAllreduceAlgorithm). The table must
+// be identical across processes.
+//
+// Every rule is a line of space separated key=value pairs. Lines that
+// are empty or start with '#' are ignored. Rules may also be separated
+// by ';' instead of newlines. The first rule that matches is used.
+//
+// Conditions (a rule matches if all its conditions are met):
+//
+//   size=RANGE     number of processes
+//   hosts=RANGE    number of hosts
+//   bytes=RANGE    size of the buffer being reduced in bytes
+//
+// A range is either a single number (e.g. "8"), a closed range (e.g.
+// "2-8"), or a range that is open on the right (e.g. "1048576-").
+//
+// Results:
+//
+//   algorithm=NAME   algorithm to use (ring, bcube, halving_doubling,
+//                    hierarchical, or double_binary_tree), required
+//   segment=BYTES    maximum segment size for the ring and double
+//                    binary tree algorithms
+//
+// Example:
+//
+//   # Small buffers on many processes.
+//   size=64- bytes=0-65536 algorithm=bcube
+//   bytes=1048576- algorithm=ring segment=524288
+//
+class AllreduceTuningTable {
+ public:
+  using Algorithm = AllreduceOptions::Algorithm;
+
+  struct Range {
+    size_t min = 0;
+    size_t max = std::numeric_limits<size_t>::max();
+
+    bool contains(size_t value) const {
+      return value >= min && value <= max;
+    }
+  };
+
+  struct Rule {
+    Range size;
+    Range hosts;
+    Range bytes;
+    Algorithm algorithm;
+
+    // Zero if not specified.
+    size_t maxSegmentSize = 0;
+  };
+
+  // Throws if the text cannot be parsed.
+  static AllreduceTuningTable parse(const std::string& text);
+
+  // Throws if the file cannot be read or parsed.
+  static AllreduceTuningTable load(const std::string& path);
+
+  // Returns the table specified by the environment, which is read on
+  // first use. GLOO_ALLREDUCE_TUNING_FILE specifies the path of a file
+  // with rules. GLOO_ALLREDUCE_TUNING specifies rules inline (separated
+  // by ';') and takes precedence over the rules in the file.
+  static const AllreduceTuningTable& getDefault();
+
+  // Returns the first rule that matches, or nullptr.
+  const Rule* lookup(int size, int hosts, size_t bytes) const;
+
+  std::vector<Rule> rules;
+};
+
+struct AllreduceSelection {
+  AllreduceOptions::Algorithm algorithm;
+  size_t maxSegmentSize;
+};
+
+// Characteristics of the links between processes used to estimate
+// the cost of the allreduce algorithms.
+//
+// Every process must select the same algorithm, so the model must be
+// identical across processes. This is why it is not derived from
+// local properties (e.g. the speed of the network interface), but
+// specified through the environment (see getDefault).
+//
+struct AllreduceLinkModel {
+  // Bandwidth between processes on different hosts.
+  double bandwidthMbps = 10000;
+
+  // Bandwidth between processes on the same host.
+  double localBandwidthMbps = 40000;
+
+  // Fixed cost per message.
+  double latencyMicros = 10;
+
+  // Throughput of the reduction function.
+  double reduceBytesPerMicro = 4000;
+
+  // Parses space separated key=value pairs, with keys bandwidth,
+  // local_bandwidth (both in Mbps), latency (in microseconds), and
+  // reduce (in bytes per microsecond). Unspecified values keep their
+  // default. Throws if the text cannot be parsed.
+  static AllreduceLinkModel parse(const std::string& text);
+
+  // Returns the model specified by GLOO_ALLREDUCE_LINK_MODEL, which is
+  // read on first use, or the default model if it is not set.
+  static const AllreduceLinkModel& getDefault();
+};
+
+// Selects the allreduce algorithm (and ring segment size) for a buffer
+// of the specified size. The tuning table is consulted first. If none
+// of its rules match, the algorithm with the lowest estimated cost
+// according to the link model is used. The hierarchical algorithm is
+// only considered if the processes can be spread evenly over the hosts.
+// The double binary tree algorithm is never selected automatically: in
+// this model, it never beats halving/doubling, and it only pays off
+// where the model doesn't hold (e.g. on congested networks). Use a
+// tuning table rule to select it.
+//
+// Unless a matching rule specifies it, the segment size is the one
+// that minimizes the estimated cost of the ring algorithm. It grows
+// with the square root of the buffer size, up to kMaxSegmentSize.
+AllreduceSelection selectAllreduceAlgorithm(
+    int size,
+    int hosts,
+    size_t bytes,
+    const AllreduceLinkModel& model,
+    const AllreduceTuningTable& table);
+
+} // namespace gloo
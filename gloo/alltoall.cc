@@ -53,4 +53,9 @@ void alltoall(AlltoallOptions& opts) {
   }
 }
 
+std::shared_ptr<Work> ialltoall(AlltoallOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](AlltoallOptions& opts) { alltoall(opts); });
+}
+
 } // namespace gloo
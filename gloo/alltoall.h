@@ -11,6 +11,7 @@
 #include "gloo/common/logging.h"
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -72,4 +73,8 @@ class AlltoallOptions {
 
 void alltoall(AlltoallOptions& opts);
 
+// Non-blocking variant of alltoall. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> ialltoall(AlltoallOptions opts);
+
 } // namespace gloo
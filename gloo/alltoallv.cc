@@ -160,4 +160,9 @@ void alltoallv(AlltoallvOptions& opts) {
   }
 }
 
+std::shared_ptr<Work> ialltoallv(AlltoallvOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](AlltoallvOptions& opts) { alltoallv(opts); });
+}
+
 } // namespace gloo
@@ -11,6 +11,7 @@
 #include "gloo/common/logging.h"
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -99,4 +100,8 @@ class AlltoallvOptions {
 
 void alltoallv(AlltoallvOptions& opts);
 
+// Non-blocking variant of alltoallv. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> ialltoallv(AlltoallvOptions opts);
+
 } // namespace gloo
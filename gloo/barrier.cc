@@ -35,4 +35,9 @@ void barrier(BarrierOptions& opts) {
   }
 }
 
+std::shared_ptr<Work> ibarrier(BarrierOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](BarrierOptions& opts) { barrier(opts); });
+}
+
 } // namespace gloo
@@ -11,6 +11,7 @@
 #include "gloo/algorithm.h"
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -50,4 +51,8 @@ class BarrierOptions {
 
 void barrier(BarrierOptions& opts);
 
+// Non-blocking variant of barrier. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> ibarrier(BarrierOptions opts);
+
 } // namespace gloo
@@ -476,9 +476,12 @@ class BroadcastBenchmark : public Benchmark<T> {
   public:
     BroadcastBenchmark(
       std::shared_ptr<::gloo::Context>& context,
-      struct options& options)
+      struct options& options,
+      BroadcastOptions::Algorithm algorithm = BroadcastOptions::UNSPECIFIED)
         : Benchmark<T>(context, options),
-          opts_(context) {}
+          opts_(context) {
+      opts_.setAlgorithm(algorithm);
+    }
 
     void initialize(size_t elements) override {
       // Create input buffer
@@ -552,9 +555,12 @@ class ReduceBenchmark : public Benchmark<T> {
   public:
     ReduceBenchmark(
       std::shared_ptr<::gloo::Context>& context,
-      struct options& options)
+      struct options& options,
+      ReduceOptions::Algorithm algorithm = ReduceOptions::UNSPECIFIED)
         : Benchmark<T>(context, options),
-          opts_(context) {}
+          opts_(context) {
+      opts_.setAlgorithm(algorithm);
+    }
 
     void initialize(size_t elements) override {
       // Create input/output buffers
@@ -856,9 +862,11 @@ class NewAllreduceBenchmark : public Benchmark<T> {
  public:
   NewAllreduceBenchmark(
     std::shared_ptr<::gloo::Context>& context,
-    struct options& options)
+    struct options& options,
+    AllreduceOptions::Algorithm algorithm)
       : Benchmark<T>(context, options),
-        opts_(context) {}
+        opts_(context),
+        algorithm_(algorithm) {}
 
   allocation newAllocation(int inputs, size_t elements) {
     allocation out;
@@ -896,9 +904,24 @@ class NewAllreduceBenchmark : public Benchmark<T> {
     // Configure AllreduceOptions struct
     opts_.setInputs(inputPointers, elements);
     opts_.setOutputs(outputPointers, elements);
-    opts_.setAlgorithm(AllreduceOptions::Algorithm::RING);
-    void (*fn)(void*, const void*, const void*, long unsigned int) = &sum<T>;
-    opts_.setReduceFunction(fn);
+    opts_.setAlgorithm(algorithm_);
+    opts_.setRings(this->options_.rings);
+    opts_.setPipelineDepth(this->options_.pipelineDepth);
+    opts_.setReductionThreads(this->options_.reductionThreads);
+    if (!this->options_.compression.empty()) {
+      // Compression requires a built-in reduction operation.
+      opts_.setReduceOp(ReduceOp::SUM);
+      auto type = DataType::FLOAT16;
+      if (this->options_.compression == "bf16") {
+        type = DataType::BFLOAT16;
+      } else if (this->options_.compression == "int8") {
+        type = DataType::INT8;
+      }
+      opts_.setCompression(type);
+    } else {
+      void (*fn)(void*, const void*, const void*, long unsigned int) = &sum<T>;
+      opts_.setReduceFunction(fn);
+    }
   }
 
   void run() override {
@@ -907,11 +930,66 @@ class NewAllreduceBenchmark : public Benchmark<T> {
 
  private:
   AllreduceOptions opts_;
+  const AllreduceOptions::Algorithm algorithm_;
 
   allocation inputAllocation_;
   allocation outputAllocation_;
 };
 
+// Runs a number of small allreduce operations concurrently, either on
+// the progress engine (one thread per operation in flight) or on a
+// scheduler (a single thread for all operations).
+template <typename T>
+class ConcurrentAllreduceBenchmark : public Benchmark<T> {
+ public:
+  ConcurrentAllreduceBenchmark(
+    std::shared_ptr<::gloo::Context>& context,
+    struct options& options,
+    bool useScheduler)
+      : Benchmark<T>(context, options),
+        useScheduler_(useScheduler) {}
+
+  void initialize(size_t elements) override {
+    elements_ = elements;
+    buffers_.clear();
+    for (auto i = 0; i < this->options_.operations; i++) {
+      buffers_.emplace_back(elements);
+      for (size_t j = 0; j < elements; j++) {
+        buffers_[i][j] = this->context_->rank;
+      }
+    }
+  }
+
+  void run() override {
+    void (*fn)(void*, const void*, const void*, long unsigned int) = &sum<T>;
+    std::vector<std::shared_ptr<Work>> work;
+    work.reserve(buffers_.size());
+    for (size_t i = 0; i < buffers_.size(); i++) {
+      AllreduceOptions opts(this->context_);
+      opts.setOutput(buffers_[i].data(), elements_);
+      opts.setAlgorithm(AllreduceOptions::Algorithm::RING);
+      opts.setReduceFunction(fn);
+      opts.setTag(i);
+      if (useScheduler_) {
+        work.push_back(iallreduce(std::move(opts), scheduler_));
+      } else {
+        auto ptr = std::make_shared<AllreduceOptions>(std::move(opts));
+        work.push_back(engine_.enqueue([ptr] { allreduce(*ptr); }));
+      }
+    }
+    for (auto& w : work) {
+      w->wait();
+    }
+  }
+
+ private:
+  const bool useScheduler_;
+  ::gloo::Scheduler scheduler_;
+  ::gloo::ProgressEngine engine_;
+  size_t elements_;
+  std::vector<std::vector<T, aligned_allocator<T, kBufferAlignment>>> buffers_;
+};
+
 }
 
 #define RUN_BENCHMARK(T)                                                   \
@@ -973,6 +1051,16 @@ class NewAllreduceBenchmark : public Benchmark<T> {
     fn = [&](std::shared_ptr<Context>& context) {                          \
       return gloo::make_unique<BroadcastBenchmark<T>>(context, x);         \
     };                                                                     \
+  } else if (x.benchmark == "broadcast_binomial") {                        \
+    fn = [&](std::shared_ptr<Context>& context) {                          \
+      return gloo::make_unique<BroadcastBenchmark<T>>(                     \
+          context, x, BroadcastOptions::BINOMIAL);                         \
+    };                                                                     \
+  } else if (x.benchmark == "broadcast_scatter_allgather") {               \
+    fn = [&](std::shared_ptr<Context>& context) {                          \
+      return gloo::make_unique<BroadcastBenchmark<T>>(                     \
+          context, x, BroadcastOptions::SCATTER_ALLGATHER);                \
+    };                                                                     \
   } else if (x.benchmark == "broadcast_one_to_all") {                      \
     fn = [&](std::shared_ptr<Context>& context) {                          \
       return gloo::make_unique<BroadcastOneToAllBenchmark<T>>(context, x); \
@@ -985,6 +1073,21 @@ class NewAllreduceBenchmark : public Benchmark<T> {
     fn = [&](std::shared_ptr<Context>& context) {                          \
       return gloo::make_unique<ReduceBenchmark<T>>(context, x);            \
     };                                                                     \
+  } else if (x.benchmark == "reduce_ring") {                               \
+    fn = [&](std::shared_ptr<Context>& context) {                          \
+      return gloo::make_unique<ReduceBenchmark<T>>(                        \
+          context, x, ReduceOptions::RING);                                \
+    };                                                                     \
+  } else if (x.benchmark == "reduce_binomial") {                           \
+    fn = [&](std::shared_ptr<Context>& context) {                          \
+      return gloo::make_unique<ReduceBenchmark<T>>(                        \
+          context, x, ReduceOptions::BINOMIAL);                            \
+    };                                                                     \
+  } else if (x.benchmark == "reduce_pipelined_tree") {                     \
+    fn = [&](std::shared_ptr<Context>& context) {                          \
+      return gloo::make_unique<ReduceBenchmark<T>>(                        \
+          context, x, ReduceOptions::PIPELINED_TREE);                      \
+    };                                                                     \
   } else if (x.benchmark == "reduce_scatter") {                            \
     fn = [&](std::shared_ptr<Context>& context) {                          \
       return gloo::make_unique<ReduceScatterBenchmark<T>>(context, x);     \
@@ -1027,7 +1130,38 @@ void runNewBenchmark(options& options) {
   const auto name = options.benchmark.substr(4);
   if (name == "allreduce_ring") {
     fn = [&](std::shared_ptr<Context>& context) {
-      return gloo::make_unique<NewAllreduceBenchmark<T>>(context, options);
+      return gloo::make_unique<NewAllreduceBenchmark<T>>(
+          context, options, AllreduceOptions::Algorithm::RING);
+    };
+  } else if (name == "allreduce_bcube") {
+    fn = [&](std::shared_ptr<Context>& context) {
+      return gloo::make_unique<NewAllreduceBenchmark<T>>(
+          context, options, AllreduceOptions::Algorithm::BCUBE);
+    };
+  } else if (name == "allreduce_halving_doubling") {
+    fn = [&](std::shared_ptr<Context>& context) {
+      return gloo::make_unique<NewAllreduceBenchmark<T>>(
+          context, options, AllreduceOptions::Algorithm::HALVING_DOUBLING);
+    };
+  } else if (name == "allreduce_hierarchical") {
+    fn = [&](std::shared_ptr<Context>& context) {
+      return gloo::make_unique<NewAllreduceBenchmark<T>>(
+          context, options, AllreduceOptions::Algorithm::HIERARCHICAL);
+    };
+  } else if (name == "allreduce_double_binary_tree") {
+    fn = [&](std::shared_ptr<Context>& context) {
+      return gloo::make_unique<NewAllreduceBenchmark<T>>(
+          context, options, AllreduceOptions::Algorithm::DOUBLE_BINARY_TREE);
+    };
+  } else if (name == "allreduce_ring_threads") {
+    fn = [&](std::shared_ptr<Context>& context) {
+      return gloo::make_unique<ConcurrentAllreduceBenchmark<T>>(
+          context, options, false);
+    };
+  } else if (name == "allreduce_ring_scheduler") {
+    fn = [&](std::shared_ptr<Context>& context) {
+      return gloo::make_unique<ConcurrentAllreduceBenchmark<T>>(
+          context, options, true);
     };
   } else {
     GLOO_ENFORCE(false, "Invalid benchmark name: ", options.benchmark);
@@ -1043,12 +1177,20 @@ int main(int argc, char** argv) {
   // Run new style benchmarks if the benchmark name starts with "new_".
   // Eventually we'd like to deprecate all the old style ones...
   if (x.benchmark.substr(0, 4) == "new_") {
-    runNewBenchmark<float>(x);
+    if (x.bfloat16) {
+      runNewBenchmark<bfloat16>(x);
+    } else if (x.halfPrecision) {
+      runNewBenchmark<float16>(x);
+    } else {
+      runNewBenchmark<float>(x);
+    }
     return 0;
   }
 
   if (x.benchmark == "pairwise_exchange") {
     RUN_BENCHMARK(char);
+  } else if (x.bfloat16) {
+    RUN_BENCHMARK(bfloat16);
   } else if (x.halfPrecision) {
     RUN_BENCHMARK(float16);
   } else {
@@ -74,12 +74,25 @@ static void usage(int status, const char* argv0) {
   X("      --nanos            Display timing data in nanos instead of micros");
   X("      --gpudirect        Use GPUDirect (CUDA only)");
   X("      --halfprecision    Use 16-bit floating point values");
+  X("      --bfloat16         Use 16-bit brain floating point values");
   X("      --destinations     Number of separate destinations per host in "
                               "pairwise exchange benchmark");
   X("Algorithm parameters:");
   X("      --base           The base for allreduce_bcube (if applicable)");
   X("      --messages       The number of messages to send from A to B for");
   X("                       sendrecv_stress and isendirecv_stress (default: 10000)");
+  X("      --operations     The number of concurrent operations per iteration for");
+  X("                       new_allreduce_ring_threads and");
+  X("                       new_allreduce_ring_scheduler (default: 16)");
+  X("      --rings          The number of concurrent rings for new_allreduce_ring");
+  X("                       (default: 1)");
+  X("      --pipeline-depth The number of segments in flight for");
+  X("                       new_allreduce_ring (default: 2)");
+  X("      --reduction-threads");
+  X("                       The number of threads that execute reductions for");
+  X("                       new_allreduce_ring (default: 0)");
+  X("      --compression    Transfer float data as fp16, bf16, or int8 in the");
+  X("                       ring allreduce (new_allreduce_ring only)");
   X("");
   X("BENCHMARK is one of:");
   X("  allgather");
@@ -94,9 +107,14 @@ static void usage(int status, const char* argv0) {
   X("  alltoall_v");
   X("  barrier_all_to_all");
   X("  broadcast");
+  X("  broadcast_binomial");
+  X("  broadcast_scatter_allgather");
   X("  broadcast_one_to_all");
   X("  pairwise_exchange");
   X("  reduce");
+  X("  reduce_ring");
+  X("  reduce_binomial");
+  X("  reduce_pipelined_tree");
   X("  reduce_scatter");
   X("  scatter");
   X("  sendrecv_roundtrip");
@@ -173,6 +191,12 @@ struct options parseOptions(int argc, char** argv) {
       {"tcp-device", required_argument, nullptr, 0x1010},
       {"base", required_argument, nullptr, 0x1011},
       {"messages", required_argument, nullptr, 0x1013},
+      {"operations", required_argument, nullptr, 0x1016},
+      {"rings", required_argument, nullptr, 0x1017},
+      {"pipeline-depth", required_argument, nullptr, 0x1018},
+      {"reduction-threads", required_argument, nullptr, 0x1019},
+      {"bfloat16", no_argument, nullptr, 0x101a},
+      {"compression", required_argument, nullptr, 0x101b},
       {"pkey", required_argument, nullptr, 0x2001},
       {"cert", required_argument, nullptr, 0x2002},
       {"ca-file", required_argument, nullptr, 0x2003},
@@ -324,6 +348,36 @@ struct options parseOptions(int argc, char** argv) {
         result.messages = atoi(optarg);
         break;
       }
+      case 0x1016: // --operations
+      {
+        result.operations = atoi(optarg);
+        break;
+      }
+      case 0x1017: // --rings
+      {
+        result.rings = atoi(optarg);
+        break;
+      }
+      case 0x1018: // --pipeline-depth
+      {
+        result.pipelineDepth = atoi(optarg);
+        break;
+      }
+      case 0x1019: // --reduction-threads
+      {
+        result.reductionThreads = atoi(optarg);
+        break;
+      }
+      case 0x101a: // --bfloat16
+      {
+        result.bfloat16 = true;
+        break;
+      }
+      case 0x101b: // --compression
+      {
+        result.compression = std::string(optarg, strlen(optarg));
+        break;
+      }
       case 0x2001: // --pkey
       {
         result.pkey = std::string(optarg, strlen(optarg));
@@ -366,6 +420,12 @@ struct options parseOptions(int argc, char** argv) {
     usage(EXIT_FAILURE, argv[0]);
   }
 
+  if (!result.compression.empty() && result.compression != "fp16" &&
+      result.compression != "bf16" && result.compression != "int8") {
+    fprintf(stderr, "%s: compression must be fp16, bf16, or int8\n", argv[0]);
+    usage(EXIT_FAILURE, argv[0]);
+  }
+
   if (optind != (argc - 1)) {
     fprintf(stderr, "%s: missing benchmark specifier\n", argv[0]);
     usage(EXIT_FAILURE, argv[0]);
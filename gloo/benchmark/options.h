@@ -54,10 +54,16 @@ struct options {
   int inputs = 1;
   bool gpuDirect = false;
   bool halfPrecision = false;
+  bool bfloat16 = false;
   int destinations  = 1;
   int threads = 1;
   int base = 2;
   int messages = 10000;
+  int operations = 16;
+  int rings = 1;
+  int pipelineDepth = 2;
+  int reductionThreads = 0;
+  std::string compression;
 
   // TLS
   std::string pkey;
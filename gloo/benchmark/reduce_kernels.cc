@@ -0,0 +1,263 @@
+/**
+ * Copyright (c) 2018-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Measures the memory bandwidth of the reduction kernels for every
+// data type, operation, and instruction set this CPU supports.
+//
+// The bandwidth counts every byte read and written by a kernel: two
+// inputs and one output for the binary kernels, and k inputs and one
+// output for the N-ary kernels.
+//
+// It also measures the kernels for compressed float32 data (see
+// CompressedReduceKernels), with and without error feedback. Their
+// bandwidth (GB/s) counts the float32 bytes that a kernel processes, so
+// that the formats can be compared. Their
+// error is measured on values spread over three orders of magnitude:
+// the largest error relative to the largest absolute value, and the
+// root mean square error relative to the root mean square value.
+
+#include <getopt.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "gloo/benchmark/timer.h"
+#include "gloo/reduce_op.h"
+
+using namespace gloo;
+
+namespace {
+
+struct Options {
+  size_t bytes = 4 * 1024 * 1024;
+  size_t inputs = 4;
+  long minNanoseconds = 200 * 1000 * 1000;
+};
+
+void usage(int status, const char* argv0) {
+  fprintf(stderr, "Usage: %s [OPTIONS]\n", argv0);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "  --bytes N    Size of every buffer (default: 4194304)\n");
+  fprintf(stderr, "  --inputs K   Number of inputs for the N-ary kernels\n");
+  fprintf(stderr, "               (default: 4)\n");
+  fprintf(stderr, "  --ms N       Minimum duration per kernel (default: 200)\n");
+  exit(status);
+}
+
+Options parseOptions(int argc, char** argv) {
+  Options result;
+  static struct option long_options[] = {
+      {"bytes", required_argument, nullptr, 'b'},
+      {"inputs", required_argument, nullptr, 'k'},
+      {"ms", required_argument, nullptr, 'm'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+    switch (opt) {
+      case 'b':
+        result.bytes = atoll(optarg);
+        break;
+      case 'k':
+        result.inputs = atoi(optarg);
+        break;
+      case 'm':
+        result.minNanoseconds = atol(optarg) * 1000 * 1000;
+        break;
+      case 'h':
+        usage(EXIT_SUCCESS, argv[0]);
+        break;
+      default:
+        usage(EXIT_FAILURE, argv[0]);
+        break;
+    }
+  }
+  if (result.inputs < 1) {
+    usage(EXIT_FAILURE, argv[0]);
+  }
+  return result;
+}
+
+// Runs the function until the minimum duration has passed and returns
+// the number of bytes per second it processed.
+template <typename Fn>
+double measure(const Options& options, size_t bytesPerCall, Fn fn) {
+  // Warm up caches and page tables.
+  fn();
+
+  size_t calls = 0;
+  benchmark::Timer timer;
+  long ns;
+  do {
+    fn();
+    calls++;
+    ns = timer.ns();
+  } while (ns < options.minNanoseconds);
+  return (double)(calls * bytesPerCall) / ns;
+}
+
+// Returns values of both signs, spread over three orders of magnitude.
+std::vector<float> generateValues(size_t n) {
+  std::vector<float> result(n);
+  uint32_t state = 1;
+  for (size_t i = 0; i < n; i++) {
+    state = state * 1664525 + 1013904223;
+    const float mantissa = float(state >> 8) / (1 << 24) * 2 - 1;
+    result[i] = mantissa * std::pow(10.0f, float(i % 3));
+  }
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const auto options = parseOptions(argc, argv);
+
+  const struct {
+    DataType type;
+    const char* name;
+  } types[] = {
+      {DataType::INT32, "int32"},
+      {DataType::INT64, "int64"},
+      {DataType::FLOAT16, "float16"},
+      {DataType::BFLOAT16, "bfloat16"},
+      {DataType::FLOAT32, "float32"},
+      {DataType::FLOAT64, "float64"},
+  };
+
+  const struct {
+    ReduceOp op;
+    const char* name;
+  } ops[] = {
+      {ReduceOp::SUM, "sum"},
+      {ReduceOp::PRODUCT, "product"},
+      {ReduceOp::MIN, "min"},
+      {ReduceOp::MAX, "max"},
+  };
+
+  // Zeroed buffers: every type and operation computes on valid numbers.
+  const size_t k = options.inputs;
+  std::vector<std::vector<char>> inputs(k);
+  std::vector<const void*> ptrs(k);
+  for (size_t i = 0; i < k; i++) {
+    inputs[i].assign(options.bytes, 0);
+    ptrs[i] = inputs[i].data();
+  }
+  std::vector<char> output(options.bytes, 0);
+
+  printf("Buffer size: %zu bytes, N-ary inputs: %zu\n", options.bytes, k);
+  printf("Supported instruction set: %s\n", getSimdIsaName(getSimdIsa()));
+  printf("\n");
+  printf(
+      "%-8s %-8s %-10s %16s %16s\n",
+      "type",
+      "op",
+      "isa",
+      "binary (GB/s)",
+      "n-ary (GB/s)");
+
+  for (const auto& type : types) {
+    const size_t n = options.bytes / getDataTypeSize(type.type);
+    for (const auto& op : ops) {
+      for (auto i = 0; i <= static_cast<int>(getSimdIsa()); i++) {
+        const auto isa = static_cast<SimdIsa>(i);
+        const auto kernels = getReduceKernels(op.op, type.type, isa);
+        const auto binary = measure(options, 3 * options.bytes, [&] {
+          kernels.binary(output.data(), ptrs[0], ptrs[k > 1 ? 1 : 0], n);
+        });
+        double nary = 0;
+        if (kernels.nary != nullptr) {
+          nary = measure(options, (k + 1) * options.bytes, [&] {
+            kernels.nary(output.data(), ptrs.data(), k, n);
+          });
+        }
+        printf(
+            "%-8s %-8s %-10s %16.2f %16.2f\n",
+            type.name,
+            op.name,
+            getSimdIsaName(isa),
+            binary,
+            nary);
+      }
+    }
+  }
+
+  const struct {
+    DataType type;
+    const char* name;
+  } formats[] = {
+      {DataType::FLOAT16, "float16"},
+      {DataType::BFLOAT16, "bfloat16"},
+      {DataType::INT8, "int8"},
+  };
+
+  const size_t n = options.bytes / sizeof(float);
+  const auto values = generateValues(n);
+  double absmax = 0;
+  double squares = 0;
+  for (const auto value : values) {
+    absmax = std::max(absmax, (double)std::fabs(value));
+    squares += (double)value * value;
+  }
+  std::vector<float> decoded(n);
+  std::vector<float> residual(n, 0);
+
+  printf("\n");
+  printf(
+      "%-8s %-10s %6s %12s %12s %12s %10s %10s\n",
+      "format",
+      "isa",
+      "ratio",
+      "compress",
+      "feedback",
+      "decompress",
+      "max error",
+      "rms error");
+
+  for (const auto& format : formats) {
+    for (auto i = 0; i <= static_cast<int>(getSimdIsa()); i++) {
+      const auto isa = static_cast<SimdIsa>(i);
+      const auto kernels =
+          getCompressedReduceKernels(ReduceOp::SUM, format.type, isa);
+      std::vector<char> wire(kernels.getCompressedSize(n));
+      const auto compress = measure(options, options.bytes, [&] {
+        kernels.compress(wire.data(), values.data(), nullptr, n);
+      });
+      const auto feedback = measure(options, options.bytes, [&] {
+        kernels.compress(wire.data(), values.data(), residual.data(), n);
+      });
+      kernels.compress(wire.data(), values.data(), nullptr, n);
+      const auto decompress = measure(options, options.bytes, [&] {
+        kernels.decompress(decoded.data(), wire.data(), n);
+      });
+      double maxError = 0;
+      double squaredErrors = 0;
+      for (size_t j = 0; j < n; j++) {
+        const double error = (double)decoded[j] - values[j];
+        maxError = std::max(maxError, std::fabs(error));
+        squaredErrors += error * error;
+      }
+      printf(
+          "%-8s %-10s %6.2f %12.2f %12.2f %12.2f %10.2e %10.2e\n",
+          format.name,
+          getSimdIsaName(isa),
+          (double)options.bytes / wire.size(),
+          compress,
+          feedback,
+          decompress,
+          maxError / absmax,
+          std::sqrt(squaredErrors / squares));
+    }
+  }
+
+  return 0;
+}
@@ -435,6 +435,9 @@ void Runner::printHeader() {
       std::cout << "no";
     }
   }
+  if (!options_.compression.empty()) {
+    std::cout << ", compression=" << options_.compression;
+  }
   std::cout << std::boolalpha;
   std::cout << ", verify=" << options_.verify;
   std::cout << std::endl << std::endl;
@@ -596,6 +599,8 @@ template void Runner::run(BenchmarkFn<float>& fn);
 template void Runner::run(BenchmarkFn<float>& fn, size_t n);
 template void Runner::run(BenchmarkFn<float16>& fn);
 template void Runner::run(BenchmarkFn<float16>& fn, size_t n);
+template void Runner::run(BenchmarkFn<bfloat16>& fn);
+template void Runner::run(BenchmarkFn<bfloat16>& fn, size_t n);
 
 RunnerThread::RunnerThread() : stop_(false), job_(nullptr) {
   thread_ = std::thread(&RunnerThread::spawn, this);
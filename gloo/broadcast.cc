@@ -10,48 +10,33 @@
 
 #include <algorithm>
 #include <cstring>
+#include <vector>
 
+#include "gloo/allreduce_tuning.h"
 #include "gloo/common/logging.h"
 #include "gloo/math.h"
 #include "gloo/types.h"
 
 namespace gloo {
 
-void broadcast(BroadcastOptions& opts) {
-  const auto& context = opts.context;
-  transport::UnboundBuffer* in = opts.in.get();
-  transport::UnboundBuffer* out = opts.out.get();
-  const auto slot = Slot::build(kBroadcastSlotPrefix, opts.tag);
+namespace {
 
-  // Sanity checks
-  GLOO_ENFORCE(opts.elementSize > 0);
-  GLOO_ENFORCE(opts.root >= 0 && opts.root < context->size);
-  GLOO_ENFORCE(out);
-  if (context->rank == opts.root) {
-    if (in) {
-      GLOO_ENFORCE_EQ(in->size, out->size);
-    } else {
-      // Broadcast in place
-      in = out;
-    }
-  } else {
-    GLOO_ENFORCE(!in, "Non-root may not specify input");
+// Single send or receive operation of the broadcast.
+struct Step {
+  int peer;
+  bool send;
+};
 
-    // Broadcast in place (for forwarding)
-    in = out;
-  }
+// Returns the sequence of operations this process executes to
+// participate in a binomial tree broadcast from the specified root.
+std::vector<Step> computeSteps(int rank, int size, int root) {
+  std::vector<Step> steps;
 
   // Map rank to new rank where root process has rank 0.
-  const size_t vsize = context->size;
-  const size_t vrank = (context->rank + vsize - opts.root) % vsize;
+  const size_t vsize = size;
+  const size_t vrank = (rank + vsize - root) % vsize;
   const size_t dim = log2ceil(vsize);
 
-  // Track number of pending send operations.
-  // Send operations can complete asynchronously because there is dependency
-  // between iterations. This unlike recv operations that must complete
-  // before any send operations can be queued.
-  size_t numSends = 0;
-
   // Create mask with all 1's where we progressively set bits to 0
   // starting with the LSB. When the mask applied to the virtual rank
   // equals 0 we know the process must participate. This results in
@@ -73,25 +58,277 @@ void broadcast(BroadcastOptions& opts) {
     }
 
     // Map virtual rank of peer to actual rank of peer.
-    auto peer = (vpeer + opts.root) % vsize;
-    if ((vrank & (1 << i)) == 0) {
-      in->send(peer, slot);
+    Step step;
+    step.peer = (vpeer + root) % vsize;
+    step.send = (vrank & (1 << i)) == 0;
+    steps.push_back(step);
+  }
+
+  return steps;
+}
+
+// Byte range of the buffer.
+struct Block {
+  size_t offset;
+  size_t length;
+};
+
+// Returns the blocks that the scatter/allgather algorithm splits the
+// buffer into, one per virtual rank. They are as equal in size as the
+// element size allows.
+std::vector<Block> computeBlocks(size_t bytes, size_t elementSize, int size) {
+  const size_t elements = bytes / elementSize;
+  const size_t quotient = elements / size;
+  const size_t remainder = elements % size;
+  std::vector<Block> blocks(size);
+  size_t offset = 0;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    blocks[i].offset = offset * elementSize;
+    blocks[i].length = (quotient + (i < remainder ? 1 : 0)) * elementSize;
+    offset += quotient + (i < remainder ? 1 : 0);
+  }
+  return blocks;
+}
+
+// Sequence of operations this process executes for either algorithm.
+struct Schedule {
+  BroadcastOptions::Algorithm algorithm;
+
+  // Binomial tree.
+  std::vector<Step> steps;
+
+  // Scatter/allgather.
+  int root;
+  int size;
+  int vrank;
+  std::vector<Block> blocks;
+};
+
+Schedule computeSchedule(
+    BroadcastOptions::Algorithm algorithm,
+    int rank,
+    int size,
+    int root,
+    size_t bytes,
+    size_t elementSize) {
+  Schedule schedule;
+  schedule.algorithm = algorithm;
+  if (schedule.algorithm == BroadcastOptions::UNSPECIFIED) {
+    schedule.algorithm = selectBroadcastAlgorithm(size, bytes);
+  }
+  if (schedule.algorithm == BroadcastOptions::BINOMIAL) {
+    schedule.steps = computeSteps(rank, size, root);
+  } else {
+    GLOO_ENFORCE_EQ(
+        schedule.algorithm,
+        BroadcastOptions::SCATTER_ALLGATHER,
+        "Algorithm not implemented.");
+    schedule.root = root;
+    schedule.size = size;
+    schedule.vrank = (rank + size - root) % size;
+    schedule.blocks = computeBlocks(bytes, elementSize, size);
+  }
+  return schedule;
+}
+
+// Validates the options and returns the buffer to send from.
+transport::UnboundBuffer* validate(
+    const std::shared_ptr<Context>& context,
+    transport::UnboundBuffer* in,
+    transport::UnboundBuffer* out,
+    size_t elementSize,
+    int root) {
+  // Sanity checks
+  GLOO_ENFORCE(elementSize > 0);
+  GLOO_ENFORCE(root >= 0 && root < context->size);
+  GLOO_ENFORCE(out);
+  if (context->rank == root) {
+    if (in) {
+      GLOO_ENFORCE_EQ(in->size, out->size);
+    } else {
+      // Broadcast in place
+      in = out;
+    }
+  } else {
+    GLOO_ENFORCE(!in, "Non-root may not specify input");
+
+    // Broadcast in place (for forwarding)
+    in = out;
+  }
+  return in;
+}
+
+void runBinomial(
+    const std::vector<Step>& steps,
+    transport::UnboundBuffer* in,
+    transport::UnboundBuffer* out,
+    uint64_t slot,
+    std::chrono::milliseconds timeout) {
+  // Track number of pending send operations.
+  // Send operations can complete asynchronously because there is dependency
+  // between iterations. This unlike recv operations that must complete
+  // before any send operations can be queued.
+  size_t numSends = 0;
+
+  for (const auto& step : steps) {
+    if (step.send) {
+      in->send(step.peer, slot);
       numSends++;
     } else {
-      out->recv(peer, slot);
-      out->waitRecv(opts.timeout);
+      out->recv(step.peer, slot);
+      out->waitRecv(timeout);
     }
   }
 
   // Copy local input to output if applicable.
-  if (context->rank == opts.root && in != out) {
+  if (in != out) {
     memcpy(out->ptr, in->ptr, out->size);
   }
 
   // Wait on pending sends.
   for (auto i = 0; i < numSends; i++) {
-    in->waitSend(opts.timeout);
+    in->waitSend(timeout);
+  }
+}
+
+void runScatterAllgather(
+    const Schedule& schedule,
+    transport::UnboundBuffer* in,
+    transport::UnboundBuffer* out,
+    Slot slot,
+    std::chrono::milliseconds timeout) {
+  const auto size = schedule.size;
+  const auto vrank = schedule.vrank;
+  const auto& blocks = schedule.blocks;
+  const auto peer = [&](int vpeer) { return (vpeer + schedule.root) % size; };
+  size_t numSends = 0;
+
+  // The root sends every other process its block. Blocks are empty if
+  // there are fewer elements than processes; these are skipped by both
+  // the sender and the receiver.
+  if (vrank == 0) {
+    for (auto i = 1; i < size; i++) {
+      if (blocks[i].length > 0) {
+        in->send(peer(i), slot, blocks[i].offset, blocks[i].length);
+        numSends++;
+      }
+    }
+  } else if (blocks[vrank].length > 0) {
+    out->recv(peer(0), slot, blocks[vrank].offset, blocks[vrank].length);
+    out->waitRecv(timeout);
   }
+
+  // Ring allgather. In every step, a process forwards the block it
+  // received in the previous step to the next process in the ring. The
+  // root already has every block, so its predecessor doesn't send to it.
+  const auto ringSlot = slot + static_cast<uint8_t>(1);
+  auto src = vrank == 0 ? in : out;
+  for (auto i = 0; i < size - 1; i++) {
+    const auto& sendBlock = blocks[(vrank - i + size) % size];
+    const auto& recvBlock = blocks[(vrank - i - 1 + size) % size];
+    if (vrank != size - 1 && sendBlock.length > 0) {
+      src->send(
+          peer(vrank + 1), ringSlot, sendBlock.offset, sendBlock.length);
+      numSends++;
+    }
+    if (vrank != 0 && recvBlock.length > 0) {
+      out->recv(
+          peer(vrank - 1), ringSlot, recvBlock.offset, recvBlock.length);
+      out->waitRecv(timeout);
+    }
+  }
+
+  // Copy local input to output if applicable.
+  if (in != out) {
+    memcpy(out->ptr, in->ptr, out->size);
+  }
+
+  // Wait on pending sends.
+  for (auto i = 0; i < numSends; i++) {
+    src->waitSend(timeout);
+  }
+}
+
+void run(
+    const Schedule& schedule,
+    transport::UnboundBuffer* in,
+    transport::UnboundBuffer* out,
+    Slot slot,
+    std::chrono::milliseconds timeout) {
+  if (schedule.algorithm == BroadcastOptions::BINOMIAL) {
+    runBinomial(schedule.steps, in, out, slot, timeout);
+  } else {
+    runScatterAllgather(schedule, in, out, slot, timeout);
+  }
+}
+
+} // namespace
+
+BroadcastOptions::Algorithm selectBroadcastAlgorithm(int size, size_t bytes) {
+  const auto& model = AllreduceLinkModel::getDefault();
+  const double transfer = bytes / (model.bandwidthMbps / 8);
+  const double binomial = log2ceil(size) * (model.latencyMicros + transfer);
+  const double scatterAllgather =
+      2 * (size - 1) * (model.latencyMicros + transfer / size);
+  if (scatterAllgather < binomial) {
+    return BroadcastOptions::SCATTER_ALLGATHER;
+  }
+  return BroadcastOptions::BINOMIAL;
+}
+
+void broadcast(BroadcastOptions& opts) {
+  const auto& context = opts.context;
+  transport::UnboundBuffer* out = opts.out.get();
+  transport::UnboundBuffer* in = validate(
+      context, opts.in.get(), out, opts.elementSize, opts.root);
+  const auto slot = Slot::build(kBroadcastSlotPrefix, opts.tag);
+  const auto schedule = computeSchedule(
+      opts.algorithm,
+      context->rank,
+      context->size,
+      opts.root,
+      out->size,
+      opts.elementSize);
+  run(schedule, in, out, slot, opts.timeout);
+}
+
+struct BroadcastPlan::State {
+  transport::UnboundBuffer* in;
+  Slot slot;
+  Schedule schedule;
+};
+
+BroadcastPlan::BroadcastPlan(BroadcastOptions opts)
+    : opts_(std::move(opts)),
+      state_(new State{
+          nullptr,
+          Slot::build(kBroadcastSlotPrefix, opts_.tag),
+          Schedule()}) {
+  const auto& context = opts_.context;
+  state_->in = validate(
+      context, opts_.in.get(), opts_.out.get(), opts_.elementSize, opts_.root);
+  state_->schedule = computeSchedule(
+      opts_.algorithm,
+      context->rank,
+      context->size,
+      opts_.root,
+      opts_.out->size,
+      opts_.elementSize);
+}
+
+BroadcastPlan::~BroadcastPlan() {}
+
+void BroadcastPlan::execute() {
+  run(state_->schedule,
+      state_->in,
+      opts_.out.get(),
+      state_->slot,
+      opts_.timeout);
+}
+
+std::shared_ptr<Work> ibroadcast(BroadcastOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](BroadcastOptions& opts) { broadcast(opts); });
 }
 
 } // namespace gloo
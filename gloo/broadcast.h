@@ -10,11 +10,22 @@
 
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
 class BroadcastOptions {
  public:
+  // The binomial tree sends the full buffer in each of its log2(P)
+  // steps. Scatter/allgather splits the buffer into P blocks, scatters
+  // them from the root, and circulates them with a ring allgather. This
+  // sends every byte twice, regardless of the number of processes.
+  enum Algorithm {
+    UNSPECIFIED = 0,
+    BINOMIAL = 1,
+    SCATTER_ALLGATHER = 2,
+  };
+
   explicit BroadcastOptions(const std::shared_ptr<Context>& context)
       : context(context), timeout(context->getTimeout()) {}
 
@@ -50,6 +61,12 @@ class BroadcastOptions {
     this->root = root;
   }
 
+  // If not specified, the algorithm with the lowest estimated cost
+  // for the size of the buffer is used (see selectBroadcastAlgorithm).
+  void setAlgorithm(Algorithm algorithm) {
+    this->algorithm = algorithm;
+  }
+
   void setTag(uint32_t tag) {
     this->tag = tag;
   }
@@ -76,6 +93,9 @@ class BroadcastOptions {
   // Rank of process to broadcast from.
   int root = -1;
 
+  // Algorithm selection.
+  Algorithm algorithm = UNSPECIFIED;
+
   // Tag for this operation.
   // Must be unique across operations executing in parallel.
   uint32_t tag = 0;
@@ -84,8 +104,44 @@ class BroadcastOptions {
   std::chrono::milliseconds timeout;
 
   friend void broadcast(BroadcastOptions&);
+  friend class BroadcastPlan;
 };
 
 void broadcast(BroadcastOptions& opts);
 
+// Non-blocking variant of broadcast. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> ibroadcast(BroadcastOptions opts);
+
+// Selects the broadcast algorithm with the lowest estimated cost for a
+// buffer of the specified size, using the fixed cost per message and
+// the bandwidth between hosts of the default link model (see
+// AllreduceLinkModel in gloo/allreduce_tuning.h).
+BroadcastOptions::Algorithm selectBroadcastAlgorithm(int size, size_t bytes);
+
+// Persistent broadcast.
+//
+// The buffers are validated and the peers this process exchanges data
+// with are computed once, when the plan is created. Every call to
+// execute() then runs the broadcast on the same buffers.
+//
+class BroadcastPlan {
+ public:
+  explicit BroadcastPlan(BroadcastOptions opts);
+
+  ~BroadcastPlan();
+
+  BroadcastPlan(const BroadcastPlan&) = delete;
+
+  BroadcastPlan& operator=(const BroadcastPlan&) = delete;
+
+  void execute();
+
+ protected:
+  struct State;
+
+  BroadcastOptions opts_;
+  std::unique_ptr<State> state_;
+};
+
 } // namespace gloo
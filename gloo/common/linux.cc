@@ -17,6 +17,8 @@
 #include <linux/version.h>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
@@ -189,6 +191,68 @@ const std::string& infinibandToBusID(const std::string& name) {
   return map[name];
 }
 
+int pciNumaNode(const std::string& id) {
+  if (id.empty()) {
+    return -1;
+  }
+  auto path = kSysfsPath + id + "/numa_node";
+  std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+  std::ifstream ifs(path);
+  int node = -1;
+  if (!(ifs >> node)) {
+    return -1;
+  }
+  return node;
+}
+
+std::vector<int> numaNodeCpus(int node) {
+  std::vector<int> cpus;
+  if (node < 0) {
+    return cpus;
+  }
+
+  // The CPU list is formatted as comma separated ranges, e.g. "0-7,16-23".
+  auto path = "/sys/devices/system/node/node" + std::to_string(node) +
+      "/cpulist";
+  std::ifstream ifs(path);
+  std::string line;
+  if (!std::getline(ifs, line)) {
+    return cpus;
+  }
+  std::vector<std::string> ranges;
+  split(line, ',', std::back_inserter(ranges));
+  for (const auto& range : ranges) {
+    if (range.empty()) {
+      continue;
+    }
+    auto sep = range.find('-');
+    auto first = std::stoi(range.substr(0, sep));
+    auto last = first;
+    if (sep != std::string::npos) {
+      last = std::stoi(range.substr(sep + 1));
+    }
+    for (auto cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+bool setThreadAffinity(std::thread& thread, const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const auto cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  auto rv = pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+  return rv == 0;
+}
+
 static int getInterfaceSpeedGLinkSettings(int sock, struct ifreq* ifr) {
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,6,0)
   constexpr auto link_mode_data_nwords = 3 * 127;
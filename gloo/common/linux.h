@@ -10,6 +10,7 @@
 
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace gloo {
@@ -31,4 +32,16 @@ int getInterfaceSpeedByName(const std::string& ifname);
 
 const std::string& infinibandToBusID(const std::string& name);
 
+// Returns the NUMA node the PCI device with the specified bus ID is
+// attached to, or -1 if this is not known (e.g. on single socket
+// machines, or for virtual devices such as the loopback interface).
+int pciNumaNode(const std::string& id);
+
+// Returns the CPUs that are local to the specified NUMA node.
+std::vector<int> numaNodeCpus(int node);
+
+// Restricts the specified thread to run on the specified CPUs.
+// Returns false if the affinity could not be set.
+bool setThreadAffinity(std::thread& thread, const std::vector<int>& cpus);
+
 } // namespace gloo
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/common/memory.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace gloo {
+namespace detail {
+
+// Table of epoch slots. Slots are allocated in chunks and are never
+// freed, so that weak references to them stay valid for the lifetime
+// of the process.
+class EpochSlotTable {
+ public:
+  static constexpr size_t kChunkSize = 1024;
+
+  static EpochSlotTable& instance() {
+    // Leaked on purpose: weak references may be dereferenced by
+    // threads that outlive static destruction.
+    static EpochSlotTable* table = new EpochSlotTable;
+    return *table;
+  }
+
+  EpochSlot* acquire(uint32_t* epoch) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (free_ == nullptr) {
+      std::unique_ptr<EpochSlot[]> chunk(new EpochSlot[kChunkSize]);
+      for (size_t i = 0; i < kChunkSize; i++) {
+        chunk[i].next_ = free_;
+        free_ = &chunk[i];
+      }
+      chunks_.push_back(std::move(chunk));
+    }
+    auto slot = free_;
+    free_ = slot->next_;
+    *epoch = EpochSlot::epochOf(slot->state_.load(std::memory_order_relaxed));
+    return slot;
+  }
+
+  void release(EpochSlot* slot) {
+    // Advance the epoch. From here on, no new references can be taken.
+    const uint64_t kEpochIncrement = 1ULL << 32;
+    auto state =
+        slot->state_.fetch_add(kEpochIncrement, std::memory_order_acq_rel);
+
+    // Wait for outstanding references, if any. This is only necessary
+    // if destruction races with an I/O thread using the object.
+    if (EpochSlot::refsOf(state) > 0) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&] {
+        return EpochSlot::refsOf(
+                   slot->state_.load(std::memory_order_acquire)) == 0;
+      });
+      slot->next_ = free_;
+      free_ = slot;
+      return;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    slot->next_ = free_;
+    free_ = slot;
+  }
+
+  void notify() {
+    // Acquire the lock so that the notification cannot be lost
+    // between the waiter checking the predicate and going to sleep.
+    std::lock_guard<std::mutex> guard(mutex_);
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::unique_ptr<EpochSlot[]>> chunks_;
+  EpochSlot* free_ = nullptr;
+};
+
+constexpr size_t EpochSlotTable::kChunkSize;
+
+EpochSlot* EpochSlot::acquire(uint32_t* epoch) {
+  return EpochSlotTable::instance().acquire(epoch);
+}
+
+void EpochSlot::release(EpochSlot* slot) {
+  EpochSlotTable::instance().release(slot);
+}
+
+void EpochSlot::notify() {
+  EpochSlotTable::instance().notify();
+}
+
+} // namespace detail
+} // namespace gloo
@@ -12,8 +12,9 @@
 #include <unistd.h>
 #endif
 
-#include <memory>
-#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <utility>
 
 namespace gloo {
 
@@ -49,16 +50,85 @@ namespace gloo {
 // finish. Otherwise, we risk the device thread writing to memory it's
 // not supposed to.
 //
-// We solve this by using a shared_ptr of the "this" pointer of the
-// unbound buffer. This doesn't magically convert the unbound buffer
-// to be a shared_ptr, but it allows for handing out weak_ptr
-// instances to refer to it. Then, whenever the unbound buffer is
-// used by another thread, it converts the weak_ptr into a shared_ptr
-// and uses it for a very short period of time. The wrapper class below
-// waits for all shared_ptr instances to be released before returning
-// from its destructor. This will block indefinitely if the shared_ptr
-// acquired from the weak_ptr stays alive.
+// We solve this with a table of epoch counted reference slots. The
+// root reference (ShareableNonOwningPtr) takes a slot from the table
+// and remembers the slot's current epoch. Weak references copy the
+// slot pointer and the epoch. Whenever the unbound buffer is used by
+// another thread, it converts the weak reference into a strong one
+// (NonOwningPtr) by incrementing the slot's reference count, but only
+// if the epoch still matches, and uses it for a very short period of
+// time. The destructor of the root reference advances the epoch, so
+// that no new strong references can be acquired, and waits for the
+// existing ones to be released. This will block indefinitely if a
+// strong reference stays alive.
 //
+// Slots are never freed, but recycled, so creating an unbound buffer
+// doesn't allocate, and a stale weak reference to a recycled slot
+// fails to convert because the epoch has advanced.
+//
+
+namespace detail {
+
+class EpochSlot final {
+ public:
+  // Takes a slot from the table and stores its current epoch.
+  static EpochSlot* acquire(uint32_t* epoch);
+
+  // Advances the epoch of the slot, waits for all references taken
+  // in the previous epoch to be released, and returns it to the table.
+  static void release(EpochSlot* slot);
+
+  // Takes reference if the slot is still in the specified epoch.
+  bool ref(uint32_t epoch) noexcept {
+    auto state = state_.load(std::memory_order_relaxed);
+    while (epochOf(state) == epoch) {
+      if (state_.compare_exchange_weak(
+              state,
+              state + 1,
+              std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Takes another reference. Only valid while holding one.
+  void addRef() noexcept {
+    state_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Releases reference taken in the specified epoch.
+  void unref(uint32_t epoch) noexcept {
+    auto state = state_.fetch_sub(1, std::memory_order_release);
+    // If this was the last reference and the epoch has advanced,
+    // the destructor of the root reference may be waiting for it.
+    if (refsOf(state) == 1 && epochOf(state) != epoch) {
+      notify();
+    }
+  }
+
+ private:
+  // High 32 bits hold the epoch; low 32 bits hold the reference count.
+  std::atomic<uint64_t> state_{0};
+
+  // Next slot in the table's free list.
+  EpochSlot* next_{nullptr};
+
+  static uint32_t epochOf(uint64_t state) {
+    return static_cast<uint32_t>(state >> 32);
+  }
+
+  static uint32_t refsOf(uint64_t state) {
+    return static_cast<uint32_t>(state);
+  }
+
+  static void notify();
+
+  friend class EpochSlotTable;
+};
+
+} // namespace detail
 
 // Forward definitions.
 template <typename T>
@@ -69,54 +139,83 @@ class ShareableNonOwningPtr;
 // NonOwningPtr is constructed from a WeakNonOwningPtr, if and
 // only if the underlying object is still alive. If it is, destruction
 // of the underlying object is blocked until the NonOwningPtr
-// is destructed. It boxes a shared_ptr instead of being typedef'd as
-// one to prevent misuse (e.g. extending its lifetime).
+// is destructed.
 template <typename T>
 class NonOwningPtr final {
  public:
   NonOwningPtr() {}
 
-  explicit NonOwningPtr(const WeakNonOwningPtr<T>& ptr)
-      : ptr_(ptr.ptr_.lock()) {}
+  explicit NonOwningPtr(const WeakNonOwningPtr<T>& ptr) {
+    if (ptr.slot_ != nullptr && ptr.slot_->ref(ptr.epoch_)) {
+      ptr_ = ptr.ptr_;
+      slot_ = ptr.slot_;
+      epoch_ = ptr.epoch_;
+    }
+  }
+
+  NonOwningPtr(const NonOwningPtr& other) noexcept
+      : ptr_(other.ptr_), slot_(other.slot_), epoch_(other.epoch_) {
+    // The other instance holds a reference, so the destructor of the
+    // root reference cannot have returned. Even if the epoch has
+    // advanced, it will wait for this reference to be released.
+    if (slot_ != nullptr) {
+      slot_->addRef();
+    }
+  }
+
+  NonOwningPtr(NonOwningPtr&& other) noexcept
+      : ptr_(other.ptr_), slot_(other.slot_), epoch_(other.epoch_) {
+    other.ptr_ = nullptr;
+    other.slot_ = nullptr;
+  }
+
+  NonOwningPtr& operator=(NonOwningPtr other) noexcept {
+    std::swap(ptr_, other.ptr_);
+    std::swap(slot_, other.slot_);
+    std::swap(epoch_, other.epoch_);
+    return *this;
+  }
+
+  ~NonOwningPtr() {
+    if (slot_ != nullptr) {
+      slot_->unref(epoch_);
+    }
+  }
 
   T* operator->() const noexcept {
-    return ptr_.get();
+    return ptr_;
   }
 
   explicit operator bool() const noexcept {
-    return (bool)ptr_;
+    return ptr_ != nullptr;
   }
 
  private:
-  std::shared_ptr<T> ptr_;
+  T* ptr_{nullptr};
+  detail::EpochSlot* slot_{nullptr};
+  uint32_t epoch_{0};
 };
 
 // WeakNonOwningPtr can be constructed from a ShareableNonOwningPtr.
 // It can instantiate a NonOwningPtr if and only if the
-// underlying object is still alive. It boxes a weak_ptr instead of
-// being typedef'd as one because it must instantiate the
-// NonOwningPtr type instead of a raw shared_ptr.
+// underlying object is still alive. It is trivially copyable.
 template <typename T>
 class WeakNonOwningPtr final {
  public:
   WeakNonOwningPtr() {}
 
   explicit WeakNonOwningPtr(const ShareableNonOwningPtr<T>& ref)
-      : ptr_(ref.ptr_) {}
+      : ptr_(ref.ptr_), slot_(ref.slot_), epoch_(ref.epoch_) {}
 
   // Returns true if the instance was initialized.
   explicit operator bool() const noexcept {
-    // Per std::weak_ptr::owner_before, "[...] two smart pointers
-    // compare equivalent only if they are both empty or if they both
-    // own the same object [...]". Therefore, if owner_before is true
-    // in either direction w.r.t. an empty weak_ptr, the instance was
-    // initialized.
-    return ptr_.owner_before(std::weak_ptr<T>{}) ||
-        std::weak_ptr<T>{}.owner_before(ptr_);
+    return slot_ != nullptr;
   }
 
  protected:
-  std::weak_ptr<T> ptr_;
+  T* ptr_{nullptr};
+  detail::EpochSlot* slot_{nullptr};
+  uint32_t epoch_{0};
 
   friend class NonOwningPtr<T>;
 };
@@ -129,26 +228,21 @@ class WeakNonOwningPtr final {
 template <typename T>
 class ShareableNonOwningPtr final {
  public:
-  // Initializes private shared_ptr with nop deallocation function.
-  explicit ShareableNonOwningPtr(T* t) : ptr_(t, [](void* ptr) {}) {}
+  explicit ShareableNonOwningPtr(T* t)
+      : ptr_(t), slot_(detail::EpochSlot::acquire(&epoch_)) {}
 
   // Disable copy constructors.
   ShareableNonOwningPtr(const ShareableNonOwningPtr&) = delete;
   ShareableNonOwningPtr& operator=(ShareableNonOwningPtr const&) = delete;
 
   ~ShareableNonOwningPtr() {
-    // Acquire weak_ptr to T
-    auto weak = std::weak_ptr<T>(ptr_);
-    // Release shared_ptr to T
-    ptr_.reset();
-    // Wait for all shared_ptr's to T have been released
-    while (!weak.expired()) {
-      std::this_thread::yield();
-    }
+    detail::EpochSlot::release(slot_);
   }
 
  protected:
-  std::shared_ptr<T> ptr_;
+  T* const ptr_;
+  uint32_t epoch_;
+  detail::EpochSlot* const slot_;
 
   friend class WeakNonOwningPtr<T>;
 };
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/common/numa.h"
+
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+#include "gloo/common/logging.h"
+
+namespace gloo {
+
+static NumaBuffer allocateFromHeap(size_t size) {
+  void* ptr = nullptr;
+  auto rv = posix_memalign(&ptr, kCacheLineSize, size > 0 ? size : 1);
+  GLOO_ENFORCE_EQ(rv, 0, "posix_memalign: ", rv);
+  return NumaBuffer(static_cast<uint8_t*>(ptr));
+}
+
+#ifdef __linux__
+
+// From linux/mempolicy.h; not using libnuma avoids a dependency.
+constexpr int kMemoryPolicyPreferred = 1;
+
+NumaBuffer allocateOnNumaNode(size_t size, int node, bool hugePages) {
+  hugePages = hugePages && size >= kHugePageSize;
+  if (!hugePages && (node < 0 || size < kNumaMinAllocationSize)) {
+    return allocateFromHeap(size);
+  }
+
+  auto ptr = mmap(
+      nullptr,
+      size,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1,
+      0);
+  GLOO_ENFORCE(ptr != MAP_FAILED, "mmap: ", strerror(errno));
+
+  // Like the memory policy below, this is a hint.
+#ifdef MADV_HUGEPAGE
+  if (hugePages) {
+    madvise(ptr, size, MADV_HUGEPAGE);
+  }
+#endif
+
+  if (node < 0) {
+    return NumaBuffer(static_cast<uint8_t*>(ptr), NumaDeleter(size));
+  }
+
+  // Prefer (instead of bind to) the node, so that the allocation can
+  // still be satisfied if the node runs out of memory. This is a hint:
+  // if the system call is not available (e.g. restricted by seccomp),
+  // the pages are allocated according to the default policy.
+  const size_t bits = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask((node / bits) + 1, 0);
+  mask[node / bits] |= 1UL << (node % bits);
+  syscall(
+      SYS_mbind,
+      ptr,
+      size,
+      kMemoryPolicyPreferred,
+      mask.data(),
+      mask.size() * bits + 1,
+      0);
+
+  return NumaBuffer(static_cast<uint8_t*>(ptr), NumaDeleter(size));
+}
+
+void NumaDeleter::operator()(uint8_t* ptr) const {
+  if (size_ == 0) {
+    free(ptr);
+    return;
+  }
+  auto rv = munmap(ptr, size_);
+  GLOO_ENFORCE_EQ(rv, 0, "munmap: ", strerror(errno));
+}
+
+#else
+
+NumaBuffer allocateOnNumaNode(
+    size_t size,
+    int /* unused */,
+    bool /* unused */) {
+  return allocateFromHeap(size);
+}
+
+void NumaDeleter::operator()(uint8_t* ptr) const {
+  free(ptr);
+}
+
+#endif
+
+} // namespace gloo
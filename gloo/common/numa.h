@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace gloo {
+
+// Allocations smaller than this are not worth a dedicated mapping and
+// are always allocated from the heap.
+constexpr size_t kNumaMinAllocationSize = 64 * 1024;
+
+// Buffers are aligned to (at least) this many bytes.
+constexpr size_t kCacheLineSize = 64;
+
+// Allocations of at least this size can be backed by huge pages.
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Deleter for buffers returned by allocateOnNumaNode.
+class NumaDeleter {
+ public:
+  NumaDeleter() : size_(0) {}
+
+  explicit NumaDeleter(size_t size) : size_(size) {}
+
+  void operator()(uint8_t* ptr) const;
+
+ private:
+  // Size of the mapping, or 0 if allocated from the heap.
+  size_t size_;
+};
+
+using NumaBuffer = std::unique_ptr<uint8_t[], NumaDeleter>;
+
+// Allocates a buffer of which the pages are preferably backed by memory
+// on the specified NUMA node. Scratch space used by the collectives is
+// read and written by both the CPU and the NIC, so it should be local
+// to the NIC to avoid cross-socket memory traffic.
+//
+// If the node is negative, the buffer is smaller than
+// kNumaMinAllocationSize, or the platform doesn't support memory
+// policies, the buffer is allocated from the heap instead.
+//
+// If hugePages is set and the buffer is at least kHugePageSize, the
+// kernel is advised to back it by transparent huge pages, regardless
+// of the node. Either way, the buffer is aligned to kCacheLineSize.
+//
+NumaBuffer allocateOnNumaNode(size_t size, int node, bool hugePages = false);
+
+} // namespace gloo
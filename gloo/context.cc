@@ -8,6 +8,8 @@
 
 #include "gloo/context.h"
 
+#include <map>
+
 #include "gloo/common/error.h"
 #include "gloo/common/logging.h"
 #include "gloo/transport/device.h"
@@ -22,13 +24,51 @@ Context::Context(int rank, int size, int base)
       size(size),
       base(base),
       slot_(0),
-      timeout_(kTimeoutDefault) {
+      timeout_(kTimeoutDefault),
+      localRank_(0),
+      localSize_(1),
+      numHosts_(size),
+      scratchPoolHugePages_(false),
+      scratchPoolMaxCachedBytes_(ScratchPool::kDefaultMaxCachedBytes) {
   GLOO_ENFORCE_GE(rank, 0);
   GLOO_ENFORCE_LT(rank, size);
   GLOO_ENFORCE_GE(size, 1);
+  hosts_.resize(size);
+  for (int i = 0; i < size; i++) {
+    hosts_[i] = i;
+  }
 }
 
 Context::~Context() {
+  scratchPool_.reset();
+}
+
+void Context::setHostLayout(const std::vector<int>& hosts) {
+  GLOO_ENFORCE_EQ(hosts.size(), size);
+
+  // Renumber hosts in order of the lowest rank that runs on them.
+  std::map<int, int> index;
+  std::vector<int> renumbered(size);
+  for (int i = 0; i < size; i++) {
+    auto it = index.find(hosts[i]);
+    if (it == index.end()) {
+      it = index.emplace(hosts[i], index.size()).first;
+    }
+    renumbered[i] = it->second;
+  }
+
+  localRank_ = 0;
+  localSize_ = 0;
+  for (int i = 0; i < size; i++) {
+    if (renumbered[i] == renumbered[rank]) {
+      if (i < rank) {
+        localRank_++;
+      }
+      localSize_++;
+    }
+  }
+  numHosts_ = index.size();
+  hosts_ = std::move(renumbered);
 }
 
 std::shared_ptr<transport::Device>& Context::getDevice() {
@@ -46,6 +86,40 @@ std::unique_ptr<transport::UnboundBuffer> Context::createUnboundBuffer(
   return transportContext_->createUnboundBuffer(ptr, size);
 }
 
+void Context::registerMemory(void* ptr, size_t size) {
+  GLOO_ENFORCE(transportContext_, "Context is not connected");
+  transportContext_->registerMemory(ptr, size);
+}
+
+void Context::deregisterMemory(void* ptr, size_t size) {
+  GLOO_ENFORCE(transportContext_, "Context is not connected");
+  transportContext_->deregisterMemory(ptr, size);
+}
+
+ScratchPool& Context::getScratchPool() {
+  std::lock_guard<std::mutex> guard(scratchPoolMutex_);
+  if (!scratchPool_) {
+    scratchPool_.reset(new ScratchPool(
+        this,
+        getDevice()->getNumaNode(),
+        scratchPoolHugePages_,
+        scratchPoolMaxCachedBytes_));
+  }
+  return *scratchPool_;
+}
+
+void Context::setScratchPoolHugePages(bool enable) {
+  std::lock_guard<std::mutex> guard(scratchPoolMutex_);
+  GLOO_ENFORCE(!scratchPool_, "Scratch pool is already in use");
+  scratchPoolHugePages_ = enable;
+}
+
+void Context::setScratchPoolMaxCachedBytes(size_t bytes) {
+  std::lock_guard<std::mutex> guard(scratchPoolMutex_);
+  GLOO_ENFORCE(!scratchPool_, "Scratch pool is already in use");
+  scratchPoolMaxCachedBytes_ = bytes;
+}
+
 int Context::nextSlot(int numToSkip) {
   GLOO_ENFORCE_GT(numToSkip, 0);
   auto temp = slot_;
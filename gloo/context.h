@@ -10,8 +10,10 @@
 
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <vector>
 
+#include <gloo/scratch_pool.h>
 #include <gloo/transport/pair.h>
 
 namespace gloo {
@@ -42,6 +44,16 @@ class Context {
   std::unique_ptr<transport::UnboundBuffer> createUnboundBuffer(
       void* ptr, size_t size);
 
+  // Registers memory that is passed to collectives repeatedly, such
+  // as the tensors of a training loop. Collectives create unbound
+  // buffers per call; with transports that require memory
+  // registration (ibverbs), memory that is not registered this way is
+  // registered again by every call. The memory must be deregistered
+  // before it is released. See transport::Context::registerMemory.
+  void registerMemory(void* ptr, size_t size);
+
+  void deregisterMemory(void* ptr, size_t size);
+
   int nextSlot(int numToSkip = 1);
 
   void closeConnections();
@@ -50,11 +62,69 @@ class Context {
 
   std::chrono::milliseconds getTimeout() const;
 
+  // Rank of this process among the processes on the same host.
+  int getLocalRank() const {
+    return localRank_;
+  }
+
+  // Number of processes on the same host as this process.
+  int getLocalSize() const {
+    return localSize_;
+  }
+
+  // Number of hosts that the processes in this context run on.
+  //
+  // The host layout is determined when the context is connected (see
+  // rendezvous::Context::connectFullMesh). If it is not known, every
+  // process is assumed to run on a different host.
+  int getNumHosts() const {
+    return numHosts_;
+  }
+
+  // Index of the host that the specified process runs on. Hosts are
+  // numbered in order of the lowest rank that runs on them.
+  int getHost(int rank) const {
+    return hosts_.at(rank);
+  }
+
+  // Sets the host that every process runs on, indexed by rank. Any
+  // value can be used to identify a host; hosts are renumbered (see
+  // getHost). The layout must be identical across processes.
+  //
+  // This is set when the context is connected. It can be overridden if
+  // host names don't reflect the network topology, or to emulate
+  // multiple hosts in tests.
+  void setHostLayout(const std::vector<int>& hosts);
+
+  // Returns pool of scratch buffers for use by collectives.
+  // It is created on first use, after the context is connected.
+  ScratchPool& getScratchPool();
+
+  // Back scratch buffers by transparent huge pages (where supported).
+  // Must be called before the scratch pool is first used.
+  void setScratchPoolHugePages(bool enable);
+
+  // Caps the number of bytes held by scratch buffers that are not in
+  // use (see ScratchPool). Must be called before the scratch pool is
+  // first used.
+  void setScratchPoolMaxCachedBytes(size_t bytes);
+
  protected:
   std::shared_ptr<transport::Device> device_;
   std::shared_ptr<transport::Context> transportContext_;
   int slot_;
   std::chrono::milliseconds timeout_;
+  int localRank_;
+  int localSize_;
+  int numHosts_;
+  std::vector<int> hosts_;
+
+  // The scratch pool is destructed before the transport context,
+  // since it holds unbound buffers created by the transport context.
+  std::mutex scratchPoolMutex_;
+  std::unique_ptr<ScratchPool> scratchPool_;
+  bool scratchPoolHugePages_;
+  size_t scratchPoolMaxCachedBytes_;
 };
 
 } // namespace gloo
@@ -59,4 +59,9 @@ void gather(GatherOptions& opts) {
   }
 }
 
+std::shared_ptr<Work> igather(GatherOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](GatherOptions& opts) { gather(opts); });
+}
+
 } // namespace gloo
@@ -10,6 +10,7 @@
 
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -77,4 +78,8 @@ class GatherOptions {
 
 void gather(GatherOptions& opts);
 
+// Non-blocking variant of gather. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> igather(GatherOptions opts);
+
 } // namespace gloo
@@ -111,4 +111,9 @@ void gatherv(GathervOptions& opts) {
   }
 }
 
+std::shared_ptr<Work> igatherv(GathervOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](GathervOptions& opts) { gatherv(opts); });
+}
+
 } // namespace gloo
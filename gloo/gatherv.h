@@ -10,6 +10,7 @@
 
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -98,4 +99,8 @@ class GathervOptions {
 
 void gatherv(GathervOptions& opts);
 
+// Non-blocking variant of gatherv. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> igatherv(GathervOptions opts);
+
 } // namespace gloo
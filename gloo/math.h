@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include "gloo/types.h"
 
 namespace gloo {
@@ -72,6 +74,120 @@ void min(T* a, const T* b, size_t n) {
   min<T>(a, a, b, n);
 }
 
+namespace detail {
+
+// Number of bytes of the output that the N-ary reductions below compute
+// at a time. Small enough for the block to stay in L1 cache while the
+// inputs are streamed through it.
+constexpr size_t kReduceBlockBytes = 4096;
+
+// Reduces k inputs into the output using the specified binary operation.
+// Instead of making a pass over the output for every input, this works
+// on one block of the output at a time, so that every input is read
+// once and the output is written once. The output may be equal to the
+// first input, but must not overlap with the other inputs.
+//
+// The finish function is called with every block of the output after
+// it is reduced, while it is still in cache.
+template <typename T, typename Op, typename Finish>
+void reduceN(
+    T* out,
+    const T* const* ins,
+    size_t k,
+    size_t n,
+    Op op,
+    Finish finish) {
+  const size_t block = std::max(kReduceBlockBytes / sizeof(T), (size_t)1);
+  for (size_t begin = 0; begin < n; begin += block) {
+    const size_t end = std::min(begin + block, n);
+    if (k == 1) {
+      if (out != ins[0]) {
+        std::copy(ins[0] + begin, ins[0] + end, out + begin);
+      }
+      finish(out + begin, end - begin);
+      continue;
+    }
+
+    const T* a = ins[0];
+    const T* b = ins[1];
+    for (size_t j = begin; j < end; j++) {
+      out[j] = op(a[j], b[j]);
+    }
+
+    // Consume the remaining inputs two at a time to halve the number
+    // of loads and stores of the output block.
+    size_t i = 2;
+    for (; i + 1 < k; i += 2) {
+      a = ins[i];
+      b = ins[i + 1];
+      for (size_t j = begin; j < end; j++) {
+        out[j] = op(op(out[j], a[j]), b[j]);
+      }
+    }
+    if (i < k) {
+      a = ins[i];
+      for (size_t j = begin; j < end; j++) {
+        out[j] = op(out[j], a[j]);
+      }
+    }
+    finish(out + begin, end - begin);
+  }
+}
+
+template <typename T, typename Op>
+void reduceN(T* out, const T* const* ins, size_t k, size_t n, Op op) {
+  reduceN(out, ins, k, n, op, [](T* /* unused */, size_t /* unused */) {});
+}
+
+} // namespace detail
+
+// N-ary variants of the reduction functions above. They reduce k >= 1
+// inputs of n elements into the output in a single pass over memory.
+
+template <typename T>
+void sum(T* out, const T* const* ins, size_t k, size_t n) {
+  detail::reduceN(
+      out, ins, k, n, [](const T& a, const T& b) -> T { return a + b; });
+}
+
+// Computes the sum of k inputs multiplied by the specified factor. The
+// multiplication is fused with the reduction, so it doesn't take
+// another pass over memory.
+template <typename T>
+void sum(T* out, const T* const* ins, size_t k, size_t n, T factor) {
+  detail::reduceN(
+      out,
+      ins,
+      k,
+      n,
+      [](const T& a, const T& b) -> T { return a + b; },
+      [factor](T* block, size_t length) {
+        for (size_t j = 0; j < length; j++) {
+          block[j] = block[j] * factor;
+        }
+      });
+}
+
+template <typename T>
+void product(T* out, const T* const* ins, size_t k, size_t n) {
+  detail::reduceN(
+      out, ins, k, n, [](const T& a, const T& b) -> T { return a * b; });
+}
+
+template <typename T>
+void max(T* out, const T* const* ins, size_t k, size_t n) {
+  detail::reduceN(out, ins, k, n, [](const T& a, const T& b) -> T {
+    return std::max(a, b);
+  });
+}
+
+template <typename T>
+void min(T* out, const T* const* ins, size_t k, size_t n) {
+  detail::reduceN(out, ins, k, n, [](const T& a, const T& b) -> T {
+    return std::min(a, b);
+  });
+}
+
 template <typename T>
 T roundUp(T value, T multiple) {
   T remainder = value % multiple;
@@ -10,14 +10,202 @@
 
 #include <array>
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 
+#include "gloo/allreduce_tuning.h"
 #include "gloo/common/logging.h"
 #include "gloo/math.h"
 #include "gloo/types.h"
 
 namespace gloo {
 
+namespace {
+
+// Position of this process in the tree that a tree algorithm reduces
+// along. The root of the tree is the root of the reduce.
+struct Tree {
+  int parent = -1;
+  std::vector<int> children;
+};
+
+// Maps a virtual rank, where the root has virtual rank 0, to a rank.
+int toRank(int vrank, int size, int root) {
+  return (vrank + root) % size;
+}
+
+// In a binomial tree, a process receives from the processes whose
+// virtual rank differs only in a bit below its lowest set bit, and
+// then sends to the process with that bit cleared. Children are
+// ordered by the size of their subtree, smallest first.
+Tree computeBinomialTree(int rank, int size, int root) {
+  Tree tree;
+  const int vrank = (rank + size - root) % size;
+  for (int bit = 1; bit < size; bit <<= 1) {
+    if ((vrank & bit) != 0) {
+      tree.parent = toRank(vrank ^ bit, size, root);
+      break;
+    }
+    if ((vrank | bit) < size) {
+      tree.children.push_back(toRank(vrank | bit, size, root));
+    }
+  }
+  return tree;
+}
+
+// In a binary tree, virtual rank v has children 2v+1 and 2v+2.
+Tree computeBinaryTree(int rank, int size, int root) {
+  Tree tree;
+  const int vrank = (rank + size - root) % size;
+  if (vrank > 0) {
+    tree.parent = toRank((vrank - 1) / 2, size, root);
+  }
+  for (int child = 2 * vrank + 1; child <= 2 * vrank + 2; child++) {
+    if (child < size) {
+      tree.children.push_back(toRank(child, size, root));
+    }
+  }
+  return tree;
+}
+
+// Depth of the binary tree of the specified size.
+size_t getBinaryTreeDepth(int size) {
+  return log2ceil(size + 1) - 1;
+}
+
+// Estimated cost of the pipelined tree with the specified number of
+// segments. Every step takes as long as the transfer of a segment from
+// every child. The reduction of a segment overlaps with the transfer of
+// the next, except for the last segment at every level of the tree.
+double getPipelinedTreeCost(
+    const AllreduceLinkModel& model,
+    int size,
+    size_t bytes,
+    double segments) {
+  const double depth = getBinaryTreeDepth(size);
+  const double children = std::min(size - 1, 2);
+  const double segmentBytes = children * bytes / segments;
+  return (segments + depth - 1) *
+      (model.latencyMicros + segmentBytes * 8 / model.bandwidthMbps) +
+      depth * segmentBytes / model.reduceBytesPerMicro;
+}
+
+// Returns the number of segments that minimizes the estimated cost of
+// the pipelined tree (see getPipelinedTreeCost).
+size_t getPipelineSegments(int size, size_t bytes) {
+  if (size < 2) {
+    return 1;
+  }
+  const auto& model = AllreduceLinkModel::getDefault();
+  const double depth = getBinaryTreeDepth(size);
+  const double children = std::min(size - 1, 2);
+  const double segments = std::sqrt(
+      children * bytes *
+      ((depth - 1) * 8 / model.bandwidthMbps +
+       depth / model.reduceBytesPerMicro) /
+      model.latencyMicros);
+  return std::max(static_cast<size_t>(segments + 0.5), (size_t)1);
+}
+
+// Reduces along the tree, in segments of the specified size. Every
+// process reduces the segments it receives from its children into its
+// output and sends the result to its parent. Two segments are in flight
+// per child, so that the transfer of the next segment overlaps with the
+// reduction of the current one.
+void reduceTree(
+    const std::shared_ptr<Context>& context,
+    const Tree& tree,
+    transport::UnboundBuffer* in,
+    transport::UnboundBuffer* out,
+    Slot slot,
+    size_t segmentBytes,
+    size_t elementSize,
+    const ReduceOptions::Func& fn,
+    std::chrono::milliseconds timeout) {
+  const size_t totalBytes = out->size;
+  const size_t numSegments = (totalBytes + segmentBytes - 1) / segmentBytes;
+  const auto length = [&](size_t i) {
+    return std::min(segmentBytes, totalBytes - i * segmentBytes);
+  };
+
+  // Every child receives into a buffer of its own, so that the
+  // completion of a receive identifies the child. Receives from the
+  // same child complete in order, which identifies the segment. With
+  // more than one segment, every buffer holds two segments, so that
+  // the next segment is received while the current one is reduced.
+  // The scratch space is registered for as long as it lives (see
+  // ScratchPool), so the buffers don't register it again.
+  const size_t depth = numSegments > 1 ? 2 : 1;
+  auto scratch = context->getScratchPool().acquire(
+      tree.children.size() * depth * segmentBytes);
+  std::vector<std::unique_ptr<transport::UnboundBuffer>> tmp;
+  for (size_t j = 0; j < tree.children.size(); j++) {
+    tmp.push_back(context->createUnboundBuffer(
+        scratch.ptr() + j * depth * segmentBytes, depth * segmentBytes));
+  }
+  const auto recv = [&](size_t i) {
+    for (size_t j = 0; j < tree.children.size(); j++) {
+      tmp[j]->recv(
+          tree.children[j], slot, (i % depth) * segmentBytes, length(i));
+    }
+  };
+
+  // A leaf sends its input, other processes send their output.
+  auto src = tree.children.empty() ? in : out;
+  size_t numSends = 0;
+  if (numSegments > 0) {
+    recv(0);
+  }
+  for (size_t i = 0; i < numSegments; i++) {
+    if (i + 1 < numSegments) {
+      recv(i + 1);
+    }
+    const size_t offset = i * segmentBytes;
+    const void* acc = static_cast<const uint8_t*>(in->ptr) + offset;
+    for (size_t j = 0; j < tree.children.size(); j++) {
+      auto buf = tmp[j].get();
+      buf->waitRecv(timeout);
+      fn(static_cast<uint8_t*>(out->ptr) + offset,
+         acc,
+         static_cast<const uint8_t*>(buf->ptr) + (i % depth) * segmentBytes,
+         length(i) / elementSize);
+      acc = static_cast<const uint8_t*>(out->ptr) + offset;
+    }
+    if (tree.parent >= 0) {
+      src->send(tree.parent, slot, offset, length(i));
+      numSends++;
+    }
+  }
+
+  for (size_t i = 0; i < numSends; i++) {
+    src->waitSend(timeout);
+  }
+}
+
+} // namespace
+
+ReduceOptions::Algorithm selectReduceAlgorithm(int size, size_t bytes) {
+  const auto& model = AllreduceLinkModel::getDefault();
+  const double latency = model.latencyMicros;
+  const double byteCost = 8 / model.bandwidthMbps;
+  const double reduceCost = 1 / model.reduceBytesPerMicro;
+
+  // The ring overlaps the reduction with the transfer, the binomial
+  // tree receives the full buffer before reducing it.
+  const double ring = 2 * (size - 1) * (latency + bytes * byteCost / size);
+  const double binomial =
+      log2ceil(size) * (latency + bytes * (byteCost + reduceCost));
+  const double tree = getPipelinedTreeCost(
+      model, size, bytes, getPipelineSegments(size, bytes));
+  if (binomial <= ring && binomial <= tree) {
+    return ReduceOptions::BINOMIAL;
+  }
+  if (tree < ring) {
+    return ReduceOptions::PIPELINED_TREE;
+  }
+  return ReduceOptions::RING;
+}
+
 void reduce(ReduceOptions& opts) {
   if (opts.elements == 0) {
     return;
@@ -31,16 +219,6 @@ void reduce(ReduceOptions& opts) {
   GLOO_ENFORCE(opts.elementSize > 0);
   GLOO_ENFORCE(opts.root >= 0 && opts.root < context->size);
   GLOO_ENFORCE(opts.reduce != nullptr);
-  const auto recvRank = (context->size + context->rank + 1) % context->size;
-  GLOO_ENFORCE(
-      recvRank == context->rank || context->getPair(recvRank),
-      "missing connection between rank " + std::to_string(context->rank) +
-          " (this process) and rank " + std::to_string(recvRank));
-  const auto sendRank = (context->size + context->rank - 1) % context->size;
-  GLOO_ENFORCE(
-      sendRank == context->rank || context->getPair(sendRank),
-      "missing connection between rank " + std::to_string(context->rank) +
-          " (this process) and rank " + std::to_string(sendRank));
 
   // If input buffer is not specified, the output is also the input
   if (in == nullptr) {
@@ -58,6 +236,64 @@ void reduce(ReduceOptions& opts) {
     return;
   }
 
+  auto algorithm = opts.algorithm;
+  if (algorithm == ReduceOptions::UNSPECIFIED) {
+    algorithm = selectReduceAlgorithm(context->size, out->size);
+  }
+  if (algorithm == ReduceOptions::BINOMIAL ||
+      algorithm == ReduceOptions::PIPELINED_TREE) {
+    Tree tree;
+    size_t segmentBytes = out->size;
+    if (algorithm == ReduceOptions::BINOMIAL) {
+      tree = computeBinomialTree(context->rank, context->size, opts.root);
+    } else {
+      tree = computeBinaryTree(context->rank, context->size, opts.root);
+      // Round the maximum segment size down and the segment size up to
+      // a multiple of the element size (see the ring algorithm below).
+      const size_t maxSegmentSize = opts.elementSize *
+          std::max(opts.maxSegmentSize / opts.elementSize, (size_t)1);
+      const auto segments = getPipelineSegments(context->size, out->size);
+      segmentBytes = std::min(
+          roundUp((out->size + segments - 1) / segments, opts.elementSize),
+          maxSegmentSize);
+    }
+    for (const auto peer : tree.children) {
+      GLOO_ENFORCE(
+          context->getPair(peer),
+          "missing connection between rank " + std::to_string(context->rank) +
+              " (this process) and rank " + std::to_string(peer));
+    }
+    if (tree.parent >= 0) {
+      GLOO_ENFORCE(
+          context->getPair(tree.parent),
+          "missing connection between rank " + std::to_string(context->rank) +
+              " (this process) and rank " + std::to_string(tree.parent));
+    }
+    reduceTree(
+        context,
+        tree,
+        in,
+        out,
+        slot,
+        segmentBytes,
+        opts.elementSize,
+        opts.reduce,
+        opts.timeout);
+    return;
+  }
+  GLOO_ENFORCE_EQ(algorithm, ReduceOptions::RING, "Algorithm not implemented.");
+
+  const auto recvRank = (context->size + context->rank + 1) % context->size;
+  GLOO_ENFORCE(
+      recvRank == context->rank || context->getPair(recvRank),
+      "missing connection between rank " + std::to_string(context->rank) +
+          " (this process) and rank " + std::to_string(recvRank));
+  const auto sendRank = (context->size + context->rank - 1) % context->size;
+  GLOO_ENFORCE(
+      sendRank == context->rank || context->getPair(sendRank),
+      "missing connection between rank " + std::to_string(context->rank) +
+          " (this process) and rank " + std::to_string(sendRank));
+
   // The ring algorithm works as follows.
   //
   // The given input is split into a number of chunks equal to the
@@ -121,10 +357,8 @@ void reduce(ReduceOptions& opts) {
   const size_t chunkBytes = numSegmentsPerRank * segmentBytes;
 
   // Allocate scratch space to hold two chunks
-  std::unique_ptr<uint8_t[]> tmpAllocation(new uint8_t[segmentBytes * 2]);
-  std::unique_ptr<transport::UnboundBuffer> tmpBuffer =
-      context->createUnboundBuffer(tmpAllocation.get(), segmentBytes * 2);
-  transport::UnboundBuffer* tmp = tmpBuffer.get();
+  auto scratch = context->getScratchPool().acquire(segmentBytes * 2);
+  transport::UnboundBuffer* tmp = scratch.getUnboundBuffer();
 
   // Use dynamic lookup for chunk offset in the temporary buffer.
   // With two operations in flight we need two offsets.
@@ -246,4 +480,9 @@ void reduce(ReduceOptions& opts) {
   }
 }
 
+std::shared_ptr<Work> ireduce(ReduceOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](ReduceOptions& opts) { reduce(opts); });
+}
+
 } // namespace gloo
@@ -13,6 +13,7 @@
 
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -20,6 +21,18 @@ class ReduceOptions {
  public:
   using Func = std::function<void(void*, const void*, const void*, size_t)>;
 
+  // The ring algorithm runs a reduce-scatter and gathers the result to
+  // the root. It is bandwidth optimal, but takes 2(P-1) steps. The
+  // binomial tree takes log2(P) steps, each sending the full buffer.
+  // The pipelined tree reduces along a binary tree in segments, so
+  // that the levels of the tree work on different segments at once.
+  enum Algorithm {
+    UNSPECIFIED = 0,
+    RING = 1,
+    BINOMIAL = 2,
+    PIPELINED_TREE = 3,
+  };
+
   explicit ReduceOptions(const std::shared_ptr<Context>& context)
       : context(context), timeout(context->getTimeout()) {}
 
@@ -55,6 +68,12 @@ class ReduceOptions {
     this->root = root;
   }
 
+  // If not specified, the algorithm with the lowest estimated cost
+  // for the size of the buffer is used (see selectReduceAlgorithm).
+  void setAlgorithm(Algorithm algorithm) {
+    this->algorithm = algorithm;
+  }
+
   void setReduceFunction(Func fn) {
     this->reduce = fn;
   }
@@ -88,13 +107,17 @@ class ReduceOptions {
   // Reduction function.
   Func reduce;
 
+  // Algorithm selection.
+  Algorithm algorithm = UNSPECIFIED;
+
   // Tag for this operation.
   // Must be unique across operations executing in parallel.
   uint32_t tag = 0;
 
   // This is the maximum size of each I/O operation (send/recv) of which
-  // two are in flight at all times. A smaller value leads to more
-  // overhead and a larger value leads to poor cache behavior.
+  // two are in flight at all times (per child for the pipelined tree).
+  // A smaller value leads to more overhead and a larger value leads to
+  // poor cache behavior.
   static constexpr size_t kMaxSegmentSize = 1024 * 1024;
 
   // Internal use only. This is used to exercise code paths where we
@@ -111,4 +134,13 @@ class ReduceOptions {
 
 void reduce(ReduceOptions& opts);
 
+// Selects the reduce algorithm with the lowest estimated cost for a
+// buffer of the specified size, using the default link model (see
+// AllreduceLinkModel in gloo/allreduce_tuning.h).
+ReduceOptions::Algorithm selectReduceAlgorithm(int size, size_t bytes);
+
+// Non-blocking variant of reduce. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> ireduce(ReduceOptions opts);
+
 } // namespace gloo
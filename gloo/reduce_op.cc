@@ -0,0 +1,489 @@
+/**
+ * Copyright (c) 2018-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/reduce_op.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+#include "gloo/common/logging.h"
+#include "gloo/config.h"
+#include "gloo/math.h"
+
+namespace gloo {
+
+namespace {
+
+using BinaryFunction = void (*)(void*, const void*, const void*, size_t);
+
+template <typename T, void (*Fn)(T*, const T* const*, size_t, size_t)>
+void naryReduce(void* out, const void* const* ins, size_t k, size_t n) {
+  Fn(static_cast<T*>(out), reinterpret_cast<const T* const*>(ins), k, n);
+}
+
+template <typename T>
+void scaledNaryReduce(
+    void* out,
+    const void* const* ins,
+    size_t k,
+    size_t n,
+    double factor) {
+  sum<T>(
+      static_cast<T*>(out),
+      reinterpret_cast<const T* const*>(ins),
+      k,
+      n,
+      T(factor));
+}
+
+template <typename T>
+ReduceKernels getKernels(ReduceOp op) {
+  if (op == ReduceOp::AVG) {
+    GLOO_ENFORCE(
+        !std::is_integral<T>::value,
+        "Average is only supported for floating point types.");
+    auto kernels = getKernels<T>(ReduceOp::SUM);
+    kernels.scaledNary = &scaledNaryReduce<T>;
+    return kernels;
+  }
+
+  ReduceKernels kernels;
+  switch (op) {
+    case ReduceOp::SUM:
+      kernels.binary = &sum<T>;
+      kernels.nary = &naryReduce<T, &sum<T>>;
+      break;
+    case ReduceOp::PRODUCT:
+      kernels.binary = &product<T>;
+      kernels.nary = &naryReduce<T, &product<T>>;
+      break;
+    case ReduceOp::MIN:
+      kernels.binary = &min<T>;
+      kernels.nary = &naryReduce<T, &min<T>>;
+      break;
+    case ReduceOp::MAX:
+      kernels.binary = &max<T>;
+      kernels.nary = &naryReduce<T, &max<T>>;
+      break;
+    default:
+      GLOO_ENFORCE(false, "Reduce op not handled.");
+  }
+
+  // With AVX, the binary float16 kernels are vectorized and faster
+  // than the scalar N-ary kernels.
+  if (GLOO_USE_AVX && std::is_same<T, float16>::value) {
+    kernels.nary = nullptr;
+  }
+  return kernels;
+}
+
+float toFloat(float16 value) {
+  return cpu_half2float(value);
+}
+
+float toFloat(bfloat16 value) {
+  return cpu_bfloat162float(value);
+}
+
+template <typename T>
+T fromFloat(float value);
+
+template <>
+float16 fromFloat<float16>(float value) {
+  return cpu_float2half_rn(value);
+}
+
+template <>
+bfloat16 fromFloat<bfloat16>(float value) {
+  return cpu_float2bfloat16_rn(value);
+}
+
+template <ReduceOp op>
+float applyFloat(float a, float b) {
+  switch (op) {
+    case ReduceOp::SUM:
+      return a + b;
+    case ReduceOp::PRODUCT:
+      return a * b;
+    case ReduceOp::MIN:
+      return std::min(a, b);
+    default:
+      return std::max(a, b);
+  }
+}
+
+template <typename T>
+void compress(void* out_, const void* in_, float* residual, size_t n) {
+  T* out = static_cast<T*>(out_);
+  const float* in = static_cast<const float*>(in_);
+  if (residual == nullptr) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = fromFloat<T>(in[i]);
+    }
+    return;
+  }
+  for (size_t i = 0; i < n; i++) {
+    const float value = in[i] + residual[i];
+    out[i] = fromFloat<T>(value);
+    residual[i] = value - toFloat(out[i]);
+  }
+}
+
+template <typename T>
+void decompress(void* out_, const void* in_, size_t n) {
+  float* out = static_cast<float*>(out_);
+  const T* in = static_cast<const T*>(in_);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = toFloat(in[i]);
+  }
+}
+
+template <typename T, ReduceOp op>
+void reduceCompressed(
+    void* out_,
+    void* copy_,
+    const void* in_,
+    float* residual,
+    size_t n) {
+  float* out = static_cast<float*>(out_);
+  T* copy = static_cast<T*>(copy_);
+  const T* in = static_cast<const T*>(in_);
+  for (size_t i = 0; i < n; i++) {
+    const float local = residual != nullptr ? out[i] + residual[i] : out[i];
+    const float value = applyFloat<op>(local, toFloat(in[i]));
+    copy[i] = fromFloat<T>(value);
+    out[i] = toFloat(copy[i]);
+    if (residual != nullptr) {
+      residual[i] = value - out[i];
+    }
+  }
+}
+
+// Size of a full block of int8 data (see kQuantizationBlockSize).
+constexpr size_t kQuantizationBlockBytes =
+    sizeof(float) + kQuantizationBlockSize;
+
+// Quantizes n <= kQuantizationBlockSize elements to a block of int8
+// data. Stores the decoded values in decoded, if not null.
+void quantizeBlock(uint8_t* block, const float* in, float* decoded, size_t n) {
+  uint32_t absmaxBits = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint32_t bits;
+    std::memcpy(&bits, &in[i], sizeof(bits));
+    absmaxBits = std::max(absmaxBits, bits & 0x7fffffff);
+  }
+  float scale;
+  float inverse;
+  const bool finite =
+      detail::getQuantizationScale(absmaxBits, &scale, &inverse);
+  std::memcpy(block, &scale, sizeof(scale));
+  int8_t* values = reinterpret_cast<int8_t*>(block + sizeof(scale));
+  for (size_t i = 0; i < n; i++) {
+    values[i] = finite ? static_cast<int8_t>(std::nearbyint(in[i] * inverse))
+                       : 0;
+    if (decoded != nullptr) {
+      decoded[i] = values[i] * scale;
+    }
+  }
+}
+
+void quantize(void* out_, const void* in_, float* residual, size_t n) {
+  uint8_t* out = static_cast<uint8_t*>(out_);
+  const float* in = static_cast<const float*>(in_);
+  float value[kQuantizationBlockSize];
+  float decoded[kQuantizationBlockSize];
+  for (size_t i = 0; i < n; i += kQuantizationBlockSize) {
+    const size_t m = std::min(kQuantizationBlockSize, n - i);
+    uint8_t* block = out + i / kQuantizationBlockSize * kQuantizationBlockBytes;
+    if (residual == nullptr) {
+      quantizeBlock(block, in + i, nullptr, m);
+      continue;
+    }
+    for (size_t j = 0; j < m; j++) {
+      value[j] = in[i + j] + residual[i + j];
+    }
+    quantizeBlock(block, value, decoded, m);
+    for (size_t j = 0; j < m; j++) {
+      residual[i + j] = value[j] - decoded[j];
+    }
+  }
+}
+
+void dequantize(void* out_, const void* in_, size_t n) {
+  float* out = static_cast<float*>(out_);
+  const uint8_t* in = static_cast<const uint8_t*>(in_);
+  for (size_t i = 0; i < n; i += kQuantizationBlockSize) {
+    const size_t m = std::min(kQuantizationBlockSize, n - i);
+    const uint8_t* block =
+        in + i / kQuantizationBlockSize * kQuantizationBlockBytes;
+    float scale;
+    std::memcpy(&scale, block, sizeof(scale));
+    const int8_t* values =
+        reinterpret_cast<const int8_t*>(block + sizeof(scale));
+    for (size_t j = 0; j < m; j++) {
+      out[i + j] = values[j] * scale;
+    }
+  }
+}
+
+template <ReduceOp op>
+void reduceQuantized(
+    void* out_,
+    void* copy_,
+    const void* in_,
+    float* residual,
+    size_t n) {
+  float* out = static_cast<float*>(out_);
+  uint8_t* copy = static_cast<uint8_t*>(copy_);
+  const uint8_t* in = static_cast<const uint8_t*>(in_);
+  float value[kQuantizationBlockSize];
+  for (size_t i = 0; i < n; i += kQuantizationBlockSize) {
+    const size_t m = std::min(kQuantizationBlockSize, n - i);
+    const size_t offset = i / kQuantizationBlockSize * kQuantizationBlockBytes;
+    float scale;
+    std::memcpy(&scale, in + offset, sizeof(scale));
+    const int8_t* values =
+        reinterpret_cast<const int8_t*>(in + offset + sizeof(scale));
+    for (size_t j = 0; j < m; j++) {
+      const float local =
+          residual != nullptr ? out[i + j] + residual[i + j] : out[i + j];
+      value[j] = applyFloat<op>(local, values[j] * scale);
+    }
+    quantizeBlock(copy + offset, value, out + i, m);
+    if (residual != nullptr) {
+      for (size_t j = 0; j < m; j++) {
+        residual[i + j] = value[j] - out[i + j];
+      }
+    }
+  }
+}
+
+CompressedReduceKernels getQuantizedKernels(ReduceOp op) {
+  CompressedReduceKernels kernels;
+  kernels.compress = &quantize;
+  kernels.decompress = &dequantize;
+  switch (op) {
+    case ReduceOp::SUM:
+    case ReduceOp::AVG:
+      kernels.reduce = &reduceQuantized<ReduceOp::SUM>;
+      break;
+    case ReduceOp::PRODUCT:
+      kernels.reduce = &reduceQuantized<ReduceOp::PRODUCT>;
+      break;
+    case ReduceOp::MIN:
+      kernels.reduce = &reduceQuantized<ReduceOp::MIN>;
+      break;
+    case ReduceOp::MAX:
+      kernels.reduce = &reduceQuantized<ReduceOp::MAX>;
+      break;
+    default:
+      GLOO_ENFORCE(false, "Reduce op not handled.");
+  }
+  return kernels;
+}
+
+template <typename T>
+CompressedReduceKernels getCompressedKernels(ReduceOp op) {
+  CompressedReduceKernels kernels;
+  kernels.compress = &compress<T>;
+  kernels.decompress = &decompress<T>;
+  switch (op) {
+    case ReduceOp::SUM:
+    case ReduceOp::AVG:
+      kernels.reduce = &reduceCompressed<T, ReduceOp::SUM>;
+      break;
+    case ReduceOp::PRODUCT:
+      kernels.reduce = &reduceCompressed<T, ReduceOp::PRODUCT>;
+      break;
+    case ReduceOp::MIN:
+      kernels.reduce = &reduceCompressed<T, ReduceOp::MIN>;
+      break;
+    case ReduceOp::MAX:
+      kernels.reduce = &reduceCompressed<T, ReduceOp::MAX>;
+      break;
+    default:
+      GLOO_ENFORCE(false, "Reduce op not handled.");
+  }
+  return kernels;
+}
+
+const ReduceOp kReduceOps[] = {
+    ReduceOp::SUM,
+    ReduceOp::PRODUCT,
+    ReduceOp::MIN,
+    ReduceOp::MAX,
+};
+
+const DataType kDataTypes[] = {
+    DataType::INT8,
+    DataType::UINT8,
+    DataType::INT32,
+    DataType::UINT32,
+    DataType::INT64,
+    DataType::UINT64,
+    DataType::FLOAT16,
+    DataType::FLOAT32,
+    DataType::FLOAT64,
+    DataType::BFLOAT16,
+};
+
+} // namespace
+
+size_t getDataTypeSize(DataType type) {
+  switch (type) {
+    case DataType::INT8:
+      return sizeof(int8_t);
+    case DataType::UINT8:
+      return sizeof(uint8_t);
+    case DataType::INT32:
+      return sizeof(int32_t);
+    case DataType::UINT32:
+      return sizeof(uint32_t);
+    case DataType::INT64:
+      return sizeof(int64_t);
+    case DataType::UINT64:
+      return sizeof(uint64_t);
+    case DataType::FLOAT16:
+      return sizeof(float16);
+    case DataType::FLOAT32:
+      return sizeof(float);
+    case DataType::FLOAT64:
+      return sizeof(double);
+    case DataType::BFLOAT16:
+      return sizeof(bfloat16);
+    default:
+      GLOO_ENFORCE(false, "Data type not handled.");
+  }
+  return 0;
+}
+
+const char* getSimdIsaName(SimdIsa isa) {
+  switch (isa) {
+    case SimdIsa::SCALAR:
+      return "scalar";
+    case SimdIsa::SSE4:
+      return "sse4";
+    case SimdIsa::AVX2:
+      return "avx2";
+    case SimdIsa::AVX512:
+      return "avx512";
+    case SimdIsa::AVX512BF16:
+      return "avx512bf16";
+    default:
+      GLOO_ENFORCE(false, "Instruction set not handled.");
+  }
+  return nullptr;
+}
+
+ReduceKernels getReduceKernels(ReduceOp op, DataType type) {
+  return getReduceKernels(op, type, getSimdIsa());
+}
+
+ReduceKernels getReduceKernels(ReduceOp op, DataType type, SimdIsa isa) {
+  for (auto i = static_cast<int>(isa); i > 0; i--) {
+    const auto kernels =
+        detail::getSimdReduceKernels(op, type, static_cast<SimdIsa>(i));
+    if (kernels.binary != nullptr) {
+      return kernels;
+    }
+  }
+
+  switch (type) {
+    case DataType::INT8:
+      return getKernels<int8_t>(op);
+    case DataType::UINT8:
+      return getKernels<uint8_t>(op);
+    case DataType::INT32:
+      return getKernels<int32_t>(op);
+    case DataType::UINT32:
+      return getKernels<uint32_t>(op);
+    case DataType::INT64:
+      return getKernels<int64_t>(op);
+    case DataType::UINT64:
+      return getKernels<uint64_t>(op);
+    case DataType::FLOAT16:
+      return getKernels<float16>(op);
+    case DataType::FLOAT32:
+      return getKernels<float>(op);
+    case DataType::FLOAT64:
+      return getKernels<double>(op);
+    case DataType::BFLOAT16:
+      return getKernels<bfloat16>(op);
+    default:
+      GLOO_ENFORCE(false, "Data type not handled.");
+  }
+  return ReduceKernels();
+}
+
+CompressedReduceKernels getCompressedReduceKernels(
+    ReduceOp op,
+    DataType type) {
+  return getCompressedReduceKernels(op, type, getSimdIsa());
+}
+
+CompressedReduceKernels getCompressedReduceKernels(
+    ReduceOp op,
+    DataType type,
+    SimdIsa isa) {
+  CompressedReduceKernels kernels;
+  for (auto i = static_cast<int>(isa); i > 0; i--) {
+    kernels = detail::getSimdCompressedReduceKernels(
+        op, type, static_cast<SimdIsa>(i));
+    if (kernels.reduce != nullptr) {
+      break;
+    }
+  }
+
+  switch (type) {
+    case DataType::FLOAT16:
+      if (kernels.reduce == nullptr) {
+        kernels = getCompressedKernels<float16>(op);
+      }
+      kernels.elementBytes = sizeof(float16);
+      break;
+    case DataType::BFLOAT16:
+      if (kernels.reduce == nullptr) {
+        kernels = getCompressedKernels<bfloat16>(op);
+      }
+      kernels.elementBytes = sizeof(bfloat16);
+      break;
+    case DataType::INT8:
+      if (kernels.reduce == nullptr) {
+        kernels = getQuantizedKernels(op);
+      }
+      kernels.blockSize = kQuantizationBlockSize;
+      kernels.headerBytes = sizeof(float);
+      kernels.elementBytes = sizeof(int8_t);
+      break;
+    default:
+      GLOO_ENFORCE(
+          false, "Data is only compressed to float16, bfloat16, or int8.");
+  }
+  return kernels;
+}
+
+ReduceKernels findReduceKernels(
+    const std::function<void(void*, const void*, const void*, size_t)>& fn) {
+  const auto target = fn.target<BinaryFunction>();
+  if (target == nullptr) {
+    return ReduceKernels();
+  }
+  for (const auto type : kDataTypes) {
+    for (const auto op : kReduceOps) {
+      const auto kernels = getReduceKernels(op, type, SimdIsa::SCALAR);
+      if (kernels.binary == *target) {
+        return getReduceKernels(op, type);
+      }
+    }
+  }
+  return ReduceKernels();
+}
+
+} // namespace gloo
@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2018-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include "gloo/types.h"
+
+namespace gloo {
+
+// Built-in reduction operations.
+//
+// Unlike an opaque reduction function, a built-in operation tells the
+// collective what it computes. Together with the data type, this lets
+// it select specialized kernels once, when it is set up, instead of
+// calling a type erased function for every segment.
+//
+enum class ReduceOp : uint8_t {
+  UNSPECIFIED = 0,
+  SUM = 1,
+  PRODUCT = 2,
+  MIN = 3,
+  MAX = 4,
+
+  // Sum divided by the number of buffers that are reduced. Only
+  // supported for floating point types. The inputs are scaled before
+  // they are summed, while they are reduced locally, so averaging
+  // doesn't take another pass over the output.
+  AVG = 5,
+};
+
+// Element types supported by the built-in reduction operations.
+enum class DataType : uint8_t {
+  UNSPECIFIED = 0,
+  INT8 = 1,
+  UINT8 = 2,
+  INT32 = 3,
+  UINT32 = 4,
+  INT64 = 5,
+  UINT64 = 6,
+  FLOAT16 = 7,
+  FLOAT32 = 8,
+  FLOAT64 = 9,
+  BFLOAT16 = 10,
+};
+
+// Returns the data type of T, or UNSPECIFIED if T is not supported.
+template <typename T>
+inline DataType getDataType() {
+  return DataType::UNSPECIFIED;
+}
+
+template <>
+inline DataType getDataType<int8_t>() {
+  return DataType::INT8;
+}
+
+template <>
+inline DataType getDataType<uint8_t>() {
+  return DataType::UINT8;
+}
+
+template <>
+inline DataType getDataType<int32_t>() {
+  return DataType::INT32;
+}
+
+template <>
+inline DataType getDataType<uint32_t>() {
+  return DataType::UINT32;
+}
+
+template <>
+inline DataType getDataType<int64_t>() {
+  return DataType::INT64;
+}
+
+template <>
+inline DataType getDataType<uint64_t>() {
+  return DataType::UINT64;
+}
+
+template <>
+inline DataType getDataType<float16>() {
+  return DataType::FLOAT16;
+}
+
+template <>
+inline DataType getDataType<float>() {
+  return DataType::FLOAT32;
+}
+
+template <>
+inline DataType getDataType<double>() {
+  return DataType::FLOAT64;
+}
+
+template <>
+inline DataType getDataType<bfloat16>() {
+  return DataType::BFLOAT16;
+}
+
+// Returns the number of bytes per element of the data type.
+size_t getDataTypeSize(DataType type);
+
+// Kernels that implement a built-in reduction operation for a data type.
+struct ReduceKernels {
+  // Computes c = a op b for n elements (see gloo/math.h).
+  void (*binary)(void* c, const void* a, const void* b, size_t n) = nullptr;
+
+  // Reduces k inputs of n elements into the output in a single pass
+  // (see gloo/math.h). May be null if the binary kernel is faster.
+  void (*nary)(void* out, const void* const* ins, size_t k, size_t n) =
+      nullptr;
+
+  // Like nary, but multiplies the result by a factor. Only set for
+  // ReduceOp::AVG, where the other kernels compute the sum.
+  void (*scaledNary)(
+      void* out,
+      const void* const* ins,
+      size_t k,
+      size_t n,
+      double factor) = nullptr;
+};
+
+// Instruction sets that the reduction kernels are specialized for.
+enum class SimdIsa : uint8_t {
+  SCALAR = 0,
+  SSE4 = 1,
+  AVX2 = 2,
+  AVX512 = 3,
+
+  // AVX-512 with the BF16 extension, which only adds a faster
+  // conversion to bfloat16. It flushes denormals to zero.
+  AVX512BF16 = 4,
+};
+
+// Returns the widest instruction set that this CPU supports and that
+// there are kernels for. It is detected once, using CPUID.
+SimdIsa getSimdIsa();
+
+// Returns the name of the instruction set (e.g. "avx2").
+const char* getSimdIsaName(SimdIsa isa);
+
+// Returns the kernels for the specified operation and data type.
+// Both must be specified. The kernels are specialized for the
+// instruction set returned by getSimdIsa.
+ReduceKernels getReduceKernels(ReduceOp op, DataType type);
+
+// Returns the kernels for the specified operation and data type that
+// are specialized for the specified instruction set, or a narrower one
+// if there are none. This CPU must support the instruction set.
+ReduceKernels getReduceKernels(ReduceOp op, DataType type, SimdIsa isa);
+
+// Returns the kernels for the specified reduction function if it wraps
+// one of the built-in reduction functions in gloo/math.h (e.g. a
+// pointer to gloo::sum<float>). Returns no kernels otherwise. Like
+// getReduceKernels, the kernels are specialized for this CPU, so they
+// need not be the same as the specified function.
+ReduceKernels findReduceKernels(
+    const std::function<void(void*, const void*, const void*, size_t)>& fn);
+
+// Number of elements per block of int8 compressed data. Every block is
+// stored as a float32 scale followed by one int8 value per element, so
+// that float32 data is compressed by a factor of almost 4.
+constexpr size_t kQuantizationBlockSize = 256;
+
+// Kernels for reducing float32 data that is transferred in a narrower
+// format, to reduce the number of bytes on the wire. The format is
+// float16 or bfloat16, or int8 values that are scaled per block of
+// kQuantizationBlockSize elements such that the largest absolute value
+// in the block maps to 127. A block that contains infinity or NaN
+// decodes as NaN.
+struct CompressedReduceKernels {
+  // Converts n float32 elements to the narrower format. If residual is
+  // not null, it holds n elements that are added to the input before
+  // it is rounded, and that are replaced by the rounding error (error
+  // feedback).
+  void (*compress)(void* out, const void* in, float* residual, size_t n) =
+      nullptr;
+
+  // Converts n elements of the narrower format to float32.
+  void (*decompress)(void* out, const void* in, size_t n) = nullptr;
+
+  // Reduces n elements of the narrower format into n float32 elements,
+  // and rounds the result to the narrower format. The rounded result
+  // is stored in both the float32 output and the narrower copy, so
+  // that the copy can be forwarded and every process ends up with the
+  // same result. If residual is not null, it is added to the output
+  // before the reduction and replaced by the rounding error, like for
+  // compress.
+  void (*reduce)(
+      void* out,
+      void* copy,
+      const void* in,
+      float* residual,
+      size_t n) = nullptr;
+
+  // Layout of the narrower format: blocks of blockSize elements, each
+  // with a header of headerBytes followed by elementBytes per element.
+  size_t blockSize = 1;
+  size_t headerBytes = 0;
+  size_t elementBytes = 0;
+
+  // Returns the number of bytes that n elements take in the narrower
+  // format. The last block may be partial.
+  size_t getCompressedSize(size_t n) const {
+    return (n + blockSize - 1) / blockSize * headerBytes + n * elementBytes;
+  }
+};
+
+// Returns the kernels for reducing float32 data with the specified
+// operation, where the data is transferred as the specified type
+// (FLOAT16, BFLOAT16, or INT8 for block scaled int8). An average is
+// reduced as a sum, because the inputs are scaled before they are
+// transferred (see ReduceOp::AVG).
+CompressedReduceKernels getCompressedReduceKernels(ReduceOp op, DataType type);
+
+// Like getReduceKernels, for the kernels above.
+CompressedReduceKernels getCompressedReduceKernels(
+    ReduceOp op,
+    DataType type,
+    SimdIsa isa);
+
+namespace detail {
+
+// Returns the kernels specialized for the specified instruction set, or
+// no kernels if there are none (see gloo/reduce_op_simd.cc).
+ReduceKernels getSimdReduceKernels(ReduceOp op, DataType type, SimdIsa isa);
+
+CompressedReduceKernels getSimdCompressedReduceKernels(
+    ReduceOp op,
+    DataType type,
+    SimdIsa isa);
+
+// Computes the scale of a block of int8 data and its inverse from the
+// bit pattern of the largest absolute value in the block. The scalar
+// and vector kernels share this, so that they round identically.
+// Blocks with only tiny values are flushed to zero, because the
+// inverse would overflow. Returns false if the block contains
+// infinity or NaN.
+inline bool getQuantizationScale(
+    uint32_t absmaxBits,
+    float* scale,
+    float* inverse) {
+  // Compares with the bit patterns of infinity and 1e-30f.
+  if (absmaxBits >= 0x7f800000) {
+    *scale = std::numeric_limits<float>::quiet_NaN();
+    *inverse = 0;
+    return false;
+  }
+  if (absmaxBits < 0x0da24260) {
+    *scale = 0;
+    *inverse = 0;
+    return true;
+  }
+  float absmax;
+  std::memcpy(&absmax, &absmaxBits, sizeof(absmax));
+  *scale = absmax / 127;
+  *inverse = 127 / absmax;
+  return true;
+}
+
+} // namespace detail
+
+} // namespace gloo
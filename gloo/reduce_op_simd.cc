@@ -0,0 +1,1429 @@
+/**
+ * Copyright (c) 2018-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Reduction kernels for x86 vector instruction sets.
+//
+// The library is compiled for the baseline instruction set, so these
+// kernels can't rely on compiler flags. Instead, every function that
+// uses wider instructions is compiled for its instruction set using a
+// target attribute, and the kernels are selected at runtime based on
+// what the CPU supports (see getSimdIsa). Everything in this file has
+// internal linkage, so that no function compiled for a wider
+// instruction set can be picked by the linker for a call from generic
+// code.
+
+#include "gloo/reduce_op.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GLOO_HAVE_SIMD_KERNELS 1
+#else
+#define GLOO_HAVE_SIMD_KERNELS 0
+#endif
+
+// The BF16 extension needs GCC 10 or Clang 9.
+#if GLOO_HAVE_SIMD_KERNELS &&                           \
+    ((defined(__clang__) && __clang_major__ >= 9) ||    \
+     (!defined(__clang__) && __GNUC__ >= 10))
+#define GLOO_HAVE_AVX512BF16 1
+#else
+#define GLOO_HAVE_AVX512BF16 0
+#endif
+
+#if GLOO_HAVE_SIMD_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace gloo {
+
+#if GLOO_HAVE_SIMD_KERNELS
+
+namespace {
+
+// Number of bytes of the output that the N-ary kernels compute at a
+// time (see gloo/math.h).
+constexpr size_t kBlockBytes = 4096;
+
+// Maximum number of inputs that the N-ary kernels accumulate in
+// registers before storing the intermediate result.
+constexpr size_t kMaxStreams = 8;
+
+// Size of a full block of int8 data (see kQuantizationBlockSize).
+constexpr size_t kQuantizationBlockBytes =
+    sizeof(float) + kQuantizationBlockSize;
+
+// Scalar equivalent of the vector operations, for leftover elements.
+// Must be consistent with the reduction functions in gloo/math.h.
+template <typename T, ReduceOp op>
+T applyScalar(T a, T b) {
+  switch (op) {
+    case ReduceOp::SUM:
+      return a + b;
+    case ReduceOp::PRODUCT:
+      return a * b;
+    case ReduceOp::MIN:
+      return std::min(a, b);
+    case ReduceOp::MAX:
+      return std::max(a, b);
+    default:
+      return a;
+  }
+}
+
+// Scalar conversions of the half precision types, for leftover
+// elements. Must be consistent with gloo/reduce_op.cc.
+float toFloat(float16 value) {
+  return cpu_half2float(value);
+}
+
+float toFloat(bfloat16 value) {
+  return cpu_bfloat162float(value);
+}
+
+template <typename T>
+T fromFloat(float value);
+
+template <>
+float16 fromFloat<float16>(float value) {
+  return cpu_float2half_rn(value);
+}
+
+template <>
+bfloat16 fromFloat<bfloat16>(float value) {
+  return cpu_float2bfloat16_rn(value);
+}
+
+// Returns the bit pattern of the absolute value, which orders like the
+// absolute value for non-negative integers.
+uint32_t absBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits & 0x7fffffff;
+}
+
+// Defines the binary and N-ary kernels for the vector types of one
+// instruction set. A vector type V defines the element type T, the
+// register type R, the number of elements per register kWidth, and
+// load, store, and apply<op> functions. The kHasProduct and kHasScale
+// flags tell whether it supports multiplication and averages; with the
+// latter, it also defines broadcast, which fills a register with the
+// scale factor (see ReduceOp::AVG). The half precision types define
+// the single precision type they compute in as Wide, which is needed
+// for the compressed kernels (see CompressedReduceKernels).
+//
+// These must be compiled for the instruction set of the vector type,
+// which is specified with the target attribute. It can't be passed
+// as template argument, hence the macro.
+//
+#define GLOO_DEFINE_SIMD_KERNELS(TARGET)                                    \
+  template <typename V, ReduceOp op>                                        \
+  TARGET void binary(void* c_, const void* a_, const void* b_, size_t n) {  \
+    using T = typename V::T;                                                \
+    T* c = static_cast<T*>(c_);                                             \
+    const T* a = static_cast<const T*>(a_);                                 \
+    const T* b = static_cast<const T*>(b_);                                 \
+    size_t i = 0;                                                           \
+    for (; i + V::kWidth <= n; i += V::kWidth) {                            \
+      V::store(                                                             \
+          c + i, V::template apply<op>(V::load(a + i), V::load(b + i)));    \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+      c[i] = applyScalar<T, op>(a[i], b[i]);                                \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  /* Leaves the result of a reduction unchanged. */                      \
+  template <typename V>                                                     \
+  struct Identity {                                                         \
+    TARGET typename V::R operator()(typename V::R v) const {                \
+      return v;                                                             \
+    }                                                                       \
+    TARGET typename V::T operator()(typename V::T v) const {                \
+      return v;                                                             \
+    }                                                                       \
+  };                                                                        \
+                                                                            \
+  /* Multiplies the result of a reduction by a factor. */                  \
+  template <typename V>                                                     \
+  struct Scale {                                                            \
+    typename V::R vector;                                                   \
+    typename V::T scalar;                                                   \
+                                                                            \
+    TARGET typename V::R operator()(typename V::R v) const {                \
+      return V::template apply<ReduceOp::PRODUCT>(v, vector);               \
+    }                                                                       \
+    TARGET typename V::T operator()(typename V::T v) const {                \
+      return applyScalar<typename V::T, ReduceOp::PRODUCT>(v, scalar);      \
+    }                                                                       \
+  };                                                                        \
+                                                                            \
+  /* Reduces inputs [first, last) into elements [begin, end) of the */   \
+  /* output, where src holds the result of the inputs before first. */    \
+  template <typename V, ReduceOp op, typename F>                            \
+  TARGET void reduceRange(                                                  \
+      typename V::T* out,                                                   \
+      const typename V::T* src,                                             \
+      const typename V::T* const* ins,                                      \
+      size_t first,                                                         \
+      size_t last,                                                          \
+      size_t begin,                                                         \
+      size_t end,                                                           \
+      F finish) {                                                           \
+    using T = typename V::T;                                                \
+    using R = typename V::R;                                                \
+    const size_t w = V::kWidth;                                             \
+    size_t j = begin;                                                       \
+    for (; j + 4 * w <= end; j += 4 * w) {                                  \
+      R acc0 = V::load(src + j);                                            \
+      R acc1 = V::load(src + j + w);                                        \
+      R acc2 = V::load(src + j + 2 * w);                                    \
+      R acc3 = V::load(src + j + 3 * w);                                    \
+      for (size_t i = first; i < last; i++) {                               \
+        const T* in = ins[i] + j;                                           \
+        acc0 = V::template apply<op>(acc0, V::load(in));                    \
+        acc1 = V::template apply<op>(acc1, V::load(in + w));                \
+        acc2 = V::template apply<op>(acc2, V::load(in + 2 * w));            \
+        acc3 = V::template apply<op>(acc3, V::load(in + 3 * w));            \
+      }                                                                     \
+      V::store(out + j, finish(acc0));                                      \
+      V::store(out + j + w, finish(acc1));                                  \
+      V::store(out + j + 2 * w, finish(acc2));                              \
+      V::store(out + j + 3 * w, finish(acc3));                              \
+    }                                                                       \
+    for (; j < end; j += w) {                                               \
+      R acc = V::load(src + j);                                             \
+      for (size_t i = first; i < last; i++) {                               \
+        acc = V::template apply<op>(acc, V::load(ins[i] + j));              \
+      }                                                                     \
+      V::store(out + j, finish(acc));                                       \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  /* Applies the finish function to every element of the result. */       \
+  template <typename V, ReduceOp op, typename F>                            \
+  TARGET void reduceN(                                                      \
+      typename V::T* out,                                                   \
+      const typename V::T* const* ins,                                      \
+      size_t k,                                                             \
+      size_t n,                                                             \
+      F finish) {                                                           \
+    using T = typename V::T;                                                \
+    const size_t w = V::kWidth;                                             \
+    const size_t block = std::max(kBlockBytes / sizeof(T) / w * w, w);      \
+    const size_t vn = n / w * w;                                            \
+    for (size_t begin = 0; begin < vn; begin += block) {                    \
+      const size_t end = std::min(begin + block, vn);                       \
+      for (size_t first = 0; first < k; first += kMaxStreams) {             \
+        const size_t last = std::min(first + kMaxStreams, k);               \
+        const T* src = first == 0 ? ins[0] : out;                           \
+        const size_t next = first == 0 ? 1 : first;                         \
+        if (last == k) {                                                    \
+          reduceRange<V, op>(out, src, ins, next, last, begin, end, finish);\
+        } else {                                                            \
+          reduceRange<V, op>(                                               \
+              out, src, ins, next, last, begin, end, Identity<V>());        \
+        }                                                                   \
+      }                                                                     \
+    }                                                                       \
+    for (size_t j = vn; j < n; j++) {                                       \
+      T acc = ins[0][j];                                                    \
+      for (size_t i = 1; i < k; i++) {                                      \
+        acc = applyScalar<T, op>(acc, ins[i][j]);                           \
+      }                                                                     \
+      out[j] = finish(acc);                                                 \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  template <typename V, ReduceOp op>                                        \
+  TARGET void nary(void* out_, const void* const* ins_, size_t k, size_t n) \
+  {                                                                         \
+    using T = typename V::T;                                                \
+    reduceN<V, op>(                                                         \
+        static_cast<T*>(out_),                                              \
+        reinterpret_cast<const T* const*>(ins_),                            \
+        k,                                                                  \
+        n,                                                                  \
+        Identity<V>());                                                     \
+  }                                                                         \
+                                                                            \
+  template <typename V>                                                     \
+  TARGET void scaledNary(                                                   \
+      void* out_,                                                           \
+      const void* const* ins_,                                              \
+      size_t k,                                                             \
+      size_t n,                                                             \
+      double factor) {                                                      \
+    using T = typename V::T;                                                \
+    Scale<V> scale;                                                         \
+    scale.vector = V::broadcast(factor);                                    \
+    scale.scalar = T(factor);                                               \
+    reduceN<V, ReduceOp::SUM>(                                              \
+        static_cast<T*>(out_),                                              \
+        reinterpret_cast<const T* const*>(ins_),                            \
+        k,                                                                  \
+        n,                                                                  \
+        scale);                                                             \
+  }                                                                         \
+                                                                            \
+  template <typename V>                                                     \
+  TARGET void                                                               \
+  compress(void* out_, const void* in_, float* residual, size_t n) {        \
+    using W = typename V::Wide;                                             \
+    using T = typename V::T;                                                \
+    T* out = static_cast<T*>(out_);                                         \
+    const float* in = static_cast<const float*>(in_);                       \
+    size_t i = 0;                                                           \
+    if (residual == nullptr) {                                              \
+      for (; i + V::kWidth <= n; i += V::kWidth) {                          \
+        V::store(out + i, W::load(in + i));                                 \
+      }                                                                     \
+      for (; i < n; i++) {                                                  \
+        out[i] = fromFloat<T>(in[i]);                                       \
+      }                                                                     \
+      return;                                                               \
+    }                                                                       \
+    for (; i + V::kWidth <= n; i += V::kWidth) {                            \
+      const auto value = W::template apply<ReduceOp::SUM>(                  \
+          W::load(in + i), W::load(residual + i));                          \
+      V::store(out + i, value);                                             \
+      W::store(residual + i, W::sub(value, V::load(out + i)));              \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+      const float value = in[i] + residual[i];                              \
+      out[i] = fromFloat<T>(value);                                         \
+      residual[i] = value - toFloat(out[i]);                                \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  template <typename V>                                                     \
+  TARGET void decompress(void* out_, const void* in_, size_t n) {           \
+    using W = typename V::Wide;                                             \
+    using T = typename V::T;                                                \
+    float* out = static_cast<float*>(out_);                                 \
+    const T* in = static_cast<const T*>(in_);                               \
+    size_t i = 0;                                                           \
+    for (; i + V::kWidth <= n; i += V::kWidth) {                            \
+      W::store(out + i, V::load(in + i));                                   \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+      out[i] = toFloat(in[i]);                                              \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  template <typename V, ReduceOp op>                                        \
+  TARGET void reduceCompressed(                                             \
+      void* out_,                                                           \
+      void* copy_,                                                          \
+      const void* in_,                                                      \
+      float* residual,                                                      \
+      size_t n) {                                                           \
+    using W = typename V::Wide;                                             \
+    using T = typename V::T;                                                \
+    float* out = static_cast<float*>(out_);                                 \
+    T* copy = static_cast<T*>(copy_);                                       \
+    const T* in = static_cast<const T*>(in_);                               \
+    size_t i = 0;                                                           \
+    for (; i + V::kWidth <= n; i += V::kWidth) {                            \
+      auto local = W::load(out + i);                                        \
+      if (residual != nullptr) {                                            \
+        local = W::template apply<ReduceOp::SUM>(                           \
+            local, W::load(residual + i));                                  \
+      }                                                                     \
+      const auto value = V::template apply<op>(local, V::load(in + i));     \
+      V::store(copy + i, value);                                            \
+      const auto rounded = V::load(copy + i);                               \
+      W::store(out + i, rounded);                                           \
+      if (residual != nullptr) {                                            \
+        W::store(residual + i, W::sub(value, rounded));                     \
+      }                                                                     \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+      const float local =                                                   \
+          residual != nullptr ? out[i] + residual[i] : out[i];              \
+      const float value = applyScalar<float, op>(local, toFloat(in[i]));    \
+      copy[i] = fromFloat<T>(value);                                        \
+      out[i] = toFloat(copy[i]);                                            \
+      if (residual != nullptr) {                                            \
+        residual[i] = value - out[i];                                       \
+      }                                                                     \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  template <typename V>                                                     \
+  CompressedReduceKernels getCompressedKernels(ReduceOp op) {               \
+    CompressedReduceKernels kernels;                                        \
+    kernels.compress = &compress<V>;                                        \
+    kernels.decompress = &decompress<V>;                                    \
+    switch (op) {                                                           \
+      case ReduceOp::SUM:                                                   \
+      case ReduceOp::AVG:                                                   \
+        kernels.reduce = &reduceCompressed<V, ReduceOp::SUM>;               \
+        break;                                                              \
+      case ReduceOp::PRODUCT:                                               \
+        kernels.reduce = &reduceCompressed<V, ReduceOp::PRODUCT>;           \
+        break;                                                              \
+      case ReduceOp::MIN:                                                   \
+        kernels.reduce = &reduceCompressed<V, ReduceOp::MIN>;               \
+        break;                                                              \
+      case ReduceOp::MAX:                                                   \
+        kernels.reduce = &reduceCompressed<V, ReduceOp::MAX>;               \
+        break;                                                              \
+      default:                                                              \
+        return CompressedReduceKernels();                                   \
+    }                                                                       \
+    return kernels;                                                         \
+  }                                                                         \
+                                                                            \
+  /* Stores a - b for n elements. */                                        \
+  template <typename W>                                                     \
+  TARGET void                                                               \
+  subtract(float* out, const float* a, const float* b, size_t n) {          \
+    size_t i = 0;                                                           \
+    for (; i + W::kWidth <= n; i += W::kWidth) {                            \
+      W::store(out + i, W::sub(W::load(a + i), W::load(b + i)));            \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+      out[i] = a[i] - b[i];                                                 \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  /* See quantizeBlock in gloo/reduce_op.cc. */                             \
+  template <typename Q>                                                     \
+  TARGET void quantizeBlock(                                                \
+      uint8_t* block,                                                       \
+      const float* in,                                                      \
+      float* decoded,                                                       \
+      size_t n) {                                                           \
+    using W = typename Q::Wide;                                             \
+    float scale;                                                            \
+    float inverse;                                                          \
+    const bool finite = detail::getQuantizationScale(                       \
+        Q::absmaxBits(in, n), &scale, &inverse);                            \
+    std::memcpy(block, &scale, sizeof(scale));                              \
+    int8_t* values = reinterpret_cast<int8_t*>(block + sizeof(scale));      \
+    if (!finite) {                                                          \
+      std::memset(values, 0, n);                                            \
+      if (decoded != nullptr) {                                             \
+        std::fill(decoded, decoded + n, scale);                             \
+      }                                                                     \
+      return;                                                               \
+    }                                                                       \
+    const auto vscale = W::broadcast(scale);                                \
+    const auto vinverse = W::broadcast(inverse);                            \
+    size_t i = 0;                                                           \
+    for (; i + Q::kWidth <= n; i += Q::kWidth) {                            \
+      Q::store(values + i, W::load(in + i), vinverse);                      \
+      if (decoded != nullptr) {                                             \
+        W::store(decoded + i, Q::load(values + i, vscale));                 \
+      }                                                                     \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+      values[i] = static_cast<int8_t>(std::nearbyint(in[i] * inverse));     \
+      if (decoded != nullptr) {                                             \
+        decoded[i] = values[i] * scale;                                     \
+      }                                                                     \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  template <typename Q>                                                     \
+  TARGET void                                                               \
+  quantize(void* out_, const void* in_, float* residual, size_t n) {        \
+    using W = typename Q::Wide;                                             \
+    uint8_t* out = static_cast<uint8_t*>(out_);                             \
+    const float* in = static_cast<const float*>(in_);                       \
+    float value[kQuantizationBlockSize];                                    \
+    float decoded[kQuantizationBlockSize];                                  \
+    for (size_t i = 0; i < n; i += kQuantizationBlockSize) {                \
+      const size_t m = std::min(kQuantizationBlockSize, n - i);             \
+      uint8_t* block =                                                      \
+          out + i / kQuantizationBlockSize * kQuantizationBlockBytes;       \
+      if (residual == nullptr) {                                            \
+        quantizeBlock<Q>(block, in + i, nullptr, m);                        \
+        continue;                                                           \
+      }                                                                     \
+      size_t j = 0;                                                         \
+      for (; j + W::kWidth <= m; j += W::kWidth) {                          \
+        W::store(                                                           \
+            value + j,                                                      \
+            W::template apply<ReduceOp::SUM>(                               \
+                W::load(in + i + j), W::load(residual + i + j)));           \
+      }                                                                     \
+      for (; j < m; j++) {                                                  \
+        value[j] = in[i + j] + residual[i + j];                             \
+      }                                                                     \
+      quantizeBlock<Q>(block, value, decoded, m);                           \
+      subtract<W>(residual + i, value, decoded, m);                         \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  template <typename Q>                                                     \
+  TARGET void dequantize(void* out_, const void* in_, size_t n) {           \
+    using W = typename Q::Wide;                                             \
+    float* out = static_cast<float*>(out_);                                 \
+    const uint8_t* in = static_cast<const uint8_t*>(in_);                   \
+    for (size_t i = 0; i < n; i += kQuantizationBlockSize) {                \
+      const size_t m = std::min(kQuantizationBlockSize, n - i);             \
+      const uint8_t* block =                                                \
+          in + i / kQuantizationBlockSize * kQuantizationBlockBytes;        \
+      float scale;                                                          \
+      std::memcpy(&scale, block, sizeof(scale));                            \
+      const int8_t* values =                                                \
+          reinterpret_cast<const int8_t*>(block + sizeof(scale));           \
+      const auto vscale = W::broadcast(scale);                              \
+      size_t j = 0;                                                         \
+      for (; j + Q::kWidth <= m; j += Q::kWidth) {                          \
+        W::store(out + i + j, Q::load(values + j, vscale));                 \
+      }                                                                     \
+      for (; j < m; j++) {                                                  \
+        out[i + j] = values[j] * scale;                                     \
+      }                                                                     \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  template <typename Q, ReduceOp op>                                        \
+  TARGET void reduceQuantized(                                              \
+      void* out_,                                                           \
+      void* copy_,                                                          \
+      const void* in_,                                                      \
+      float* residual,                                                      \
+      size_t n) {                                                           \
+    using W = typename Q::Wide;                                             \
+    float* out = static_cast<float*>(out_);                                 \
+    uint8_t* copy = static_cast<uint8_t*>(copy_);                           \
+    const uint8_t* in = static_cast<const uint8_t*>(in_);                   \
+    float value[kQuantizationBlockSize];                                    \
+    for (size_t i = 0; i < n; i += kQuantizationBlockSize) {                \
+      const size_t m = std::min(kQuantizationBlockSize, n - i);             \
+      const size_t offset =                                                 \
+          i / kQuantizationBlockSize * kQuantizationBlockBytes;             \
+      float scale;                                                          \
+      std::memcpy(&scale, in + offset, sizeof(scale));                      \
+      const int8_t* values =                                                \
+          reinterpret_cast<const int8_t*>(in + offset + sizeof(scale));     \
+      const auto vscale = W::broadcast(scale);                              \
+      size_t j = 0;                                                         \
+      for (; j + Q::kWidth <= m; j += Q::kWidth) {                          \
+        auto local = W::load(out + i + j);                                  \
+        if (residual != nullptr) {                                          \
+          local = W::template apply<ReduceOp::SUM>(                         \
+              local, W::load(residual + i + j));                            \
+        }                                                                   \
+        W::store(                                                           \
+            value + j,                                                      \
+            W::template apply<op>(local, Q::load(values + j, vscale)));     \
+      }                                                                     \
+      for (; j < m; j++) {                                                  \
+        const float local = residual != nullptr                             \
+            ? out[i + j] + residual[i + j]                                  \
+            : out[i + j];                                                   \
+        value[j] = applyScalar<float, op>(local, values[j] * scale);        \
+      }                                                                     \
+      quantizeBlock<Q>(copy + offset, value, out + i, m);                   \
+      if (residual != nullptr) {                                            \
+        subtract<W>(residual + i, value, out + i, m);                       \
+      }                                                                     \
+    }                                                                       \
+  }                                                                         \
+                                                                            \
+  template <typename Q>                                                     \
+  CompressedReduceKernels getQuantizedKernels(ReduceOp op) {                \
+    CompressedReduceKernels kernels;                                        \
+    kernels.compress = &quantize<Q>;                                        \
+    kernels.decompress = &dequantize<Q>;                                    \
+    switch (op) {                                                           \
+      case ReduceOp::SUM:                                                   \
+      case ReduceOp::AVG:                                                   \
+        kernels.reduce = &reduceQuantized<Q, ReduceOp::SUM>;                \
+        break;                                                              \
+      case ReduceOp::PRODUCT:                                               \
+        kernels.reduce = &reduceQuantized<Q, ReduceOp::PRODUCT>;            \
+        break;                                                              \
+      case ReduceOp::MIN:                                                   \
+        kernels.reduce = &reduceQuantized<Q, ReduceOp::MIN>;                \
+        break;                                                              \
+      case ReduceOp::MAX:                                                   \
+        kernels.reduce = &reduceQuantized<Q, ReduceOp::MAX>;                \
+        break;                                                              \
+      default:                                                              \
+        return CompressedReduceKernels();                                   \
+    }                                                                       \
+    return kernels;                                                         \
+  }                                                                         \
+                                                                            \
+  template <typename V, ReduceOp op>                                        \
+  ReduceKernels getKernels(std::true_type) {                                \
+    ReduceKernels kernels;                                                  \
+    kernels.binary = &binary<V, op>;                                        \
+    kernels.nary = &nary<V, op>;                                            \
+    return kernels;                                                         \
+  }                                                                         \
+                                                                            \
+  template <typename V, ReduceOp op>                                        \
+  ReduceKernels getKernels(std::false_type) {                               \
+    return ReduceKernels();                                                 \
+  }                                                                         \
+                                                                            \
+  template <typename V>                                                     \
+  ReduceKernels getAverageKernels(std::true_type) {                         \
+    auto kernels = getKernels<V, ReduceOp::SUM>(std::true_type());          \
+    kernels.scaledNary = &scaledNary<V>;                                    \
+    return kernels;                                                         \
+  }                                                                         \
+                                                                            \
+  template <typename V>                                                     \
+  ReduceKernels getAverageKernels(std::false_type) {                        \
+    return ReduceKernels();                                                 \
+  }                                                                         \
+                                                                            \
+  template <typename V>                                                     \
+  ReduceKernels getKernels(ReduceOp op) {                                   \
+    switch (op) {                                                           \
+      case ReduceOp::SUM:                                                   \
+        return getKernels<V, ReduceOp::SUM>(std::true_type());              \
+      case ReduceOp::PRODUCT:                                               \
+        return getKernels<V, ReduceOp::PRODUCT>(                            \
+            std::integral_constant<bool, V::kHasProduct>());                \
+      case ReduceOp::MIN:                                                   \
+        return getKernels<V, ReduceOp::MIN>(std::true_type());              \
+      case ReduceOp::MAX:                                                   \
+        return getKernels<V, ReduceOp::MAX>(std::true_type());              \
+      case ReduceOp::AVG:                                                   \
+        return getAverageKernels<V>(                                        \
+            std::integral_constant<bool, V::kHasScale>());                  \
+      default:                                                              \
+        return ReduceKernels();                                             \
+    }                                                                       \
+  }
+
+// Note on min and max: std::max(a, b) returns a if either is NaN,
+// whereas the max instructions return their second operand. Swapping
+// the operands makes the vector kernels consistent with the scalar
+// ones.
+
+namespace sse4 {
+
+#define GLOO_TARGET __attribute__((target("sse4.2")))
+
+struct F32 {
+  using T = float;
+  using R = __m128;
+  static constexpr size_t kWidth = 4;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = true;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm_loadu_ps(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm_storeu_ps(p, v);
+  }
+
+  GLOO_TARGET static R broadcast(double f) {
+    return _mm_set1_ps(static_cast<float>(f));
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm_add_ps(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm_mul_ps(a, b);
+      case ReduceOp::MIN:
+        return _mm_min_ps(b, a);
+      default:
+        return _mm_max_ps(b, a);
+    }
+  }
+};
+
+struct F64 {
+  using T = double;
+  using R = __m128d;
+  static constexpr size_t kWidth = 2;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = true;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm_loadu_pd(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm_storeu_pd(p, v);
+  }
+
+  GLOO_TARGET static R broadcast(double f) {
+    return _mm_set1_pd(f);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm_add_pd(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm_mul_pd(a, b);
+      case ReduceOp::MIN:
+        return _mm_min_pd(b, a);
+      default:
+        return _mm_max_pd(b, a);
+    }
+  }
+};
+
+struct I32 {
+  using T = int32_t;
+  using R = __m128i;
+  static constexpr size_t kWidth = 4;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = false;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm_add_epi32(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm_mullo_epi32(a, b);
+      case ReduceOp::MIN:
+        return _mm_min_epi32(a, b);
+      default:
+        return _mm_max_epi32(a, b);
+    }
+  }
+};
+
+struct I64 {
+  using T = int64_t;
+  using R = __m128i;
+  static constexpr size_t kWidth = 2;
+  static constexpr bool kHasProduct = false;
+  static constexpr bool kHasScale = false;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm_add_epi64(a, b);
+      case ReduceOp::MIN:
+        return _mm_blendv_epi8(a, b, _mm_cmpgt_epi64(a, b));
+      default:
+        return _mm_blendv_epi8(a, b, _mm_cmpgt_epi64(b, a));
+    }
+  }
+};
+
+GLOO_DEFINE_SIMD_KERNELS(GLOO_TARGET)
+
+#undef GLOO_TARGET
+
+} // namespace sse4
+
+namespace avx2 {
+
+#define GLOO_TARGET __attribute__((target("avx2,f16c")))
+
+struct F32 {
+  using T = float;
+  using R = __m256;
+  static constexpr size_t kWidth = 8;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = true;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm256_loadu_ps(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm256_storeu_ps(p, v);
+  }
+
+  GLOO_TARGET static R broadcast(double f) {
+    return _mm256_set1_ps(static_cast<float>(f));
+  }
+
+  GLOO_TARGET static R sub(R a, R b) {
+    return _mm256_sub_ps(a, b);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm256_add_ps(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm256_mul_ps(a, b);
+      case ReduceOp::MIN:
+        return _mm256_min_ps(b, a);
+      default:
+        return _mm256_max_ps(b, a);
+    }
+  }
+};
+
+// Computes in single precision. The N-ary kernels round to half
+// precision only when storing, which is more accurate than rounding
+// after every input.
+struct F16 : public F32 {
+  using T = float16;
+  using Wide = F32;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(p),
+        _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+};
+
+// Computes in single precision, like F16. Converting from bfloat16 is
+// a shift, and converting to bfloat16 rounds to nearest even, exactly
+// like cpu_float2bfloat16_rn.
+struct BF16 : public F32 {
+  using T = bfloat16;
+  using Wide = F32;
+
+  GLOO_TARGET static R load(const T* p) {
+    const __m256i x = _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(x, 16));
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    const __m256i x = _mm256_castps_si256(v);
+    const __m256i high = _mm256_srli_epi32(x, 16);
+    const __m256i bias = _mm256_add_epi32(
+        _mm256_and_si256(high, _mm256_set1_epi32(1)),
+        _mm256_set1_epi32(0x7fff));
+    const __m256i rounded =
+        _mm256_srli_epi32(_mm256_add_epi32(x, bias), 16);
+    const __m256i quiet = _mm256_or_si256(high, _mm256_set1_epi32(0x40));
+    const __m256i nan = _mm256_cmpgt_epi32(
+        _mm256_and_si256(x, _mm256_set1_epi32(0x7fffffff)),
+        _mm256_set1_epi32(0x7f800000));
+    const __m256i y = _mm256_blendv_epi8(rounded, quiet, nan);
+    // Packing works within 128 bit lanes; move both halves to the
+    // lower lane.
+    const __m256i packed =
+        _mm256_permute4x64_epi64(_mm256_packus_epi32(y, y), 0x08);
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+  }
+};
+
+// Block scaled int8 values (see kQuantizationBlockSize), computed in
+// single precision. Conversions round to nearest even, like
+// std::nearbyint in the scalar kernels.
+struct Q8 {
+  using T = int8_t;
+  using Wide = F32;
+  using R = __m256;
+  static constexpr size_t kWidth = 8;
+
+  GLOO_TARGET static R load(const T* p, R scale) {
+    const __m256i x = _mm256_cvtepi8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale);
+  }
+
+  GLOO_TARGET static void store(T* p, R v, R inverse) {
+    const __m256i x = _mm256_cvtps_epi32(_mm256_mul_ps(v, inverse));
+    const __m128i words = _mm_packs_epi32(
+        _mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+    _mm_storel_epi64(
+        reinterpret_cast<__m128i*>(p), _mm_packs_epi16(words, words));
+  }
+
+  GLOO_TARGET static uint32_t absmaxBits(const float* p, size_t n) {
+    const __m256i mask = _mm256_set1_epi32(0x7fffffff);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      const __m256i bits = _mm256_castps_si256(_mm256_loadu_ps(p + i));
+      acc = _mm256_max_epu32(acc, _mm256_and_si256(bits, mask));
+    }
+    uint32_t lanes[kWidth];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    uint32_t result = 0;
+    for (const auto lane : lanes) {
+      result = std::max(result, lane);
+    }
+    for (; i < n; i++) {
+      result = std::max(result, absBits(p[i]));
+    }
+    return result;
+  }
+};
+
+struct F64 {
+  using T = double;
+  using R = __m256d;
+  static constexpr size_t kWidth = 4;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = true;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm256_loadu_pd(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm256_storeu_pd(p, v);
+  }
+
+  GLOO_TARGET static R broadcast(double f) {
+    return _mm256_set1_pd(f);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm256_add_pd(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm256_mul_pd(a, b);
+      case ReduceOp::MIN:
+        return _mm256_min_pd(b, a);
+      default:
+        return _mm256_max_pd(b, a);
+    }
+  }
+};
+
+struct I32 {
+  using T = int32_t;
+  using R = __m256i;
+  static constexpr size_t kWidth = 8;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = false;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm256_add_epi32(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm256_mullo_epi32(a, b);
+      case ReduceOp::MIN:
+        return _mm256_min_epi32(a, b);
+      default:
+        return _mm256_max_epi32(a, b);
+    }
+  }
+};
+
+struct I64 {
+  using T = int64_t;
+  using R = __m256i;
+  static constexpr size_t kWidth = 4;
+  static constexpr bool kHasProduct = false;
+  static constexpr bool kHasScale = false;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm256_add_epi64(a, b);
+      case ReduceOp::MIN:
+        return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+      default:
+        return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(b, a));
+    }
+  }
+};
+
+GLOO_DEFINE_SIMD_KERNELS(GLOO_TARGET)
+
+#undef GLOO_TARGET
+
+} // namespace avx2
+
+namespace avx512 {
+
+#define GLOO_TARGET __attribute__((target("avx512f,avx512dq")))
+
+struct F32 {
+  using T = float;
+  using R = __m512;
+  static constexpr size_t kWidth = 16;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = true;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm512_loadu_ps(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm512_storeu_ps(p, v);
+  }
+
+  GLOO_TARGET static R broadcast(double f) {
+    return _mm512_set1_ps(static_cast<float>(f));
+  }
+
+  GLOO_TARGET static R sub(R a, R b) {
+    return _mm512_sub_ps(a, b);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm512_add_ps(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm512_mul_ps(a, b);
+      case ReduceOp::MIN:
+        return _mm512_min_ps(b, a);
+      default:
+        return _mm512_max_ps(b, a);
+    }
+  }
+};
+
+// See avx2::F16.
+struct F16 : public F32 {
+  using T = float16;
+  using Wide = F32;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm512_cvtph_ps(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(p),
+        _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+};
+
+// See avx2::BF16.
+struct BF16 : public F32 {
+  using T = bfloat16;
+  using Wide = F32;
+
+  GLOO_TARGET static R load(const T* p) {
+    const __m512i x = _mm512_cvtepu16_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(x, 16));
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    const __m512i x = _mm512_castps_si512(v);
+    const __m512i high = _mm512_srli_epi32(x, 16);
+    const __m512i bias = _mm512_add_epi32(
+        _mm512_and_si512(high, _mm512_set1_epi32(1)),
+        _mm512_set1_epi32(0x7fff));
+    const __m512i rounded =
+        _mm512_srli_epi32(_mm512_add_epi32(x, bias), 16);
+    const __m512i quiet = _mm512_or_si512(high, _mm512_set1_epi32(0x40));
+    const __mmask16 nan = _mm512_cmpgt_epi32_mask(
+        _mm512_and_si512(x, _mm512_set1_epi32(0x7fffffff)),
+        _mm512_set1_epi32(0x7f800000));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(p),
+        _mm512_cvtepi32_epi16(_mm512_mask_blend_epi32(nan, rounded, quiet)));
+  }
+};
+
+// See avx2::Q8.
+struct Q8 {
+  using T = int8_t;
+  using Wide = F32;
+  using R = __m512;
+  static constexpr size_t kWidth = 16;
+
+  GLOO_TARGET static R load(const T* p, R scale) {
+    const __m512i x = _mm512_cvtepi8_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    return _mm512_mul_ps(_mm512_cvtepi32_ps(x), scale);
+  }
+
+  GLOO_TARGET static void store(T* p, R v, R inverse) {
+    const __m512i x = _mm512_cvtps_epi32(_mm512_mul_ps(v, inverse));
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(p), _mm512_cvtsepi32_epi8(x));
+  }
+
+  GLOO_TARGET static uint32_t absmaxBits(const float* p, size_t n) {
+    const __m512i mask = _mm512_set1_epi32(0x7fffffff);
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + kWidth <= n; i += kWidth) {
+      const __m512i bits = _mm512_castps_si512(_mm512_loadu_ps(p + i));
+      acc = _mm512_max_epu32(acc, _mm512_and_si512(bits, mask));
+    }
+    uint32_t result = _mm512_reduce_max_epu32(acc);
+    for (; i < n; i++) {
+      result = std::max(result, absBits(p[i]));
+    }
+    return result;
+  }
+};
+
+struct F64 {
+  using T = double;
+  using R = __m512d;
+  static constexpr size_t kWidth = 8;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = true;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm512_loadu_pd(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm512_storeu_pd(p, v);
+  }
+
+  GLOO_TARGET static R broadcast(double f) {
+    return _mm512_set1_pd(f);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm512_add_pd(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm512_mul_pd(a, b);
+      case ReduceOp::MIN:
+        return _mm512_min_pd(b, a);
+      default:
+        return _mm512_max_pd(b, a);
+    }
+  }
+};
+
+struct I32 {
+  using T = int32_t;
+  using R = __m512i;
+  static constexpr size_t kWidth = 16;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = false;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm512_loadu_si512(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm512_storeu_si512(p, v);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm512_add_epi32(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm512_mullo_epi32(a, b);
+      case ReduceOp::MIN:
+        return _mm512_min_epi32(a, b);
+      default:
+        return _mm512_max_epi32(a, b);
+    }
+  }
+};
+
+struct I64 {
+  using T = int64_t;
+  using R = __m512i;
+  static constexpr size_t kWidth = 8;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = false;
+
+  GLOO_TARGET static R load(const T* p) {
+    return _mm512_loadu_si512(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm512_storeu_si512(p, v);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    switch (op) {
+      case ReduceOp::SUM:
+        return _mm512_add_epi64(a, b);
+      case ReduceOp::PRODUCT:
+        return _mm512_mullo_epi64(a, b);
+      case ReduceOp::MIN:
+        return _mm512_min_epi64(a, b);
+      default:
+        return _mm512_max_epi64(a, b);
+    }
+  }
+};
+
+GLOO_DEFINE_SIMD_KERNELS(GLOO_TARGET)
+
+#undef GLOO_TARGET
+
+} // namespace avx512
+
+#if GLOO_HAVE_AVX512BF16
+
+namespace avx512bf16 {
+
+#define GLOO_TARGET __attribute__((target("avx512f,avx512dq,avx512bf16")))
+
+// Same as avx512::BF16, but converts to bfloat16 with a single
+// instruction. Unlike cpu_float2bfloat16_rn, it flushes denormals to
+// zero.
+//
+// This delegates to the AVX-512 types instead of deriving from them,
+// so that argument dependent lookup doesn't find the AVX-512 kernels.
+struct BF16 {
+  using T = bfloat16;
+  using Wide = avx512::F32;
+  using R = __m512;
+  static constexpr size_t kWidth = avx512::BF16::kWidth;
+  static constexpr bool kHasProduct = true;
+  static constexpr bool kHasScale = true;
+
+  GLOO_TARGET static R load(const T* p) {
+    return avx512::BF16::load(p);
+  }
+
+  GLOO_TARGET static void store(T* p, R v) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(p), (__m256i)_mm512_cvtneps_pbh(v));
+  }
+
+  GLOO_TARGET static R broadcast(double f) {
+    return avx512::BF16::broadcast(f);
+  }
+
+  template <ReduceOp op>
+  GLOO_TARGET static R apply(R a, R b) {
+    return avx512::BF16::apply<op>(a, b);
+  }
+};
+
+GLOO_DEFINE_SIMD_KERNELS(GLOO_TARGET)
+
+#undef GLOO_TARGET
+
+} // namespace avx512bf16
+
+#endif // GLOO_HAVE_AVX512BF16
+
+#undef GLOO_DEFINE_SIMD_KERNELS
+
+SimdIsa detectSimdIsa() {
+  __builtin_cpu_init();
+
+  // The F16C extension is not part of AVX2, but is supported by every
+  // CPU that supports AVX2. It is required by the AVX2 kernels anyway.
+  unsigned int eax, ebx, ecx, edx;
+  const bool f16c =
+      __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_F16C) != 0;
+
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512dq") && f16c) {
+#if GLOO_HAVE_AVX512BF16
+    // AVX512_BF16 is reported in bit 5 of EAX for leaf 7, subleaf 1.
+    if (__get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx) &&
+        (eax & (1 << 5)) != 0) {
+      return SimdIsa::AVX512BF16;
+    }
+#endif
+    return SimdIsa::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2") && f16c) {
+    return SimdIsa::AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return SimdIsa::SSE4;
+  }
+  return SimdIsa::SCALAR;
+}
+
+} // namespace
+
+SimdIsa getSimdIsa() {
+  static const SimdIsa isa = detectSimdIsa();
+  return isa;
+}
+
+namespace detail {
+
+ReduceKernels getSimdReduceKernels(ReduceOp op, DataType type, SimdIsa isa) {
+  switch (isa) {
+#if GLOO_HAVE_AVX512BF16
+    case SimdIsa::AVX512BF16:
+      if (type == DataType::BFLOAT16) {
+        return avx512bf16::getKernels<avx512bf16::BF16>(op);
+      }
+      break;
+#endif
+    case SimdIsa::AVX512:
+      switch (type) {
+        case DataType::INT32:
+          return avx512::getKernels<avx512::I32>(op);
+        case DataType::INT64:
+          return avx512::getKernels<avx512::I64>(op);
+        case DataType::FLOAT16:
+          return avx512::getKernels<avx512::F16>(op);
+        case DataType::FLOAT32:
+          return avx512::getKernels<avx512::F32>(op);
+        case DataType::FLOAT64:
+          return avx512::getKernels<avx512::F64>(op);
+        case DataType::BFLOAT16:
+          return avx512::getKernels<avx512::BF16>(op);
+        default:
+          break;
+      }
+      break;
+    case SimdIsa::AVX2:
+      switch (type) {
+        case DataType::INT32:
+          return avx2::getKernels<avx2::I32>(op);
+        case DataType::INT64:
+          return avx2::getKernels<avx2::I64>(op);
+        case DataType::FLOAT16:
+          return avx2::getKernels<avx2::F16>(op);
+        case DataType::FLOAT32:
+          return avx2::getKernels<avx2::F32>(op);
+        case DataType::FLOAT64:
+          return avx2::getKernels<avx2::F64>(op);
+        case DataType::BFLOAT16:
+          return avx2::getKernels<avx2::BF16>(op);
+        default:
+          break;
+      }
+      break;
+    case SimdIsa::SSE4:
+      switch (type) {
+        case DataType::INT32:
+          return sse4::getKernels<sse4::I32>(op);
+        case DataType::INT64:
+          return sse4::getKernels<sse4::I64>(op);
+        case DataType::FLOAT32:
+          return sse4::getKernels<sse4::F32>(op);
+        case DataType::FLOAT64:
+          return sse4::getKernels<sse4::F64>(op);
+        default:
+          break;
+      }
+      break;
+    default:
+      break;
+  }
+  return ReduceKernels();
+}
+
+CompressedReduceKernels getSimdCompressedReduceKernels(
+    ReduceOp op,
+    DataType type,
+    SimdIsa isa) {
+  switch (isa) {
+#if GLOO_HAVE_AVX512BF16
+    case SimdIsa::AVX512BF16:
+      if (type == DataType::BFLOAT16) {
+        return avx512bf16::getCompressedKernels<avx512bf16::BF16>(op);
+      }
+      break;
+#endif
+    case SimdIsa::AVX512:
+      switch (type) {
+        case DataType::FLOAT16:
+          return avx512::getCompressedKernels<avx512::F16>(op);
+        case DataType::BFLOAT16:
+          return avx512::getCompressedKernels<avx512::BF16>(op);
+        case DataType::INT8:
+          return avx512::getQuantizedKernels<avx512::Q8>(op);
+        default:
+          break;
+      }
+      break;
+    case SimdIsa::AVX2:
+      switch (type) {
+        case DataType::FLOAT16:
+          return avx2::getCompressedKernels<avx2::F16>(op);
+        case DataType::BFLOAT16:
+          return avx2::getCompressedKernels<avx2::BF16>(op);
+        case DataType::INT8:
+          return avx2::getQuantizedKernels<avx2::Q8>(op);
+        default:
+          break;
+      }
+      break;
+    default:
+      break;
+  }
+  return CompressedReduceKernels();
+}
+
+} // namespace detail
+
+#else // GLOO_HAVE_SIMD_KERNELS
+
+SimdIsa getSimdIsa() {
+  return SimdIsa::SCALAR;
+}
+
+namespace detail {
+
+ReduceKernels getSimdReduceKernels(ReduceOp op, DataType type, SimdIsa isa) {
+  return ReduceKernels();
+}
+
+CompressedReduceKernels getSimdCompressedReduceKernels(
+    ReduceOp op,
+    DataType type,
+    SimdIsa isa) {
+  return CompressedReduceKernels();
+}
+
+} // namespace detail
+
+#endif // GLOO_HAVE_SIMD_KERNELS
+
+} // namespace gloo
@@ -123,7 +123,14 @@ class ReduceScatterHalvingDoubling : public Algorithm {
         chunkSize_((count_ + chunks_ - 1) / chunks_),
         chunkBytes_(chunkSize_ * sizeof(T)),
         fn_(fn),
-        recvBuf_(chunkSize_ << steps_),
+        recvScratch_(
+            count_ == 0 || this->contextSize_ == 1
+                ? ScratchPool::Scratch()
+                : context->getScratchPool().acquire(
+                      (chunkSize_ << steps_) * sizeof(T))),
+        recvBuf_(
+            recvScratch_ ? reinterpret_cast<T*>(recvScratch_.ptr())
+                         : nullptr),
         recvBufDist_(count_),
         sendOffsets_(steps_),
         recvOffsets_(steps_),
@@ -446,7 +453,9 @@ class ReduceScatterHalvingDoubling : public Algorithm {
   const ReductionFunction<T>* fn_;
 
   // buffer where data is received prior to being reduced
-  std::vector<T> recvBuf_;
+  // (borrowed from the context's scratch pool)
+  ScratchPool::Scratch recvScratch_;
+  T* recvBuf_;
 
   // buffer where data is received during distribution phase
   std::vector<T> recvBufDist_;
@@ -8,6 +8,8 @@
 
 #include "gloo/rendezvous/context.h"
 
+#include <map>
+
 #include "gloo/common/logging.h"
 #include "gloo/transport/address.h"
 
@@ -44,7 +46,6 @@ void Context::connectFullMesh(
     rendezvous::Store& store,
     std::shared_ptr<transport::Device>& dev) {
   std::vector<char> allBytes;
-  int localRank = 0;
 
   // Get Hostname using syscall
   char hostname[HOSTNAME_MAX_SIZE]; // NOLINT
@@ -61,19 +62,26 @@ void Context::connectFullMesh(
   const std::vector<char> value(localHostName.begin(), localHostName.end());
   store.set(localKey, value);
 
+  // Look up the host names of all processes to compute the host
+  // layout (see ::gloo::Context::getHost).
+  std::vector<std::string> keys;
   for (int i = 0; i < size; i++) {
-    if (i == rank) {
-      break;
-    }
+    keys.push_back("rank_" + std::to_string(i));
+  }
+  store.wait(keys, getTimeout());
 
-    std::string key("rank_" + std::to_string(i));
-    auto val = store.get(key);
+  std::map<std::string, int> hostIndex;
+  std::vector<int> hosts(size);
+  for (int i = 0; i < size; i++) {
+    auto val = store.get(keys[i]);
     auto hostName = std::string((const char*)val.data(), val.size());
-
-    if (hostName == localHostName) {
-      localRank++;
+    auto it = hostIndex.find(hostName);
+    if (it == hostIndex.end()) {
+      it = hostIndex.emplace(hostName, hostIndex.size()).first;
     }
+    hosts[i] = it->second;
   }
+  setHostLayout(hosts);
 
   // Create pairs
   auto transportContext = dev->createContext(rank, size);
@@ -84,7 +92,7 @@ void Context::connectFullMesh(
     }
 
     auto& pair = transportContext->createPair(i);
-    pair->setLocalRank(localRank);
+    pair->setLocalRank(getLocalRank());
     auto addrBytes = pair->address().bytes();
     allBytes.insert(allBytes.end(), addrBytes.begin(), addrBytes.end());
   }
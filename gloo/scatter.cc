@@ -60,4 +60,9 @@ void scatter(ScatterOptions& opts) {
   }
 }
 
+std::shared_ptr<Work> iscatter(ScatterOptions opts) {
+  return detail::enqueue(
+      std::move(opts), [](ScatterOptions& opts) { scatter(opts); });
+}
+
 } // namespace gloo
@@ -13,6 +13,7 @@
 
 #include "gloo/context.h"
 #include "gloo/transport/unbound_buffer.h"
+#include "gloo/work.h"
 
 namespace gloo {
 
@@ -95,4 +96,8 @@ class ScatterOptions {
 
 void scatter(ScatterOptions& opts);
 
+// Non-blocking variant of scatter. Executes on the default progress
+// engine; see gloo/work.h.
+std::shared_ptr<Work> iscatter(ScatterOptions opts);
+
 } // namespace gloo
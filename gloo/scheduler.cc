@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/scheduler.h"
+
+#include <algorithm>
+
+#include "gloo/transport/unbound_buffer.h"
+
+namespace gloo {
+
+namespace {
+
+// Operations without a deadline are still polled this often.
+constexpr auto kMaxSleep = std::chrono::seconds(1);
+
+} // namespace
+
+Scheduler::Scheduler()
+    : signal_(std::make_shared<transport::CompletionSignal>()), done_(false) {
+  thread_ = std::thread(&Scheduler::loop, this);
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    done_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+std::shared_ptr<Work> Scheduler::submit(std::unique_ptr<Operation> op) {
+  auto work = std::shared_ptr<Work>(new Work(nullptr));
+  const auto signaled = op->setCompletionSignal(signal_);
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    pending_.push_back(Task{std::move(op), work, signaled});
+  }
+  cv_.notify_one();
+  signal_->notify();
+  return work;
+}
+
+Scheduler& Scheduler::getDefault() {
+  // Leaked on purpose: operations may still be executing when static
+  // destructors run.
+  static Scheduler* scheduler = new Scheduler();
+  return *scheduler;
+}
+
+void Scheduler::loop() {
+  std::vector<Task> active;
+  std::vector<Task> next;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (active.empty()) {
+        cv_.wait(lock, [&] { return done_ || !pending_.empty(); });
+        if (pending_.empty()) {
+          break;
+        }
+      }
+
+      // Operations that were cancelled before they started are dropped.
+      for (auto& task : pending_) {
+        if (task.work->start()) {
+          active.push_back(std::move(task));
+        } else if (task.signaled) {
+          task.op->setCompletionSignal(nullptr);
+        }
+      }
+      pending_.clear();
+    }
+
+    // Poll every operation once, in submission order. The generation
+    // is read first, so that I/O that completes while polling is not
+    // missed when going to sleep below.
+    const auto generation = signal_->generation();
+    auto deadline = std::chrono::steady_clock::now() + kMaxSleep;
+    bool completed = false;
+    bool busyPoll = false;
+    for (auto& task : active) {
+      std::exception_ptr ex;
+      bool done;
+      try {
+        done = task.op->poll();
+      } catch (...) {
+        ex = std::current_exception();
+        done = true;
+      }
+      if (!done) {
+        deadline = std::min(deadline, task.op->getDeadline());
+        busyPoll = busyPoll || !task.signaled;
+        next.push_back(std::move(task));
+        continue;
+      }
+
+      // Destroy the operation before signaling completion, so that the
+      // caller is the sole owner of its buffers once wait() returns.
+      // Its buffers may outlive it, so detach the signal first.
+      if (task.signaled) {
+        task.op->setCompletionSignal(nullptr);
+      }
+      task.op.reset();
+      task.work->complete(ex);
+      completed = true;
+    }
+    active.swap(next);
+    next.clear();
+
+    if (completed) {
+      continue;
+    }
+    if (busyPoll) {
+      std::this_thread::yield();
+    } else {
+      signal_->wait(generation, deadline);
+    }
+  }
+}
+
+} // namespace gloo
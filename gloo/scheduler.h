@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gloo/work.h"
+
+namespace gloo {
+
+// There is no need to materialize all transport types here.
+namespace transport {
+class CompletionSignal;
+}
+
+// Collective that executes as a state machine.
+//
+// Instead of blocking until its I/O completes, it returns control to
+// its caller whenever it has to wait, so that a single thread can
+// interleave the execution of many operations.
+//
+class Operation {
+ public:
+  virtual ~Operation() {}
+
+  // Advances the operation as far as possible without waiting for
+  // I/O. Returns true if the operation has completed.
+  virtual bool poll() = 0;
+
+  // Attaches signal that is notified whenever I/O of this operation
+  // completes, so that it only has to be polled after that. A null
+  // signal detaches it. Returns false if the operation doesn't support
+  // this, in which case it is polled continuously.
+  virtual bool setCompletionSignal(
+      const std::shared_ptr<transport::CompletionSignal>& /* unused */) {
+    return false;
+  }
+
+  // Time at which the operation has to be polled even if none of its
+  // I/O completed, so that it can report a timeout.
+  virtual std::chrono::steady_clock::time_point getDeadline() const {
+    return std::chrono::steady_clock::time_point::max();
+  }
+};
+
+// Thread that executes operations by polling them in turn.
+//
+// This is an alternative to the progress engine (see gloo/work.h) for
+// collectives that can execute as a state machine. Many small
+// operations that are in flight at the same time (for example, the
+// allreduce of every bucket of parameters in a model) can then execute
+// on a single thread instead of one thread per operation.
+//
+// Operations are polled again when any of their I/O completes, or
+// when the nearest deadline of an operation expires. In between, the
+// thread sleeps. If any operation in flight doesn't support completion
+// signals (see Operation::setCompletionSignal), the thread busy polls.
+//
+class Scheduler {
+ public:
+  Scheduler();
+
+  // Waits for all submitted operations to complete.
+  ~Scheduler();
+
+  Scheduler(const Scheduler&) = delete;
+
+  Scheduler& operator=(const Scheduler&) = delete;
+
+  std::shared_ptr<Work> submit(std::unique_ptr<Operation> op);
+
+  // Scheduler that lives for the duration of the process.
+  static Scheduler& getDefault();
+
+ protected:
+  struct Task {
+    std::unique_ptr<Operation> op;
+    std::shared_ptr<Work> work;
+    bool signaled;
+  };
+
+  // Notified when I/O of any operation completes, and when an
+  // operation is submitted.
+  const std::shared_ptr<transport::CompletionSignal> signal_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Task> pending_;
+  bool done_;
+  std::thread thread_;
+
+  void loop();
+};
+
+} // namespace gloo
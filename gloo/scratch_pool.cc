@@ -0,0 +1,197 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/scratch_pool.h"
+
+#include <iterator>
+
+#include "gloo/common/logging.h"
+#include "gloo/context.h"
+#include "gloo/transport/unbound_buffer.h"
+
+namespace gloo {
+
+constexpr size_t ScratchPool::kMinSizeClass;
+constexpr size_t ScratchPool::kDefaultMaxCachedBytes;
+
+namespace {
+
+// Stride for faulting in new buffers. Touching a single byte per page
+// is enough and avoids writing the full buffer.
+constexpr size_t kPageSize = 4096;
+
+} // namespace
+
+struct ScratchPool::Entry {
+  explicit Entry(size_t size);
+
+  ~Entry();
+
+  NumaBuffer buffer;
+  size_t size;
+
+  // Set if the buffer is registered with the context.
+  Context* context;
+
+  // Created on first use (see Scratch::getUnboundBuffer).
+  std::unique_ptr<transport::UnboundBuffer> unboundBuffer;
+};
+
+ScratchPool::Entry::Entry(size_t size) : size(size), context(nullptr) {}
+
+ScratchPool::Entry::~Entry() {
+  if (context != nullptr) {
+    context->deregisterMemory(buffer.get(), size);
+  }
+}
+
+ScratchPool::Scratch::Scratch() : pool_(nullptr) {}
+
+ScratchPool::Scratch::Scratch(
+    ScratchPool* pool,
+    std::unique_ptr<Entry> entry)
+    : pool_(pool), entry_(std::move(entry)) {}
+
+ScratchPool::Scratch::Scratch(Scratch&& other) noexcept
+    : pool_(other.pool_), entry_(std::move(other.entry_)) {}
+
+ScratchPool::Scratch& ScratchPool::Scratch::operator=(
+    Scratch&& other) noexcept {
+  if (entry_) {
+    pool_->release(std::move(entry_));
+  }
+  pool_ = other.pool_;
+  entry_ = std::move(other.entry_);
+  return *this;
+}
+
+ScratchPool::Scratch::~Scratch() {
+  if (entry_) {
+    pool_->release(std::move(entry_));
+  }
+}
+
+uint8_t* ScratchPool::Scratch::ptr() const {
+  GLOO_ENFORCE(entry_);
+  return entry_->buffer.get();
+}
+
+size_t ScratchPool::Scratch::size() const {
+  GLOO_ENFORCE(entry_);
+  return entry_->size;
+}
+
+transport::UnboundBuffer* ScratchPool::Scratch::getUnboundBuffer() {
+  GLOO_ENFORCE(entry_);
+  GLOO_ENFORCE(pool_->context_ != nullptr, "Scratch pool has no context");
+  if (!entry_->unboundBuffer) {
+    entry_->unboundBuffer = pool_->context_->createUnboundBuffer(
+        entry_->buffer.get(), entry_->size);
+  }
+  return entry_->unboundBuffer.get();
+}
+
+ScratchPool::ScratchPool(
+    Context* context,
+    int numaNode,
+    bool hugePages,
+    size_t maxCachedBytes)
+    : context_(context),
+      numaNode_(numaNode),
+      hugePages_(hugePages),
+      maxCachedBytes_(maxCachedBytes),
+      allocations_(0),
+      cachedBytes_(0) {}
+
+ScratchPool::~ScratchPool() {}
+
+size_t ScratchPool::sizeClass(size_t size) {
+  if (size <= kMinSizeClass) {
+    return kMinSizeClass;
+  }
+
+  // Round up to a multiple of a quarter of the largest power of two
+  // that is not larger than the specified size.
+  size_t power = kMinSizeClass;
+  while (power <= size / 2) {
+    power <<= 1;
+  }
+  const size_t step = power / 4;
+  return (size + step - 1) / step * step;
+}
+
+ScratchPool::Scratch ScratchPool::acquire(size_t size) {
+  const auto size_class = sizeClass(size);
+
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = free_.find(size_class);
+    if (it != free_.end() && !it->second.empty()) {
+      auto entry = std::move(it->second.back());
+      it->second.pop_back();
+      if (it->second.empty()) {
+        free_.erase(it);
+      }
+      cachedBytes_ -= entry->size;
+      return Scratch(this, std::move(entry));
+    }
+    allocations_++;
+  }
+
+  // Allocate outside the lock. Touch every page so that page faults
+  // don't happen while this buffer is used by a collective.
+  std::unique_ptr<Entry> entry(new Entry(size_class));
+  entry->buffer = allocateOnNumaNode(size_class, numaNode_, hugePages_);
+  for (size_t i = 0; i < size_class; i += kPageSize) {
+    entry->buffer.get()[i] = 0;
+  }
+
+  // Collectives wrap parts of scratch buffers in short lived unbound
+  // buffers. Register the memory for as long as it lives, so that they
+  // don't register it again every time.
+  if (context_ != nullptr) {
+    context_->registerMemory(entry->buffer.get(), size_class);
+    entry->context = context_;
+  }
+  return Scratch(this, std::move(entry));
+}
+
+size_t ScratchPool::allocations() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return allocations_;
+}
+
+size_t ScratchPool::cachedBytes() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return cachedBytes_;
+}
+
+void ScratchPool::clear() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  free_.clear();
+  cachedBytes_ = 0;
+}
+
+void ScratchPool::release(std::unique_ptr<Entry> entry) {
+  // Buffers in excess of the cap are destructed outside the lock.
+  std::vector<std::unique_ptr<Entry>> evicted;
+  std::lock_guard<std::mutex> guard(mutex_);
+  cachedBytes_ += entry->size;
+  free_[entry->size].push_back(std::move(entry));
+  while (cachedBytes_ > maxCachedBytes_) {
+    auto it = std::prev(free_.end());
+    cachedBytes_ -= it->second.back()->size;
+    evicted.push_back(std::move(it->second.back()));
+    it->second.pop_back();
+    if (it->second.empty()) {
+      free_.erase(it);
+    }
+  }
+}
+
+} // namespace gloo
@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "gloo/common/numa.h"
+
+namespace gloo {
+
+// Forward declaration
+class Context;
+
+// There is no need to materialize all transport types here.
+namespace transport {
+class UnboundBuffer;
+}
+
+// Pool of scratch buffers owned by a context.
+//
+// Collectives need temporary space to receive data from peers. Instead
+// of allocating (and faulting in) this space on every call, they borrow
+// it from this pool and return it when done. Buffers are kept in size
+// classes, so that a buffer can be reused by calls with different (but
+// similar) sizes. There are four size classes per power of two, so a
+// buffer is at most 25% larger than requested.
+//
+// Every buffer is cache line aligned, allocated on the NUMA node of the
+// context's device, and faulted in when it is first allocated. It is
+// also registered with the context for as long as it lives (see
+// Context::registerMemory), so that unbound buffers over parts of it
+// don't register it again. The unbound buffer that wraps it is created
+// on first use and reused for as long as the buffer lives.
+//
+// The number of bytes held by buffers that are not borrowed is capped.
+// When a buffer is returned and the cap is exceeded, buffers of the
+// largest size classes are released first.
+//
+class ScratchPool {
+  struct Entry;
+
+ public:
+  // Smallest size class.
+  static constexpr size_t kMinSizeClass = 4096;
+
+  // Default cap on the number of bytes held by buffers that are not
+  // borrowed.
+  static constexpr size_t kDefaultMaxCachedBytes = 256 * 1024 * 1024;
+
+  // Scratch buffer borrowed from the pool. It is returned to the pool
+  // when this instance is destructed.
+  class Scratch {
+   public:
+    Scratch();
+
+    Scratch(Scratch&& other) noexcept;
+
+    Scratch& operator=(Scratch&& other) noexcept;
+
+    ~Scratch();
+
+    uint8_t* ptr() const;
+
+    // Size of the buffer. This is the size class and may therefore
+    // be larger than the size that was requested.
+    size_t size() const;
+
+    // Returns unbound buffer for the full size of this buffer.
+    // Requires the pool to be owned by a context.
+    transport::UnboundBuffer* getUnboundBuffer();
+
+    explicit operator bool() const {
+      return entry_ != nullptr;
+    }
+
+   private:
+    Scratch(ScratchPool* pool, std::unique_ptr<Entry> entry);
+
+    ScratchPool* pool_;
+    std::unique_ptr<Entry> entry_;
+
+    friend class ScratchPool;
+  };
+
+  // The context may be null if unbound buffers are never used.
+  ScratchPool(
+      Context* context,
+      int numaNode,
+      bool hugePages = false,
+      size_t maxCachedBytes = kDefaultMaxCachedBytes);
+
+  ~ScratchPool();
+
+  ScratchPool(const ScratchPool&) = delete;
+
+  ScratchPool& operator=(const ScratchPool&) = delete;
+
+  // Borrows buffer of at least the specified size.
+  Scratch acquire(size_t size);
+
+  // Returns the size class for the specified size.
+  static size_t sizeClass(size_t size);
+
+  // Number of buffers allocated over the lifetime of this pool.
+  size_t allocations() const;
+
+  // Number of bytes held by buffers that are not borrowed.
+  size_t cachedBytes() const;
+
+  // Releases all buffers that are not borrowed.
+  void clear();
+
+ protected:
+  Context* const context_;
+  const int numaNode_;
+  const bool hugePages_;
+  const size_t maxCachedBytes_;
+
+  mutable std::mutex mutex_;
+
+  // Buffers that are not borrowed, keyed by size class.
+  std::map<size_t, std::vector<std::unique_ptr<Entry>>> free_;
+
+  size_t allocations_;
+  size_t cachedBytes_;
+
+  void release(std::unique_ptr<Entry> entry);
+};
+
+} // namespace gloo
@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/sparse_allreduce.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <queue>
+
+#include "gloo/allgather.h"
+#include "gloo/allgatherv.h"
+#include "gloo/allreduce.h"
+#include "gloo/common/logging.h"
+#include "gloo/types.h"
+
+namespace gloo {
+
+void SparseAllreduceOptions::setDataType(
+    DataType dataType,
+    size_t elementSize) {
+  GLOO_ENFORCE(
+      dataType != DataType::UNSPECIFIED,
+      "Values must be of a built-in data type");
+  if (this->dataType == DataType::UNSPECIFIED) {
+    this->dataType = dataType;
+    this->elementSize = elementSize;
+  } else {
+    GLOO_ENFORCE(
+        dataType == this->dataType,
+        "Data type does not match existing value. ",
+        "Please double check that the input and output types match.");
+  }
+}
+
+namespace {
+
+// Number of bytes that the specified number of pairs take in the
+// allgatherv: the indices, followed by the rows, padded such that the
+// indices of the next process are aligned.
+size_t getPairBytes(size_t count, size_t rowBytes) {
+  const size_t bytes = count * (sizeof(int64_t) + rowBytes);
+  return (bytes + sizeof(int64_t) - 1) / sizeof(int64_t) * sizeof(int64_t);
+}
+
+template <typename T>
+void allreduceDense(
+    const std::shared_ptr<Context>& context,
+    void* ptr,
+    size_t elements,
+    uint32_t tag,
+    std::chrono::milliseconds timeout) {
+  AllreduceOptions opts(context);
+  opts.setOutput(static_cast<T*>(ptr), elements);
+  opts.setReduceOp(ReduceOp::SUM);
+  opts.setTag(tag);
+  opts.setTimeout(timeout);
+  allreduce(opts);
+}
+
+void allreduceDense(
+    DataType type,
+    const std::shared_ptr<Context>& context,
+    void* ptr,
+    size_t elements,
+    uint32_t tag,
+    std::chrono::milliseconds timeout) {
+  switch (type) {
+    case DataType::INT8:
+      return allreduceDense<int8_t>(context, ptr, elements, tag, timeout);
+    case DataType::UINT8:
+      return allreduceDense<uint8_t>(context, ptr, elements, tag, timeout);
+    case DataType::INT32:
+      return allreduceDense<int32_t>(context, ptr, elements, tag, timeout);
+    case DataType::UINT32:
+      return allreduceDense<uint32_t>(context, ptr, elements, tag, timeout);
+    case DataType::INT64:
+      return allreduceDense<int64_t>(context, ptr, elements, tag, timeout);
+    case DataType::UINT64:
+      return allreduceDense<uint64_t>(context, ptr, elements, tag, timeout);
+    case DataType::FLOAT16:
+      return allreduceDense<float16>(context, ptr, elements, tag, timeout);
+    case DataType::FLOAT32:
+      return allreduceDense<float>(context, ptr, elements, tag, timeout);
+    case DataType::FLOAT64:
+      return allreduceDense<double>(context, ptr, elements, tag, timeout);
+    case DataType::BFLOAT16:
+      return allreduceDense<bfloat16>(context, ptr, elements, tag, timeout);
+    default:
+      GLOO_ENFORCE(false, "Data type not handled.");
+  }
+}
+
+} // namespace
+
+void sparseAllreduce(SparseAllreduceOptions& opts) {
+  const auto& context = opts.context;
+  const size_t columns = opts.columns;
+  const size_t rowBytes = columns * opts.elementSize;
+
+  // Sanity checks
+  GLOO_ENFORCE(opts.dataType != DataType::UNSPECIFIED);
+  GLOO_ENFORCE_GT(opts.rows, 0, "Shape must be set");
+  GLOO_ENFORCE_GT(columns, 0, "Shape must be set");
+  GLOO_ENFORCE(
+      opts.count == 0 || (opts.inIndices != nullptr && opts.inValues),
+      "Input must be set");
+  GLOO_ENFORCE(
+      opts.outDense != nullptr || opts.outIndices != nullptr,
+      "Output must be set");
+  const auto sum = getReduceKernels(ReduceOp::SUM, opts.dataType).binary;
+
+  // Sort the local pairs by index and sum the rows of repeated
+  // indices, so that the pairs of every process are sorted and unique.
+  std::vector<size_t> order(opts.count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&opts](size_t a, size_t b) {
+    return opts.inIndices[a] < opts.inIndices[b];
+  });
+  auto local = context->getScratchPool().acquire(
+      getPairBytes(opts.count, rowBytes));
+  int64_t* localIndices = reinterpret_cast<int64_t*>(local.ptr());
+  size_t count = 0;
+  for (const auto i : order) {
+    const auto index = opts.inIndices[i];
+    GLOO_ENFORCE(
+        index >= 0 && static_cast<size_t>(index) < opts.rows,
+        "Index ",
+        index,
+        " is out of range");
+    const auto src = static_cast<const uint8_t*>(opts.inValues) + i * rowBytes;
+    if (count > 0 && localIndices[count - 1] == index) {
+      auto dst = local.ptr() + opts.count * sizeof(int64_t) +
+          (count - 1) * rowBytes;
+      sum(dst, dst, src, columns);
+      continue;
+    }
+    localIndices[count] = index;
+    memcpy(
+        local.ptr() + opts.count * sizeof(int64_t) + count * rowBytes,
+        src,
+        rowBytes);
+    count++;
+  }
+
+  // Move the rows to directly follow the unique indices.
+  if (count < opts.count) {
+    memmove(
+        local.ptr() + count * sizeof(int64_t),
+        local.ptr() + opts.count * sizeof(int64_t),
+        count * rowBytes);
+  }
+
+  // Exchange the number of unique pairs of every process.
+  std::vector<uint64_t> counts(context->size);
+  {
+    uint64_t input = count;
+    AllgatherOptions allgatherOpts(context);
+    allgatherOpts.setInput(&input, 1);
+    allgatherOpts.setOutput(counts.data(), counts.size());
+    allgatherOpts.setTag(opts.tag);
+    allgatherOpts.setTimeout(opts.timeout);
+    allgather(allgatherOpts);
+  }
+  const size_t total =
+      std::accumulate(counts.begin(), counts.end(), uint64_t(0));
+
+  // The sparse exchange costs an index and a row per pair, the dense
+  // ring allreduce twice the matrix.
+  auto threshold = opts.densityThreshold;
+  if (threshold < 0) {
+    threshold = 2.0 * rowBytes / (sizeof(int64_t) + rowBytes);
+  }
+
+  if (total > threshold * opts.rows) {
+    // Scatter the local rows into a dense matrix and allreduce it.
+    const size_t denseBytes = opts.rows * rowBytes;
+    ScratchPool::Scratch scratch;
+    uint8_t* dense = static_cast<uint8_t*>(opts.outDense);
+    if (dense == nullptr) {
+      scratch = context->getScratchPool().acquire(denseBytes);
+      dense = scratch.ptr();
+    }
+    memset(dense, 0, denseBytes);
+    const uint8_t* localRows = local.ptr() + count * sizeof(int64_t);
+    for (size_t i = 0; i < count; i++) {
+      memcpy(
+          dense + localIndices[i] * rowBytes,
+          localRows + i * rowBytes,
+          rowBytes);
+    }
+    allreduceDense(
+        opts.dataType,
+        context,
+        dense,
+        opts.rows * columns,
+        opts.tag,
+        opts.timeout);
+
+    // Keep the rows that any process contributed to, like the sparse
+    // exchange does, even if their sum is zero. Which rows those are
+    // can't be told from the sum, so a mask is reduced as well.
+    if (opts.outIndices != nullptr) {
+      auto mask = context->getScratchPool().acquire(opts.rows);
+      memset(mask.ptr(), 0, opts.rows);
+      for (size_t i = 0; i < count; i++) {
+        mask.ptr()[localIndices[i]] = 1;
+      }
+      {
+        AllreduceOptions maskOpts(context);
+        maskOpts.setOutput(mask.ptr(), opts.rows);
+        maskOpts.setReduceOp(ReduceOp::MAX);
+        maskOpts.setTag(opts.tag);
+        maskOpts.setTimeout(opts.timeout);
+        allreduce(maskOpts);
+      }
+      opts.outIndices->clear();
+      for (size_t i = 0; i < opts.rows; i++) {
+        if (mask.ptr()[i] != 0) {
+          opts.outIndices->push_back(i);
+        }
+      }
+      auto values = static_cast<uint8_t*>(
+          opts.outValues(opts.outIndices->size() * columns));
+      for (size_t i = 0; i < opts.outIndices->size(); i++) {
+        memcpy(
+            values + i * rowBytes,
+            dense + (*opts.outIndices)[i] * rowBytes,
+            rowBytes);
+      }
+    }
+    return;
+  }
+
+  // Gather the pairs of all processes.
+  std::vector<size_t> bytes(context->size);
+  std::vector<size_t> offsets(context->size);
+  size_t totalBytes = 0;
+  for (auto i = 0; i < context->size; i++) {
+    bytes[i] = getPairBytes(counts[i], rowBytes);
+    offsets[i] = totalBytes;
+    totalBytes += bytes[i];
+  }
+  auto gathered = context->getScratchPool().acquire(totalBytes);
+  {
+    AllgathervOptions allgathervOpts(context);
+    allgathervOpts.setInput(local.ptr(), bytes[context->rank]);
+    allgathervOpts.setOutput(gathered.ptr(), bytes);
+    allgathervOpts.setTag(opts.tag);
+    allgathervOpts.setTimeout(opts.timeout);
+    allgatherv(allgathervOpts);
+  }
+  const auto indicesOf = [&](int rank) {
+    return reinterpret_cast<const int64_t*>(gathered.ptr() + offsets[rank]);
+  };
+  const auto rowOf = [&](int rank, size_t i) {
+    return gathered.ptr() + offsets[rank] + counts[rank] * sizeof(int64_t) +
+        i * rowBytes;
+  };
+
+  // Sum the rows into a dense matrix, in order of rank, so that every
+  // process computes the same result.
+  if (opts.outDense != nullptr) {
+    uint8_t* dense = static_cast<uint8_t*>(opts.outDense);
+    memset(dense, 0, opts.rows * rowBytes);
+    for (auto rank = 0; rank < context->size; rank++) {
+      const auto indices = indicesOf(rank);
+      for (size_t i = 0; i < counts[rank]; i++) {
+        auto dst = dense + indices[i] * rowBytes;
+        sum(dst, dst, rowOf(rank, i), columns);
+      }
+    }
+    return;
+  }
+
+  // Merge the sorted pairs of all processes. Pairs with the same index
+  // are summed in order of rank, so that every process computes the
+  // same result.
+  using Entry = std::pair<int64_t, int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+  std::vector<size_t> next(context->size, 0);
+  for (auto rank = 0; rank < context->size; rank++) {
+    if (counts[rank] > 0) {
+      heap.emplace(indicesOf(rank)[0], rank);
+    }
+  }
+  auto& outIndices = *opts.outIndices;
+  outIndices.resize(total);
+  auto values = static_cast<uint8_t*>(opts.outValues(total * columns));
+  size_t merged = 0;
+  while (!heap.empty()) {
+    const auto entry = heap.top();
+    heap.pop();
+    const auto rank = entry.second;
+    const auto i = next[rank]++;
+    if (i + 1 < counts[rank]) {
+      heap.emplace(indicesOf(rank)[i + 1], rank);
+    }
+    if (merged > 0 && outIndices[merged - 1] == entry.first) {
+      auto dst = values + (merged - 1) * rowBytes;
+      sum(dst, dst, rowOf(rank, i), columns);
+      continue;
+    }
+    outIndices[merged] = entry.first;
+    memcpy(values + merged * rowBytes, rowOf(rank, i), rowBytes);
+    merged++;
+  }
+  outIndices.resize(merged);
+  opts.outValues(merged * columns);
+}
+
+std::shared_ptr<Work> isparseAllreduce(SparseAllreduceOptions opts) {
+  return detail::enqueue(std::move(opts), [](SparseAllreduceOptions& opts) {
+    sparseAllreduce(opts);
+  });
+}
+
+} // namespace gloo
@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "gloo/context.h"
+#include "gloo/reduce_op.h"
+#include "gloo/work.h"
+
+namespace gloo {
+
+// Sums sparse data across processes, such as the gradient of an
+// embedding table where most rows are zero.
+//
+// The data is a matrix of rows x columns elements (see setShape). Every
+// process contributes a list of (index, row) pairs in coordinate (COO)
+// format, where the index selects a row of the matrix. Indices need not
+// be sorted and may repeat. The result holds every row that at least
+// one process contributed to, with the sum of all contributions.
+//
+// Every process contributes its pairs to an allgatherv, after which
+// every process merges them. The number of bytes that a process
+// receives grows with the total number of pairs, whereas a dense
+// allreduce sends twice the size of the matrix regardless. Therefore,
+// if the pairs of all processes exceed the density threshold (see
+// setDensityThreshold), the rows are scattered into a dense matrix and
+// summed with a dense allreduce instead.
+class SparseAllreduceOptions {
+ public:
+  explicit SparseAllreduceOptions(const std::shared_ptr<Context>& context)
+      : context(context), timeout(context->getTimeout()) {}
+
+  // Shape of the dense matrix. Indices must be less than rows, and
+  // every row has the specified number of columns.
+  void setShape(size_t rows, size_t columns = 1) {
+    this->rows = rows;
+    this->columns = columns;
+  }
+
+  // The count indices and count rows (of columns values each) that
+  // this process contributes.
+  template <typename T>
+  void setInput(const int64_t* indices, const T* values, size_t count) {
+    setDataType(getDataType<T>(), sizeof(T));
+    this->inIndices = indices;
+    this->inValues = values;
+    this->count = count;
+  }
+
+  // Store the result as sorted indices and their rows. The vectors are
+  // resized to fit the result.
+  template <typename T>
+  void setOutput(std::vector<int64_t>* indices, std::vector<T>* values) {
+    setDataType(getDataType<T>(), sizeof(T));
+    this->outIndices = indices;
+    this->outValues = [values](size_t elements) {
+      values->resize(elements);
+      return static_cast<void*>(values->data());
+    };
+    this->outDense = nullptr;
+  }
+
+  // Store the result as a dense matrix of rows x columns elements, with
+  // zeros for the rows that no process contributed to.
+  template <typename T>
+  void setOutput(T* ptr) {
+    setDataType(getDataType<T>(), sizeof(T));
+    this->outDense = ptr;
+    this->outIndices = nullptr;
+    this->outValues = nullptr;
+  }
+
+  // Use a dense allreduce if the total number of pairs of all processes
+  // exceeds the specified fraction of the number of rows.
+  //
+  // By default, the threshold is where the bytes that every process
+  // receives in the allgatherv (an 8 byte index and a row per pair)
+  // match the bytes that a ring allreduce sends (twice the matrix).
+  void setDensityThreshold(double threshold) {
+    this->densityThreshold = threshold;
+  }
+
+  void setTag(uint32_t tag) {
+    this->tag = tag;
+  }
+
+  void setTimeout(std::chrono::milliseconds timeout) {
+    this->timeout = timeout;
+  }
+
+ protected:
+  std::shared_ptr<Context> context;
+
+  // Shape of the dense matrix.
+  size_t rows = 0;
+  size_t columns = 1;
+
+  // Data type of the values and number of bytes per value.
+  DataType dataType = DataType::UNSPECIFIED;
+  size_t elementSize = 0;
+
+  // Pairs that this process contributes.
+  const int64_t* inIndices = nullptr;
+  const void* inValues = nullptr;
+  size_t count = 0;
+
+  // Sparse output. The function resizes the values to the specified
+  // number of elements and returns a pointer to them.
+  std::vector<int64_t>* outIndices = nullptr;
+  std::function<void*(size_t)> outValues;
+
+  // Dense output.
+  void* outDense = nullptr;
+
+  // Fraction of the rows above which a dense allreduce is used, or
+  // negative for the default (see setDensityThreshold).
+  double densityThreshold = -1;
+
+  // Tag for this operation.
+  // Must be unique across operations executing in parallel.
+  uint32_t tag = 0;
+
+  // End-to-end timeout for this operation.
+  std::chrono::milliseconds timeout;
+
+  // Set data type, or check the argument is equal to the current value.
+  void setDataType(DataType dataType, size_t elementSize);
+
+  friend void sparseAllreduce(SparseAllreduceOptions&);
+};
+
+void sparseAllreduce(SparseAllreduceOptions& opts);
+
+// Non-blocking variant of sparseAllreduce. Executes on the default
+// progress engine; see gloo/work.h.
+std::shared_ptr<Work> isparseAllreduce(SparseAllreduceOptions opts);
+
+} // namespace gloo
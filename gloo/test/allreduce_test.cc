@@ -7,7 +7,12 @@
  */
 
 #include <stdlib.h>
+#include <sys/resource.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <functional>
 #include <thread>
 #include <vector>
@@ -377,12 +382,770 @@ INSTANTIATE_TEST_CASE_P(
         ::testing::Values(true, false),
         ::testing::Values(Algorithm::BCUBE)));
 
+INSTANTIATE_TEST_CASE_P(
+    AllreduceNewHalvingDoubling,
+    AllreduceNewTest,
+    ::testing::Combine(
+        ::testing::ValuesIn(kTransportsForFunctionAlgorithms),
+        ::testing::Values(1, 2, 3, 4, 6, 7, 13),
+        ::testing::Values(1, 2, 3),
+        ::testing::Values(0, 1, 10, 100, 1000),
+        ::testing::Values(true, false),
+        ::testing::Values(Algorithm::HALVING_DOUBLING)));
+
+INSTANTIATE_TEST_CASE_P(
+    AllreduceNewHierarchical,
+    AllreduceNewTest,
+    ::testing::Combine(
+        ::testing::ValuesIn(kTransportsForFunctionAlgorithms),
+        ::testing::Values(1, 2, 4, 7),
+        ::testing::Values(1, 2, 3),
+        ::testing::Values(0, 1, 10, 100, 1000),
+        ::testing::Values(true, false),
+        ::testing::Values(Algorithm::HIERARCHICAL)));
+
+INSTANTIATE_TEST_CASE_P(
+    AllreduceNewDoubleBinaryTree,
+    AllreduceNewTest,
+    ::testing::Combine(
+        ::testing::ValuesIn(kTransportsForFunctionAlgorithms),
+        ::testing::Values(1, 2, 3, 4, 5, 8, 13),
+        ::testing::Values(1, 2, 3),
+        ::testing::Values(0, 1, 10, 100, 1000),
+        ::testing::Values(true, false),
+        ::testing::Values(Algorithm::DOUBLE_BINARY_TREE)));
+
 template <typename T>
 AllreduceOptions::Func getFunction() {
   void (*func)(void*, const void*, const void*, size_t) = &::gloo::sum<T>;
   return AllreduceOptions::Func(func);
 }
 
+TEST_F(AllreduceNewTest, ReuseScratch) {
+  spawn(Transport::TCP, 4, [&](std::shared_ptr<Context> context) {
+    Fixture<uint64_t> outputs(context, 1, 1000);
+    AllreduceOptions opts(context);
+    opts.setOutputs(outputs.getPointers(), 1000);
+    opts.setReduceFunction(getFunction<uint64_t>());
+
+    // Scratch space is only allocated by the first call.
+    allreduce(opts);
+    const auto allocations = context->getScratchPool().allocations();
+    ASSERT_GT(allocations, 0);
+    for (auto i = 0; i < 10; i++) {
+      allreduce(opts);
+    }
+    ASSERT_EQ(allocations, context->getScratchPool().allocations());
+  });
+}
+
+TEST_F(AllreduceNewTest, Plan) {
+  const auto contextSize = 4;
+  const auto numPointers = 2;
+  const auto dataSize = 1000;
+
+  spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+    for (const auto algorithm : {Algorithm::RING, Algorithm::BCUBE}) {
+      Fixture<uint64_t> inputs(context, numPointers, dataSize);
+      Fixture<uint64_t> outputs(context, numPointers, dataSize);
+      AllreduceOptions opts(context);
+      opts.setAlgorithm(algorithm);
+      opts.setInputs(inputs.getPointers(), dataSize);
+      opts.setOutputs(outputs.getPointers(), dataSize);
+      opts.setReduceFunction(getFunction<uint64_t>());
+      opts.setMaxSegmentSize(128);
+      AllreducePlan plan(std::move(opts));
+
+      // Executing the plan must not borrow additional scratch space.
+      const auto allocations = context->getScratchPool().allocations();
+      for (auto i = 0; i < 5; i++) {
+        inputs.assignValues();
+        outputs.clear();
+        plan.execute();
+
+        const auto stride = contextSize * numPointers;
+        const auto base = (stride * (stride - 1)) / 2;
+        const auto out = outputs.getPointers();
+        for (auto j = 0; j < numPointers; j++) {
+          for (auto k = 0; k < dataSize; k++) {
+            ASSERT_EQ(k * stride * stride + base, out[j][k])
+                << "Mismatch at out[" << j << "][" << k << "]";
+          }
+        }
+      }
+      ASSERT_EQ(allocations, context->getScratchPool().allocations());
+    }
+  });
+}
+
+TEST_F(AllreduceNewTest, NonBlocking) {
+  const auto contextSize = 4;
+  const auto numOperations = 4;
+  const auto dataSize = 1000;
+
+  spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+    std::vector<std::unique_ptr<Fixture<uint64_t>>> outputs;
+    std::vector<std::shared_ptr<Work>> work;
+    for (auto i = 0; i < numOperations; i++) {
+      outputs.emplace_back(new Fixture<uint64_t>(context, 1, dataSize));
+      outputs.back()->assignValues();
+      AllreduceOptions opts(context);
+      opts.setOutputs(outputs.back()->getPointers(), dataSize);
+      opts.setReduceFunction(getFunction<uint64_t>());
+      opts.setTag(i);
+      work.push_back(iallreduce(std::move(opts)));
+    }
+
+    const auto base = (contextSize * (contextSize - 1)) / 2;
+    for (auto i = 0; i < numOperations; i++) {
+      work[i]->wait();
+      ASSERT_TRUE(work[i]->test());
+      const auto out = outputs[i]->getPointers();
+      for (auto k = 0; k < dataSize; k++) {
+        ASSERT_EQ(k * contextSize * contextSize + base, out[0][k])
+            << "Mismatch at out[" << i << "][" << k << "]";
+      }
+    }
+  });
+}
+
+TEST_F(AllreduceNewTest, Scheduler) {
+  const auto contextSize = 4;
+  const auto numOperations = 32;
+  const auto dataSize = 100;
+
+  spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+    // Every process drives all its operations from a single thread.
+    ::gloo::Scheduler scheduler;
+    const std::array<Algorithm, 5> algorithms = {
+        Algorithm::RING,
+        Algorithm::BCUBE,
+        Algorithm::HALVING_DOUBLING,
+        Algorithm::HIERARCHICAL,
+        Algorithm::DOUBLE_BINARY_TREE};
+    std::vector<std::unique_ptr<Fixture<uint64_t>>> outputs;
+    std::vector<std::shared_ptr<Work>> work;
+    for (auto i = 0; i < numOperations; i++) {
+      outputs.emplace_back(new Fixture<uint64_t>(context, 2, dataSize));
+      outputs.back()->assignValues();
+      AllreduceOptions opts(context);
+      opts.setAlgorithm(algorithms[i % algorithms.size()]);
+      opts.setOutputs(outputs.back()->getPointers(), dataSize);
+      opts.setReduceFunction(getFunction<uint64_t>());
+      opts.setMaxSegmentSize(128);
+      opts.setTag(i);
+      work.push_back(iallreduce(std::move(opts), scheduler));
+    }
+
+    const auto stride = contextSize * 2;
+    const auto base = (stride * (stride - 1)) / 2;
+    for (auto i = 0; i < numOperations; i++) {
+      work[i]->wait();
+      const auto out = outputs[i]->getPointers();
+      for (auto j = 0; j < 2; j++) {
+        for (auto k = 0; k < dataSize; k++) {
+          ASSERT_EQ(k * stride * stride + base, out[j][k])
+              << "Mismatch at out[" << i << "][" << j << "][" << k << "]";
+        }
+      }
+    }
+  });
+}
+
+// Returns CPU time consumed by this process.
+std::chrono::microseconds getProcessCpuTime() {
+  struct rusage usage;
+  GLOO_ENFORCE_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+  const auto& user = usage.ru_utime;
+  const auto& system = usage.ru_stime;
+  return std::chrono::seconds(user.tv_sec + system.tv_sec) +
+      std::chrono::microseconds(user.tv_usec + system.tv_usec);
+}
+
+// The scheduler sleeps while its operations wait for a peer.
+TEST_F(AllreduceNewTest, SchedulerSleeps) {
+  const auto delay = std::chrono::milliseconds(200);
+  const std::array<Algorithm, 5> algorithms = {
+      Algorithm::RING,
+      Algorithm::BCUBE,
+      Algorithm::HALVING_DOUBLING,
+      Algorithm::HIERARCHICAL,
+      Algorithm::DOUBLE_BINARY_TREE};
+
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    ::gloo::Scheduler scheduler;
+    for (const auto algorithm : algorithms) {
+      Fixture<uint64_t> outputs(context, 1, 1000);
+      outputs.assignValues();
+      AllreduceOptions opts(context);
+      opts.setAlgorithm(algorithm);
+      opts.setOutputs(outputs.getPointers(), 1000);
+      opts.setReduceFunction(getFunction<uint64_t>());
+
+      // Rank 1 joins late. The process only sleeps in the meantime, so
+      // its CPU time is that of rank 0 waiting for the operation.
+      if (context->rank == 1) {
+        std::this_thread::sleep_for(delay);
+        iallreduce(std::move(opts), scheduler)->wait();
+        continue;
+      }
+      const auto start = getProcessCpuTime();
+      iallreduce(std::move(opts), scheduler)->wait();
+      const auto cpu = getProcessCpuTime() - start;
+      ASSERT_LT(cpu.count(), delay.count() * 1000 / 4)
+          << "Algorithm " << static_cast<int>(algorithm);
+    }
+  });
+}
+
+TEST_F(AllreduceNewTest, Hierarchical) {
+  // Host of every process, for different layouts of 6 processes.
+  const std::vector<std::vector<int>> layouts = {
+      {0, 0, 0, 1, 1, 1},
+      {0, 0, 1, 1, 2, 2},
+      {0, 1, 2, 0, 1, 2},
+      {0, 1, 2, 3, 4, 5},
+  };
+  const auto contextSize = 6;
+  const auto numPointers = 2;
+
+  spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+    for (const auto& layout : layouts) {
+      context->setHostLayout(layout);
+      for (const auto dataSize : {1, 5, 100, 1001}) {
+        Fixture<uint64_t> outputs(context, numPointers, dataSize);
+        outputs.assignValues();
+
+        AllreduceOptions opts(context);
+        opts.setAlgorithm(Algorithm::HIERARCHICAL);
+        opts.setOutputs(outputs.getPointers(), dataSize);
+        opts.setReduceFunction(getFunction<uint64_t>());
+        allreduce(opts);
+
+        const auto stride = contextSize * numPointers;
+        const auto base = (stride * (stride - 1)) / 2;
+        const auto out = outputs.getPointers();
+        for (auto j = 0; j < numPointers; j++) {
+          for (auto k = 0; k < dataSize; k++) {
+            ASSERT_EQ(k * stride * stride + base, out[j][k])
+                << "Mismatch at out[" << j << "][" << k << "]";
+          }
+        }
+      }
+    }
+  });
+}
+
+TEST_F(AllreduceNewTest, HierarchicalRequiresUniformLayout) {
+  spawn(Transport::TCP, 3, [&](std::shared_ptr<Context> context) {
+    context->setHostLayout({0, 0, 1});
+    Fixture<uint64_t> outputs(context, 1, 10);
+    AllreduceOptions opts(context);
+    opts.setAlgorithm(Algorithm::HIERARCHICAL);
+    opts.setOutputs(outputs.getPointers(), 10);
+    opts.setReduceFunction(getFunction<uint64_t>());
+    ASSERT_THROW(allreduce(opts), ::gloo::EnforceNotMet);
+  });
+}
+
+TEST_F(AllreduceNewTest, MultiRing) {
+  const auto numPointers = 2;
+
+  for (const auto contextSize : {2, 3, 4, 5, 7}) {
+    spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+      ::gloo::Scheduler scheduler;
+      for (const auto rings : {2, 3, 4}) {
+        for (const auto dataSize : {1, 10, 1000}) {
+          for (const auto useScheduler : {false, true}) {
+            Fixture<uint64_t> outputs(context, numPointers, dataSize);
+            outputs.assignValues();
+
+            AllreduceOptions opts(context);
+            opts.setAlgorithm(Algorithm::RING);
+            opts.setRings(rings);
+            opts.setOutputs(outputs.getPointers(), dataSize);
+            opts.setReduceFunction(getFunction<uint64_t>());
+            opts.setMaxSegmentSize(128);
+            if (useScheduler) {
+              iallreduce(std::move(opts), scheduler)->wait();
+            } else {
+              allreduce(opts);
+            }
+
+            const auto stride = contextSize * numPointers;
+            const auto base = (stride * (stride - 1)) / 2;
+            const auto out = outputs.getPointers();
+            for (auto j = 0; j < numPointers; j++) {
+              for (auto k = 0; k < dataSize; k++) {
+                ASSERT_EQ(k * stride * stride + base, out[j][k])
+                    << "Mismatch at out[" << j << "][" << k << "] with "
+                    << rings << " rings";
+              }
+            }
+          }
+        }
+      }
+    });
+  }
+}
+
+TEST_F(AllreduceNewTest, ReductionThreads) {
+  const auto numPointers = 2;
+
+  for (const auto contextSize : {2, 3, 5}) {
+    spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+      ::gloo::Scheduler scheduler;
+      for (const auto threads : {0, 2}) {
+        for (const auto depth : {2, 3, 8}) {
+          for (const auto dataSize : {1, 10, 1000}) {
+            for (const auto useScheduler : {false, true}) {
+              Fixture<uint64_t> inputs(context, numPointers, dataSize);
+              Fixture<uint64_t> outputs(context, numPointers, dataSize);
+              inputs.assignValues();
+              outputs.clear();
+
+              AllreduceOptions opts(context);
+              opts.setAlgorithm(Algorithm::RING);
+              opts.setReductionThreads(threads);
+              opts.setPipelineDepth(depth);
+              opts.setInputs(inputs.getPointers(), dataSize);
+              opts.setOutputs(outputs.getPointers(), dataSize);
+              opts.setReduceFunction(getFunction<uint64_t>());
+              opts.setMaxSegmentSize(128);
+              if (useScheduler) {
+                iallreduce(std::move(opts), scheduler)->wait();
+              } else {
+                allreduce(opts);
+              }
+
+              const auto stride = contextSize * numPointers;
+              const auto base = (stride * (stride - 1)) / 2;
+              const auto out = outputs.getPointers();
+              for (auto j = 0; j < numPointers; j++) {
+                for (auto k = 0; k < dataSize; k++) {
+                  ASSERT_EQ(k * stride * stride + base, out[j][k])
+                      << "Mismatch at out[" << j << "][" << k << "] with "
+                      << threads << " threads and depth " << depth;
+                }
+              }
+            }
+          }
+        }
+      }
+    });
+  }
+}
+
+TEST_F(AllreduceNewTest, InvalidPipelineDepth) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    Fixture<uint64_t> outputs(context, 1, 10);
+    AllreduceOptions opts(context);
+    opts.setAlgorithm(Algorithm::RING);
+    opts.setPipelineDepth(1);
+    opts.setOutputs(outputs.getPointers(), 10);
+    opts.setReduceFunction(getFunction<uint64_t>());
+    ASSERT_THROW(allreduce(opts), ::gloo::EnforceNotMet);
+  });
+}
+
+TEST_F(AllreduceNewTest, ReduceOp) {
+  const auto contextSize = 3;
+  const auto numPointers = 2;
+  const auto dataSize = 100;
+
+  spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+    for (const auto op :
+         {ReduceOp::SUM, ReduceOp::PRODUCT, ReduceOp::MIN, ReduceOp::MAX}) {
+      for (const auto opFirst : {false, true}) {
+        // Input j of rank r holds r * numPointers + j + 1 everywhere.
+        std::vector<std::vector<double>> inputs(numPointers);
+        std::vector<std::vector<double>> outputs(numPointers);
+        std::vector<double*> inputPointers;
+        std::vector<double*> outputPointers;
+        for (auto j = 0; j < numPointers; j++) {
+          inputs[j].assign(dataSize, context->rank * numPointers + j + 1);
+          outputs[j].assign(dataSize, 0);
+          inputPointers.push_back(inputs[j].data());
+          outputPointers.push_back(outputs[j].data());
+        }
+
+        AllreduceOptions opts(context);
+        opts.setAlgorithm(Algorithm::RING);
+        if (opFirst) {
+          opts.setReduceOp(op);
+        }
+        opts.setInputs(inputPointers, dataSize);
+        opts.setOutputs(outputPointers, dataSize);
+        if (!opFirst) {
+          opts.setReduceOp(op);
+        }
+        allreduce(opts);
+
+        // Values of all inputs are 1 through contextSize * numPointers.
+        const auto n = contextSize * numPointers;
+        double expected = 0;
+        switch (op) {
+          case ReduceOp::SUM:
+            expected = n * (n + 1) / 2;
+            break;
+          case ReduceOp::PRODUCT:
+            expected = 1;
+            for (auto i = 1; i <= n; i++) {
+              expected *= i;
+            }
+            break;
+          case ReduceOp::MIN:
+            expected = 1;
+            break;
+          default:
+            expected = n;
+            break;
+        }
+        for (auto j = 0; j < numPointers; j++) {
+          for (auto k = 0; k < dataSize; k++) {
+            ASSERT_EQ(expected, outputs[j][k])
+                << "Mismatch at out[" << j << "][" << k << "] for op "
+                << static_cast<int>(op);
+          }
+        }
+      }
+    }
+  });
+}
+
+TEST_F(AllreduceNewTest, ReduceOpRequiresDataType) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    std::vector<char> output(10);
+    AllreduceOptions opts(context);
+    opts.setOutput(output.data(), output.size());
+    opts.setReduceOp(ReduceOp::SUM);
+    ASSERT_THROW(allreduce(opts), ::gloo::EnforceNotMet);
+  });
+}
+
+TEST_F(AllreduceNewTest, Average) {
+  const auto dataSize = 1000;
+  const std::array<Algorithm, 5> algorithms = {
+      Algorithm::RING,
+      Algorithm::BCUBE,
+      Algorithm::HALVING_DOUBLING,
+      Algorithm::HIERARCHICAL,
+      Algorithm::DOUBLE_BINARY_TREE};
+
+  // Number of inputs and outputs. Without inputs, the outputs are
+  // reduced in place.
+  const std::vector<std::pair<int, int>> layouts = {{2, 2}, {0, 2}, {0, 1}};
+
+  for (const auto contextSize : {1, 3, 4}) {
+    spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+      for (const auto algorithm : algorithms) {
+        for (const auto& layout : layouts) {
+          const auto numInputs = layout.first;
+          const auto numOutputs = layout.second;
+          const auto numBuffers = numInputs > 0 ? numInputs : numOutputs;
+
+          // Element k of buffer j of rank r holds (r * numBuffers + j + 1)
+          // times (k + 1).
+          std::vector<std::vector<double>> inputs(numInputs);
+          std::vector<std::vector<double>> outputs(numOutputs);
+          auto& buffers = numInputs > 0 ? inputs : outputs;
+          for (auto& output : outputs) {
+            output.assign(dataSize, 0);
+          }
+          for (auto j = 0; j < numBuffers; j++) {
+            buffers[j].resize(dataSize);
+            for (auto k = 0; k < dataSize; k++) {
+              buffers[j][k] = (context->rank * numBuffers + j + 1) * (k + 1);
+            }
+          }
+
+          AllreduceOptions opts(context);
+          opts.setAlgorithm(algorithm);
+          opts.setReduceOp(ReduceOp::AVG);
+          opts.setMaxSegmentSize(1024);
+          std::vector<double*> inputPointers;
+          std::vector<double*> outputPointers;
+          for (auto& input : inputs) {
+            inputPointers.push_back(input.data());
+          }
+          for (auto& output : outputs) {
+            outputPointers.push_back(output.data());
+          }
+          if (numInputs > 0) {
+            opts.setInputs(inputPointers, dataSize);
+          }
+          opts.setOutputs(outputPointers, dataSize);
+          allreduce(opts);
+
+          // The average of 1 through n is (n + 1) / 2.
+          const auto n = contextSize * numBuffers;
+          for (auto j = 0; j < numOutputs; j++) {
+            for (auto k = 0; k < dataSize; k++) {
+              const double expected = (n + 1) / 2.0 * (k + 1);
+              ASSERT_NEAR(expected, outputs[j][k], expected * 1e-12)
+                  << "Mismatch at out[" << j << "][" << k << "] with "
+                  << numInputs << " inputs for algorithm "
+                  << static_cast<int>(algorithm);
+            }
+          }
+        }
+      }
+    });
+  }
+}
+
+TEST_F(AllreduceNewTest, AverageRequiresFloatingPoint) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    std::vector<int32_t> output(10);
+    AllreduceOptions opts(context);
+    opts.setOutput(output.data(), output.size());
+    ASSERT_THROW(opts.setReduceOp(ReduceOp::AVG), ::gloo::EnforceNotMet);
+  });
+}
+
+TEST_F(AllreduceNewTest, Compression) {
+  const auto dataSize = 1000;
+  const std::array<DataType, 3> types = {
+      DataType::FLOAT16, DataType::BFLOAT16, DataType::INT8};
+  const std::array<ReduceOp, 3> ops = {ReduceOp::SUM, ReduceOp::AVG,
+                                       ReduceOp::MAX};
+  const std::vector<std::pair<int, int>> layouts = {{2, 2}, {0, 1}};
+
+  for (const auto contextSize : {2, 3, 5}) {
+    spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+      for (const auto type : types) {
+        // Relative rounding error of a single conversion. For int8, it
+        // is relative to the largest value in the block.
+        float epsilon = 1.0f / 254;
+        if (type == DataType::FLOAT16) {
+          epsilon = 1.0f / 2048;
+        } else if (type == DataType::BFLOAT16) {
+          epsilon = 1.0f / 256;
+        }
+        for (const auto op : ops) {
+          for (const auto rings : {1, 2}) {
+            for (const auto& layout : layouts) {
+              const auto numInputs = layout.first;
+              const auto numOutputs = layout.second;
+              const auto numBuffers = numInputs > 0 ? numInputs : numOutputs;
+
+              // Element k of buffer j of rank r holds a value that isn't
+              // exactly representable in the narrower type.
+              std::vector<std::vector<float>> inputs(numInputs);
+              std::vector<std::vector<float>> outputs(numOutputs);
+              auto& buffers = numInputs > 0 ? inputs : outputs;
+              for (auto& output : outputs) {
+                output.assign(dataSize, 0);
+              }
+              std::vector<float> expected(dataSize);
+              for (auto k = 0; k < dataSize; k++) {
+                for (auto r = 0; r < contextSize; r++) {
+                  for (auto j = 0; j < numBuffers; j++) {
+                    const float value = 0.1f * (r * numBuffers + j + 1) *
+                        (k + 1);
+                    if (op == ReduceOp::MAX) {
+                      expected[k] = std::max(expected[k], value);
+                    } else {
+                      expected[k] += value;
+                    }
+                    if (r == context->rank) {
+                      buffers[j].resize(dataSize);
+                      buffers[j][k] = value;
+                    }
+                  }
+                }
+                if (op == ReduceOp::AVG) {
+                  expected[k] /= contextSize * numBuffers;
+                }
+              }
+
+              AllreduceOptions opts(context);
+              opts.setReduceOp(op);
+              opts.setCompression(type);
+              opts.setRings(rings);
+              opts.setMaxSegmentSize(1024);
+              std::vector<float*> inputPointers;
+              std::vector<float*> outputPointers;
+              for (auto& input : inputs) {
+                inputPointers.push_back(input.data());
+              }
+              for (auto& output : outputs) {
+                outputPointers.push_back(output.data());
+              }
+              if (numInputs > 0) {
+                opts.setInputs(inputPointers, dataSize);
+              }
+              opts.setOutputs(outputPointers, dataSize);
+              allreduce(opts);
+
+              // Every partial result is rounded once per hop. The
+              // expected values increase with k, so the largest value
+              // in the int8 block of element k is at most that of
+              // element k + kQuantizationBlockSize - 1.
+              const float tolerance = epsilon * (contextSize + 1);
+              for (auto j = 0; j < numOutputs; j++) {
+                for (auto k = 0; k < dataSize; k++) {
+                  const auto reference = type == DataType::INT8
+                      ? expected[std::min<size_t>(
+                            dataSize - 1, k + kQuantizationBlockSize - 1)]
+                      : expected[k];
+                  ASSERT_NEAR(expected[k], outputs[j][k],
+                              reference * tolerance)
+                      << "Mismatch at out[" << j << "][" << k << "] for op "
+                      << static_cast<int>(op) << " with " << rings
+                      << " rings and " << numInputs << " inputs";
+                  ASSERT_EQ(outputs[0][k], outputs[j][k]);
+                }
+              }
+
+              // All ranks must end up with the same result.
+              std::vector<float> min(outputs[0]);
+              std::vector<float> max(outputs[0]);
+              for (auto* result : {&min, &max}) {
+                AllreduceOptions check(context);
+                check.setOutput(result->data(), dataSize);
+                check.setReduceOp(result == &min ? ReduceOp::MIN
+                                                 : ReduceOp::MAX);
+                allreduce(check);
+              }
+              ASSERT_EQ(min, outputs[0]);
+              ASSERT_EQ(max, outputs[0]);
+            }
+          }
+        }
+      }
+    });
+  }
+}
+
+TEST_F(AllreduceNewTest, ErrorFeedback) {
+  const auto dataSize = 1000;
+  const auto iterations = 8;
+  for (const auto contextSize : {2, 3}) {
+    spawn(Transport::TCP, contextSize, [&](std::shared_ptr<Context> context) {
+      for (const auto type : {DataType::BFLOAT16, DataType::INT8}) {
+        // Two inputs that don't change between iterations.
+        std::vector<std::vector<float>> inputs(2);
+        std::vector<float> expected(dataSize);
+        for (auto j = 0; j < 2; j++) {
+          inputs[j].resize(dataSize);
+          for (auto k = 0; k < dataSize; k++) {
+            inputs[j][k] = 0.01f * (context->rank * 2 + j + 1) * (k % 300);
+          }
+        }
+        for (auto k = 0; k < dataSize; k++) {
+          for (auto r = 0; r < contextSize; r++) {
+            expected[k] += 0.01f * (r * 4 + 3) * (k % 300);
+          }
+        }
+
+        std::vector<float> output(dataSize);
+        std::vector<float> residual(dataSize, 0.0f);
+        std::vector<float> total(dataSize, 0.0f);
+        for (auto i = 0; i < iterations; i++) {
+          AllreduceOptions opts(context);
+          opts.setInputs(
+              std::vector<float*>{inputs[0].data(), inputs[1].data()},
+              dataSize);
+          opts.setOutput(output.data(), dataSize);
+          opts.setReduceOp(ReduceOp::SUM);
+          opts.setCompression(type);
+          opts.setErrorFeedback(residual.data(), residual.size());
+          opts.setMaxSegmentSize(1024);
+          allreduce(opts);
+          for (auto k = 0; k < dataSize; k++) {
+            total[k] += output[k];
+          }
+        }
+
+        // The rounding errors that are not yet compensated for are
+        // exactly the residuals of all processes.
+        AllreduceOptions opts(context);
+        opts.setOutput(residual.data(), dataSize);
+        opts.setReduceOp(ReduceOp::SUM);
+        allreduce(opts);
+        for (auto k = 0; k < dataSize; k++) {
+          ASSERT_NEAR(
+              iterations * expected[k],
+              total[k] + residual[k],
+              1e-4f * iterations * expected[299])
+              << "Mismatch at " << k << " for type "
+              << static_cast<int>(type);
+        }
+      }
+    });
+  }
+}
+
+TEST_F(AllreduceNewTest, ErrorFeedbackRequiresCompression) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    std::vector<float> output(10);
+    std::vector<float> residual(10);
+    AllreduceOptions opts(context);
+    opts.setOutput(output.data(), output.size());
+    opts.setReduceOp(ReduceOp::SUM);
+    opts.setErrorFeedback(residual.data(), residual.size());
+    ASSERT_THROW(allreduce(opts), ::gloo::EnforceNotMet);
+  });
+}
+
+TEST_F(AllreduceNewTest, CompressionOverflow) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    // The sum exceeds the largest float16 (65504).
+    std::vector<float> output(100, 40000.0f);
+    AllreduceOptions opts(context);
+    opts.setOutput(output.data(), output.size());
+    opts.setReduceOp(ReduceOp::SUM);
+    opts.setCompression(DataType::FLOAT16);
+    allreduce(opts);
+    for (const auto value : output) {
+      ASSERT_TRUE(std::isinf(value));
+    }
+  });
+}
+
+TEST_F(AllreduceNewTest, CompressionRequiresFloat32) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    std::vector<double> output(10);
+    AllreduceOptions opts(context);
+    opts.setOutput(output.data(), output.size());
+    opts.setReduceOp(ReduceOp::SUM);
+    opts.setCompression(DataType::FLOAT16);
+    ASSERT_THROW(allreduce(opts), ::gloo::EnforceNotMet);
+  });
+}
+
+TEST_F(AllreduceNewTest, CompressionRequiresRing) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    std::vector<float> output(10);
+    AllreduceOptions opts(context);
+    opts.setOutput(output.data(), output.size());
+    opts.setReduceOp(ReduceOp::SUM);
+    opts.setCompression(DataType::BFLOAT16);
+    opts.setAlgorithm(Algorithm::HALVING_DOUBLING);
+    ASSERT_THROW(allreduce(opts), ::gloo::EnforceNotMet);
+  });
+}
+
+TEST_F(AllreduceNewTest, SchedulerTimeout) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    Fixture<uint64_t> outputs(context, 1, 1);
+    AllreduceOptions opts(context);
+    opts.setOutputs(outputs.getPointers(), 1);
+    opts.setReduceFunction(getFunction<uint64_t>());
+    opts.setTimeout(std::chrono::milliseconds(10));
+    if (context->rank == 0) {
+      auto work = iallreduce(std::move(opts), ::gloo::Scheduler::getDefault());
+      try {
+        work->wait();
+        FAIL() << "Expected exception to be thrown";
+      } catch (::gloo::IoException& e) {
+        ASSERT_NE(std::string(e.what()).find("Timed out"), std::string::npos);
+      }
+    }
+  });
+}
+
 TEST_F(AllreduceNewTest, TestTimeout) {
   spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
     Fixture<uint64_t> outputs(context, 1, 1);
@@ -401,6 +1164,33 @@ TEST_F(AllreduceNewTest, TestTimeout) {
   });
 }
 
+// Concurrent schedules sleep while none of them can make progress.
+// They must still wake up and report the timeout.
+TEST_F(AllreduceNewTest, ConcurrentScheduleTimeout) {
+  // A timeout closes the pairs, so every algorithm gets new contexts.
+  for (const auto algorithm :
+       {Algorithm::RING, Algorithm::DOUBLE_BINARY_TREE}) {
+    spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+      Fixture<uint64_t> outputs(context, 1, 1000);
+      AllreduceOptions opts(context);
+      opts.setAlgorithm(algorithm);
+      opts.setRings(2);
+      opts.setOutputs(outputs.getPointers(), 1000);
+      opts.setReduceFunction(getFunction<uint64_t>());
+      opts.setTimeout(std::chrono::milliseconds(10));
+      if (context->rank == 0) {
+        try {
+          allreduce(opts);
+          FAIL() << "Expected exception to be thrown";
+        } catch (::gloo::IoException& e) {
+          ASSERT_NE(std::string(e.what()).find("Timed out"), std::string::npos)
+              << e.what();
+        }
+      }
+    });
+  }
+}
+
 } // namespace
 } // namespace test
 } // namespace gloo
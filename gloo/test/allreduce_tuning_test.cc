@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/test/base_test.h"
+
+#include "gloo/allreduce_tuning.h"
+
+namespace gloo {
+namespace test {
+namespace {
+
+using Algorithm = AllreduceOptions::Algorithm;
+
+TEST(AllreduceTuningTest, ParseTable) {
+  const auto table = AllreduceTuningTable::parse(
+      "# Comment\n"
+      "\n"
+      "size=64- bytes=0-65536 algorithm=bcube\n"
+      "hosts=2 algorithm=ring segment=4096; algorithm=halving_doubling");
+  ASSERT_EQ(3, table.rules.size());
+
+  const auto& rule = table.rules[0];
+  ASSERT_EQ(64, rule.size.min);
+  ASSERT_EQ(std::numeric_limits<size_t>::max(), rule.size.max);
+  ASSERT_EQ(0, rule.bytes.min);
+  ASSERT_EQ(65536, rule.bytes.max);
+  ASSERT_EQ(Algorithm::BCUBE, rule.algorithm);
+  ASSERT_EQ(0, rule.maxSegmentSize);
+
+  // First matching rule wins.
+  ASSERT_EQ(&table.rules[0], table.lookup(128, 2, 1024));
+  ASSERT_EQ(&table.rules[1], table.lookup(128, 2, 1 << 20));
+  ASSERT_EQ(4096, table.rules[1].maxSegmentSize);
+  ASSERT_EQ(&table.rules[2], table.lookup(8, 4, 1024));
+  ASSERT_EQ(Algorithm::HALVING_DOUBLING, table.rules[2].algorithm);
+}
+
+TEST(AllreduceTuningTest, ParseErrors) {
+  ASSERT_THROW(
+      AllreduceTuningTable::parse("size=4"), ::gloo::EnforceNotMet);
+  ASSERT_THROW(
+      AllreduceTuningTable::parse("algorithm=unknown"), ::gloo::EnforceNotMet);
+  ASSERT_THROW(
+      AllreduceTuningTable::parse("ranks=4 algorithm=ring"),
+      ::gloo::EnforceNotMet);
+  ASSERT_THROW(
+      AllreduceTuningTable::parse("size=8-4 algorithm=ring"),
+      ::gloo::EnforceNotMet);
+  ASSERT_THROW(
+      AllreduceLinkModel::parse("bandwidth=fast"), ::gloo::EnforceNotMet);
+}
+
+TEST(AllreduceTuningTest, ParseLinkModel) {
+  const auto model = AllreduceLinkModel::parse("bandwidth=25000 latency=5");
+  ASSERT_EQ(25000, model.bandwidthMbps);
+  ASSERT_EQ(5, model.latencyMicros);
+  ASSERT_EQ(AllreduceLinkModel().reduceBytesPerMicro, model.reduceBytesPerMicro);
+}
+
+TEST(AllreduceTuningTest, Select) {
+  const AllreduceLinkModel model;
+  const AllreduceTuningTable empty;
+
+  // Latency bound: fewer steps wins.
+  auto selection = selectAllreduceAlgorithm(512, 64, 4, model, empty);
+  ASSERT_EQ(Algorithm::BCUBE, selection.algorithm);
+
+  // Latency bound with a large prime factor.
+  selection = selectAllreduceAlgorithm(13, 13, 4, model, empty);
+  ASSERT_EQ(Algorithm::HALVING_DOUBLING, selection.algorithm);
+
+  // Bandwidth bound on multiple hosts: only cross hosts once.
+  selection = selectAllreduceAlgorithm(16, 2, 64 << 20, model, empty);
+  ASSERT_EQ(Algorithm::HIERARCHICAL, selection.algorithm);
+  selection = selectAllreduceAlgorithm(15, 2, 64 << 20, model, empty);
+  ASSERT_NE(Algorithm::HIERARCHICAL, selection.algorithm);
+
+  // Bandwidth bound: overlapping reduction with I/O wins.
+  selection = selectAllreduceAlgorithm(2, 2, 256 << 20, model, empty);
+  ASSERT_EQ(Algorithm::RING, selection.algorithm);
+
+  // Tuning table takes precedence.
+  const auto table =
+      AllreduceTuningTable::parse("bytes=0-1024 algorithm=ring segment=512");
+  selection = selectAllreduceAlgorithm(512, 64, 4, model, table);
+  ASSERT_EQ(Algorithm::RING, selection.algorithm);
+  ASSERT_EQ(512, selection.maxSegmentSize);
+
+  // Double binary tree is only used if selected by the tuning table.
+  selection = selectAllreduceAlgorithm(
+      256,
+      256,
+      256 << 10,
+      model,
+      AllreduceTuningTable::parse("algorithm=double_binary_tree"));
+  ASSERT_EQ(Algorithm::DOUBLE_BINARY_TREE, selection.algorithm);
+}
+
+TEST(AllreduceTuningTest, SelectSegmentSize) {
+  const AllreduceLinkModel model;
+  const AllreduceTuningTable empty;
+  const size_t maxSegmentSize = detail::AllreduceOptionsImpl::kMaxSegmentSize;
+
+  // Segments grow with the buffer size, so that the number of
+  // messages doesn't grow linearly with it.
+  const auto small = selectAllreduceAlgorithm(8, 8, 1 << 20, model, empty);
+  const auto medium = selectAllreduceAlgorithm(8, 8, 16 << 20, model, empty);
+  const auto large = selectAllreduceAlgorithm(8, 8, 1 << 30, model, empty);
+  ASSERT_LT(small.maxSegmentSize, medium.maxSegmentSize);
+  ASSERT_LT(
+      (1 << 20) / small.maxSegmentSize, (16 << 20) / medium.maxSegmentSize);
+  ASSERT_EQ(maxSegmentSize, large.maxSegmentSize);
+
+  // Lower latency favors smaller segments.
+  const auto fast = selectAllreduceAlgorithm(
+      8, 8, 16 << 20, AllreduceLinkModel::parse("latency=1"), empty);
+  ASSERT_LT(fast.maxSegmentSize, medium.maxSegmentSize);
+
+  // A segment size in the tuning table takes precedence.
+  const auto table = AllreduceTuningTable::parse("algorithm=ring segment=512");
+  const auto selection = selectAllreduceAlgorithm(8, 8, 1 << 20, model, table);
+  ASSERT_EQ(512, selection.maxSegmentSize);
+}
+
+class AllreduceTuningContextTest : public BaseTest {};
+
+TEST_F(AllreduceTuningContextTest, HostLayout) {
+  spawn(Transport::TCP, 4, [&](std::shared_ptr<Context> context) {
+    // All processes in this test run on the same host.
+    ASSERT_EQ(1, context->getNumHosts());
+    ASSERT_EQ(4, context->getLocalSize());
+    ASSERT_EQ(context->rank, context->getLocalRank());
+    for (auto i = 0; i < context->size; i++) {
+      ASSERT_EQ(0, context->getHost(i));
+    }
+  });
+}
+
+TEST_F(AllreduceTuningContextTest, SetHostLayout) {
+  spawn(Transport::TCP, 5, [&](std::shared_ptr<Context> context) {
+    // Hosts are renumbered in order of their lowest rank.
+    context->setHostLayout({7, 3, 7, 3, 5});
+    const std::vector<int> hosts = {0, 1, 0, 1, 2};
+    const std::vector<int> localRanks = {0, 0, 1, 1, 0};
+    const std::vector<int> localSizes = {2, 2, 2, 2, 1};
+    ASSERT_EQ(3, context->getNumHosts());
+    ASSERT_EQ(localRanks[context->rank], context->getLocalRank());
+    ASSERT_EQ(localSizes[context->rank], context->getLocalSize());
+    for (auto i = 0; i < context->size; i++) {
+      ASSERT_EQ(hosts[i], context->getHost(i));
+    }
+  });
+}
+
+} // namespace
+} // namespace test
+} // namespace gloo
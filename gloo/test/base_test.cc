@@ -36,6 +36,18 @@ std::shared_ptr<::gloo::transport::Device> createDevice(Transport transport) {
     return ::gloo::transport::uv::CreateDevice(kDefaultDevice);
 #endif
   }
+#endif
+#if GLOO_HAVE_TRANSPORT_IBVERBS
+  if (transport == Transport::IBVERBS) {
+    // Use the first device, if there is any.
+    if (::gloo::transport::ibverbs::getDeviceNames().empty()) {
+      return nullptr;
+    }
+    ::gloo::transport::ibverbs::attr attr;
+    attr.port = 1;
+    attr.index = 0;
+    return ::gloo::transport::ibverbs::CreateDevice(attr);
+  }
 #endif
   return nullptr;
 }
@@ -32,6 +32,10 @@
 #include "gloo/transport/uv/device.h"
 #endif
 
+#if GLOO_HAVE_TRANSPORT_IBVERBS
+#include "gloo/transport/ibverbs/device.h"
+#endif
+
 namespace gloo {
 namespace test {
 
@@ -62,6 +66,9 @@ enum Transport {
   TCP_TLS,
 #endif
   UV,
+#if GLOO_HAVE_TRANSPORT_IBVERBS
+  IBVERBS,
+#endif
 };
 
 // Transports that instantiated algorithms can be tested against.
@@ -75,14 +82,21 @@ const std::vector<Transport> kTransportsForClassAlgorithms{
 // Transports that function algorithms can be tested against.
 // This is the new style of calling collectives and must be
 // preferred over the instantiated style.
+//
+// Tests against the ibverbs transport are skipped if this machine has
+// no ibverbs device (see createDevice).
 const std::vector<Transport> kTransportsForFunctionAlgorithms{
     Transport::TCP,
 #if GLOO_HAVE_TRANSPORT_TCP_TLS
     Transport::TCP_TLS,
 #endif
     Transport::UV,
+#if GLOO_HAVE_TRANSPORT_IBVERBS
+    Transport::IBVERBS,
+#endif
 };
 
+// Returns null if the transport is not available.
 std::shared_ptr<::gloo::transport::Device> createDevice(Transport transport);
 
 class BaseTest : public ::testing::Test {
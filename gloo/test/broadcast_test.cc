@@ -175,6 +175,142 @@ INSTANTIATE_TEST_CASE_P(
         ::testing::Values(false, true),
         ::testing::Values(false, true)));
 
+TEST_F(BroadcastNewTest, Plan) {
+  const auto dataSize = 100;
+
+  spawn(Transport::TCP, 5, [&](std::shared_ptr<Context> context) {
+    auto output = Fixture<uint64_t>(context, 1, dataSize);
+
+    // Take turns being root
+    for (auto root = 0; root < context->size; root++) {
+      BroadcastOptions opts(context);
+      opts.setRoot(root);
+      opts.setOutput(output.getPointer(), dataSize);
+      BroadcastPlan plan(std::move(opts));
+
+      for (auto i = 0; i < 3; i++) {
+        output.clear();
+        if (context->rank == root) {
+          output.assignValues();
+        }
+
+        plan.execute();
+
+        // Validate output
+        const auto ptr = output.getPointer();
+        const auto stride = context->size;
+        for (auto k = 0; k < dataSize; k++) {
+          ASSERT_EQ(root + k * stride, ptr[k]) << "Mismatch at index " << k;
+        }
+      }
+    }
+  });
+}
+
+using AlgorithmParam =
+    std::tuple<Transport, int, int, bool, BroadcastOptions::Algorithm>;
+
+class BroadcastAlgorithmTest
+    : public BaseTest,
+      public ::testing::WithParamInterface<AlgorithmParam> {};
+
+TEST_P(BroadcastAlgorithmTest, Default) {
+  const auto transport = std::get<0>(GetParam());
+  const auto contextSize = std::get<1>(GetParam());
+  const auto dataSize = std::get<2>(GetParam());
+  const auto inPlace = std::get<3>(GetParam());
+  const auto algorithm = std::get<4>(GetParam());
+
+  spawn(transport, contextSize, [&](std::shared_ptr<Context> context) {
+    auto input = Fixture<uint64_t>(context, 1, dataSize);
+    auto output = Fixture<uint64_t>(context, 1, dataSize);
+
+    // Take turns being root
+    for (auto root = 0; root < context->size; root++) {
+      BroadcastOptions opts(context);
+      opts.setRoot(root);
+      opts.setAlgorithm(algorithm);
+
+      input.clear();
+      output.clear();
+
+      if (context->rank == root) {
+        if (inPlace) {
+          output.assignValues();
+        } else {
+          input.assignValues();
+          opts.setInput(input.getPointer(), dataSize);
+        }
+      }
+      opts.setOutput(output.getPointer(), dataSize);
+
+      broadcast(opts);
+
+      // Validate output
+      const auto ptr = output.getPointer();
+      const auto stride = context->size;
+      for (auto k = 0; k < dataSize; k++) {
+        ASSERT_EQ(root + k * stride, ptr[k]) << "Mismatch at index " << k;
+      }
+    }
+  });
+}
+
+INSTANTIATE_TEST_CASE_P(
+    BroadcastAlgorithm,
+    BroadcastAlgorithmTest,
+    ::testing::Combine(
+        ::testing::ValuesIn(kTransportsForFunctionAlgorithms),
+        ::testing::Values(1, 2, 3, 5),
+        ::testing::Values(1, 4, 1000, 100000),
+        ::testing::Values(false, true),
+        ::testing::Values(
+            BroadcastOptions::BINOMIAL,
+            BroadcastOptions::SCATTER_ALLGATHER)));
+
+TEST_F(BroadcastAlgorithmTest, Plan) {
+  const auto dataSize = 1000;
+
+  spawn(Transport::TCP, 4, [&](std::shared_ptr<Context> context) {
+    auto output = Fixture<uint64_t>(context, 1, dataSize);
+    BroadcastOptions opts(context);
+    opts.setRoot(1);
+    opts.setAlgorithm(BroadcastOptions::SCATTER_ALLGATHER);
+    opts.setOutput(output.getPointer(), dataSize);
+    BroadcastPlan plan(std::move(opts));
+
+    for (auto i = 0; i < 3; i++) {
+      output.clear();
+      if (context->rank == 1) {
+        output.assignValues();
+      }
+
+      plan.execute();
+
+      // Validate output
+      const auto ptr = output.getPointer();
+      const auto stride = context->size;
+      for (auto k = 0; k < dataSize; k++) {
+        ASSERT_EQ(1 + k * stride, ptr[k]) << "Mismatch at index " << k;
+      }
+    }
+  });
+}
+
+TEST(BroadcastSelectionTest, Default) {
+  // Two processes: both algorithms send the buffer once, but
+  // scatter/allgather takes two messages.
+  ASSERT_EQ(BroadcastOptions::BINOMIAL, selectBroadcastAlgorithm(2, 1 << 30));
+
+  // Small buffers are dominated by the cost per message.
+  ASSERT_EQ(BroadcastOptions::BINOMIAL, selectBroadcastAlgorithm(8, 1024));
+
+  // Large buffers are dominated by the bandwidth.
+  ASSERT_EQ(
+      BroadcastOptions::SCATTER_ALLGATHER,
+      selectBroadcastAlgorithm(8, 64 << 20));
+}
+
 TEST_F(BroadcastTest, TestTimeout) {
   spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
     Fixture<uint64_t> output(context, 1, 1);
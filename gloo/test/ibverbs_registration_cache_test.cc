@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "gloo/common/logging.h"
+#include "gloo/transport/ibverbs/registration_cache.h"
+
+namespace gloo {
+namespace test {
+namespace {
+
+using ::gloo::transport::ibverbs::RegistrationCache;
+
+// Registration cache that doesn't call into ibverbs, so that it can be
+// tested without a device. It keeps track of the number of live
+// registrations.
+class FakeRegistrationCache : public RegistrationCache {
+ public:
+  explicit FakeRegistrationCache(size_t capacity)
+      : RegistrationCache(nullptr, capacity) {}
+
+  int registered = 0;
+
+ protected:
+  Registration registerMemory(void* ptr, size_t size) override {
+    auto mr = new struct ibv_mr();
+    mr->addr = ptr;
+    mr->length = size;
+    registered++;
+    return Registration(mr, [this](struct ibv_mr* mr) {
+      registered--;
+      delete mr;
+    });
+  }
+};
+
+TEST(RegistrationCacheTest, Lookup) {
+  std::vector<char> buffer(1024);
+  FakeRegistrationCache cache(4);
+  auto mr = cache.lookup(buffer.data(), buffer.size());
+  ASSERT_EQ(buffer.data(), mr->addr);
+  ASSERT_EQ(1, cache.misses());
+
+  // Same range and a sub range are served from the cache.
+  ASSERT_EQ(mr, cache.lookup(buffer.data(), buffer.size()));
+  ASSERT_EQ(mr, cache.lookup(buffer.data() + 10, 100));
+  ASSERT_EQ(2, cache.hits());
+  ASSERT_EQ(1, cache.registered);
+
+  // A larger range with the same start address replaces it.
+  auto larger = cache.lookup(buffer.data(), buffer.size() + 1);
+  ASSERT_NE(mr, larger);
+  ASSERT_EQ(1, cache.size());
+}
+
+TEST(RegistrationCacheTest, EvictLeastRecentlyUsed) {
+  std::vector<char> buffer(1024);
+  FakeRegistrationCache cache(2);
+  cache.lookup(buffer.data(), 10);
+  cache.lookup(buffer.data() + 100, 10);
+
+  // Use the first one again, so that the second one is evicted.
+  cache.lookup(buffer.data(), 10);
+  cache.lookup(buffer.data() + 200, 10);
+  ASSERT_EQ(2, cache.size());
+  ASSERT_EQ(2, cache.registered);
+
+  cache.lookup(buffer.data(), 10);
+  ASSERT_EQ(2, cache.hits());
+  cache.lookup(buffer.data() + 100, 10);
+  ASSERT_EQ(4, cache.misses());
+}
+
+TEST(RegistrationCacheTest, EvictedRegistrationOutlivesCache) {
+  std::vector<char> buffer(1024);
+  FakeRegistrationCache cache(1);
+  auto mr = cache.lookup(buffer.data(), 10);
+  cache.lookup(buffer.data() + 100, 10);
+  ASSERT_EQ(1, cache.size());
+
+  // The evicted registration is released by its last user.
+  ASSERT_EQ(2, cache.registered);
+  ASSERT_EQ(buffer.data(), mr->addr);
+  mr.reset();
+  ASSERT_EQ(1, cache.registered);
+}
+
+TEST(RegistrationCacheTest, Invalidate) {
+  std::vector<char> buffer(1024);
+  FakeRegistrationCache cache(4);
+  auto mr = cache.lookup(buffer.data(), 100);
+  cache.lookup(buffer.data() + 200, 100);
+  cache.lookup(buffer.data() + 400, 100);
+
+  // Invalidate ranges that overlap with the first two.
+  cache.invalidate(buffer.data() + 50, 200);
+  ASSERT_EQ(1, cache.size());
+  ASSERT_EQ(2, cache.registered);
+
+  // Memory at the same address now gets a new registration.
+  auto other = cache.lookup(buffer.data(), 100);
+  ASSERT_NE(mr, other);
+  ASSERT_EQ(4, cache.misses());
+}
+
+TEST(RegistrationCacheTest, Pin) {
+  std::vector<char> buffer(4096);
+  FakeRegistrationCache cache(1);
+  cache.pin(buffer.data(), 1024);
+  auto mr = cache.lookup(buffer.data() + 100, 100);
+
+  // Pinned registrations are neither invalidated nor evicted.
+  cache.invalidate(buffer.data() + 100, 100);
+  auto other = cache.lookup(buffer.data() + 2000, 10);
+  ASSERT_EQ(2, cache.size());
+  ASSERT_EQ(mr, cache.lookup(buffer.data(), 1024));
+  ASSERT_EQ(2, cache.hits());
+
+  // Nested pins keep the registration until the last one is undone.
+  cache.pin(buffer.data(), 1024);
+  cache.unpin(buffer.data(), 1024);
+  ASSERT_EQ(mr, cache.lookup(buffer.data(), 1024));
+  cache.unpin(buffer.data(), 1024);
+  ASSERT_NE(mr, cache.lookup(buffer.data(), 1024));
+  ASSERT_THROW(cache.unpin(buffer.data(), 10), ::gloo::EnforceNotMet);
+}
+
+TEST(RegistrationCacheTest, PinLargerRange) {
+  std::vector<char> buffer(1024);
+  FakeRegistrationCache cache(4);
+  cache.pin(buffer.data(), 100);
+
+  // A larger registration with the same start address inherits the pin.
+  auto mr = cache.lookup(buffer.data(), 200);
+  cache.invalidate(buffer.data(), 10);
+  ASSERT_EQ(mr, cache.lookup(buffer.data(), 200));
+  cache.unpin(buffer.data(), 100);
+  ASSERT_EQ(0, cache.size());
+  mr.reset();
+  ASSERT_EQ(0, cache.registered);
+}
+
+} // namespace
+} // namespace test
+} // namespace gloo
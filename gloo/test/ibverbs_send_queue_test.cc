@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "gloo/transport/ibverbs/send_queue.h"
+
+namespace gloo {
+namespace test {
+namespace {
+
+using ::gloo::transport::ibverbs::SendQueue;
+
+// Records the work requests that would have been posted to the queue
+// pair, along with the scatter/gather element they refer to.
+struct Posted {
+  uint64_t wr_id;
+  uint64_t addr;
+  uint32_t length;
+};
+
+class SendQueueTest : public ::testing::Test {
+ protected:
+  SendQueue::PostFunction recorder() {
+    return [this](struct ibv_send_wr* wr) {
+      EXPECT_EQ(wr->next, nullptr);
+      Posted p;
+      p.wr_id = wr->wr_id;
+      p.addr = wr->num_sge > 0 ? wr->sg_list->addr : 0;
+      p.length = wr->num_sge > 0 ? wr->sg_list->length : 0;
+      posted.push_back(p);
+      return rv;
+    };
+  }
+
+  // Posts work request with a scatter/gather element that goes out of
+  // scope when this function returns.
+  int post(SendQueue& queue, uint64_t id) {
+    struct ibv_sge sge;
+    memset(&sge, 0, sizeof(sge));
+    sge.addr = 1000 + id;
+    sge.length = id;
+    struct ibv_send_wr wr;
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = id;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    return queue.post(&wr);
+  }
+
+  std::vector<Posted> posted;
+  int rv = 0;
+};
+
+TEST_F(SendQueueTest, PostWithinCapacity) {
+  SendQueue queue(4, recorder());
+  for (uint64_t i = 0; i < 4; i++) {
+    ASSERT_EQ(post(queue, i), 0);
+  }
+  ASSERT_EQ(posted.size(), 4);
+  ASSERT_EQ(queue.posted(), 4);
+  ASSERT_EQ(queue.queued(), 0);
+}
+
+TEST_F(SendQueueTest, OverflowIsPostedInOrderOnCompletion) {
+  SendQueue queue(2, recorder());
+  for (uint64_t i = 0; i < 5; i++) {
+    ASSERT_EQ(post(queue, i), 0);
+  }
+  ASSERT_EQ(posted.size(), 2);
+  ASSERT_EQ(queue.posted(), 2);
+  ASSERT_EQ(queue.queued(), 3);
+
+  // Every completion makes room for exactly one queued work request.
+  for (uint64_t i = 2; i < 5; i++) {
+    ASSERT_EQ(queue.complete(), 0);
+    ASSERT_EQ(posted.size(), i + 1);
+    ASSERT_EQ(queue.posted(), 2);
+  }
+  ASSERT_EQ(queue.queued(), 0);
+
+  // Queued work requests carry a copy of their scatter/gather element.
+  for (uint64_t i = 0; i < posted.size(); i++) {
+    ASSERT_EQ(posted[i].wr_id, i);
+    ASSERT_EQ(posted[i].addr, 1000 + i);
+    ASSERT_EQ(posted[i].length, i);
+  }
+
+  ASSERT_EQ(queue.complete(), 0);
+  ASSERT_EQ(queue.complete(), 0);
+  ASSERT_EQ(queue.posted(), 0);
+  ASSERT_EQ(posted.size(), 5);
+}
+
+TEST_F(SendQueueTest, PostFailure) {
+  SendQueue queue(1, recorder());
+  ASSERT_EQ(post(queue, 0), 0);
+  ASSERT_EQ(post(queue, 1), 0);
+  ASSERT_EQ(queue.queued(), 1);
+
+  // A failure to post a queued work request is reported on completion.
+  rv = EINVAL;
+  ASSERT_EQ(queue.complete(), EINVAL);
+  ASSERT_EQ(queue.posted(), 0);
+  ASSERT_EQ(queue.queued(), 0);
+
+  // A failure to post directly is reported to the caller.
+  ASSERT_EQ(post(queue, 2), EINVAL);
+  ASSERT_EQ(queue.posted(), 0);
+}
+
+} // namespace
+} // namespace test
+} // namespace gloo
@@ -12,6 +12,7 @@
 
 #include "gloo/common/linux.h"
 #include "gloo/common/linux_devices.h"
+#include "gloo/common/numa.h"
 #include "gloo/test/base_test.h"
 
 namespace gloo {
@@ -45,6 +46,41 @@ TEST_F(LinuxTest, PCIDistance) {
   }
 }
 
+TEST_F(LinuxTest, PCINumaNode) {
+  for (const auto& nic : pciDevices(kPCIClassNetwork)) {
+    auto node = pciNumaNode(nic);
+    ASSERT_GE(node, -1);
+    if (node >= 0) {
+      ASSERT_FALSE(numaNodeCpus(node).empty());
+    }
+  }
+  ASSERT_EQ(-1, pciNumaNode(""));
+  ASSERT_TRUE(numaNodeCpus(-1).empty());
+}
+
+TEST_F(LinuxTest, ThreadAffinity) {
+  // Node 0 exists on every machine that exposes NUMA topology.
+  auto cpus = numaNodeCpus(0);
+  if (cpus.empty()) {
+    return;
+  }
+  std::thread thread([] {});
+  ASSERT_TRUE(setThreadAffinity(thread, cpus));
+  thread.join();
+}
+
+TEST_F(LinuxTest, AllocateOnNumaNode) {
+  for (auto size : {size_t(16), kNumaMinAllocationSize * 4}) {
+    for (auto node : {-1, 0}) {
+      auto buffer = allocateOnNumaNode(size, node);
+      ASSERT_NE(nullptr, buffer.get());
+      ASSERT_EQ(0, reinterpret_cast<uintptr_t>(buffer.get()) % kCacheLineSize);
+      memset(buffer.get(), node, size);
+      ASSERT_EQ(uint8_t(node), buffer[size - 1]);
+    }
+  }
+}
+
 } // namespace
 } // namespace test
 } // namespace gloo
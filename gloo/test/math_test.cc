@@ -9,6 +9,8 @@
 #include "gloo/test/base_test.h"
 
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 #include "gloo/math.h"
@@ -29,7 +31,8 @@ using MathTestTypes = ::testing::Types<
     uint64_t,
     float,
     double,
-    float16>;
+    float16,
+    bfloat16>;
 
 TYPED_TEST_CASE(MathTest, MathTestTypes);
 
@@ -140,6 +143,75 @@ TYPED_TEST(MathTest, Max) {
   }
 };
 
+// The N-ary functions work on blocks of the output, so use enough
+// elements for multiple blocks and a partial final block.
+TYPED_TEST(MathTest, Nary) {
+  const size_t n = 3 * gloo::detail::kReduceBlockBytes / sizeof(TypeParam) + 7;
+  for (size_t k = 1; k <= 6; k++) {
+    for (const auto inPlace : {false, true}) {
+      // Input i holds 1, except for element i which holds 2.
+      std::vector<std::vector<TypeParam>> inputs(k);
+      std::vector<const TypeParam*> ptrs(k);
+      for (size_t i = 0; i < k; i++) {
+        inputs[i].assign(n, TypeParam(1));
+        inputs[i][i] = TypeParam(2);
+        ptrs[i] = inputs[i].data();
+      }
+
+      std::vector<TypeParam> sum(n), product(n), max(n), min(n);
+      auto output = [&](std::vector<TypeParam>& out) {
+        if (!inPlace) {
+          return out.data();
+        }
+        out = inputs[0];
+        ptrs[0] = out.data();
+        return out.data();
+      };
+      gloo::sum<TypeParam>(output(sum), ptrs.data(), k, n);
+      gloo::product<TypeParam>(output(product), ptrs.data(), k, n);
+      gloo::max<TypeParam>(output(max), ptrs.data(), k, n);
+      gloo::min<TypeParam>(output(min), ptrs.data(), k, n);
+
+      for (size_t j = 0; j < n; j++) {
+        const auto special = j < k;
+        ASSERT_EQ(sum[j], special ? k + 1 : k) << "k=" << k << " j=" << j;
+        ASSERT_EQ(product[j], special ? 2 : 1) << "k=" << k << " j=" << j;
+        ASSERT_EQ(max[j], special ? 2 : 1) << "k=" << k << " j=" << j;
+        ASSERT_EQ(min[j], special && k == 1 ? 2 : 1)
+            << "k=" << k << " j=" << j;
+      }
+    }
+  }
+}
+
+float bitsToFloat(uint32_t bits) {
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+TEST(BFloat16Test, Conversion) {
+  // Exactly representable values.
+  for (const float f : {0.0f, -1.0f, 3.0f, 0.5f, 256.0f, -1e30f}) {
+    const auto bf = cpu_float2bfloat16_rn(f);
+    if (f != -1e30f) {
+      ASSERT_EQ(f, cpu_bfloat162float(bf));
+    }
+    ASSERT_EQ(cpu_bfloat162float(bf), cpu_bfloat162float(bfloat16(f)));
+  }
+
+  // Round to nearest, ties to even.
+  ASSERT_EQ(0x3f80, cpu_float2bfloat16_rn(bitsToFloat(0x3f808000)).x);
+  ASSERT_EQ(0x3f82, cpu_float2bfloat16_rn(bitsToFloat(0x3f818000)).x);
+  ASSERT_EQ(0x3f81, cpu_float2bfloat16_rn(bitsToFloat(0x3f808001)).x);
+
+  // Overflow to infinity, and NaN stays NaN.
+  ASSERT_EQ(0x7f80, cpu_float2bfloat16_rn(bitsToFloat(0x7f7fffff)).x);
+  ASSERT_EQ(0xff80, cpu_float2bfloat16_rn(bitsToFloat(0xff800000)).x);
+  const auto nan = cpu_float2bfloat16_rn(bitsToFloat(0x7f800001));
+  ASSERT_TRUE(std::isnan(cpu_bfloat162float(nan)));
+}
+
 template <typename TypeParam>
 void perf(void (*fn)(void* c, const void* a, const void* b, size_t n)) {
   std::array<TypeParam, 1000> a, b, c;
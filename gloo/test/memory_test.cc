@@ -8,8 +8,12 @@
 
 #include "gloo/test/base_test.h"
 
+#include <atomic>
 #include <fstream>
 #include <sstream>
+#include <thread>
+
+#include "gloo/common/memory.h"
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -92,6 +96,49 @@ TEST_P(MemoryTest, ManySlotsNoLeaks) {
   });
 }
 
+TEST(NonOwningPtrTest, ExpiresOnDestruction) {
+  int value = 0;
+  WeakNonOwningPtr<int> weak;
+  ASSERT_FALSE(weak);
+  {
+    ShareableNonOwningPtr<int> root(&value);
+    weak = WeakNonOwningPtr<int>(root);
+    ASSERT_TRUE(weak);
+    NonOwningPtr<int> ptr(weak);
+    ASSERT_TRUE(ptr);
+    ASSERT_EQ(&value, ptr.operator->());
+  }
+
+  // Weak reference stays initialized, but can no longer be upgraded,
+  // not even after its slot was recycled.
+  ASSERT_TRUE(weak);
+  ASSERT_FALSE(NonOwningPtr<int>(weak));
+  ShareableNonOwningPtr<int> other(&value);
+  ASSERT_FALSE(NonOwningPtr<int>(weak));
+  ASSERT_TRUE(NonOwningPtr<int>(WeakNonOwningPtr<int>(other)));
+}
+
+TEST(NonOwningPtrTest, DestructionWaitsForReferences) {
+  int value = 0;
+  std::atomic<bool> released(false);
+  std::unique_ptr<ShareableNonOwningPtr<int>> root(
+      new ShareableNonOwningPtr<int>(&value));
+  NonOwningPtr<int> ptr((WeakNonOwningPtr<int>(*root)));
+  auto copy = ptr;
+
+  std::thread thread([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    released = true;
+    ptr = NonOwningPtr<int>();
+    copy = NonOwningPtr<int>();
+  });
+
+  // Blocks until the thread has released both references.
+  root.reset();
+  ASSERT_TRUE(released);
+  thread.join();
+}
+
 INSTANTIATE_TEST_CASE_P(
     MemoryTestDefault,
     MemoryTest,
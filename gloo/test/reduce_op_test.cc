@@ -0,0 +1,301 @@
+/**
+ * Copyright (c) 2018-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+#include "gloo/common/logging.h"
+#include "gloo/math.h"
+#include "gloo/reduce_op.h"
+
+namespace gloo {
+namespace test {
+namespace {
+
+using BinaryFunction = void (*)(void*, const void*, const void*, size_t);
+
+TEST(ReduceOpTest, DataType) {
+  ASSERT_EQ(DataType::INT8, getDataType<int8_t>());
+  ASSERT_EQ(DataType::UINT64, getDataType<uint64_t>());
+  ASSERT_EQ(DataType::FLOAT16, getDataType<float16>());
+  ASSERT_EQ(DataType::FLOAT32, getDataType<float>());
+  ASSERT_EQ(DataType::BFLOAT16, getDataType<bfloat16>());
+  ASSERT_EQ(DataType::UNSPECIFIED, getDataType<char>());
+  ASSERT_EQ(2, getDataTypeSize(DataType::FLOAT16));
+  ASSERT_EQ(2, getDataTypeSize(DataType::BFLOAT16));
+  ASSERT_EQ(8, getDataTypeSize(DataType::FLOAT64));
+}
+
+TEST(ReduceOpTest, GetKernels) {
+  const auto sumFloat =
+      getReduceKernels(ReduceOp::SUM, DataType::FLOAT32, SimdIsa::SCALAR);
+  ASSERT_EQ(static_cast<BinaryFunction>(&sum<float>), sumFloat.binary);
+  ASSERT_NE(nullptr, sumFloat.nary);
+
+  const auto maxInt = getReduceKernels(ReduceOp::MAX, DataType::INT32);
+  ASSERT_NE(nullptr, maxInt.binary);
+
+  std::vector<int32_t> a = {1, 5, 3};
+  std::vector<int32_t> b = {4, 2, 6};
+  std::vector<int32_t> c = {0, 7, 0};
+  std::vector<int32_t> out(3);
+  const void* ins[] = {a.data(), b.data(), c.data()};
+  maxInt.nary(out.data(), ins, 3, 3);
+  ASSERT_EQ(std::vector<int32_t>({4, 7, 6}), out);
+}
+
+TEST(ReduceOpTest, FindKernels) {
+  BinaryFunction fn = &product<double>;
+  const auto kernels = findReduceKernels(fn);
+  const auto expected = getReduceKernels(ReduceOp::PRODUCT, DataType::FLOAT64);
+  ASSERT_EQ(expected.binary, kernels.binary);
+  ASSERT_EQ(expected.nary, kernels.nary);
+
+  // Custom functions don't have kernels.
+  const auto custom = findReduceKernels(
+      [](void* c, const void* a, const void* b, size_t n) {});
+  ASSERT_EQ(nullptr, custom.binary);
+  ASSERT_EQ(nullptr, custom.nary);
+}
+
+template <typename T>
+std::vector<T> generateInput(size_t n, size_t seed) {
+  // Small integers, so that every result is exact in every type.
+  std::vector<T> result(n);
+  for (size_t i = 0; i < n; i++) {
+    result[i] = T(int((i * 7 + seed * 13) % 5) - 2);
+  }
+  return result;
+}
+
+// Compares the kernels for every supported instruction set against the
+// scalar kernels. The number of elements is not a multiple of any
+// vector width and spans multiple blocks of the N-ary kernels.
+template <typename T>
+void testSimdKernels(DataType type) {
+  const size_t n = 3001;
+  for (const auto op :
+       {ReduceOp::SUM, ReduceOp::PRODUCT, ReduceOp::MIN, ReduceOp::MAX}) {
+    const auto scalar = getReduceKernels(op, type, SimdIsa::SCALAR);
+    for (auto i = 1; i <= static_cast<int>(getSimdIsa()); i++) {
+      const auto isa = static_cast<SimdIsa>(i);
+      const auto kernels = getReduceKernels(op, type, isa);
+      const auto a = generateInput<T>(n, 1);
+      const auto b = generateInput<T>(n, 2);
+      std::vector<T> expected(n);
+      std::vector<T> actual(n);
+      scalar.binary(expected.data(), a.data(), b.data(), n);
+      kernels.binary(actual.data(), a.data(), b.data(), n);
+      ASSERT_EQ(expected, actual) << getSimdIsaName(isa);
+
+      // More inputs than the N-ary kernels accumulate in registers.
+      for (const size_t k : {1, 2, 3, 8, 11}) {
+        std::vector<std::vector<T>> inputs;
+        std::vector<const void*> ptrs;
+        for (size_t j = 0; j < k; j++) {
+          inputs.push_back(generateInput<T>(n, j));
+        }
+        for (auto& input : inputs) {
+          ptrs.push_back(input.data());
+        }
+        std::vector<T> expected(n);
+        std::vector<T> actual(n);
+        scalar.nary(expected.data(), ptrs.data(), k, n);
+        kernels.nary(actual.data(), ptrs.data(), k, n);
+        ASSERT_EQ(expected, actual) << getSimdIsaName(isa) << " k=" << k;
+      }
+    }
+  }
+}
+
+// Compares the averaging kernels for every supported instruction set
+// against the scalar ones. A factor that is a power of two keeps the
+// results exact, even in half precision.
+template <typename T>
+void testSimdAverage(DataType type) {
+  const size_t n = 3001;
+  const double factor = 0.25;
+  const auto scalar = getReduceKernels(ReduceOp::AVG, type, SimdIsa::SCALAR);
+  ASSERT_NE(nullptr, scalar.scaledNary);
+  for (auto i = 1; i <= static_cast<int>(getSimdIsa()); i++) {
+    const auto isa = static_cast<SimdIsa>(i);
+    const auto kernels = getReduceKernels(ReduceOp::AVG, type, isa);
+    ASSERT_NE(nullptr, kernels.scaledNary);
+    for (const size_t k : {1, 3, 11}) {
+      std::vector<std::vector<T>> inputs;
+      std::vector<const void*> ptrs;
+      for (size_t j = 0; j < k; j++) {
+        inputs.push_back(generateInput<T>(n, j));
+      }
+      for (auto& input : inputs) {
+        ptrs.push_back(input.data());
+      }
+      std::vector<T> expected(n);
+      std::vector<T> actual(n);
+      scalar.scaledNary(expected.data(), ptrs.data(), k, n, factor);
+      kernels.scaledNary(actual.data(), ptrs.data(), k, n, factor);
+      ASSERT_EQ(expected, actual) << getSimdIsaName(isa) << " k=" << k;
+
+      // In place, where the output is the first input.
+      ptrs[0] = inputs[0].data();
+      kernels.scaledNary(inputs[0].data(), ptrs.data(), k, n, factor);
+      ASSERT_EQ(expected, inputs[0]) << getSimdIsaName(isa) << " k=" << k;
+    }
+  }
+}
+
+TEST(ReduceOpTest, Average) {
+  const auto kernels = getReduceKernels(ReduceOp::AVG, DataType::FLOAT32);
+  ASSERT_EQ(
+      getReduceKernels(ReduceOp::SUM, DataType::FLOAT32).binary,
+      kernels.binary);
+  ASSERT_EQ(
+      nullptr, getReduceKernels(ReduceOp::SUM, DataType::FLOAT32).scaledNary);
+
+  std::vector<float> a = {1, 2, 3};
+  std::vector<float> b = {3, 4, 5};
+  std::vector<float> out(3);
+  const void* ins[] = {a.data(), b.data()};
+  kernels.scaledNary(out.data(), ins, 2, 3, 0.5);
+  ASSERT_EQ(std::vector<float>({2, 3, 4}), out);
+
+  // Not supported for integers.
+  ASSERT_THROW(
+      getReduceKernels(ReduceOp::AVG, DataType::INT32),
+      ::gloo::EnforceNotMet);
+
+  testSimdAverage<float>(DataType::FLOAT32);
+  testSimdAverage<double>(DataType::FLOAT64);
+  testSimdAverage<float16>(DataType::FLOAT16);
+  testSimdAverage<bfloat16>(DataType::BFLOAT16);
+}
+
+// Compares the compression kernels for every supported instruction set
+// against the scalar kernels, with and without error feedback. The
+// inputs need rounding in the narrower format, and some overflow
+// float16. The number of elements ends with a partial int8 block.
+void testSimdCompressed(DataType type) {
+  const size_t n = 3001;
+  std::vector<float> a(n);
+  std::vector<float> b(n);
+  std::vector<float> r(n);
+  for (size_t i = 0; i < n; i++) {
+    a[i] = (float(i) - 1500) * 0.37f;
+    b[i] = (i % 100 == 0) ? 40000.0f : float(i % 17) / 3;
+    r[i] = float(i % 5) / 7;
+  }
+  for (const auto op : {ReduceOp::SUM, ReduceOp::MAX}) {
+    for (const auto feedback : {false, true}) {
+      const auto scalar =
+          getCompressedReduceKernels(op, type, SimdIsa::SCALAR);
+      const size_t bytes = scalar.getCompressedSize(n);
+      std::vector<uint8_t> wire(bytes);
+      std::vector<float> expected(a);
+      std::vector<uint8_t> expectedCopy(bytes);
+      std::vector<float> expectedResidual(r);
+      float* residual = feedback ? expectedResidual.data() : nullptr;
+      scalar.compress(wire.data(), b.data(), residual, n);
+      scalar.reduce(
+          expected.data(), expectedCopy.data(), wire.data(), residual, n);
+      std::vector<float> decompressed(n);
+      scalar.decompress(decompressed.data(), expectedCopy.data(), n);
+      ASSERT_EQ(expected, decompressed);
+
+      for (auto i = 1; i <= static_cast<int>(getSimdIsa()); i++) {
+        const auto isa = static_cast<SimdIsa>(i);
+        const auto kernels = getCompressedReduceKernels(op, type, isa);
+        ASSERT_EQ(bytes, kernels.getCompressedSize(n));
+        std::vector<uint8_t> actualWire(bytes);
+        std::vector<float> actual(a);
+        std::vector<uint8_t> actualCopy(bytes);
+        std::vector<float> actualResidual(r);
+        residual = feedback ? actualResidual.data() : nullptr;
+        kernels.compress(actualWire.data(), b.data(), residual, n);
+        ASSERT_EQ(wire, actualWire) << getSimdIsaName(isa);
+        kernels.reduce(
+            actual.data(), actualCopy.data(), actualWire.data(), residual, n);
+        ASSERT_EQ(expectedCopy, actualCopy) << getSimdIsaName(isa);
+        ASSERT_EQ(expected, actual) << getSimdIsaName(isa);
+        ASSERT_EQ(expectedResidual, actualResidual) << getSimdIsaName(isa);
+        kernels.decompress(decompressed.data(), actualCopy.data(), n);
+        ASSERT_EQ(expected, decompressed) << getSimdIsaName(isa);
+      }
+    }
+  }
+}
+
+TEST(ReduceOpTest, Compressed) {
+  testSimdCompressed(DataType::FLOAT16);
+  testSimdCompressed(DataType::BFLOAT16);
+  testSimdCompressed(DataType::INT8);
+
+  // Data is only compressed to float16, bfloat16, or int8.
+  ASSERT_THROW(
+      getCompressedReduceKernels(ReduceOp::SUM, DataType::FLOAT64),
+      ::gloo::EnforceNotMet);
+}
+
+TEST(ReduceOpTest, Quantized) {
+  const auto kernels =
+      getCompressedReduceKernels(ReduceOp::SUM, DataType::INT8);
+  const size_t n = kQuantizationBlockSize + 2;
+  ASSERT_EQ(2 * sizeof(float) + n, kernels.getCompressedSize(n));
+
+  // The largest absolute value in a block maps to 127. The second
+  // block is all zeros.
+  std::vector<float> in(n, 1.0f);
+  in[0] = -127.0f;
+  in[1] = 0.4f;
+  in[2] = 0.6f;
+  std::vector<uint8_t> wire(kernels.getCompressedSize(n));
+  std::vector<float> residual(n, 0.0f);
+  kernels.compress(wire.data(), in.data(), residual.data(), 3);
+  kernels.compress(
+      wire.data() + sizeof(float) + kQuantizationBlockSize,
+      std::vector<float>(2, 0.0f).data(),
+      nullptr,
+      2);
+  std::vector<float> out(n);
+  kernels.decompress(out.data(), wire.data(), n);
+  ASSERT_EQ(-127.0f, out[0]);
+  ASSERT_EQ(0.0f, out[1]);
+  ASSERT_EQ(1.0f, out[2]);
+  ASSERT_EQ(0.0f, out[n - 1]);
+
+  // The rounding error is kept in the residual, and added to the input
+  // of the next compression.
+  ASSERT_FLOAT_EQ(0.4f, residual[1]);
+  ASSERT_FLOAT_EQ(-0.4f, residual[2]);
+  kernels.compress(wire.data(), in.data(), residual.data(), 3);
+  kernels.decompress(out.data(), wire.data(), 3);
+  ASSERT_EQ(1.0f, out[1]);
+  ASSERT_EQ(0.0f, out[2]);
+
+  // A block that contains infinity decodes as NaN.
+  in[1] = std::numeric_limits<float>::infinity();
+  kernels.compress(wire.data(), in.data(), nullptr, 3);
+  kernels.decompress(out.data(), wire.data(), 3);
+  for (size_t i = 0; i < 3; i++) {
+    ASSERT_TRUE(std::isnan(out[i]));
+  }
+}
+
+TEST(ReduceOpTest, SimdKernels) {
+  testSimdKernels<int32_t>(DataType::INT32);
+  testSimdKernels<int64_t>(DataType::INT64);
+  testSimdKernels<float>(DataType::FLOAT32);
+  testSimdKernels<double>(DataType::FLOAT64);
+  testSimdKernels<float16>(DataType::FLOAT16);
+  testSimdKernels<bfloat16>(DataType::BFLOAT16);
+}
+
+} // namespace
+} // namespace test
+} // namespace gloo
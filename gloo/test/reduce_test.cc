@@ -15,7 +15,8 @@ namespace test {
 namespace {
 
 // Test parameterization.
-using Param = std::tuple<Transport, int, size_t, bool>;
+using Param =
+    std::tuple<Transport, int, size_t, bool, ReduceOptions::Algorithm>;
 
 // Test fixture.
 class ReduceTest : public BaseTest,
@@ -26,12 +27,14 @@ TEST_P(ReduceTest, Default) {
   const auto contextSize = std::get<1>(GetParam());
   const auto dataSize = std::get<2>(GetParam());
   const auto inPlace = std::get<3>(GetParam());
+  const auto algorithm = std::get<4>(GetParam());
 
   spawn(transport, contextSize, [&](std::shared_ptr<Context> context) {
     auto input = Fixture<uint64_t>(context, 1, dataSize);
     auto output = Fixture<uint64_t>(context, 1, dataSize);
 
     ReduceOptions opts(context);
+    opts.setAlgorithm(algorithm);
 
     if (inPlace) {
       opts.setOutput(output.getPointer(), dataSize);
@@ -86,7 +89,27 @@ INSTANTIATE_TEST_CASE_P(
         ::testing::ValuesIn(kTransportsForFunctionAlgorithms),
         ::testing::Values(1, 2, 4, 7),
         ::testing::Values(0, 1, 10, 100, 1000, 10000),
-        ::testing::Values(true, false)));
+        ::testing::Values(true, false),
+        ::testing::Values(
+            ReduceOptions::UNSPECIFIED,
+            ReduceOptions::RING,
+            ReduceOptions::BINOMIAL,
+            ReduceOptions::PIPELINED_TREE)));
+
+TEST(ReduceSelectionTest, Default) {
+  // Small buffers are dominated by the cost per message.
+  ASSERT_EQ(ReduceOptions::BINOMIAL, selectReduceAlgorithm(8, 64));
+  ASSERT_EQ(ReduceOptions::BINOMIAL, selectReduceAlgorithm(64, 1024));
+
+  // Large buffers are dominated by the bandwidth.
+  ASSERT_EQ(ReduceOptions::RING, selectReduceAlgorithm(2, 64 << 20));
+  ASSERT_EQ(ReduceOptions::RING, selectReduceAlgorithm(64, 64 << 20));
+
+  // In between, the pipelined tree takes fewer steps than the ring,
+  // and sends fewer bytes than the binomial tree.
+  ASSERT_EQ(
+      ReduceOptions::PIPELINED_TREE, selectReduceAlgorithm(64, 256 << 10));
+}
 
 template <typename T>
 ReduceOptions::Func getFunction() {
@@ -94,6 +117,29 @@ ReduceOptions::Func getFunction() {
   return ReduceOptions::Func(func);
 }
 
+// The binomial tree receives the full buffer in a single segment, so
+// every child needs a single receive buffer.
+TEST_F(ReduceTest, BinomialScratch) {
+  const size_t dataSize = 1 << 15;
+  spawn(Transport::TCP, 4, [&](std::shared_ptr<Context> context) {
+    auto output = Fixture<uint64_t>(context, 1, dataSize);
+    output.assignValues();
+    ReduceOptions opts(context);
+    opts.setAlgorithm(ReduceOptions::Algorithm::BINOMIAL);
+    opts.setOutput(output.getPointer(), dataSize);
+    opts.setRoot(0);
+    opts.setReduceFunction(getFunction<uint64_t>());
+    reduce(opts);
+
+    // The root has two children.
+    if (context->rank == 0) {
+      ASSERT_EQ(
+          2 * ScratchPool::sizeClass(dataSize * sizeof(uint64_t)),
+          context->getScratchPool().cachedBytes());
+    }
+  });
+}
+
 TEST_F(ReduceTest, TestTimeout) {
   spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
     Fixture<uint64_t> outputs(context, 1, 1);
@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "gloo/scratch_pool.h"
+
+namespace gloo {
+namespace test {
+namespace {
+
+TEST(ScratchPoolTest, SizeClass) {
+  ASSERT_EQ(ScratchPool::kMinSizeClass, ScratchPool::sizeClass(0));
+  ASSERT_EQ(ScratchPool::kMinSizeClass, ScratchPool::sizeClass(1));
+  ASSERT_EQ(5120, ScratchPool::sizeClass(4097));
+  ASSERT_EQ(8192, ScratchPool::sizeClass(8192));
+  ASSERT_EQ(10240, ScratchPool::sizeClass(8193));
+  ASSERT_EQ(1 << 20, ScratchPool::sizeClass(1 << 20));
+
+  // Buffers are never more than 25% larger than requested.
+  for (size_t size = 4096; size < (1 << 24); size = size * 9 / 8 + 1) {
+    const auto size_class = ScratchPool::sizeClass(size);
+    ASSERT_GE(size_class, size);
+    ASSERT_LE(size_class, size + size / 4);
+    ASSERT_EQ(0, size_class % kCacheLineSize);
+  }
+}
+
+TEST(ScratchPoolTest, Alignment) {
+  ScratchPool pool(nullptr, -1);
+  for (auto size : {size_t(1), size_t(100000), size_t(1 << 22)}) {
+    auto scratch = pool.acquire(size);
+    ASSERT_GE(scratch.size(), size);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(scratch.ptr()) % kCacheLineSize);
+  }
+}
+
+TEST(ScratchPoolTest, Reuse) {
+  ScratchPool pool(nullptr, -1);
+  uint8_t* ptr;
+  {
+    auto scratch = pool.acquire(1000);
+    ptr = scratch.ptr();
+  }
+  ASSERT_EQ(1, pool.allocations());
+
+  // Returned buffer is reused for a request of the same size class.
+  {
+    auto scratch = pool.acquire(2000);
+    ASSERT_EQ(ptr, scratch.ptr());
+
+    // Buffer is borrowed, so this requires a new allocation.
+    auto other = pool.acquire(2000);
+    ASSERT_NE(ptr, other.ptr());
+  }
+  ASSERT_EQ(2, pool.allocations());
+
+  // Different size class requires a new allocation.
+  pool.acquire(100000);
+  ASSERT_EQ(3, pool.allocations());
+}
+
+TEST(ScratchPoolTest, MaxCachedBytes) {
+  ScratchPool pool(nullptr, -1, false, 3 * 4096);
+  {
+    auto a = pool.acquire(4096);
+    auto b = pool.acquire(4096);
+    auto c = pool.acquire(8192);
+  }
+
+  // The largest buffer was released to stay within the cap.
+  ASSERT_EQ(2 * 4096, pool.cachedBytes());
+  ASSERT_EQ(3, pool.allocations());
+  {
+    auto a = pool.acquire(4096);
+    auto b = pool.acquire(4096);
+    ASSERT_EQ(0, pool.cachedBytes());
+  }
+  ASSERT_EQ(3, pool.allocations());
+  pool.acquire(8192);
+  ASSERT_EQ(4, pool.allocations());
+
+  // A buffer larger than the cap is never kept around.
+  pool.acquire(1 << 20);
+  ASSERT_EQ(2 * 4096, pool.cachedBytes());
+
+  pool.clear();
+  ASSERT_EQ(0, pool.cachedBytes());
+}
+
+TEST(ScratchPoolTest, HugePages) {
+  ScratchPool pool(nullptr, -1, true);
+  auto scratch = pool.acquire(kHugePageSize);
+  ASSERT_EQ(kHugePageSize, scratch.size());
+  scratch.ptr()[kHugePageSize - 1] = 1;
+}
+
+} // namespace
+} // namespace test
+} // namespace gloo
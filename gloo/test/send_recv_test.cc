@@ -10,8 +10,11 @@
 
 #include <algorithm>
 #include <array>
+#include <fstream>
+#include <functional>
 #include <unordered_set>
 
+#include "gloo/transport/tcp/pair.h"
 #include "gloo/transport/tcp/unbound_buffer.h"
 
 namespace gloo {
@@ -511,6 +514,164 @@ TEST_P(SendRecvTest, RecvFromAnyRPCEmptyThenNonEmpty) {
   });
 }
 
+#if GLOO_HAVE_TRANSPORT_TCP
+
+class SendRecvTuningTest : public BaseTest {
+ protected:
+  // Returns the value of net.core.rmem_max or net.core.wmem_max.
+  static size_t readLimit(const char* path) {
+    size_t limit = 0;
+    std::ifstream(path) >> limit;
+    return limit;
+  }
+
+  // Returns the buffer size a pair is expected to report for the
+  // specified (clamped) bandwidth-delay product.
+  static size_t expectedBufferSize(size_t size) {
+    const auto sendLimit = readLimit("/proc/sys/net/core/wmem_max");
+    const auto recvLimit = readLimit("/proc/sys/net/core/rmem_max");
+    if ((sendLimit > 0 && size > sendLimit) ||
+        (recvLimit > 0 && size > recvLimit)) {
+      // Left to autotuning.
+      return 0;
+    }
+    // The kernel doubles the requested value (see socket(7)).
+    return 2 * size;
+  }
+
+  static std::function<std::shared_ptr<transport::Device>(Transport)>
+  tunedDevice(const ::gloo::transport::tcp::tuning& tuning) {
+    return [tuning](Transport) {
+      ::gloo::transport::tcp::attr attr("localhost");
+      attr.tuning = tuning;
+      attr.tuning.enabled = true;
+      return ::gloo::transport::tcp::CreateDevice(attr);
+    };
+  }
+
+  static ::gloo::transport::tcp::SocketOptions getSocketOptions(
+      const std::shared_ptr<Context>& context,
+      int peer) {
+    auto& pair = context->getPair(peer);
+    auto tcpPair = dynamic_cast<::gloo::transport::tcp::Pair*>(pair.get());
+    GLOO_ENFORCE(tcpPair != nullptr);
+    return tcpPair->getSocketOptions();
+  }
+};
+
+TEST_F(SendRecvTuningTest, LargeMessage) {
+  const auto contextSize = 2;
+  const auto elements = 1024 * 1024;
+  ::gloo::transport::tcp::tuning tuning;
+  tuning.bandwidthMbps = 1000;
+  tuning.rtt = std::chrono::microseconds(2000);
+  tuning.recvLowWatermark = 64 * 1024;
+  tuning.notSentLowWatermark = 128 * 1024;
+
+  spawn(
+      Transport::TCP,
+      contextSize,
+      tunedDevice(tuning),
+      [&](std::shared_ptr<Context> context) {
+        const auto peer = (context->rank + 1) % context->size;
+
+        // The bandwidth-delay product is 250000 bytes, which is raised
+        // to the minimum buffer size.
+        const auto options = getSocketOptions(context, peer);
+        ASSERT_EQ(1000, options.bandwidthMbps);
+        ASSERT_EQ(2000, options.expectedRtt.count());
+        ASSERT_EQ(250000, options.bdp);
+        const auto expected = expectedBufferSize(tuning.minBufferSize);
+        ASSERT_EQ(expected, options.sendBufferSize);
+        ASSERT_EQ(expected, options.recvBufferSize);
+        ASSERT_EQ(64 * 1024, options.recvLowWatermark);
+        ASSERT_EQ(128 * 1024, options.notSentLowWatermark);
+
+        std::vector<int> input(elements, context->rank);
+        std::vector<int> output(elements, -1);
+        auto inputBuffer = context->createUnboundBuffer(
+            input.data(), input.size() * sizeof(int));
+        auto outputBuffer = context->createUnboundBuffer(
+            output.data(), output.size() * sizeof(int));
+        inputBuffer->send(peer, 0);
+        outputBuffer->recv(peer, 0);
+        inputBuffer->waitSend();
+        outputBuffer->waitRecv();
+        for (auto i = 0; i < elements; i++) {
+          ASSERT_EQ(peer, output[i]) << "Mismatch at index " << i;
+        }
+      });
+}
+
+TEST_F(SendRecvTuningTest, MaxBufferSize) {
+  ::gloo::transport::tcp::tuning tuning;
+  tuning.bandwidthMbps = 10000;
+  tuning.rtt = std::chrono::microseconds(1600);
+  tuning.maxBufferSize = 1024 * 1024;
+
+  spawn(Transport::TCP, 2, tunedDevice(tuning), [&](
+      std::shared_ptr<Context> context) {
+    const auto peer = (context->rank + 1) % context->size;
+    const auto options = getSocketOptions(context, peer);
+    ASSERT_EQ(2000000, options.bdp);
+    const auto expected = expectedBufferSize(tuning.maxBufferSize);
+    ASSERT_EQ(expected, options.sendBufferSize);
+    ASSERT_EQ(expected, options.recvBufferSize);
+  });
+}
+
+TEST_F(SendRecvTuningTest, AboveSystemLimit) {
+  // Larger than any reasonable net.core.{r,w}mem_max.
+  ::gloo::transport::tcp::tuning tuning;
+  tuning.bandwidthMbps = 100000;
+  tuning.rtt = std::chrono::microseconds(100000);
+  tuning.maxBufferSize = 1ULL << 40;
+  if (expectedBufferSize(1250000000) != 0) {
+    return;
+  }
+
+  spawn(Transport::TCP, 2, tunedDevice(tuning), [&](
+      std::shared_ptr<Context> context) {
+    const auto peer = (context->rank + 1) % context->size;
+    const auto options = getSocketOptions(context, peer);
+    ASSERT_EQ(1250000000, options.bdp);
+    ASSERT_EQ(0, options.sendBufferSize);
+    ASSERT_EQ(0, options.recvBufferSize);
+  });
+}
+
+TEST_F(SendRecvTuningTest, MeasuredRtt) {
+  // Without an expected round trip time, the first context leaves the
+  // buffers to autotuning. Contexts created later on the same device
+  // use the round trip time measured by the first.
+  ::gloo::transport::tcp::attr attr("localhost");
+  attr.tuning.enabled = true;
+  attr.tuning.bandwidthMbps = 1000;
+  auto device = ::gloo::transport::tcp::CreateDevice(attr);
+  const auto createDevice = [&](Transport) { return device; };
+
+  spawn(Transport::TCP, 2, createDevice, [&](
+      std::shared_ptr<Context> context) {
+    const auto peer = (context->rank + 1) % context->size;
+    const auto options = getSocketOptions(context, peer);
+    ASSERT_EQ(0, options.expectedRtt.count());
+    ASSERT_EQ(0, options.sendBufferSize);
+    ASSERT_GT(options.rtt.count(), 0);
+  });
+
+  spawn(Transport::TCP, 2, createDevice, [&](
+      std::shared_ptr<Context> context) {
+    const auto peer = (context->rank + 1) % context->size;
+    const auto options = getSocketOptions(context, peer);
+    ASSERT_GT(options.expectedRtt.count(), 0);
+    ASSERT_EQ(
+        expectedBufferSize(attr.tuning.minBufferSize),
+        options.sendBufferSize);
+  });
+}
+
+#endif
+
 INSTANTIATE_TEST_CASE_P(
     SendRecvDefault,
     SendRecvTest,
@@ -0,0 +1,171 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "gloo/sparse_allreduce.h"
+#include "gloo/test/base_test.h"
+
+namespace gloo {
+namespace test {
+namespace {
+
+// Transport, context size, rows, density threshold, dense output.
+using Param = std::tuple<Transport, int, int, double, bool>;
+
+class SparseAllreduceTest : public BaseTest,
+                            public ::testing::WithParamInterface<Param> {};
+
+const size_t kColumns = 3;
+
+// Every process contributes rank + 1 pairs, of which the first and the
+// last have the same index if there is more than one.
+void generatePairs(
+    int rank,
+    size_t rows,
+    std::vector<int64_t>& indices,
+    std::vector<float>& values) {
+  const size_t count = rank + 1;
+  indices.resize(count);
+  values.resize(count * kColumns);
+  for (size_t i = 0; i < count; i++) {
+    const size_t j = (i + 1 < count) ? i : 0;
+    indices[i] = (rank * 5 + j * 7) % rows;
+    for (size_t k = 0; k < kColumns; k++) {
+      values[i * kColumns + k] = rank * 100 + i * 10 + k;
+    }
+  }
+}
+
+TEST_P(SparseAllreduceTest, Default) {
+  const auto transport = std::get<0>(GetParam());
+  const auto contextSize = std::get<1>(GetParam());
+  const size_t rows = std::get<2>(GetParam());
+  const auto threshold = std::get<3>(GetParam());
+  const auto dense = std::get<4>(GetParam());
+
+  spawn(transport, contextSize, [&](std::shared_ptr<Context> context) {
+    // Compute the expected result from the pairs of every process.
+    std::map<int64_t, std::vector<float>> expected;
+    std::vector<int64_t> indices;
+    std::vector<float> values;
+    for (auto rank = 0; rank < context->size; rank++) {
+      generatePairs(rank, rows, indices, values);
+      for (size_t i = 0; i < indices.size(); i++) {
+        auto& row = expected[indices[i]];
+        row.resize(kColumns, 0);
+        for (size_t k = 0; k < kColumns; k++) {
+          row[k] += values[i * kColumns + k];
+        }
+      }
+    }
+
+    generatePairs(context->rank, rows, indices, values);
+    SparseAllreduceOptions opts(context);
+    opts.setShape(rows, kColumns);
+    opts.setInput(indices.data(), values.data(), indices.size());
+    opts.setDensityThreshold(threshold);
+
+    if (dense) {
+      std::vector<float> output(rows * kColumns, -1);
+      opts.setOutput(output.data());
+      sparseAllreduce(opts);
+      for (size_t i = 0; i < rows; i++) {
+        const auto it = expected.find(i);
+        for (size_t k = 0; k < kColumns; k++) {
+          const float value = it == expected.end() ? 0 : it->second[k];
+          ASSERT_EQ(value, output[i * kColumns + k])
+              << "Mismatch at row " << i << ", column " << k;
+        }
+      }
+      return;
+    }
+
+    std::vector<int64_t> outIndices;
+    std::vector<float> outValues;
+    opts.setOutput(&outIndices, &outValues);
+    sparseAllreduce(opts);
+    ASSERT_EQ(expected.size(), outIndices.size());
+    ASSERT_EQ(expected.size() * kColumns, outValues.size());
+    size_t i = 0;
+    for (const auto& row : expected) {
+      ASSERT_EQ(row.first, outIndices[i]);
+      for (size_t k = 0; k < kColumns; k++) {
+        ASSERT_EQ(row.second[k], outValues[i * kColumns + k])
+            << "Mismatch at row " << row.first << ", column " << k;
+      }
+      i++;
+    }
+  });
+}
+
+INSTANTIATE_TEST_CASE_P(
+    SparseAllreduceDefault,
+    SparseAllreduceTest,
+    ::testing::Combine(
+        ::testing::ValuesIn(kTransportsForFunctionAlgorithms),
+        ::testing::Values(1, 2, 4),
+        ::testing::Values(1, 4, 1000),
+        ::testing::Values(-1.0, 0.0, 1e9),
+        ::testing::Values(false, true)));
+
+TEST_F(SparseAllreduceTest, Empty) {
+  spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+    std::vector<int64_t> outIndices(1);
+    std::vector<float> outValues(1);
+    SparseAllreduceOptions opts(context);
+    opts.setShape(10);
+    opts.setInput<float>(nullptr, nullptr, 0);
+    opts.setOutput(&outIndices, &outValues);
+    sparseAllreduce(opts);
+    ASSERT_TRUE(outIndices.empty());
+    ASSERT_TRUE(outValues.empty());
+  });
+}
+
+// Rows that processes contributed to are part of the result even if
+// they sum to zero, regardless of whether the result is computed with
+// the sparse exchange or the dense allreduce.
+TEST_F(SparseAllreduceTest, RowsSumToZero) {
+  for (const auto threshold : {1e9, 0.0}) {
+    spawn(Transport::TCP, 2, [&](std::shared_ptr<Context> context) {
+      const float sign = context->rank == 0 ? 1 : -1;
+      std::vector<int64_t> indices = {2, 5};
+      std::vector<float> values = {sign, 0.0f};
+      std::vector<int64_t> outIndices;
+      std::vector<float> outValues;
+      SparseAllreduceOptions opts(context);
+      opts.setShape(10);
+      opts.setInput(indices.data(), values.data(), indices.size());
+      opts.setOutput(&outIndices, &outValues);
+      opts.setDensityThreshold(threshold);
+      sparseAllreduce(opts);
+      ASSERT_EQ(indices, outIndices) << "Threshold " << threshold;
+      ASSERT_EQ(std::vector<float>({0.0f, 0.0f}), outValues);
+    });
+  }
+}
+
+TEST_F(SparseAllreduceTest, IndexOutOfRange) {
+  spawn(Transport::TCP, 1, [&](std::shared_ptr<Context> context) {
+    std::vector<int64_t> indices = {10};
+    std::vector<float> values = {1};
+    std::vector<float> output(10);
+    SparseAllreduceOptions opts(context);
+    opts.setShape(10);
+    opts.setInput(indices.data(), values.data(), indices.size());
+    opts.setOutput(output.data());
+    ASSERT_THROW(sparseAllreduce(opts), ::gloo::EnforceNotMet);
+  });
+}
+
+} // namespace
+} // namespace test
+} // namespace gloo
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "gloo/common/error.h"
+#include "gloo/work.h"
+
+namespace gloo {
+namespace test {
+namespace {
+
+TEST(WorkTest, Completes) {
+  ProgressEngine engine;
+  bool executed = false;
+  auto work = engine.enqueue([&] { executed = true; });
+  work->wait();
+  ASSERT_TRUE(work->test());
+  ASSERT_TRUE(executed);
+
+  // Completed work cannot be cancelled.
+  ASSERT_FALSE(work->cancel());
+}
+
+TEST(WorkTest, RethrowsException) {
+  ProgressEngine engine;
+  auto work = engine.enqueue([] { GLOO_THROW("Expected"); });
+  try {
+    work->wait();
+    FAIL() << "Expected exception to be thrown";
+  } catch (::gloo::Exception& e) {
+    ASSERT_NE(std::string(e.what()).find("Expected"), std::string::npos);
+  }
+  ASSERT_TRUE(work->test());
+}
+
+TEST(WorkTest, Cancel) {
+  ProgressEngine engine(1);
+  std::promise<void> promise;
+  auto future = promise.get_future().share();
+
+  // The first operation occupies the only thread, so that the second
+  // operation remains queued.
+  auto first = engine.enqueue([future] { future.wait(); });
+  bool executed = false;
+  auto second = engine.enqueue([&] { executed = true; });
+  ASSERT_FALSE(second->test());
+  ASSERT_TRUE(second->cancel());
+  ASSERT_TRUE(second->test());
+  ASSERT_THROW(second->wait(), ::gloo::Exception);
+
+  promise.set_value();
+  first->wait();
+  ASSERT_FALSE(executed);
+  ASSERT_EQ(1, engine.threads());
+}
+
+TEST(WorkTest, ConcurrentOperations) {
+  ProgressEngine engine;
+  const auto n = 4;
+
+  // Every operation waits for all others to start. This only completes
+  // if the engine executes them concurrently.
+  std::atomic<int> started(0);
+  std::vector<std::shared_ptr<Work>> work;
+  for (auto i = 0; i < n; i++) {
+    work.push_back(engine.enqueue([&] {
+      started++;
+      while (started < n) {
+        std::this_thread::yield();
+      }
+    }));
+  }
+  for (auto& w : work) {
+    w->wait();
+  }
+  ASSERT_EQ(n, engine.threads());
+}
+
+TEST(WorkTest, MaxThreads) {
+  ProgressEngine engine(2);
+  const auto n = 8;
+  std::atomic<int> executed(0);
+  std::vector<std::shared_ptr<Work>> work;
+  for (auto i = 0; i < n; i++) {
+    work.push_back(engine.enqueue([&] { executed++; }));
+  }
+  for (auto& w : work) {
+    w->wait();
+  }
+  ASSERT_EQ(n, executed);
+  ASSERT_LE(engine.threads(), 2);
+}
+
+TEST(WorkTest, SetMaxThreads) {
+  ProgressEngine engine(1);
+  std::promise<void> promise;
+  auto future = promise.get_future().share();
+
+  // The first operation waits for the second one, which can only
+  // start executing once the limit is raised.
+  auto first = engine.enqueue([future] { future.wait(); });
+  auto second = engine.enqueue([&] { promise.set_value(); });
+  ASSERT_FALSE(second->test());
+  engine.setMaxThreads(2);
+  ASSERT_EQ(2, engine.getMaxThreads());
+  second->wait();
+  first->wait();
+  ASSERT_EQ(2, engine.threads());
+}
+
+} // namespace
+} // namespace test
+} // namespace gloo
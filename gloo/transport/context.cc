@@ -22,6 +22,10 @@ std::unique_ptr<transport::Pair>& Context::getPair(int rank) {
   return pairs_.at(rank);
 }
 
+void Context::registerMemory(void* /* unused */, size_t /* unused */) {}
+
+void Context::deregisterMemory(void* /* unused */, size_t /* unused */) {}
+
 Context::LazyTally::LazyTally(std::vector<Tally>& vec, slot_t slot)
     : vec_(vec), slot_(slot), initialized_(false) {}
 
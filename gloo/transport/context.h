@@ -57,6 +57,16 @@ class Context {
       void* ptr,
       size_t size) = 0;
 
+  // Registers memory that is communicated with repeatedly, by unbound
+  // buffers that are created and destroyed along the way. Transports
+  // that require memory registration (ibverbs) keep the registration
+  // until deregisterMemory() is called, instead of only while an
+  // unbound buffer over the memory exists. The memory must not be
+  // released before it is deregistered. Other transports ignore this.
+  virtual void registerMemory(void* ptr, size_t size);
+
+  virtual void deregisterMemory(void* ptr, size_t size);
+
   void setTimeout(std::chrono::milliseconds timeout) {
     timeout_ = timeout;
   }
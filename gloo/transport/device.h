@@ -43,6 +43,10 @@ class Device {
 
   virtual bool hasGPUDirect() const { return false; }
 
+  // Returns the NUMA node the device is attached to, or -1 if unknown.
+  // Scratch buffers used with this device should be allocated on it.
+  virtual int getNumaNode() const { return -1; }
+
   // Factory function to create transport context. A single device may
   // service multiple contexts, with no constraints on this process
   // its rank or the context size.
@@ -11,6 +11,7 @@
 #include "gloo/transport/context.h"
 
 #include <memory>
+#include <string>
 
 namespace gloo {
 namespace transport {
@@ -19,6 +20,7 @@ namespace ibverbs {
 // Forward declaration
 class Device;
 class Pair;
+class UnboundBuffer;
 
 class Context : public ::gloo::transport::Context,
                 public std::enable_shared_from_this<Context> {
@@ -33,10 +35,21 @@ class Context : public ::gloo::transport::Context,
       void* ptr,
       size_t size) override;
 
+  void registerMemory(void* ptr, size_t size) override;
+
+  void deregisterMemory(void* ptr, size_t size) override;
+
  protected:
   std::shared_ptr<Device> device_;
 
+  // Set exception on every pair in this context. This is called when
+  // waiting for a send or recv operation on an unbound buffer times
+  // out. All pairs should be signaled and closed in that event.
+  void signalException(const std::string& msg);
+
   friend class Pair;
+
+  friend class UnboundBuffer;
 };
 
 } // namespace ibverbs
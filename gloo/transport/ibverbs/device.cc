@@ -15,16 +15,21 @@
 #include <algorithm>
 #include <array>
 
+#include "gloo/common/common.h"
 #include "gloo/common/error.h"
 #include "gloo/common/linux.h"
 #include "gloo/common/logging.h"
 #include "gloo/transport/ibverbs/context.h"
+#include "gloo/transport/ibverbs/memory_region.h"
 #include "gloo/transport/ibverbs/pair.h"
 
 namespace gloo {
 namespace transport {
 namespace ibverbs {
 
+constexpr int Device::kSharedReceiveQueueCapacity;
+constexpr int Device::kSharedReceiveQueueCapacityPerPair;
+
 static const std::chrono::seconds kTimeoutDefault = std::chrono::seconds(30);
 
 // Scope guard for ibverbs device list.
@@ -103,6 +108,7 @@ std::shared_ptr<::gloo::transport::Device> CreateDevice(
 Device::Device(const struct attr& attr, ibv_context* context)
     : attr_(attr),
       pciBusID_(infinibandToBusID(attr.name)),
+      numaNode_(pciNumaNode(pciBusID_)),
       hasNvPeerMem_(kernelModules().count("nv_peer_mem") > 0),
       context_(context) {
   int rv;
@@ -123,10 +129,43 @@ Device::Device(const struct attr& attr, ibv_context* context)
   comp_channel_ = ibv_create_comp_channel(context_);
   GLOO_ENFORCE(comp_channel_);
 
+  registrationCache_.reset(new RegistrationCache(pd_));
+
+  // Shared receive queue. If the device doesn't support them, every
+  // pair posts receive work requests to its own queue pair instead.
+  // The queue is created with the device's maximum capacity, but
+  // receive work requests are only posted as pairs are created.
+  srq_ = nullptr;
+  sharedReceiveQueueSize_ = 0;
+  if (deviceAttr_.max_srq_wr > 0) {
+    struct ibv_srq_init_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.attr.max_wr = deviceAttr_.max_srq_wr;
+    attr.attr.max_sge = 1;
+    srq_ = ibv_create_srq(pd_, &attr);
+    GLOO_ENFORCE(srq_, "ibv_create_srq: ", strerror(errno));
+
+    // Post receive requests before any pair is created.
+    // Whenever the remote side of a pair registers receive buffers,
+    // this triggers their memory registration to be sent to this side.
+    // Since these sends are one-sided, we always need a full bench of
+    // receive work requests. Memory region receives can be interleaved
+    // with regular buffer writes, so we proactively include a memory
+    // region in every receive work request.
+    mailboxes_.resize(attr.attr.max_wr);
+    std::lock_guard<std::mutex> guard(pairsMutex_);
+    growSharedReceiveQueue(0);
+  }
+
   // Start thread to poll completion queue and dispatch
   // completions for completed work requests.
   done_ = false;
   loop_.reset(new std::thread(&Device::loop, this));
+
+  // Handle completions on the NUMA node of the HCA.
+  if (numaNode_ >= 0) {
+    setThreadAffinity(*loop_, numaNodeCpus(numaNode_));
+  }
 }
 
 Device::~Device() {
@@ -138,6 +177,15 @@ Device::~Device() {
   rv = ibv_destroy_comp_channel(comp_channel_);
   GLOO_ENFORCE_EQ(rv, 0);
 
+  if (srq_ != nullptr) {
+    rv = ibv_destroy_srq(srq_);
+    GLOO_ENFORCE_EQ(rv, 0);
+  }
+  mailboxes_.clear();
+
+  // Deregister cached memory before deallocating the protection domain.
+  registrationCache_.reset();
+
   rv = ibv_dealloc_pd(pd_);
   GLOO_ENFORCE_EQ(rv, 0);
 
@@ -152,6 +200,9 @@ std::string Device::str() const {
   ss << ", dev=" << attr_.name;
   ss << ", port=" << attr_.port;
   ss << ", index=" << attr_.index;
+  if (numaNode_ >= 0) {
+    ss << ", numa=" << numaNode_;
+  }
 
   // nv_peer_mem module must be loaded for GPUDirect
   if (hasNvPeerMem_) {
@@ -169,12 +220,56 @@ bool Device::hasGPUDirect() const {
   return hasNvPeerMem_;
 }
 
+int Device::getNumaNode() const {
+  return numaNode_;
+}
+
 std::shared_ptr<transport::Context> Device::createContext(
     int rank, int size) {
   return std::shared_ptr<transport::Context>(
       new ibverbs::Context(shared_from_this(), rank, size));
 }
 
+void Device::postReceive(uint64_t id) {
+  struct ibv_sge list = mailboxes_[id]->sge();
+  struct ibv_recv_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = id;
+  wr.sg_list = &list;
+  wr.num_sge = 1;
+
+  // The work request is serialized and sent to the driver so it
+  // doesn't need to be valid after the ibv_post_srq_recv call.
+  struct ibv_recv_wr* bad_wr = nullptr;
+  auto rv = ibv_post_srq_recv(srq_, &wr, &bad_wr);
+  GLOO_ENFORCE_EQ(rv, 0, "ibv_post_srq_recv: ", strerror(rv));
+}
+
+int Device::growSharedReceiveQueue(size_t pairs) {
+  const int current = sharedReceiveQueueSize_;
+  const int target = std::min(
+      std::max(
+          static_cast<size_t>(kSharedReceiveQueueCapacity),
+          pairs * kSharedReceiveQueueCapacityPerPair),
+      mailboxes_.size());
+  if (target <= current) {
+    return current;
+  }
+
+  // Completion queues must be able to hold a completion for every
+  // receive work request before more of them are posted.
+  for (auto pair : pairs_) {
+    pair->resizeCompletionQueue(target);
+  }
+
+  for (int i = current; i < target; i++) {
+    mailboxes_[i] = make_unique<MemoryRegion>(pd_);
+    postReceive(i);
+  }
+  sharedReceiveQueueSize_ = target;
+  return target;
+}
+
 void Device::loop() {
   int rv;
 
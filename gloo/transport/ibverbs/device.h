@@ -9,13 +9,17 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include <infiniband/verbs.h>
 
 #include "gloo/config.h"
 #include "gloo/transport/device.h"
+#include "gloo/transport/ibverbs/registration_cache.h"
 
 // Check that configuration header was properly generated
 #if !GLOO_HAVE_TRANSPORT_IBVERBS
@@ -41,11 +45,22 @@ std::shared_ptr<::gloo::transport::Device> CreateDevice(
 // Forward declarations
 class Pair;
 class Buffer;
+class MemoryRegion;
 
 class Device : public ::gloo::transport::Device,
                public std::enable_shared_from_this<Device> {
   static const int capacity_ = 64;
 
+  // Number of receive work requests posted to the shared receive
+  // queue. Every receive work request references its own mailbox.
+  // The queue starts out with kSharedReceiveQueueCapacity requests
+  // and grows by kSharedReceiveQueueCapacityPerPair for every pair
+  // beyond that, so that bursts from many peers don't exhaust it and
+  // cause receiver-not-ready retries. It is capped by the device's
+  // limits (see ibv_query_device(3)).
+  static constexpr int kSharedReceiveQueueCapacity = 256;
+  static constexpr int kSharedReceiveQueueCapacityPerPair = 16;
+
  public:
   Device(const struct attr& attr, ibv_context* context);
   virtual ~Device();
@@ -56,18 +71,67 @@ class Device : public ::gloo::transport::Device,
 
   virtual bool hasGPUDirect() const override;
 
+  virtual int getNumaNode() const override;
+
   virtual std::shared_ptr<::gloo::transport::Context> createContext(
       int rank, int size) override;
 
+  // Memory registrations of unbound buffers are cached per device,
+  // because they are scoped to its protection domain.
+  RegistrationCache& getRegistrationCache() {
+    return *registrationCache_;
+  }
+
  protected:
   struct attr attr_;
   const std::string pciBusID_;
+  const int numaNode_;
   const bool hasNvPeerMem_;
   ibv_context* context_;
   ibv_device_attr deviceAttr_;
   ibv_port_attr portAttr_;
   ibv_pd* pd_;
   ibv_comp_channel* comp_channel_;
+  std::unique_ptr<RegistrationCache> registrationCache_;
+
+  // All pairs share a single receive queue, so that the number of
+  // receive work requests doesn't grow with the number of pairs.
+  // Receive work requests are identified by the index of their
+  // mailbox, so that they can be completed in any order. Null if the
+  // device doesn't support shared receive queues, in which case every
+  // pair has its own receive queue and mailboxes (see Pair).
+  ibv_srq* srq_;
+
+  // Sized to the capacity of the shared receive queue when it is
+  // created. Only mailboxes with an index below the number of posted
+  // receive work requests exist, so that the vector is never resized
+  // while completions are handled.
+  std::vector<std::unique_ptr<MemoryRegion>> mailboxes_;
+  std::atomic<int> sharedReceiveQueueSize_;
+
+  // Pairs that use the shared receive queue. Their completion queues
+  // must fit all receive work requests in the shared receive queue,
+  // so they are resized when it grows. Pairs hold this lock while
+  // they are created (see Pair::Pair).
+  std::mutex pairsMutex_;
+  std::unordered_set<Pair*> pairs_;
+
+  // Posts receive work request for the specified mailbox to the
+  // shared receive queue. Called to backfill receive work requests
+  // after their completion was handled.
+  void postReceive(uint64_t id);
+
+  // Posts additional receive work requests to the shared receive
+  // queue, for the specified number of pairs, and resizes the
+  // completion queues of existing pairs accordingly. Returns the
+  // number of receive work requests in the shared receive queue.
+  // Must be called when holding pairsMutex_.
+  int growSharedReceiveQueue(size_t pairs);
+
+  // Returns number of receive work requests in the shared receive queue.
+  int getSharedReceiveQueueCapacity() const {
+    return sharedReceiveQueueSize_;
+  }
 
   void loop();
 
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <string.h>
+
 #include "gloo/transport/ibverbs/device.h"
 
 namespace gloo {
@@ -39,6 +41,23 @@ class MemoryRegion {
     return src_;
   }
 
+  // Unbound buffers use the same mailboxes to send other types of
+  // messages to the remote side of the pair (see pair.cc).
+  template <typename T>
+  void set(const T& t) {
+    static_assert(sizeof(T) <= sizeof(src_), "Message doesn't fit");
+    memset(&src_, 0, sizeof(src_));
+    memcpy(&src_, &t, sizeof(T));
+  }
+
+  template <typename T>
+  T get() const {
+    static_assert(sizeof(T) <= sizeof(src_), "Message doesn't fit");
+    T t;
+    memcpy(&t, &src_, sizeof(T));
+    return t;
+  }
+
  protected:
   // The ibv_mr that is read from or written to.
   struct ibv_mr src_;
@@ -8,10 +8,13 @@
 
 #include "gloo/transport/ibverbs/pair.h"
 #include "gloo/transport/ibverbs/buffer.h"
+#include "gloo/transport/ibverbs/unbound_buffer.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "gloo/common/common.h"
 #include "gloo/common/error.h"
 #include "gloo/common/logging.h"
@@ -20,27 +23,65 @@ namespace gloo {
 namespace transport {
 namespace ibverbs {
 
+constexpr int Pair::kSendQueueCapacity;
+constexpr int Pair::kRecvQueueCapacity;
+
 Pair::Pair(
+    Context* context,
+    int rank,
     const std::shared_ptr<Device>& dev,
     std::chrono::milliseconds timeout)
-    : dev_(dev),
+    : context_(context),
+      rank_(rank),
+      dev_(dev),
       sync_(false),
       busyPoll_(false),
       timeout_(timeout),
       completionEventsHandled_(0),
-      recvPosted_(0),
+      sendQueue_(
+          std::min(kSendQueueCapacity, dev->deviceAttr_.max_qp_wr),
+          [this](struct ibv_send_wr* wr) {
+            // The work request is serialized and sent to the driver so
+            // it doesn't need to be valid after the ibv_post_send call.
+            struct ibv_send_wr* bad_wr = nullptr;
+            return ibv_post_send(qp_, wr, &bad_wr);
+          }),
+      nextRecvNotificationId_(0),
+      nextUnboundWorkRequestId_(0),
       ex_(nullptr) {
   int rv;
 
+  // Hold the device's lock until this pair is registered with it, so
+  // that its completion queue can't miss growth of the shared receive
+  // queue (see Device::growSharedReceiveQueue).
+  std::lock_guard<std::mutex> devGuard(dev_->pairsMutex_);
+
   // Create completion queue
   {
+    // The number of outstanding send completions is bounded by the
+    // capacity of the send queue. The number of outstanding receive
+    // completions is bounded by the capacity of the device's shared
+    // receive queue (or this pair's own receive queue), because
+    // receive work requests are only posted again after their
+    // completion was handled.
+    if (dev_->srq_ == nullptr) {
+      mailboxes_.resize(
+          std::min(kRecvQueueCapacity, dev_->deviceAttr_.max_qp_wr));
+    }
+    const int recvQueueCapacity = dev_->srq_ != nullptr
+        ? dev_->growSharedReceiveQueue(dev_->pairs_.size() + 1)
+        : static_cast<int>(mailboxes_.size());
+    const int capacity = std::min(
+        sendQueue_.capacity() + recvQueueCapacity,
+        dev_->deviceAttr_.max_cqe);
+
     // Have to register this completion queue with the device's
     // completion channel to support asynchronous completion handling.
     // Pairs use asynchronous completion handling by default so
     // we call ibv_req_notify_cq(3) to request the first notification.
     cq_ = ibv_create_cq(
       dev_->context_,
-      kCompletionQueueCapacity,
+      capacity,
       this,
       dev_->comp_channel_,
       0);
@@ -57,10 +98,13 @@ Pair::Pair(
     memset(&attr, 0, sizeof(struct ibv_qp_init_attr));
     attr.send_cq = cq_;
     attr.recv_cq = cq_;
-    attr.cap.max_send_wr = Pair::kSendCompletionQueueCapacity;
-    attr.cap.max_recv_wr = Pair::kRecvCompletionQueueCapacity;
+    attr.srq = dev_->srq_;
+    attr.cap.max_send_wr = sendQueue_.capacity();
     attr.cap.max_send_sge = 1;
-    attr.cap.max_recv_sge = 1;
+    if (dev_->srq_ == nullptr) {
+      attr.cap.max_recv_wr = mailboxes_.size();
+      attr.cap.max_recv_sge = 1;
+    }
     attr.qp_type = IBV_QPT_RC;
     qp_ = ibv_create_qp(dev->pd_, &attr);
     GLOO_ENFORCE(qp_);
@@ -101,22 +145,28 @@ Pair::Pair(
     self_.addr_.psn = rand() & 0xffffff;
   }
 
-  // Post receive requests before connecting.
-  // Whenever the remote side of this pair registers receive buffers,
-  // this triggers their memory registration to be sent to this side.
-  // Since these sends are one-sided, we always need a full bench of
-  // receive work requests. Memory region receives can be interleaved
-  // with regular buffer writes, so we proactively include a memory
-  // region in every receive work request.
-  for (int i = 0; i < kMaxBuffers; ++i) {
-    mappedRecvRegions_[i] = make_unique<MemoryRegion>(dev_->pd_);
-    postReceive();
+  // Receive work requests are posted to the device's shared receive
+  // queue, so there is no need to post them before connecting. If the
+  // device doesn't support shared receive queues, they are posted to
+  // this pair's own receive queue, before the remote side can send.
+  for (size_t i = 0; i < mailboxes_.size(); i++) {
+    mailboxes_[i] = make_unique<MemoryRegion>(dev_->pd_);
+    postReceive(i);
+  }
+
+  if (dev_->srq_ != nullptr) {
+    dev_->pairs_.insert(this);
   }
 }
 
 Pair::~Pair() {
   int rv;
 
+  {
+    std::lock_guard<std::mutex> guard(dev_->pairsMutex_);
+    dev_->pairs_.erase(this);
+  }
+
   // Acknowledge number of completion events handled by this
   // pair's completion queue (also see ibv_get_cq_event(3)).
   ibv_ack_cq_events(cq_, completionEventsHandled_);
@@ -128,6 +178,13 @@ Pair::~Pair() {
   GLOO_ENFORCE_EQ(rv, 0);
 }
 
+void Pair::resizeCompletionQueue(int recvQueueCapacity) {
+  const int capacity = std::min(
+      sendQueue_.capacity() + recvQueueCapacity, dev_->deviceAttr_.max_cqe);
+  auto rv = ibv_resize_cq(cq_, capacity);
+  GLOO_ENFORCE_EQ(rv, 0, "ibv_resize_cq: ", strerror(rv));
+}
+
 void Pair::close() {
   if (closed_) {
     // TODO: add proper handling of duplicate closes T21171834
@@ -231,12 +288,12 @@ void Pair::sendMemoryRegion(struct ibv_mr* src, int slot) {
   wr.send_flags = IBV_SEND_SIGNALED;
   wr.imm_data = slot;
 
-  // The work request is serialized and sent to the driver so it
-  // doesn't need to be valid after the ibv_post_send call.
-  struct ibv_send_wr* bad_wr = nullptr;
-  int rv = ibv_post_send(qp_, &wr, &bad_wr);
+  // The pair lock is held by the caller (see Pair::createRecvBuffer).
+  int rv = postSend(&wr);
   if (rv != 0) {
-    signalIoFailure(GLOO_ERROR_MSG("ibv_post_send: ", rv));
+    auto ex = ::gloo::IoException(GLOO_ERROR_MSG("ibv_post_send: ", rv));
+    setException(ex);
+    throw ex;
   }
 
   // Keep memory region around until this send operation completes.
@@ -290,11 +347,24 @@ const struct ibv_mr* Pair::getMemoryRegion(int slot) {
   }
 }
 
-void Pair::postReceive() {
-  const auto& mr = mappedRecvRegions_[recvPosted_++ % kMaxBuffers];
-  struct ibv_sge list = mr->sge();
+int Pair::postSend(struct ibv_send_wr* wr) {
+  return sendQueue_.post(wr);
+}
+
+void Pair::handleSendCompletion() {
+  auto rv = sendQueue_.complete();
+  if (rv != 0) {
+    auto ex = ::gloo::IoException(GLOO_ERROR_MSG("ibv_post_send: ", rv));
+    setException(ex);
+    throw ex;
+  }
+}
+
+void Pair::postReceive(uint64_t id) {
+  struct ibv_sge list = mailboxes_[id]->sge();
   struct ibv_recv_wr wr;
   memset(&wr, 0, sizeof(wr));
+  wr.wr_id = id;
   wr.sg_list = &list;
   wr.num_sge = 1;
 
@@ -302,9 +372,22 @@ void Pair::postReceive() {
   // doesn't need to be valid after the ibv_post_recv call.
   struct ibv_recv_wr* bad_wr = nullptr;
   auto rv = ibv_post_recv(qp_, &wr, &bad_wr);
-  if (rv != 0) {
-    signalIoFailure(GLOO_ERROR_MSG("ibv_post_recv: ", rv));
+  GLOO_ENFORCE_EQ(rv, 0, "ibv_post_recv: ", strerror(rv));
+}
+
+void Pair::postReceive(struct ibv_wc* wc) {
+  if (dev_->srq_ == nullptr) {
+    postReceive(wc->wr_id);
+    return;
   }
+  dev_->postReceive(wc->wr_id);
+}
+
+const MemoryRegion& Pair::getMailbox(struct ibv_wc* wc) {
+  const auto& mailboxes =
+      dev_->srq_ != nullptr ? dev_->mailboxes_ : mailboxes_;
+  GLOO_ENFORCE_LT(wc->wr_id, mailboxes.size());
+  return *mailboxes[wc->wr_id];
 }
 
 std::unique_ptr<::gloo::transport::Buffer>
@@ -329,21 +412,179 @@ Pair::createRecvBuffer(int slot, void* ptr, size_t size) {
 // Send from the specified buffer to remote side of pair.
 void Pair::send(
     transport::UnboundBuffer* tbuf,
-    uint64_t /* unused */,
-    size_t /* unused */,
-    size_t /* unused */) {
-  GLOO_THROW_INVALID_OPERATION_EXCEPTION(
-      "Unbound buffers not supported yet for ibverbs transport");
+    uint64_t slot,
+    size_t offset,
+    size_t nbytes) {
+  auto buf = static_cast<ibverbs::UnboundBuffer*>(tbuf);
+  if (sync_) {
+    GLOO_THROW_INVALID_OPERATION_EXCEPTION(
+        "Unbound buffers not supported in sync mode for ibverbs transport");
+  }
+
+  // Register memory before acquiring the pair lock; the device thread
+  // acquires the buffer lock while holding the pair lock.
+  UnboundBufferOp op;
+  op.buf = buf->getWeakNonOwningPtr();
+  op.mr = nbytes > 0 ? buf->getRegistration() : nullptr;
+  op.offset = offset;
+  op.nbytes = nbytes;
+
+  std::unique_lock<std::mutex> lock(m_);
+  checkErrorState();
+
+  // Execute the write right away if the remote side is ready to
+  // receive. Otherwise, wait for its notification to come in.
+  auto it = remotePendingRecv_.find(slot);
+  if (it == remotePendingRecv_.end() || it->second.empty()) {
+    localPendingSend_[slot].push_back(std::move(op));
+    return;
+  }
+
+  auto notification = it->second.front();
+  it->second.pop_front();
+  if (it->second.empty()) {
+    remotePendingRecv_.erase(it);
+  }
+  sendUnboundBuffer(std::move(op), notification);
 }
 
 // Receive into the specified buffer from the remote side of pair.
 void Pair::recv(
     transport::UnboundBuffer* tbuf,
-    uint64_t /* unused */,
-    size_t /* unused */,
-    size_t /* unused */) {
-  GLOO_THROW_INVALID_OPERATION_EXCEPTION(
-      "Unbound buffers not supported yet for ibverbs transport");
+    uint64_t slot,
+    size_t offset,
+    size_t nbytes) {
+  auto buf = static_cast<ibverbs::UnboundBuffer*>(tbuf);
+  if (sync_) {
+    GLOO_THROW_INVALID_OPERATION_EXCEPTION(
+        "Unbound buffers not supported in sync mode for ibverbs transport");
+  }
+
+  // Register memory before acquiring the pair lock (see Pair::send).
+  UnboundBufferOp op;
+  op.buf = buf->getWeakNonOwningPtr();
+  op.mr = nbytes > 0 ? buf->getRegistration() : nullptr;
+  op.offset = offset;
+  op.nbytes = nbytes;
+
+  std::unique_lock<std::mutex> lock(m_);
+  checkErrorState();
+
+  RecvNotification notification;
+  memset(&notification, 0, sizeof(notification));
+  notification.slot = slot;
+  notification.nbytes = nbytes;
+  notification.id = nextRecvNotificationId_++ & ~kUnboundImmediate;
+  if (op.mr) {
+    notification.addr = (uint64_t)buf->ptr + offset;
+    notification.rkey = op.mr->rkey;
+  }
+
+  GLOO_ENFORCE_EQ(localPendingRecv_.count(notification.id), 0);
+  localPendingRecv_[notification.id] = std::move(op);
+  sendRecvNotification(notification);
+}
+
+// Sends notification of a pending receive operation to the remote side
+// of this pair. The pair lock is expected to be held when called.
+void Pair::sendRecvNotification(const RecvNotification& notification) {
+  std::unique_ptr<MemoryRegion> mr;
+  if (freeNotificationRegions_.empty()) {
+    mr = make_unique<MemoryRegion>(dev_->pd_);
+  } else {
+    mr = std::move(freeNotificationRegions_.back());
+    freeNotificationRegions_.pop_back();
+  }
+  mr->set(notification);
+
+  const auto id = kUnboundWorkRequest | nextUnboundWorkRequestId_++;
+  struct ibv_sge list = mr->sge();
+  struct ibv_send_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = id;
+  wr.sg_list = &list;
+  wr.num_sge = 1;
+  wr.opcode = IBV_WR_SEND_WITH_IMM;
+  wr.send_flags = IBV_SEND_SIGNALED;
+  wr.imm_data = kUnboundImmediate;
+
+  int rv = postSend(&wr);
+  if (rv != 0) {
+    auto ex = ::gloo::IoException(GLOO_ERROR_MSG("ibv_post_send: ", rv));
+    setException(ex);
+    throw ex;
+  }
+
+  // Keep memory region around until this send operation completes.
+  mappedNotificationRegions_[id] = std::move(mr);
+}
+
+// Called when the remote side of this pair is ready to receive.
+// The pair lock is expected to be held when called.
+void Pair::handleRecvNotification(const RecvNotification& notification) {
+  auto it = localPendingSend_.find(notification.slot);
+  if (it == localPendingSend_.end() || it->second.empty()) {
+    remotePendingRecv_[notification.slot].push_back(notification);
+    return;
+  }
+
+  auto op = std::move(it->second.front());
+  it->second.pop_front();
+  if (it->second.empty()) {
+    localPendingSend_.erase(it);
+  }
+  sendUnboundBuffer(std::move(op), notification);
+}
+
+// Writes local buffer to the remote memory from the notification.
+// The pair lock is expected to be held when called.
+void Pair::sendUnboundBuffer(
+    UnboundBufferOp op,
+    const RecvNotification& notification) {
+  if (op.nbytes != notification.nbytes) {
+    auto ex = ::gloo::IoException(GLOO_ERROR_MSG(
+        "Size mismatch for unbound buffer with slot ",
+        notification.slot,
+        ": sending ",
+        op.nbytes,
+        " bytes, remote side expects ",
+        notification.nbytes,
+        " bytes"));
+    setException(ex);
+    throw ex;
+  }
+
+  NonOwningPtr<UnboundBuffer> buf(op.buf);
+  GLOO_ENFORCE(buf, "Unbound buffer was destructed before send");
+
+  const auto id = kUnboundWorkRequest | nextUnboundWorkRequestId_++;
+  struct ibv_sge list;
+  memset(&list, 0, sizeof(list));
+  struct ibv_send_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = id;
+  wr.opcode = IBV_WR_RDMA_WRITE_WITH_IMM;
+  wr.send_flags = IBV_SEND_SIGNALED;
+  wr.imm_data = kUnboundImmediate | notification.id;
+  if (op.nbytes > 0) {
+    list.addr = (uint64_t)buf->ptr + op.offset;
+    list.length = op.nbytes;
+    list.lkey = op.mr->lkey;
+    wr.sg_list = &list;
+    wr.num_sge = 1;
+    wr.wr.rdma.remote_addr = notification.addr;
+    wr.wr.rdma.rkey = notification.rkey;
+  }
+
+  auto rv = postSend(&wr);
+  if (rv != 0) {
+    auto ex = ::gloo::IoException(GLOO_ERROR_MSG("ibv_post_send: ", rv));
+    setException(ex);
+    throw ex;
+  }
+
+  // Keep memory registration around until this write completes.
+  unboundSendsInFlight_[id] = std::move(op);
 }
 
 // handleCompletionEvent is called by the device thread when it
@@ -382,7 +623,7 @@ void Pair::handleCompletionEvent() {
 // acquired. When called from the user thread, the mutex won't be
 // acquired (since there's only a single thread using this pair).
 void Pair::pollCompletions() {
-  std::array<struct ibv_wc, kCompletionQueueCapacity> wc;
+  std::array<struct ibv_wc, kPollCompletionsBatchSize> wc;
 
   // Invoke handler for every work completion.
   for (;;) {
@@ -403,7 +644,71 @@ void Pair::pollCompletions() {
 }
 
 void Pair::handleCompletion(struct ibv_wc* wc) {
-  if (wc->opcode == IBV_WC_RECV_RDMA_WITH_IMM) {
+  if (wc->opcode == IBV_WC_RECV_RDMA_WITH_IMM &&
+      (wc->imm_data & kUnboundImmediate)) {
+    // Incoming RDMA write to unbound buffer completed.
+    // Notification ID is encoded in immediate data.
+    // It is set in the Pair::sendUnboundBuffer function.
+    auto id = wc->imm_data & ~kUnboundImmediate;
+    GLOO_ENFORCE_EQ(
+      wc->status,
+      IBV_WC_SUCCESS,
+      "Recv for unbound buffer: ",
+      ibv_wc_status_str(wc->status));
+
+    auto it = localPendingRecv_.find(id);
+    GLOO_ENFORCE(it != localPendingRecv_.end());
+    NonOwningPtr<UnboundBuffer> buf(it->second.buf);
+    localPendingRecv_.erase(it);
+    if (buf) {
+      buf->handleRecvCompletion(rank_);
+    }
+
+    // Backfill receive work requests.
+    postReceive(wc);
+  } else if (
+      wc->opcode == IBV_WC_RDMA_WRITE && (wc->wr_id & kUnboundWorkRequest)) {
+    // Outbound RDMA write from unbound buffer completed.
+    GLOO_ENFORCE_EQ(
+      wc->status,
+      IBV_WC_SUCCESS,
+      "Send for unbound buffer: ",
+      ibv_wc_status_str(wc->status));
+
+    auto it = unboundSendsInFlight_.find(wc->wr_id);
+    GLOO_ENFORCE(it != unboundSendsInFlight_.end());
+    NonOwningPtr<UnboundBuffer> buf(it->second.buf);
+    unboundSendsInFlight_.erase(it);
+    if (buf) {
+      buf->handleSendCompletion(rank_);
+    }
+    handleSendCompletion();
+  } else if (wc->opcode == IBV_WC_RECV && (wc->imm_data & kUnboundImmediate)) {
+    // Notification of pending receive operation on the remote side.
+    GLOO_ENFORCE_EQ(
+      wc->status,
+      IBV_WC_SUCCESS,
+      "Recv notification: ",
+      ibv_wc_status_str(wc->status));
+
+    // Copy notification out of the 'inbox' before backfilling it.
+    auto notification = getMailbox(wc).get<RecvNotification>();
+    postReceive(wc);
+    handleRecvNotification(notification);
+  } else if (wc->opcode == IBV_WC_SEND && (wc->wr_id & kUnboundWorkRequest)) {
+    // Notification send completed.
+    GLOO_ENFORCE_EQ(
+      wc->status,
+      IBV_WC_SUCCESS,
+      "Send notification: ",
+      ibv_wc_status_str(wc->status));
+
+    auto it = mappedNotificationRegions_.find(wc->wr_id);
+    GLOO_ENFORCE(it != mappedNotificationRegions_.end());
+    freeNotificationRegions_.push_back(std::move(it->second));
+    mappedNotificationRegions_.erase(it);
+    handleSendCompletion();
+  } else if (wc->opcode == IBV_WC_RECV_RDMA_WITH_IMM) {
     // Incoming RDMA write completed.
     // Slot is encoded in immediate data on receive work completion.
     // It is set in the Pair::send function.
@@ -420,7 +725,7 @@ void Pair::handleCompletion(struct ibv_wc* wc) {
     recvCompletionHandlers_[slot]->handleCompletion(wc);
 
     // Backfill receive work requests.
-    postReceive();
+    postReceive(wc);
   } else if (wc->opcode == IBV_WC_RDMA_WRITE) {
     // Outbound RDMA write completed.
     // Slot is encoded in wr_id fields on send work request. Unlike
@@ -437,13 +742,12 @@ void Pair::handleCompletion(struct ibv_wc* wc) {
 
     GLOO_ENFORCE(sendCompletionHandlers_[slot] != nullptr);
     sendCompletionHandlers_[slot]->handleCompletion(wc);
+    handleSendCompletion();
   } else if (wc->opcode == IBV_WC_RECV) {
     // Memory region recv completed.
     //
     // Only used by the remote side of the pair to pass ibv_mr's.
-    // They are written to in FIFO order, so we can pick up
-    // and use the first MemoryRegion instance in the list of
-    // mapped receive regions.
+    // The work completion identifies the mailbox it was written to.
     //
     // The buffer trying to write to this slot might be waiting for
     // the other side of this pair to send its memory region.
@@ -461,14 +765,13 @@ void Pair::handleCompletion(struct ibv_wc* wc) {
       ibv_wc_status_str(wc->status));
 
     // Move ibv_mr from memory region 'inbox' to final slot.
-    const auto& mr = mappedRecvRegions_[recvPosted_ % kMaxBuffers];
-    peerMemoryRegions_[slot] = mr->mr();
+    peerMemoryRegions_[slot] = getMailbox(wc).mr();
 
     // Notify any buffer waiting for the details of its remote peer.
     cv_.notify_all();
 
     // Backfill receive work requests.
-    postReceive();
+    postReceive(wc);
   } else if (wc->opcode == IBV_WC_SEND) {
     // Memory region send completed.
     auto slot = wc->wr_id;
@@ -483,6 +786,7 @@ void Pair::handleCompletion(struct ibv_wc* wc) {
     GLOO_ENFORCE_GT(mappedSendRegions_.size(), 0);
     GLOO_ENFORCE_EQ(mappedSendRegions_.count(slot), 1);
     mappedSendRegions_.erase(slot);
+    handleSendCompletion();
   } else {
     GLOO_ENFORCE(false, "Unexpected completion with opcode: ", wc->opcode);
   }
@@ -508,8 +812,11 @@ void Pair::send(Buffer* buffer, size_t offset, size_t length, size_t roffset) {
   wr.wr.rdma.remote_addr = (uint64_t)peer->addr + roffset;
   wr.wr.rdma.rkey = peer->rkey;
 
-  struct ibv_send_wr* bad_wr;
-  auto rv = ibv_post_send(qp_, &wr, &bad_wr);
+  int rv;
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    rv = postSend(&wr);
+  }
   if (rv != 0) {
     signalIoFailure(GLOO_ERROR_MSG("ibv_post_send: ", rv));
   }
@@ -518,25 +825,54 @@ void Pair::send(Buffer* buffer, size_t offset, size_t length, size_t roffset) {
 void Pair::signalIoFailure(const std::string& msg) {
   std::lock_guard<std::mutex> lock(m_);
   auto ex = ::gloo::IoException(msg);
-  if (ex_ == nullptr) {
-    // If we haven't seen an error yet, store the exception to throw on future
-    // calling threads.
-    ex_ = std::make_exception_ptr(ex);
-    // Loop through the completion handlers and signal that an error has
-    // occurred.
-    for (auto& it : recvCompletionHandlers_) {
-      GLOO_ENFORCE(it.second != nullptr);
-      it.second->signalError(ex_);
-    }
-    for (auto& it : sendCompletionHandlers_) {
-      GLOO_ENFORCE(it.second != nullptr);
-      it.second->signalError(ex_);
-    }
-  }
+  setException(ex);
   // Finally, throw the exception on this thread.
   throw ex;
 };
 
+void Pair::signalExceptionExternal(const std::string& msg) {
+  std::lock_guard<std::mutex> lock(m_);
+  setException(::gloo::IoException(msg));
+}
+
+void Pair::setException(const ::gloo::IoException& ex) {
+  if (ex_ != nullptr) {
+    return;
+  }
+
+  // If we haven't seen an error yet, store the exception to throw on future
+  // calling threads.
+  ex_ = std::make_exception_ptr(ex);
+  // Loop through the completion handlers and signal that an error has
+  // occurred.
+  for (auto& it : recvCompletionHandlers_) {
+    GLOO_ENFORCE(it.second != nullptr);
+    it.second->signalError(ex_);
+  }
+  for (auto& it : sendCompletionHandlers_) {
+    GLOO_ENFORCE(it.second != nullptr);
+    it.second->signalError(ex_);
+  }
+  // Signal unbound buffers with pending operations.
+  auto signal = [&](const UnboundBufferOp& op) {
+    NonOwningPtr<UnboundBuffer> buf(op.buf);
+    if (buf) {
+      buf->signalException(ex_);
+    }
+  };
+  for (auto& it : localPendingSend_) {
+    for (auto& op : it.second) {
+      signal(op);
+    }
+  }
+  for (auto& it : localPendingRecv_) {
+    signal(it.second);
+  }
+  for (auto& it : unboundSendsInFlight_) {
+    signal(it.second);
+  }
+}
+
 void Pair::checkErrorState() {
   // If we previously encountered an error, rethrow here.
   if (ex_ != nullptr) {
@@ -10,17 +10,22 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <exception>
 #include <list>
-#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "gloo/common/error.h"
+#include "gloo/common/memory.h"
 #include "gloo/transport/ibverbs/address.h"
 #include "gloo/transport/ibverbs/device.h"
 #include "gloo/transport/ibverbs/memory_region.h"
+#include "gloo/transport/ibverbs/registration_cache.h"
+#include "gloo/transport/ibverbs/send_queue.h"
 #include "gloo/transport/pair.h"
 
 namespace gloo {
@@ -30,12 +35,24 @@ namespace ibverbs {
 // Forward declaration
 class Buffer;
 
+// Forward declaration
+class Context;
+
+// Forward declaration
+class UnboundBuffer;
+
 class Pair : public ::gloo::transport::Pair {
-  static constexpr int kMaxBuffers = 8;
-  static constexpr auto kRecvCompletionQueueCapacity = kMaxBuffers;
-  static constexpr auto kSendCompletionQueueCapacity = kMaxBuffers;
-  static constexpr auto kCompletionQueueCapacity =
-    kRecvCompletionQueueCapacity + kSendCompletionQueueCapacity;
+  // Maximum number of send work requests posted to the queue pair.
+  // Capped by the device's limits (see ibv_query_device(3)). Send work
+  // requests in excess of this number are queued until others complete.
+  static constexpr int kSendQueueCapacity = 128;
+
+  // Maximum number of receive work requests posted to the queue pair
+  // if the device doesn't support shared receive queues.
+  static constexpr int kRecvQueueCapacity = 64;
+
+  // Maximum number of work completions to poll for at once.
+  static constexpr int kPollCompletionsBatchSize = 16;
 
   // The ibv_req_notify(3) function takes an argument called
   // 'solicited_only' which makes it only trigger a notification for
@@ -43,8 +60,16 @@ class Pair : public ::gloo::transport::Pair {
   // should trigger a notification, so always pass 0.
   static constexpr auto kNotifyOnAnyCompletion = 0;
 
+  // Work request IDs and immediate data of operations on unbound
+  // buffers are flagged to tell them apart from those of operations on
+  // (bound) buffers, which carry the buffer's slot.
+  static constexpr uint64_t kUnboundWorkRequest = 1ULL << 63;
+  static constexpr uint32_t kUnboundImmediate = 1U << 31;
+
  public:
   explicit Pair(
+      Context* context,
+      int rank,
       const std::shared_ptr<Device>& dev,
       std::chrono::milliseconds timeout);
 
@@ -82,6 +107,10 @@ class Pair : public ::gloo::transport::Pair {
 
   void handleCompletionEvent();
 
+  // Resizes the completion queue to hold completions for the send
+  // queue and the specified number of receive work requests.
+  void resizeCompletionQueue(int recvQueueCapacity);
+
   void pollCompletions();
 
   void handleCompletion(struct ibv_wc* wc);
@@ -91,6 +120,12 @@ class Pair : public ::gloo::transport::Pair {
   void close() override;
 
  protected:
+  // Refer to parent context using raw pointer. The context holds a
+  // unique_ptr to this pair, so it is valid for the lifetime of this pair.
+  Context* const context_;
+
+  const int rank_;
+
   std::shared_ptr<Device> dev_;
 
   // Whether or not this pair is running in sync mode.
@@ -113,11 +148,19 @@ class Pair : public ::gloo::transport::Pair {
   struct ibv_cq* cq_;
   struct ibv_qp* qp_;
 
+  // Send work requests that can't be posted because the send queue
+  // of the queue pair is full are posted as others complete.
+  SendQueue sendQueue_;
+
+  // Mailboxes of this pair's own receive queue. Only used if the
+  // device doesn't support shared receive queues (see Device::srq_).
+  std::vector<std::unique_ptr<MemoryRegion>> mailboxes_;
+
   std::mutex m_;
   std::condition_variable cv_;
 
   // For us to copy the remote peer's ibv_mr into.
-  std::map<int, struct ibv_mr> peerMemoryRegions_;
+  std::unordered_map<int, struct ibv_mr> peerMemoryRegions_;
 
   // These fields store memory regions that the remote side of the pair
   // can send to and that the local side of the pair can send from.
@@ -127,27 +170,92 @@ class Pair : public ::gloo::transport::Pair {
   // instance is kept around in the mappedSendRegions_ list until
   // the send operation complete.
   //
-  // To allow the remote side of the pair to send its memory regions,
-  // we keep a fixed number of MemoryRegion instances in
-  // mappedRecvRegions_. These regions are referenced round-robin for
-  // every posted receive work request.
+  // The remote side of the pair sends its memory regions to one of
+  // the mailboxes of the device's shared receive queue, or of this
+  // pair's own receive queue. The work completion identifies the
+  // mailbox (see Device::postReceive and Pair::postReceive).
   //
-  std::map<int, std::unique_ptr<MemoryRegion> > mappedSendRegions_;
-  std::array<std::unique_ptr<MemoryRegion>, kMaxBuffers> mappedRecvRegions_;
-
-  // Keep track of number of request work requests posted and completed.
-  // This is needed to index into the mappedRecvRegions_ array both
-  // when posting the WR and when completing the WR.
-  uint64_t recvPosted_;
+  std::unordered_map<int, std::unique_ptr<MemoryRegion>> mappedSendRegions_;
 
-  // Completions on behalf of buffers need to be forwarded to those buffers.
-  std::map<int, Buffer*> sendCompletionHandlers_;
-  std::map<int, Buffer*> recvCompletionHandlers_;
+  // Completions on behalf of buffers need to be forwarded to those
+  // buffers. These tables map a buffer's slot to the buffer itself.
+  std::unordered_map<int, Buffer*> sendCompletionHandlers_;
+  std::unordered_map<int, Buffer*> recvCompletionHandlers_;
 
   void sendMemoryRegion(struct ibv_mr* mr, int slot);
   const struct ibv_mr* getMemoryRegion(int slot);
 
-  void postReceive();
+  // Unbound buffers use a receiver driven protocol. When an unbound
+  // buffer is ready to receive, the remote side of the pair is sent
+  // a notification with the address, size, and key of the memory to
+  // write to. The remote side executes the RDMA write once it has a
+  // matching send operation. The write carries the notification's ID
+  // in its immediate data, which identifies the receive operation.
+  //
+  // The notification is sent to the same mailboxes as the memory
+  // regions of (bound) buffers, so it must fit in a struct ibv_mr.
+  struct RecvNotification {
+    uint64_t slot;
+    uint64_t addr;
+    uint64_t nbytes;
+    uint32_t rkey;
+    uint32_t id;
+  };
+
+  // Local operation on unbound buffer. Holds on to the buffer's memory
+  // registration until the operation completes.
+  struct UnboundBufferOp {
+    WeakNonOwningPtr<UnboundBuffer> buf;
+    RegistrationCache::Registration mr;
+    size_t offset;
+    size_t nbytes;
+  };
+
+  // Send operations waiting for a notification from the remote side.
+  std::unordered_map<uint64_t, std::deque<UnboundBufferOp>> localPendingSend_;
+
+  // Notifications from the remote side waiting for a send operation.
+  std::unordered_map<uint64_t, std::deque<RecvNotification>>
+      remotePendingRecv_;
+
+  // Receive operations the remote side was notified of, by ID.
+  std::unordered_map<uint32_t, UnboundBufferOp> localPendingRecv_;
+
+  // Send operations that were posted, by work request ID.
+  std::unordered_map<uint64_t, UnboundBufferOp> unboundSendsInFlight_;
+
+  // Mailboxes for notifications that were posted, by work request ID.
+  // Mailboxes are recycled to avoid registering memory for every one.
+  std::unordered_map<uint64_t, std::unique_ptr<MemoryRegion>>
+      mappedNotificationRegions_;
+  std::vector<std::unique_ptr<MemoryRegion>> freeNotificationRegions_;
+
+  uint32_t nextRecvNotificationId_;
+  uint64_t nextUnboundWorkRequestId_;
+
+  void sendRecvNotification(const RecvNotification& notification);
+  void handleRecvNotification(const RecvNotification& notification);
+  void sendUnboundBuffer(
+      UnboundBufferOp op,
+      const RecvNotification& notification);
+
+  // Posts send work request, or queues it if the send queue is full.
+  // The work request is copied, so it doesn't need to be valid after
+  // this call. Returns the return value of ibv_post_send(3).
+  int postSend(struct ibv_send_wr* wr);
+
+  // Called for every send work completion. Posts queued work requests.
+  void handleSendCompletion();
+
+  // Posts receive work request for the specified mailbox to this
+  // pair's own receive queue.
+  void postReceive(uint64_t id);
+
+  // Backfills receive work request for the mailbox of this completion.
+  void postReceive(struct ibv_wc* wc);
+
+  // Returns mailbox that the remote side of the pair sent to.
+  const MemoryRegion& getMailbox(struct ibv_wc* wc);
 
   std::chrono::milliseconds getTimeout() const {
     return timeout_;
@@ -165,7 +273,17 @@ class Pair : public ::gloo::transport::Pair {
   void signalIoFailure(const std::string& msg);
   void checkErrorState();
 
+  // Stores exception and signals buffers with pending operations.
+  // The pair mutex is expected to be held when called.
+  void setException(const ::gloo::IoException& ex);
+
+  // Like signalIoFailure, but doesn't throw. Used by the context to
+  // signal all pairs when an operation on an unbound buffer times out.
+  void signalExceptionExternal(const std::string& msg);
+
   friend class Buffer;
+
+  friend class Context;
 };
 
 } // namespace ibverbs
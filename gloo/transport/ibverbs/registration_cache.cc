@@ -0,0 +1,179 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/transport/ibverbs/registration_cache.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <string.h>
+
+#include "gloo/common/logging.h"
+
+namespace gloo {
+namespace transport {
+namespace ibverbs {
+
+RegistrationCache::RegistrationCache(struct ibv_pd* pd, size_t capacity)
+    : pd_(pd), capacity_(capacity), hits_(0), misses_(0) {
+  GLOO_ENFORCE_GT(capacity_, 0);
+}
+
+RegistrationCache::Registration RegistrationCache::lookup(
+    void* ptr,
+    size_t size) {
+  std::lock_guard<std::mutex> guard(m_);
+  return find(ptr, size)->second.mr;
+}
+
+void RegistrationCache::invalidate(void* ptr, size_t size) {
+  const auto start = reinterpret_cast<uintptr_t>(ptr);
+  const auto end = start + size;
+  std::lock_guard<std::mutex> guard(m_);
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->first < end && start < it->second.end && it->second.pins == 0) {
+      auto next = std::next(it);
+      erase(it);
+      it = next;
+    } else {
+      ++it;
+    }
+  }
+}
+
+void RegistrationCache::pin(void* ptr, size_t size) {
+  const auto start = reinterpret_cast<uintptr_t>(ptr);
+  const auto end = start + size;
+  std::lock_guard<std::mutex> guard(m_);
+
+  // The pinned registration is keyed by the start of the range, so
+  // that unpin can find it again. A covering registration with a
+  // lower start address is not used.
+  auto it = entries_.find(start);
+  if (it == entries_.end() || it->second.end < end) {
+    misses_++;
+    it = insert(ptr, size);
+  }
+  it->second.pins++;
+}
+
+void RegistrationCache::unpin(void* ptr, size_t size) {
+  const auto start = reinterpret_cast<uintptr_t>(ptr);
+  const auto end = start + size;
+  std::lock_guard<std::mutex> guard(m_);
+  auto it = entries_.find(start);
+  GLOO_ENFORCE(
+      it != entries_.end() && it->second.end >= end && it->second.pins > 0,
+      "Memory range is not pinned");
+
+  // The memory may be released after it is unpinned.
+  if (--it->second.pins == 0) {
+    erase(it);
+  }
+}
+
+size_t RegistrationCache::size() {
+  std::lock_guard<std::mutex> guard(m_);
+  return entries_.size();
+}
+
+size_t RegistrationCache::hits() {
+  std::lock_guard<std::mutex> guard(m_);
+  return hits_;
+}
+
+size_t RegistrationCache::misses() {
+  std::lock_guard<std::mutex> guard(m_);
+  return misses_;
+}
+
+RegistrationCache::Registration RegistrationCache::registerMemory(
+    void* ptr,
+    size_t size) {
+  auto mr = ibv_reg_mr(
+      pd_, ptr, size, IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE);
+
+  // Provide hint if the error is ENOMEM
+  if (mr == nullptr && errno == ENOMEM) {
+    GLOO_ENFORCE(
+        mr != nullptr,
+        "ibv_reg_mr: ",
+        strerror(errno),
+        " (did you run into the locked memory limit?)");
+  }
+
+  GLOO_ENFORCE(mr != nullptr, "ibv_reg_mr: ", strerror(errno));
+  return Registration(mr, [](struct ibv_mr* mr) { ibv_dereg_mr(mr); });
+}
+
+std::map<uintptr_t, RegistrationCache::Entry>::iterator
+RegistrationCache::find(void* ptr, size_t size) {
+  const auto start = reinterpret_cast<uintptr_t>(ptr);
+  const auto end = start + size;
+
+  // Find the registration with the highest start address that is not
+  // greater than the start of the requested range.
+  auto it = entries_.upper_bound(start);
+  if (it != entries_.begin()) {
+    --it;
+    if (it->second.end >= end) {
+      lru_.splice(lru_.begin(), lru_, it->second.lru);
+      hits_++;
+      return it;
+    }
+  }
+
+  misses_++;
+  return insert(ptr, size);
+}
+
+std::map<uintptr_t, RegistrationCache::Entry>::iterator
+RegistrationCache::insert(void* ptr, size_t size) {
+  const auto start = reinterpret_cast<uintptr_t>(ptr);
+  size_t pins = 0;
+
+  // Replace registration with the same start address (that must be
+  // smaller than the requested range), if any. The new registration
+  // covers its range, so it inherits its pins.
+  auto it = entries_.find(start);
+  if (it != entries_.end()) {
+    pins = it->second.pins;
+    erase(it);
+  }
+
+  // Evict the least recently used registrations that are not pinned.
+  // If all of them are pinned, the cache exceeds its capacity.
+  while (entries_.size() >= capacity_) {
+    auto victim = std::find_if(
+        lru_.rbegin(), lru_.rend(), [this](uintptr_t key) {
+          return entries_.at(key).pins == 0;
+        });
+    if (victim == lru_.rend()) {
+      break;
+    }
+    erase(entries_.find(*victim));
+  }
+
+  auto mr = registerMemory(ptr, size);
+  lru_.push_front(start);
+  Entry entry;
+  entry.end = start + size;
+  entry.mr = mr;
+  entry.lru = lru_.begin();
+  entry.pins = pins;
+  return entries_.emplace(start, std::move(entry)).first;
+}
+
+void RegistrationCache::erase(std::map<uintptr_t, Entry>::iterator it) {
+  lru_.erase(it->second.lru);
+  entries_.erase(it);
+}
+
+} // namespace ibverbs
+} // namespace transport
+} // namespace gloo
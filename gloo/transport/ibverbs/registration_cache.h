@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <infiniband/verbs.h>
+
+namespace gloo {
+namespace transport {
+namespace ibverbs {
+
+// Caches memory registrations of unbound buffers, so that repeated
+// operations against the same memory (e.g. running the same
+// collective on the same tensors over and over) don't have to call
+// ibv_reg_mr(3) every time.
+//
+// Registrations are keyed by address range. A lookup is served from
+// the cache if a registration exists that covers the requested range.
+// If the cache is at capacity, the least recently used registration
+// is evicted. Registrations are reference counted: if an evicted
+// registration is still in use by a pending operation, it is only
+// deregistered after that operation completes.
+//
+// Note that a registration pins the pages that back it. If memory is
+// released and the same virtual address range is mapped again, a
+// cached registration still refers to the old pages. Therefore, an
+// unbound buffer invalidates the range it covers when it is destroyed
+// (see invalidate()), and a registration is only served from the
+// cache while a buffer over the same memory exists.
+//
+// Memory that outlives the buffers over it (e.g. tensors that are
+// passed to a new collective every iteration, or scratch memory that
+// is wrapped by short lived buffers) can be pinned (see pin()). A
+// pinned registration is neither evicted nor invalidated until it is
+// unpinned, so every buffer over that memory is served from the cache.
+// The owner of the memory must unpin it before releasing it.
+//
+class RegistrationCache {
+ public:
+  using Registration = std::shared_ptr<struct ibv_mr>;
+
+  static constexpr size_t kDefaultCapacity = 256;
+
+  RegistrationCache(struct ibv_pd* pd, size_t capacity = kDefaultCapacity);
+
+  virtual ~RegistrationCache() = default;
+
+  RegistrationCache(const RegistrationCache& that) = delete;
+
+  RegistrationCache& operator=(const RegistrationCache& that) = delete;
+
+  // Returns registration that covers the specified address range.
+  Registration lookup(void* ptr, size_t size);
+
+  // Removes all registrations that overlap with the specified
+  // address range from the cache, except for pinned ones.
+  void invalidate(void* ptr, size_t size);
+
+  // Registers the specified address range and keeps it cached until
+  // unpin() is called with the same range. Calls may be nested.
+  void pin(void* ptr, size_t size);
+
+  void unpin(void* ptr, size_t size);
+
+  // Number of cached registrations.
+  size_t size();
+
+  // Number of lookups that were served from the cache.
+  size_t hits();
+
+  // Number of lookups that required a new registration.
+  size_t misses();
+
+ protected:
+  struct Entry {
+    uintptr_t end;
+    Registration mr;
+    std::list<uintptr_t>::iterator lru;
+    size_t pins;
+  };
+
+  struct ibv_pd* const pd_;
+  const size_t capacity_;
+
+  std::mutex m_;
+
+  // Registrations keyed by start address.
+  std::map<uintptr_t, Entry> entries_;
+
+  // Start address of registrations, most recently used first.
+  std::list<uintptr_t> lru_;
+
+  size_t hits_;
+  size_t misses_;
+
+  // Registers the specified address range with the protection domain.
+  virtual Registration registerMemory(void* ptr, size_t size);
+
+  // Returns registration that covers the specified address range,
+  // registering it if needed. Must be called when holding lock.
+  std::map<uintptr_t, Entry>::iterator find(void* ptr, size_t size);
+
+  // Registers the specified address range and adds it to the cache.
+  // Must be called when holding lock.
+  std::map<uintptr_t, Entry>::iterator insert(void* ptr, size_t size);
+
+  void erase(std::map<uintptr_t, Entry>::iterator it);
+};
+
+} // namespace ibverbs
+} // namespace transport
+} // namespace gloo
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/transport/ibverbs/send_queue.h"
+
+#include <utility>
+
+#include "gloo/common/logging.h"
+
+namespace gloo {
+namespace transport {
+namespace ibverbs {
+
+SendQueue::SendQueue(int capacity, PostFunction post)
+    : capacity_(capacity), post_(std::move(post)), posted_(0) {
+  GLOO_ENFORCE_GT(capacity_, 0);
+}
+
+int SendQueue::post(struct ibv_send_wr* wr) {
+  GLOO_ENFORCE_LE(wr->num_sge, 1);
+  if (posted_ == capacity_) {
+    PendingSend pending;
+    pending.wr = *wr;
+    pending.wr.next = nullptr;
+    if (wr->num_sge > 0) {
+      pending.sge = *wr->sg_list;
+    }
+    pending_.push_back(pending);
+    return 0;
+  }
+
+  auto rv = post_(wr);
+  if (rv == 0) {
+    posted_++;
+  }
+  return rv;
+}
+
+int SendQueue::complete() {
+  GLOO_ENFORCE_GT(posted_, 0);
+  posted_--;
+  if (pending_.empty()) {
+    return 0;
+  }
+
+  auto pending = pending_.front();
+  pending_.pop_front();
+  if (pending.wr.num_sge > 0) {
+    pending.wr.sg_list = &pending.sge;
+  }
+  return post(&pending.wr);
+}
+
+} // namespace ibverbs
+} // namespace transport
+} // namespace gloo
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+
+#include <infiniband/verbs.h>
+
+namespace gloo {
+namespace transport {
+namespace ibverbs {
+
+// Software queue in front of the send queue of a queue pair.
+//
+// A queue pair has a fixed number of send work requests that can be
+// outstanding. Rather than failing when the number of operations in
+// flight exceeds that number, work requests are queued and posted in
+// FIFO order as others complete.
+//
+// This class is not thread safe. The pair that owns it serializes
+// access with its own lock.
+class SendQueue {
+ public:
+  // Function that posts a work request to the queue pair (typically
+  // a call to ibv_post_send(3)). Returns zero on success.
+  using PostFunction = std::function<int(struct ibv_send_wr* wr)>;
+
+  SendQueue(int capacity, PostFunction post);
+
+  // Posts send work request, or queues it if the send queue is full.
+  // The work request is copied, so it doesn't need to be valid after
+  // this call. Returns the return value of the post function.
+  int post(struct ibv_send_wr* wr);
+
+  // Called for every send work completion. Posts the oldest queued
+  // work request, if any. Returns the return value of the post
+  // function, or zero if nothing was posted.
+  int complete();
+
+  int capacity() const {
+    return capacity_;
+  }
+
+  // Returns number of work requests that were posted and haven't
+  // completed.
+  int posted() const {
+    return posted_;
+  }
+
+  // Returns number of work requests waiting for a slot in the send
+  // queue.
+  size_t queued() const {
+    return pending_.size();
+  }
+
+ private:
+  // Queued work requests keep a copy of their (single) scatter/gather
+  // element, because the caller's list may not outlive the call.
+  struct PendingSend {
+    struct ibv_send_wr wr;
+    struct ibv_sge sge;
+  };
+
+  const int capacity_;
+  const PostFunction post_;
+  int posted_;
+  std::deque<PendingSend> pending_;
+};
+
+} // namespace ibverbs
+} // namespace transport
+} // namespace gloo
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <string>
 
 #include <sys/socket.h>
@@ -16,6 +18,64 @@ namespace gloo {
 namespace transport {
 namespace tcp {
 
+// Socket tuning profile that is applied to every pair created on a
+// device. When enabled, a pair sizes the send and receive buffers of
+// its socket to the bandwidth-delay product of the link.
+//
+// The buffers must be sized before the socket is connected: the TCP
+// window scale is negotiated during the handshake, so buffers grown
+// afterwards cannot be fully used. Setting them explicitly also
+// disables the kernel's buffer autotuning for the socket. Therefore,
+// if the bandwidth-delay product exceeds what the kernel allows
+// (net.core.{r,w}mem_max), the buffers are left to autotuning instead
+// of being silently capped, and a warning is printed.
+//
+// Neither the bandwidth nor the round trip time are measured before
+// connecting. The bandwidth is taken from this struct, the speed of
+// the network interface, or kDefaultBandwidthMbps, in that order.
+// The round trip time is taken from this struct, or else the largest
+// round trip time measured on previously connected pairs of the same
+// device. If neither is known, the buffers are left to autotuning.
+// The values that were chosen can be retrieved from the pair through
+// Pair::getSocketOptions() for logging purposes.
+struct tuning {
+  bool enabled = false;
+
+  // Link bandwidth used to compute the bandwidth-delay product. If not
+  // specified, the speed of the device's network interface is used.
+  // If that is not known either (e.g. loopback), kDefaultBandwidthMbps
+  // is used instead. Note that the interface speed is the line rate,
+  // not the bandwidth that is achievable end to end.
+  int bandwidthMbps = 0;
+
+  static constexpr int kDefaultBandwidthMbps = 10000;
+
+  // Expected round trip time between peers.
+  std::chrono::microseconds rtt{0};
+
+  // Bounds on the socket buffer sizes. Sizes larger than what the
+  // kernel allows are not applied at all (see above).
+  size_t minBufferSize = 256 * 1024;
+  size_t maxBufferSize = 32 * 1024 * 1024;
+
+  // Upper bound for SO_RCVLOWAT while receiving the payload of a
+  // large message. The event loop is only woken up when at least
+  // this many bytes (or the remainder of the message) can be read.
+  // A value of 0 disables this option.
+  int recvLowWatermark = 0;
+
+  // Value for TCP_NOTSENT_LOWAT. Limits the amount of unsent data in
+  // the socket's write queue, so that the kernel doesn't keep
+  // megabytes of data queued that it cannot put on the wire yet.
+  // A value of 0 disables this option.
+  int notSentLowWatermark = 0;
+
+  // Value for SO_BUSY_POLL in microseconds. Increasing this beyond
+  // the system default (see net.core.busy_read) requires
+  // CAP_NET_ADMIN. A value of 0 disables this option.
+  int busyPollMicroseconds = 0;
+};
+
 struct attr {
   attr() {}
   /* implicit */ attr(const char* ptr) : hostname(ptr) {}
@@ -31,6 +91,9 @@ struct attr {
   int ai_protocol;
   struct sockaddr_storage ai_addr;
   int ai_addrlen;
+
+  // Socket tuning profile for pairs created on this device.
+  struct tuning tuning;
 };
 
 } // namespace tcp
@@ -8,6 +8,8 @@
 
 #include "gloo/transport/tcp/device.h"
 
+#include <array>
+
 #include <ifaddrs.h>
 #include <netdb.h>
 #include <netinet/in.h>
@@ -217,7 +219,14 @@ Device::Device(const struct attr& attr)
       loop_(std::make_shared<Loop>()),
       interfaceName_(sockaddrToInterfaceName(attr_)),
       interfaceSpeedMbps_(getInterfaceSpeedByName(interfaceName_)),
-      pciBusID_(interfaceToBusID(interfaceName_)) {
+      pciBusID_(interfaceToBusID(interfaceName_)),
+      numaNode_(pciNumaNode(pciBusID_)),
+      measuredRttMicroseconds_(0) {
+  // Run the event loop on the NUMA node of the NIC, so that it
+  // doesn't copy data across sockets.
+  if (numaNode_ >= 0) {
+    loop_->setAffinity(numaNodeCpus(numaNode_));
+  }
 }
 
 Device::~Device() {
@@ -229,7 +238,13 @@ std::string Device::str() const {
   ss << ", pci=" << pciBusID_;
   ss << ", iface=" << interfaceName_;
   ss << ", speed=" << interfaceSpeedMbps_;
+  if (numaNode_ >= 0) {
+    ss << ", numa=" << numaNode_;
+  }
   ss << ", addr=" << Address(attr_.ai_addr).str();
+  if (attr_.tuning.enabled) {
+    ss << ", tuning=bdp";
+  }
   return ss.str();
 }
 
@@ -241,6 +256,22 @@ int Device::getInterfaceSpeed() const {
   return interfaceSpeedMbps_;
 }
 
+int Device::getNumaNode() const {
+  return numaNode_;
+}
+
+std::chrono::microseconds Device::getMeasuredRtt() const {
+  return std::chrono::microseconds(measuredRttMicroseconds_.load());
+}
+
+void Device::updateMeasuredRtt(std::chrono::microseconds rtt) {
+  auto current = measuredRttMicroseconds_.load();
+  while (rtt.count() > current &&
+         !measuredRttMicroseconds_.compare_exchange_weak(
+             current, rtt.count())) {
+  }
+}
+
 std::shared_ptr<transport::Context> Device::createContext(
     int rank, int size) {
   return std::shared_ptr<transport::Context>(
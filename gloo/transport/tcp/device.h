@@ -9,6 +9,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -43,12 +44,19 @@ class Device : public ::gloo::transport::Device,
 
   virtual int getInterfaceSpeed() const override;
 
+  virtual int getNumaNode() const override;
+
   virtual std::shared_ptr<::gloo::transport::Context> createContext(
       int rank, int size) override;
 
   void registerDescriptor(int fd, int events, Handler* h);
   void unregisterDescriptor(int fd, Handler* h);
 
+  // Largest round trip time measured on pairs of this device.
+  // Used to size the socket buffers of pairs connected later.
+  std::chrono::microseconds getMeasuredRtt() const;
+  void updateMeasuredRtt(std::chrono::microseconds rtt);
+
  protected:
   const struct attr attr_;
 
@@ -61,6 +69,9 @@ class Device : public ::gloo::transport::Device,
   std::string interfaceName_;
   int interfaceSpeedMbps_;
   std::string pciBusID_;
+  int numaNode_;
+
+  std::atomic<int64_t> measuredRttMicroseconds_;
 };
 
 } // namespace tcp
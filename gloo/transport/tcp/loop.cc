@@ -14,6 +14,7 @@
 #include <array>
 
 #include <gloo/common/error.h>
+#include <gloo/common/linux.h>
 #include <gloo/common/logging.h>
 
 #if defined(__SANITIZE_THREAD__)
@@ -81,6 +82,11 @@ void Loop::unregisterDescriptor(int fd, Handler* h) {
   }
 }
 
+void Loop::setAffinity(const std::vector<int>& cpus) {
+  // Affinity is an optimization; failing to set it is not an error.
+  setThreadAffinity(*loop_, cpus);
+}
+
 void Loop::run() {
   std::array<struct epoll_event, capacity_> events;
   int nfds;
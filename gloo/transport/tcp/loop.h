@@ -13,6 +13,7 @@
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include <sys/epoll.h>
 
@@ -42,6 +43,9 @@ class Loop final : public std::enable_shared_from_this<Loop> {
 
   void unregisterDescriptor(int fd, Handler *h);
 
+  // Restricts the loop thread to the specified CPUs.
+  void setAffinity(const std::vector<int>& cpus);
+
   void run();
 
  private:
@@ -18,6 +18,7 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/epoll.h>
@@ -61,6 +62,7 @@ Pair::Pair(
       busyPoll_(false),
       fd_(FD_INVALID),
       sendBufferSize_(0),
+      recvLowWatermark_(1),
       is_client_(false),
       ex_(nullptr) {
   listen();
@@ -204,6 +206,10 @@ void Pair::listen() {
     }
   // END of my code block
 
+  if (attr.tuning.enabled) {
+    applyBufferSizes(fd);
+  }
+
   // listen(2) on socket
   fd_ = fd;
   rv = ::listen(fd_, 1);
@@ -291,6 +297,10 @@ void Pair::connect(const Address& peer) {
     signalAndThrowException(GLOO_ERROR_MSG("setsockopt: ", strerror(errno)));
   }
 
+  if (device_->attr_.tuning.enabled) {
+    applyBufferSizes(fd_);
+  }
+
   // Connect to peer
   rv = ::connect(fd_, (struct sockaddr*)&peerAddr, addrlen);
   if (rv == -1 && errno != EINPROGRESS) {
@@ -563,6 +573,7 @@ bool Pair::read() {
     };
     const auto nbytes = prepareRead(rx_, buf, iov);
     if (nbytes < 0) {
+      updateRecvLowWatermark(0);
       return false;
     }
 
@@ -573,6 +584,8 @@ bool Pair::read() {
       break;
     }
 
+    updateRecvLowWatermark(nbytes);
+
     // If busy-poll has been requested AND sync mode has been enabled for pair
     // we'll keep spinning calling recv() on socket by supplying MSG_DONTWAIT
     // flag. This is more efficient in terms of latency than allowing the kernel
@@ -630,6 +643,7 @@ bool Pair::read() {
     rx_.nread += rv;
   }
 
+  updateRecvLowWatermark(0);
   readComplete(buf);
   return true;
 }
@@ -856,10 +870,187 @@ void Pair::handleConnected() {
   rv = setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
   GLOO_ENFORCE_NE(rv, -1);
 
+  if (device_->attr_.tuning.enabled) {
+    applyTuning();
+  }
+
   device_->registerDescriptor(fd_, EPOLLIN, this);
   changeState(CONNECTED);
 }
 
+static size_t getSocketBufferSize(int fd, int optname) {
+  int optval = 0;
+  socklen_t optlen = sizeof(optval);
+  auto rv = getsockopt(fd, SOL_SOCKET, optname, &optval, &optlen);
+  GLOO_ENFORCE_NE(rv, -1, strerror(errno));
+  return optval;
+}
+
+static size_t setSocketBufferSize(int fd, int optname, size_t size) {
+  int optval = size;
+  socklen_t optlen = sizeof(optval);
+  auto rv = setsockopt(fd, SOL_SOCKET, optname, &optval, optlen);
+  GLOO_ENFORCE_NE(rv, -1, strerror(errno));
+  return getSocketBufferSize(fd, optname);
+}
+
+// Returns the value of net.core.rmem_max or net.core.wmem_max,
+// or 0 if it cannot be read.
+static size_t readSocketBufferLimit(const char* path) {
+  size_t limit = 0;
+  auto fp = fopen(path, "r");
+  if (fp == nullptr) {
+    return 0;
+  }
+  if (fscanf(fp, "%zu", &limit) != 1) {
+    limit = 0;
+  }
+  fclose(fp);
+  return limit;
+}
+
+void Pair::applyBufferSizes(int fd) {
+  const auto& tuning = device_->attr_.tuning;
+
+  socketOptions_.bandwidthMbps = tuning.bandwidthMbps;
+  if (socketOptions_.bandwidthMbps <= 0) {
+    socketOptions_.bandwidthMbps = device_->getInterfaceSpeed();
+  }
+  if (socketOptions_.bandwidthMbps <= 0) {
+    socketOptions_.bandwidthMbps = tuning::kDefaultBandwidthMbps;
+  }
+
+  socketOptions_.expectedRtt = tuning.rtt;
+  if (socketOptions_.expectedRtt.count() <= 0) {
+    socketOptions_.expectedRtt = device_->getMeasuredRtt();
+  }
+  if (socketOptions_.expectedRtt.count() <= 0) {
+    // Nothing to size the buffers with; leave them to autotuning.
+    return;
+  }
+
+  // Megabits per second times microseconds yields bits.
+  socketOptions_.bdp = (size_t)socketOptions_.bandwidthMbps *
+      socketOptions_.expectedRtt.count() / 8;
+  auto size = std::max(socketOptions_.bdp, tuning.minBufferSize);
+  size = std::min(size, tuning.maxBufferSize);
+
+  // The kernel silently caps sizes to these limits, which would also
+  // disable autotuning that could otherwise grow beyond them.
+  const auto sendLimit = readSocketBufferLimit("/proc/sys/net/core/wmem_max");
+  const auto recvLimit = readSocketBufferLimit("/proc/sys/net/core/rmem_max");
+  if ((sendLimit > 0 && size > sendLimit) ||
+      (recvLimit > 0 && size > recvLimit)) {
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true)) {
+      fprintf(
+          stderr,
+          "gloo: socket buffer size of %zu bytes exceeds "
+          "net.core.wmem_max (%zu) or net.core.rmem_max (%zu); "
+          "leaving socket buffers to autotuning\n",
+          size,
+          sendLimit,
+          recvLimit);
+    }
+    return;
+  }
+
+  socketOptions_.sendBufferSize = setSocketBufferSize(fd, SO_SNDBUF, size);
+  socketOptions_.recvBufferSize = setSocketBufferSize(fd, SO_RCVBUF, size);
+}
+
+void Pair::applyTuning() {
+  const auto& tuning = device_->attr_.tuning;
+  int rv;
+
+  // The kernel keeps a smoothed round trip time estimate for every
+  // connection. Right after connecting it is based on the handshake.
+  // It is too late to size the buffers of this connection with it,
+  // but pairs connected later on the same device use it.
+  struct tcp_info info;
+  socklen_t optlen = sizeof(info);
+  memset(&info, 0, sizeof(info));
+  rv = getsockopt(fd_, IPPROTO_TCP, TCP_INFO, &info, &optlen);
+  GLOO_ENFORCE_NE(rv, -1, strerror(errno));
+  socketOptions_.rtt = std::chrono::microseconds(info.tcpi_rtt);
+  device_->updateMeasuredRtt(socketOptions_.rtt);
+
+  // Report the sizes of the connected socket. An accepted socket
+  // inherits them from the listening socket.
+  if (socketOptions_.sendBufferSize > 0) {
+    socketOptions_.sendBufferSize = getSocketBufferSize(fd_, SO_SNDBUF);
+    socketOptions_.recvBufferSize = getSocketBufferSize(fd_, SO_RCVBUF);
+    sendBufferSize_ = socketOptions_.sendBufferSize;
+  }
+
+  // The receive low watermark is updated per read (see read).
+  socketOptions_.recvLowWatermark = tuning.recvLowWatermark;
+
+#ifdef TCP_NOTSENT_LOWAT
+  if (tuning.notSentLowWatermark > 0) {
+    int optval = tuning.notSentLowWatermark;
+    rv = setsockopt(
+        fd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &optval, sizeof(optval));
+    GLOO_ENFORCE_NE(rv, -1, strerror(errno));
+    socketOptions_.notSentLowWatermark = optval;
+  }
+#endif
+
+#ifdef SO_BUSY_POLL
+  if (tuning.busyPollMicroseconds > 0) {
+    // Requires CAP_NET_ADMIN when exceeding the system default.
+    // Not being able to busy poll is not a reason to fail.
+    int optval = tuning.busyPollMicroseconds;
+    rv = setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &optval, sizeof(optval));
+    if (rv == 0) {
+      socketOptions_.busyPollMicroseconds = optval;
+    }
+  }
+#endif
+}
+
+void Pair::updateRecvLowWatermark(size_t nbytes) {
+  const auto limit = device_->attr_.tuning.recvLowWatermark;
+  if (limit <= 0 || sync_) {
+    return;
+  }
+
+  // Only raise the watermark if at least that many bytes remain to be
+  // read for the current op, or the event loop could wait for bytes
+  // that never arrive. Small reads keep the default of 1 byte, so
+  // they don't incur any additional system calls.
+  int optval = 1;
+  if (nbytes >= (size_t)limit) {
+    optval = limit;
+  }
+  if (optval == recvLowWatermark_) {
+    return;
+  }
+
+  auto rv = setsockopt(fd_, SOL_SOCKET, SO_RCVLOWAT, &optval, sizeof(optval));
+  GLOO_ENFORCE_NE(rv, -1, strerror(errno));
+  recvLowWatermark_ = optval;
+}
+
+SocketOptions Pair::getSocketOptions() {
+  std::lock_guard<std::mutex> lock(m_);
+  return socketOptions_;
+}
+
+std::string SocketOptions::str() const {
+  std::stringstream ss;
+  ss << "rtt=" << rtt.count() << "us";
+  ss << ", expected_rtt=" << expectedRtt.count() << "us";
+  ss << ", bandwidth=" << bandwidthMbps << "Mbps";
+  ss << ", bdp=" << bdp;
+  ss << ", sndbuf=" << sendBufferSize;
+  ss << ", rcvbuf=" << recvBufferSize;
+  ss << ", rcvlowat=" << recvLowWatermark;
+  ss << ", notsent_lowat=" << notSentLowWatermark;
+  ss << ", busy_poll=" << busyPollMicroseconds;
+  return ss.str();
+}
+
 // getBuffer must only be called when holding lock.
 Buffer* Pair::getBuffer(int slot) {
   for (;;) {
@@ -1014,8 +1205,11 @@ void Pair::send(Op& op) {
 
   // Try to size the send buffer such that the write below completes
   // synchronously and we don't need to finish the write later.
+  // If the device has a tuning profile, the send buffer has already
+  // been sized to the bandwidth-delay product, or left to autotuning,
+  // and is left alone.
   size_t size = std::min(op.preamble.nbytes, kMaxSendBufferSize);
-  if (sendBufferSize_ < size) {
+  if (!device_->attr_.tuning.enabled && sendBufferSize_ < size) {
     int rv;
     size_t optval = size;
     socklen_t optlen = sizeof(optval);
@@ -79,6 +79,37 @@ struct Op {
   size_t nbytes = 0;
 };
 
+// Socket options chosen for a pair by the tuning profile of its
+// device (see struct tuning in attr.h).
+struct SocketOptions {
+  // Round trip time of the connection, measured when it was established.
+  std::chrono::microseconds rtt{0};
+
+  // Round trip time used to compute the bandwidth-delay product.
+  // This is known before connecting (see struct tuning in attr.h).
+  std::chrono::microseconds expectedRtt{0};
+
+  // Bandwidth used to compute the bandwidth-delay product.
+  int bandwidthMbps = 0;
+
+  // Bandwidth-delay product in bytes.
+  size_t bdp = 0;
+
+  // Effective socket buffer sizes as reported by getsockopt(2).
+  // Note that the kernel doubles the requested value to allow
+  // space for bookkeeping overhead (see socket(7)). Zero if the
+  // size was left to the kernel's autotuning.
+  size_t sendBufferSize = 0;
+  size_t recvBufferSize = 0;
+
+  // Zero if the option was not set.
+  int recvLowWatermark = 0;
+  int notSentLowWatermark = 0;
+  int busyPollMicroseconds = 0;
+
+  std::string str() const;
+};
+
 class Pair : public ::gloo::transport::Pair, public Handler {
  protected:
   enum state {
@@ -145,6 +176,10 @@ class Pair : public ::gloo::transport::Pair, public Handler {
 
   void close() override;
 
+  // Returns the socket options that were chosen for this pair when it
+  // connected. All fields are zero if the device has no tuning profile.
+  SocketOptions getSocketOptions();
+
  protected:
   // Refer to parent context using raw pointer. This could be a
   // weak_ptr, seeing as the context class is a shared_ptr, but:
@@ -168,6 +203,11 @@ class Pair : public ::gloo::transport::Pair, public Handler {
   int fd_;
   size_t sendBufferSize_;
 
+  // Socket options chosen by the tuning profile and the SO_RCVLOWAT
+  // value that is currently applied to the socket.
+  SocketOptions socketOptions_;
+  int recvLowWatermark_;
+
   Address self_;
   Address peer_;
   bool is_client_;
@@ -299,6 +339,19 @@ class Pair : public ::gloo::transport::Pair, public Handler {
   // Helper function called from `handleListening` or `handleConnecting`.
   void handleConnected();
 
+  // Sizes the socket buffers per the device's tuning profile.
+  // Called on the listening socket (accepted sockets inherit the
+  // sizes) and on the connecting socket, before connecting.
+  void applyBufferSizes(int fd);
+
+  // Applies the remainder of the device's tuning profile to the
+  // connected socket. Called from `handleConnected`.
+  void applyTuning();
+
+  // Adjusts SO_RCVLOWAT such that the event loop is only woken up
+  // when the remainder of the current read can make progress.
+  void updateRecvLowWatermark(size_t nbytes);
+
   // Advances this pair's state. See the `Pair::state` enum for
   // possible states. State can only move forward, i.e. from
   // initializing, to connected, to closed.
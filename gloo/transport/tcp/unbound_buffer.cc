@@ -33,10 +33,13 @@ UnboundBuffer::UnboundBuffer(
 UnboundBuffer::~UnboundBuffer() {}
 
 void UnboundBuffer::handleRecvCompletion(int rank) {
-  std::lock_guard<std::mutex> lock(m_);
-  recvCompletions_++;
-  recvRank_ = rank;
-  recvCv_.notify_one();
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    recvCompletions_++;
+    recvRank_ = rank;
+    recvCv_.notify_one();
+  }
+  notifyCompletion();
 }
 
 void UnboundBuffer::abortWaitRecv() {
@@ -97,10 +100,13 @@ bool UnboundBuffer::waitRecv(int* rank, std::chrono::milliseconds timeout) {
 }
 
 void UnboundBuffer::handleSendCompletion(int rank) {
-  std::lock_guard<std::mutex> lock(m_);
-  sendCompletions_++;
-  sendRank_ = rank;
-  sendCv_.notify_one();
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    sendCompletions_++;
+    sendRank_ = rank;
+    sendCv_.notify_one();
+  }
+  notifyCompletion();
 }
 
 bool UnboundBuffer::waitSend(int* rank, std::chrono::milliseconds timeout) {
@@ -149,6 +155,32 @@ bool UnboundBuffer::waitSend(int* rank, std::chrono::milliseconds timeout) {
   return true;
 }
 
+bool UnboundBuffer::testRecv(int* rank) {
+  std::lock_guard<std::mutex> guard(m_);
+  throwIfException();
+  if (recvCompletions_ == 0) {
+    return false;
+  }
+  recvCompletions_--;
+  if (rank != nullptr) {
+    *rank = recvRank_;
+  }
+  return true;
+}
+
+bool UnboundBuffer::testSend(int* rank) {
+  std::lock_guard<std::mutex> guard(m_);
+  throwIfException();
+  if (sendCompletions_ == 0) {
+    return false;
+  }
+  sendCompletions_--;
+  if (rank != nullptr) {
+    *rank = sendRank_;
+  }
+  return true;
+}
+
 void UnboundBuffer::send(
     int dstRank,
     uint64_t slot,
@@ -192,10 +224,13 @@ void UnboundBuffer::recv(
 }
 
 void UnboundBuffer::signalException(std::exception_ptr ex) {
-  std::lock_guard<std::mutex> lock(m_);
-  ex_ = std::move(ex);
-  recvCv_.notify_all();
-  sendCv_.notify_all();
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    ex_ = std::move(ex);
+    recvCv_.notify_all();
+    sendCv_.notify_all();
+  }
+  notifyCompletion();
 }
 
 void UnboundBuffer::throwIfException() {
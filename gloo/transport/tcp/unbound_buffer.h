@@ -40,6 +40,10 @@ class UnboundBuffer : public ::gloo::transport::UnboundBuffer {
   // Returns true if it completed, false if it was aborted.
   bool waitSend(int* rank, std::chrono::milliseconds timeout) override;
 
+  bool testRecv(int* rank) override;
+
+  bool testSend(int* rank) override;
+
   // Aborts a pending waitRecv call.
   void abortWaitRecv() override;
 
@@ -8,11 +8,51 @@
 
 #include "gloo/transport/unbound_buffer.h"
 
+#include <utility>
+
 namespace gloo {
 namespace transport {
 
+uint64_t CompletionSignal::generation() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return generation_;
+}
+
+void CompletionSignal::notify() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    generation_++;
+  }
+  cv_.notify_all();
+}
+
+bool CompletionSignal::wait(
+    uint64_t generation,
+    std::chrono::steady_clock::time_point deadline) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return cv_.wait_until(
+      lock, deadline, [&] { return generation_ != generation; });
+}
+
 // Have to provide implementation for pure virtual destructor.
 UnboundBuffer::~UnboundBuffer() {}
 
+void UnboundBuffer::setCompletionSignal(
+    std::shared_ptr<CompletionSignal> signal) {
+  std::lock_guard<std::mutex> guard(signalMutex_);
+  signal_ = std::move(signal);
+}
+
+void UnboundBuffer::notifyCompletion() {
+  std::shared_ptr<CompletionSignal> signal;
+  {
+    std::lock_guard<std::mutex> guard(signalMutex_);
+    signal = signal_;
+  }
+  if (signal) {
+    signal->notify();
+  }
+}
+
 } // namespace transport
 } // namespace gloo
@@ -9,9 +9,12 @@
 #pragma once
 
 #include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace gloo {
@@ -19,6 +22,30 @@ namespace transport {
 
 constexpr auto kUnsetTimeout = std::chrono::milliseconds(-1);
 
+// Notified whenever an operation on one of the unbound buffers it is
+// attached to completes or fails. This lets a single thread wait for
+// the first of the operations on many buffers to complete.
+class CompletionSignal {
+ public:
+  CompletionSignal() : generation_(0) {}
+
+  // Returns value that changes every time the signal is notified.
+  uint64_t generation() const;
+
+  void notify();
+
+  // Waits until the signal is notified after the specified generation
+  // was returned, or until the deadline. Returns false on timeout.
+  bool wait(
+      uint64_t generation,
+      std::chrono::steady_clock::time_point deadline);
+
+ protected:
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  uint64_t generation_;
+};
+
 // The unbound buffer class represents a chunk of memory.
 // It can either be used as a source for send operations or a
 // destination for receive operations, or both. There should only be a
@@ -45,6 +72,14 @@ class UnboundBuffer {
   // Returns true if it completed, false if it was aborted.
   virtual bool waitSend(int* rank, std::chrono::milliseconds timeout) = 0;
 
+  // Non-blocking variant of waitRecv. Returns true if a recv operation
+  // has completed (and consumes that completion), false otherwise.
+  virtual bool testRecv(int* rank = nullptr) = 0;
+
+  // Non-blocking variant of waitSend. Returns true if a send operation
+  // has completed (and consumes that completion), false otherwise.
+  virtual bool testSend(int* rank = nullptr) = 0;
+
   // Aborts a pending waitRecv call.
   virtual void abortWaitRecv() = 0;
 
@@ -117,6 +152,18 @@ class UnboundBuffer {
       uint64_t slot,
       size_t offset = 0,
       size_t nbytes = kUnspecifiedByteCount) = 0;
+
+  // Attaches signal that is notified when an operation on this buffer
+  // completes or fails. Replaces the signal that was attached before.
+  void setCompletionSignal(std::shared_ptr<CompletionSignal> signal);
+
+ protected:
+  // Called by the transport after an operation completed or failed.
+  void notifyCompletion();
+
+ private:
+  std::mutex signalMutex_;
+  std::shared_ptr<CompletionSignal> signal_;
 };
 
 } // namespace transport
@@ -33,10 +33,13 @@ UnboundBuffer::UnboundBuffer(
 UnboundBuffer::~UnboundBuffer() {}
 
 void UnboundBuffer::handleRecvCompletion(int rank) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  recvCompletions_++;
-  recvRank_ = rank;
-  recvCv_.notify_one();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recvCompletions_++;
+    recvRank_ = rank;
+    recvCv_.notify_one();
+  }
+  notifyCompletion();
 }
 
 void UnboundBuffer::abortWaitRecv() {
@@ -81,10 +84,13 @@ bool UnboundBuffer::waitRecv(int* rank, std::chrono::milliseconds timeout) {
 }
 
 void UnboundBuffer::handleSendCompletion(int rank) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  sendCompletions_++;
-  sendRank_ = rank;
-  sendCv_.notify_one();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sendCompletions_++;
+    sendRank_ = rank;
+    sendCv_.notify_one();
+  }
+  notifyCompletion();
 }
 
 bool UnboundBuffer::waitSend(int* rank, std::chrono::milliseconds timeout) {
@@ -116,6 +122,30 @@ bool UnboundBuffer::waitSend(int* rank, std::chrono::milliseconds timeout) {
   return true;
 }
 
+bool UnboundBuffer::testRecv(int* rank) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (recvCompletions_ == 0) {
+    return false;
+  }
+  recvCompletions_--;
+  if (rank != nullptr) {
+    *rank = recvRank_;
+  }
+  return true;
+}
+
+bool UnboundBuffer::testSend(int* rank) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (sendCompletions_ == 0) {
+    return false;
+  }
+  sendCompletions_--;
+  if (rank != nullptr) {
+    *rank = sendRank_;
+  }
+  return true;
+}
+
 void UnboundBuffer::send(
     int dstRank,
     uint64_t slot,
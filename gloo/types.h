@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstring>
 #include <iostream>
 
 #ifdef __CUDA_ARCH__
@@ -338,4 +339,156 @@ inline float cpu_half2float(float16 h) {
   return *(float*)rp;
 }
 
+// Brain floating point: the upper half of an IEEE single precision
+// float. It has the same range as float, but only 8 bits of precision.
+struct bfloat16;
+bfloat16 cpu_float2bfloat16_rn(float f);
+float cpu_bfloat162float(bfloat16 h);
+
+struct alignas(2) bfloat16 {
+  uint16_t x;
+
+  bfloat16() : x(0) {}
+
+  bfloat16(const bfloat16&) = default;
+
+  explicit bfloat16(int val) {
+    x = cpu_float2bfloat16_rn(static_cast<float>(val)).x;
+  }
+
+  explicit bfloat16(unsigned long val) {
+    x = cpu_float2bfloat16_rn(static_cast<float>(val)).x;
+  }
+
+  explicit bfloat16(unsigned long long val) {
+    x = cpu_float2bfloat16_rn(static_cast<float>(val)).x;
+  }
+
+  explicit bfloat16(double val) {
+    x = cpu_float2bfloat16_rn(static_cast<float>(val)).x;
+  }
+
+  bfloat16& operator=(const int& rhs) {
+    x = cpu_float2bfloat16_rn(static_cast<float>(rhs)).x;
+    return *this;
+  }
+
+  bfloat16& operator=(const bfloat16& rhs) = default;
+
+  bool operator==(const bfloat16& rhs) const {
+    return x == rhs.x;
+  }
+
+  bool operator!=(const bfloat16& rhs) const {
+    return !(*this == rhs);
+  }
+
+  bool operator==(const int& rhs) const {
+    return x == cpu_float2bfloat16_rn(static_cast<float>(rhs)).x;
+  }
+
+  bool operator==(const unsigned long& rhs) const {
+    return x == cpu_float2bfloat16_rn(static_cast<float>(rhs)).x;
+  }
+
+  bool operator==(const double& rhs) const {
+    return x == cpu_float2bfloat16_rn(static_cast<float>(rhs)).x;
+  }
+
+  bfloat16& operator+=(const bfloat16& rhs) {
+    *this = cpu_float2bfloat16_rn(
+        cpu_bfloat162float(*this) + cpu_bfloat162float(rhs));
+    return *this;
+  }
+
+  bfloat16& operator-=(const bfloat16& rhs) {
+    *this = cpu_float2bfloat16_rn(
+        cpu_bfloat162float(*this) - cpu_bfloat162float(rhs));
+    return *this;
+  }
+
+  bfloat16& operator*=(const bfloat16& rhs) {
+    *this = cpu_float2bfloat16_rn(
+        cpu_bfloat162float(*this) * cpu_bfloat162float(rhs));
+    return *this;
+  }
+
+  bfloat16& operator/=(const bfloat16& rhs) {
+    *this = cpu_float2bfloat16_rn(
+        cpu_bfloat162float(*this) / cpu_bfloat162float(rhs));
+    return *this;
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& stream, const bfloat16& val) {
+  stream << cpu_bfloat162float(val);
+  return stream;
+}
+
+inline bfloat16 operator+(const bfloat16& lhs, const bfloat16& rhs) {
+  bfloat16 result = lhs;
+  result += rhs;
+  return result;
+}
+
+inline bfloat16 operator-(const bfloat16& lhs, const bfloat16& rhs) {
+  bfloat16 result = lhs;
+  result -= rhs;
+  return result;
+}
+
+inline bfloat16 operator*(const bfloat16& lhs, const bfloat16& rhs) {
+  bfloat16 result = lhs;
+  result *= rhs;
+  return result;
+}
+
+inline bfloat16 operator/(const bfloat16& lhs, const bfloat16& rhs) {
+  bfloat16 result = lhs;
+  result /= rhs;
+  return result;
+}
+
+inline bool operator<(const bfloat16& lhs, const bfloat16& rhs) {
+  return cpu_bfloat162float(lhs) < cpu_bfloat162float(rhs);
+}
+
+inline bool operator<=(const bfloat16& lhs, const bfloat16& rhs) {
+  return cpu_bfloat162float(lhs) <= cpu_bfloat162float(rhs);
+}
+
+inline bool operator>(const bfloat16& lhs, const bfloat16& rhs) {
+  return cpu_bfloat162float(lhs) > cpu_bfloat162float(rhs);
+}
+
+inline bool operator>=(const bfloat16& lhs, const bfloat16& rhs) {
+  return cpu_bfloat162float(lhs) >= cpu_bfloat162float(rhs);
+}
+
+// Rounds to nearest even. NaNs stay NaNs (quiet, with the same sign).
+inline bfloat16 cpu_float2bfloat16_rn(float f) {
+  static_assert(
+      sizeof(unsigned int) == sizeof(float),
+      "Programming error sizeof(unsigned int) != sizeof(float)");
+
+  bfloat16 ret;
+  unsigned x;
+  std::memcpy(&x, &f, sizeof(x));
+  if ((x & 0x7fffffff) > 0x7f800000) {
+    ret.x = static_cast<uint16_t>((x >> 16) | 0x40);
+    return ret;
+  }
+
+  x += 0x7fff + ((x >> 16) & 1);
+  ret.x = static_cast<uint16_t>(x >> 16);
+  return ret;
+}
+
+inline float cpu_bfloat162float(bfloat16 h) {
+  const unsigned temp = static_cast<unsigned>(h.x) << 16;
+  float result;
+  std::memcpy(&result, &temp, sizeof(result));
+  return result;
+}
+
 } // namespace gloo
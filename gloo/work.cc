@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "gloo/work.h"
+
+#include "gloo/common/error.h"
+
+namespace gloo {
+
+constexpr size_t ProgressEngine::kDefaultMaxThreads;
+
+Work::Work(std::function<void()> fn) : state_(PENDING), fn_(std::move(fn)) {}
+
+Work::~Work() {}
+
+void Work::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [&] { return state_ != PENDING && state_ != RUNNING; });
+  if (state_ == FAILED) {
+    std::rethrow_exception(ex_);
+  }
+  if (state_ == CANCELLED) {
+    GLOO_THROW("Operation was cancelled");
+  }
+}
+
+bool Work::test() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return state_ != PENDING && state_ != RUNNING;
+}
+
+bool Work::cancel() {
+  std::function<void()> fn;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ != PENDING) {
+      return false;
+    }
+    state_ = CANCELLED;
+    fn = std::move(fn_);
+    fn_ = nullptr;
+  }
+  cv_.notify_all();
+  return true;
+}
+
+void Work::run() {
+  if (!start()) {
+    return;
+  }
+
+  // No longer accessed by cancel() once the operation is running.
+  std::function<void()> fn = std::move(fn_);
+  fn_ = nullptr;
+
+  std::exception_ptr ex;
+  try {
+    fn();
+  } catch (...) {
+    ex = std::current_exception();
+  }
+
+  // Destroy the operation (and the options it owns) before signaling
+  // completion, so that the caller is the sole owner of its buffers
+  // and context once wait() returns.
+  fn = nullptr;
+  complete(ex);
+}
+
+bool Work::start() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (state_ == CANCELLED) {
+    return false;
+  }
+  state_ = RUNNING;
+  return true;
+}
+
+void Work::complete(std::exception_ptr ex) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    state_ = ex ? FAILED : COMPLETED;
+    ex_ = ex;
+  }
+  cv_.notify_all();
+}
+
+ProgressEngine::ProgressEngine(size_t maxThreads)
+    : maxThreads_(maxThreads), idle_(0), done_(false) {}
+
+ProgressEngine::~ProgressEngine() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    done_ = true;
+  }
+  cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::shared_ptr<Work> ProgressEngine::enqueue(std::function<void()> fn) {
+  auto work = std::shared_ptr<Work>(new Work(std::move(fn)));
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    queue_.push_back(work);
+
+    // Every queued operation needs an idle thread to start executing.
+    if (idle_ < queue_.size() &&
+        (maxThreads_ == 0 || threads_.size() < maxThreads_)) {
+      threads_.emplace_back(&ProgressEngine::loop, this);
+    }
+  }
+  cv_.notify_one();
+  return work;
+}
+
+size_t ProgressEngine::threads() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return threads_.size();
+}
+
+void ProgressEngine::setMaxThreads(size_t maxThreads) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    maxThreads_ = maxThreads;
+
+    // Every queued operation needs an idle thread to start executing.
+    for (auto i = idle_; i < queue_.size(); i++) {
+      if (maxThreads_ != 0 && threads_.size() >= maxThreads_) {
+        break;
+      }
+      threads_.emplace_back(&ProgressEngine::loop, this);
+    }
+  }
+  cv_.notify_all();
+}
+
+size_t ProgressEngine::getMaxThreads() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return maxThreads_;
+}
+
+ProgressEngine& ProgressEngine::getDefault() {
+  // Leaked on purpose: operations may still be executing when static
+  // destructors run.
+  static ProgressEngine* engine = new ProgressEngine(kDefaultMaxThreads);
+  return *engine;
+}
+
+void ProgressEngine::loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    idle_++;
+    cv_.wait(lock, [&] { return done_ || !queue_.empty(); });
+    idle_--;
+
+    // Only exit when there is nothing left to execute.
+    if (queue_.empty()) {
+      break;
+    }
+
+    auto work = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    work->run();
+    work.reset();
+    lock.lock();
+  }
+}
+
+} // namespace gloo
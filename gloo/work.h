@@ -0,0 +1,171 @@
+/**
+ * Copyright (c) 2020-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gloo {
+
+// Forward declarations
+class ProgressEngine;
+class Scheduler;
+
+// Handle to a collective that executes asynchronously.
+//
+// Instances are returned by the non-blocking variants of the
+// collectives (e.g. iallreduce). The options passed to such a function
+// are owned by the operation until it has completed or was cancelled.
+// This means the buffers it refers to must stay valid until then.
+//
+class Work {
+ public:
+  ~Work();
+
+  Work(const Work&) = delete;
+
+  Work& operator=(const Work&) = delete;
+
+  // Waits for the operation to complete. Rethrows the exception thrown
+  // by the operation if it failed, or throws if it was cancelled.
+  void wait();
+
+  // Returns true if the operation has completed, failed, or was
+  // cancelled. Does not block and does not throw.
+  bool test();
+
+  // Cancels the operation if it has not started executing yet.
+  // Returns true if it was cancelled. An operation that has started
+  // executing runs to completion (or times out).
+  bool cancel();
+
+ protected:
+  enum State {
+    PENDING,
+    RUNNING,
+    COMPLETED,
+    FAILED,
+    CANCELLED,
+  };
+
+  explicit Work(std::function<void()> fn);
+
+  // Called by the progress engine.
+  void run();
+
+  // Marks the operation as running. Returns false if it was cancelled.
+  bool start();
+
+  // Marks the operation as completed (or failed, if an exception is
+  // specified) and wakes up waiters.
+  void complete(std::exception_ptr ex);
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  State state_;
+  std::exception_ptr ex_;
+
+  // Released as soon as the operation no longer needs it, so that the
+  // options (and with it the context) are not kept alive by handles.
+  std::function<void()> fn_;
+
+  friend class ProgressEngine;
+  friend class Scheduler;
+};
+
+// Pool of threads that execute asynchronous collectives.
+//
+// Operations are started in the order they are queued. A thread is
+// added to the pool whenever an operation is queued and no thread is
+// idle, up to the configured maximum. Threads are reused, so the
+// number of threads is also bounded by the number of operations that
+// are in flight at the same time.
+//
+// The collectives block on their I/O. With a limit on the number of
+// threads, operations that are executing can therefore deadlock if
+// they depend on operations that are still queued. Operations with
+// different tags are independent, so ranks may queue them in different
+// orders. If more operations than the limit are in flight, the ones
+// that one rank is executing can all wait for operations that another
+// rank has queued behind its own executing operations, even if every
+// rank has its own process. The same happens if different ranks run in
+// the same process. To avoid this, every rank must queue operations in
+// the same order, or keep the number of operations in flight at or
+// below the limit, or raise the limit (see setMaxThreads).
+//
+// The allreduce doesn't use this engine by default; it makes progress
+// without blocking a thread per operation (see iallreduce in
+// gloo/allreduce.h). The other non-blocking collectives (e.g.
+// ibroadcast, ireduce, isparseAllreduce) still block one thread per
+// operation. Moving them to the scheduler is left as follow-up work.
+//
+class ProgressEngine {
+ public:
+  // Maximum number of threads of the default engine.
+  static constexpr size_t kDefaultMaxThreads = 64;
+
+  // A maximum of zero means there is no limit on the number of threads.
+  explicit ProgressEngine(size_t maxThreads = 0);
+
+  // Waits for all queued operations to complete.
+  ~ProgressEngine();
+
+  ProgressEngine(const ProgressEngine&) = delete;
+
+  ProgressEngine& operator=(const ProgressEngine&) = delete;
+
+  std::shared_ptr<Work> enqueue(std::function<void()> fn);
+
+  // Number of threads in this pool.
+  size_t threads() const;
+
+  // Changes the maximum number of threads. Raising it starts threads
+  // for operations that are already queued. Lowering it does not stop
+  // threads that already exist.
+  void setMaxThreads(size_t maxThreads);
+
+  size_t getMaxThreads() const;
+
+  // Engine used by the non-blocking collectives. It has at most
+  // kDefaultMaxThreads threads (unless changed with setMaxThreads) and
+  // lives for the duration of the process.
+  static ProgressEngine& getDefault();
+
+ protected:
+  size_t maxThreads_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::shared_ptr<Work>> queue_;
+  std::vector<std::thread> threads_;
+  size_t idle_;
+  bool done_;
+
+  void loop();
+};
+
+namespace detail {
+
+// Runs fn(opts) on the default progress engine. The options are moved
+// into the operation because the caller may return before it runs.
+template <typename Options, typename Fn>
+std::shared_ptr<Work> enqueue(Options&& opts, Fn fn) {
+  auto ptr = std::make_shared<Options>(std::move(opts));
+  return ProgressEngine::getDefault().enqueue([ptr, fn]() { fn(*ptr); });
+}
+
+} // namespace detail
+
+} // namespace gloo